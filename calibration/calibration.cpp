@@ -0,0 +1,619 @@
+/*******************************************************************************
+ Frame Calibration
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "calibration.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CALIBRATION_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CALIBRATION_NEON
+#endif
+
+namespace Calibration
+{
+
+// FITS files are made of 2880 byte blocks of 80 character header cards
+static const size_t FITS_BLOCK = 2880;
+static const size_t FITS_CARD = 80;
+
+// Frames smaller than this per thread are not worth the thread start up.
+static const size_t MIN_PIXELS_PER_THREAD = 256 * 1024;
+
+Master::~Master()
+{
+    if (map != nullptr)
+        munmap(map, mapLength);
+}
+
+static inline uint32_t loadBE32(const uint8_t *p)
+{
+    return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 | static_cast<uint32_t>(p[2]) << 8 | p[3];
+}
+
+double Master::pixel(size_t i) const
+{
+    double value = 0;
+    switch (bitpix)
+    {
+        case 8:
+            value = data[i];
+            break;
+        case 16:
+            value = static_cast<int16_t>(data[i * 2] << 8 | data[i * 2 + 1]);
+            break;
+        case 32:
+            value = static_cast<int32_t>(loadBE32(data + i * 4));
+            break;
+        case -32:
+        {
+            uint32_t bits = loadBE32(data + i * 4);
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            value = f;
+            break;
+        }
+    }
+    return bzero + bscale * value;
+}
+
+static std::string trim(const std::string &s)
+{
+    size_t begin = s.find_first_not_of(' ');
+    size_t end = s.find_last_not_of(' ');
+    return begin == std::string::npos ? std::string() : s.substr(begin, end - begin + 1);
+}
+
+static std::string lower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c)
+    {
+        return std::tolower(c);
+    });
+    return s;
+}
+
+// Value of a "KEYWORD = value / comment" card, quotes removed from strings
+static std::string cardValue(const char *card)
+{
+    std::string value(card + 10, FITS_CARD - 10);
+    size_t start = value.find_first_not_of(' ');
+    if (start != std::string::npos && value[start] == '\'')
+    {
+        size_t end = value.find('\'', start + 1);
+        return trim(value.substr(start + 1, end == std::string::npos ? std::string::npos : end - start - 1));
+    }
+    return trim(value.substr(0, value.find('/')));
+}
+
+std::unique_ptr<Master> mapMaster(const std::string &path, std::string &error)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = path + ": " + strerror(errno);
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(FITS_BLOCK))
+    {
+        error = path + ": not a FITS file";
+        ::close(fd);
+        return nullptr;
+    }
+
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+    {
+        error = path + ": " + strerror(errno);
+        return nullptr;
+    }
+
+    std::unique_ptr<Master> master(new Master());
+    master->path = path;
+    master->map = map;
+    master->mapLength = st.st_size;
+
+    const char *header = static_cast<const char *>(map);
+    if (strncmp(header, "SIMPLE  =", 9) != 0 || cardValue(header) != "T")
+    {
+        error = path + ": not a FITS file";
+        return nullptr;
+    }
+
+    int naxis = 0;
+    long axes[3] = {0, 0, 1};
+    std::string imageType;
+    bool haveExposure = false;
+    size_t card = 0;
+    for (;; card++)
+    {
+        if ((card + 1) * FITS_CARD > master->mapLength)
+        {
+            error = path + ": truncated header";
+            return nullptr;
+        }
+
+        const char *c = header + card * FITS_CARD;
+        std::string keyword = trim(std::string(c, 8));
+        if (keyword == "END")
+            break;
+        if (c[8] != '=')
+            continue;
+
+        std::string value = cardValue(c);
+        if (keyword == "BITPIX")
+            master->bitpix = atoi(value.c_str());
+        else if (keyword == "NAXIS")
+            naxis = atoi(value.c_str());
+        else if (keyword == "NAXIS1")
+            axes[0] = atol(value.c_str());
+        else if (keyword == "NAXIS2")
+            axes[1] = atol(value.c_str());
+        else if (keyword == "NAXIS3")
+            axes[2] = atol(value.c_str());
+        else if (keyword == "BZERO")
+            master->bzero = atof(value.c_str());
+        else if (keyword == "BSCALE")
+            master->bscale = atof(value.c_str());
+        else if (keyword == "IMAGETYP" || keyword == "FRAME")
+            imageType = lower(value);
+        else if (keyword == "EXPTIME" || (keyword == "EXPOSURE" && !haveExposure))
+        {
+            master->key.exposure = atof(value.c_str());
+            haveExposure = true;
+        }
+        else if (keyword == "GAIN")
+            master->key.gain = atof(value.c_str());
+        else if (keyword == "CCD-TEMP")
+            master->key.temperature = atof(value.c_str());
+    }
+
+    if (naxis != 2 && naxis != 3)
+    {
+        error = path + ": not an uncompressed 2D or 3D image";
+        return nullptr;
+    }
+    if (master->bitpix != 8 && master->bitpix != 16 && master->bitpix != 32 && master->bitpix != -32)
+    {
+        error = path + ": unsupported BITPIX " + std::to_string(master->bitpix);
+        return nullptr;
+    }
+
+    // "Dark Flat" and "DARKFLAT" hold both words, so they are told apart before either
+    bool isDark = imageType.find("dark") != std::string::npos;
+    bool isFlat = imageType.find("flat") != std::string::npos;
+    if (imageType.find("bias") != std::string::npos || imageType.find("offset") != std::string::npos)
+        master->type = FrameType::Bias;
+    else if (isDark && isFlat)
+        master->type = FrameType::DarkFlat;
+    else if (isFlat)
+        master->type = FrameType::Flat;
+    else if (isDark)
+        master->type = FrameType::Dark;
+    else
+    {
+        error = path + ": not a bias, dark or flat frame";
+        return nullptr;
+    }
+
+    master->width = axes[0];
+    master->height = axes[1];
+    master->channels = axes[2];
+
+    size_t dataOffset = ((card + 1) * FITS_CARD + FITS_BLOCK - 1) / FITS_BLOCK * FITS_BLOCK;
+    size_t dataSize = static_cast<size_t>(master->width) * master->height * master->channels * std::abs(master->bitpix) / 8;
+    if (dataOffset + dataSize > master->mapLength)
+    {
+        error = path + ": truncated data";
+        return nullptr;
+    }
+    master->data = static_cast<const uint8_t *>(map) + dataOffset;
+
+    return master;
+}
+
+static void forChunks(size_t count, unsigned threads, const std::function<void(size_t, size_t)> &fn)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    size_t useful = count / MIN_PIXELS_PER_THREAD;
+    size_t workers = std::min<size_t>(threads, std::max<size_t>(useful, 1));
+    if (workers <= 1)
+    {
+        fn(0, count);
+        return;
+    }
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    // Chunks are multiples of 16 pixels so every vector loop starts aligned with the others
+    size_t chunk = ((count + workers - 1) / workers + 15) & ~static_cast<size_t>(15);
+    for (size_t begin = chunk; begin < count; begin += chunk)
+        pool.emplace_back(fn, begin, std::min(begin + chunk, count));
+
+    // The first chunk runs on the caller
+    fn(0, std::min(chunk, count));
+
+    for (auto &worker : pool)
+        worker.join();
+}
+
+static inline float calibrateOne(float v, const float *offset, const float *scale, size_t i, float maxValue)
+{
+    if (offset)
+        v -= offset[i];
+    if (scale)
+        v *= scale[i];
+    return std::min(std::max(v, 0.0f), maxValue) + 0.5f;
+}
+
+#if defined(CALIBRATION_SSE2)
+// Calibrate 8 pixels widened to 16 bits, the result is saturated to maxValue
+static inline __m128i calibrateVector(__m128i v, const float *offset, const float *scale, size_t i, __m128 maxValue)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+    __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero));
+    if (offset)
+    {
+        lo = _mm_sub_ps(lo, _mm_loadu_ps(offset + i));
+        hi = _mm_sub_ps(hi, _mm_loadu_ps(offset + i + 4));
+    }
+    if (scale)
+    {
+        lo = _mm_mul_ps(lo, _mm_loadu_ps(scale + i));
+        hi = _mm_mul_ps(hi, _mm_loadu_ps(scale + i + 4));
+    }
+    const __m128 half = _mm_set1_ps(0.5f);
+    lo = _mm_add_ps(_mm_min_ps(_mm_max_ps(lo, _mm_setzero_ps()), maxValue), half);
+    hi = _mm_add_ps(_mm_min_ps(_mm_max_ps(hi, _mm_setzero_ps()), maxValue), half);
+
+    // SSE2 has no unsigned 32 to 16 bit pack, so pack around the signed range
+    const __m128i bias32 = _mm_set1_epi32(32768);
+    __m128i packed = _mm_packs_epi32(_mm_sub_epi32(_mm_cvttps_epi32(lo), bias32),
+                                     _mm_sub_epi32(_mm_cvttps_epi32(hi), bias32));
+    return _mm_xor_si128(packed, _mm_set1_epi16(static_cast<short>(0x8000)));
+}
+#elif defined(CALIBRATION_NEON)
+static inline uint16x8_t calibrateVector(uint16x8_t v, const float *offset, const float *scale, size_t i,
+        float32x4_t maxValue)
+{
+    float32x4_t lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(v)));
+    float32x4_t hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(v)));
+    if (offset)
+    {
+        lo = vsubq_f32(lo, vld1q_f32(offset + i));
+        hi = vsubq_f32(hi, vld1q_f32(offset + i + 4));
+    }
+    if (scale)
+    {
+        lo = vmulq_f32(lo, vld1q_f32(scale + i));
+        hi = vmulq_f32(hi, vld1q_f32(scale + i + 4));
+    }
+    const float32x4_t zero = vdupq_n_f32(0.0f), half = vdupq_n_f32(0.5f);
+    lo = vaddq_f32(vminq_f32(vmaxq_f32(lo, zero), maxValue), half);
+    hi = vaddq_f32(vminq_f32(vmaxq_f32(hi, zero), maxValue), half);
+    return vcombine_u16(vmovn_u32(vcvtq_u32_f32(lo)), vmovn_u32(vcvtq_u32_f32(hi)));
+}
+#endif
+
+static void calibrateRange16(uint16_t *pixels, size_t begin, size_t end, const float *offset, const float *scale)
+{
+    size_t i = begin;
+#if defined(CALIBRATION_SSE2)
+    const __m128 maxValue = _mm_set1_ps(65535.0f);
+    for (; i + 8 <= end; i += 8)
+    {
+        __m128i *p = reinterpret_cast<__m128i *>(pixels + i);
+        _mm_storeu_si128(p, calibrateVector(_mm_loadu_si128(p), offset, scale, i, maxValue));
+    }
+#elif defined(CALIBRATION_NEON)
+    const float32x4_t maxValue = vdupq_n_f32(65535.0f);
+    for (; i + 8 <= end; i += 8)
+        vst1q_u16(pixels + i, calibrateVector(vld1q_u16(pixels + i), offset, scale, i, maxValue));
+#endif
+    for (; i < end; i++)
+        pixels[i] = static_cast<uint16_t>(calibrateOne(pixels[i], offset, scale, i, 65535.0f));
+}
+
+static void calibrateRange8(uint8_t *pixels, size_t begin, size_t end, const float *offset, const float *scale)
+{
+    size_t i = begin;
+#if defined(CALIBRATION_SSE2)
+    const __m128 maxValue = _mm_set1_ps(255.0f);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= end; i += 8)
+    {
+        __m128i *p = reinterpret_cast<__m128i *>(pixels + i);
+        __m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64(p), zero);
+        v = calibrateVector(v, offset, scale, i, maxValue);
+        _mm_storel_epi64(p, _mm_packus_epi16(v, v));
+    }
+#elif defined(CALIBRATION_NEON)
+    const float32x4_t maxValue = vdupq_n_f32(255.0f);
+    for (; i + 8 <= end; i += 8)
+        vst1_u8(pixels + i, vmovn_u16(calibrateVector(vmovl_u8(vld1_u8(pixels + i)), offset, scale, i, maxValue)));
+#endif
+    for (; i < end; i++)
+        pixels[i] = static_cast<uint8_t>(calibrateOne(pixels[i], offset, scale, i, 255.0f));
+}
+
+void calibrate16(uint16_t *pixels, size_t count, const float *offset, const float *scale, unsigned threads)
+{
+    if (offset == nullptr && scale == nullptr)
+        return;
+    forChunks(count, threads, [&](size_t begin, size_t end)
+    {
+        calibrateRange16(pixels, begin, end, offset, scale);
+    });
+}
+
+void calibrate8(uint8_t *pixels, size_t count, const float *offset, const float *scale, unsigned threads)
+{
+    if (offset == nullptr && scale == nullptr)
+        return;
+    forChunks(count, threads, [&](size_t begin, size_t end)
+    {
+        calibrateRange8(pixels, begin, end, offset, scale);
+    });
+}
+
+bool Library::Plan::same(const Plan &other) const
+{
+    return width == other.width && height == other.height && channels == other.channels && bias == other.bias &&
+           dark == other.dark && flat == other.flat && darkFlat == other.darkFlat && darkRatio == other.darkRatio;
+}
+
+size_t Library::open(const std::string &directory, std::string &error)
+{
+    std::vector<std::unique_ptr<Master>> masters;
+
+    DIR *dir = opendir(directory.c_str());
+    if (dir == nullptr)
+    {
+        error = directory + ": " + strerror(errno);
+        close();
+        return 0;
+    }
+
+    std::vector<std::string> names;
+    while (struct dirent *entry = readdir(dir))
+    {
+        std::string name = lower(entry->d_name);
+        size_t dot = name.rfind('.');
+        std::string extension = dot == std::string::npos ? std::string() : name.substr(dot);
+        if (extension == ".fits" || extension == ".fit" || extension == ".fts")
+            names.push_back(entry->d_name);
+    }
+    closedir(dir);
+
+    // Same order on every run, so equally good masters always resolve the same way
+    std::sort(names.begin(), names.end());
+    error.clear();
+    for (const auto &name : names)
+    {
+        std::string skipped;
+        auto master = mapMaster(directory + "/" + name, skipped);
+        if (master)
+            masters.push_back(std::move(master));
+        else if (error.empty())
+            error = skipped;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Plan.reset();
+    m_Masters = std::move(masters);
+    return m_Masters.size();
+}
+
+void Library::close()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Plan.reset();
+    m_Masters.clear();
+}
+
+size_t Library::size() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Masters.size();
+}
+
+const Master *Library::find(FrameType type, uint32_t width, uint32_t height, uint32_t channels, const FrameKey &key,
+                            bool nearestExposure) const
+{
+    const Master *best = nullptr;
+    double bestExposure = 0, bestTemperature = 0;
+
+    for (const auto &master : m_Masters)
+    {
+        if (master->type != type || master->width != width || master->height != height || master->channels != channels)
+            continue;
+
+        // Unknown values on either side are not held against a master
+        if (!std::isnan(key.gain) && !std::isnan(master->key.gain) && std::abs(key.gain - master->key.gain) > 0.5)
+            continue;
+
+        double temperature = 0;
+        if (!std::isnan(key.temperature) && !std::isnan(master->key.temperature))
+        {
+            temperature = std::abs(key.temperature - master->key.temperature);
+            if (type != FrameType::Flat && temperature > m_Options.temperatureTolerance)
+                continue;
+        }
+
+        double exposure = nearestExposure ? std::abs(key.exposure - master->key.exposure) : 0;
+        if (best == nullptr || exposure < bestExposure || (exposure == bestExposure && temperature < bestTemperature))
+        {
+            best = master.get();
+            bestExposure = exposure;
+            bestTemperature = temperature;
+        }
+    }
+
+    return best;
+}
+
+std::shared_ptr<const Library::Plan> Library::select(uint32_t width, uint32_t height, uint32_t channels,
+        const FrameKey &key)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    std::shared_ptr<Plan> plan(new Plan());
+    plan->width = width;
+    plan->height = height;
+    plan->channels = channels;
+    plan->bias = find(FrameType::Bias, width, height, channels, key, false);
+    plan->dark = find(FrameType::Dark, width, height, channels, key, true);
+    plan->flat = find(FrameType::Flat, width, height, channels, key, false);
+
+    // A dark flat only stands in for the bias at the exposure of the flat
+    if (plan->flat != nullptr)
+    {
+        plan->darkFlat = find(FrameType::DarkFlat, width, height, channels, plan->flat->key, true);
+        if (plan->darkFlat != nullptr && plan->flat->key.exposure > 0 &&
+                std::abs(plan->darkFlat->key.exposure / plan->flat->key.exposure - 1) > m_Options.exposureTolerance)
+            plan->darkFlat = nullptr;
+    }
+
+    // A dark at another exposure only holds once the bias is taken out of it
+    if (plan->dark != nullptr && key.exposure > 0 && plan->dark->key.exposure > 0)
+    {
+        double ratio = key.exposure / plan->dark->key.exposure;
+        if (std::abs(ratio - 1) > m_Options.exposureTolerance)
+        {
+            if (plan->bias != nullptr)
+                plan->darkRatio = ratio;
+            else
+                plan->dark = nullptr;
+        }
+    }
+
+    if (m_Plan && m_Plan->same(*plan))
+        return (m_Plan->offset.empty() && m_Plan->scale.empty()) ? nullptr : m_Plan;
+
+    const size_t count = static_cast<size_t>(width) * height * channels;
+
+    if (plan->dark != nullptr && plan->darkRatio == 1)
+    {
+        plan->offset.resize(count);
+        for (size_t i = 0; i < count; i++)
+            plan->offset[i] = plan->dark->pixel(i);
+    }
+    else if (plan->dark != nullptr)
+    {
+        plan->offset.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            double bias = plan->bias->pixel(i);
+            plan->offset[i] = bias + (plan->dark->pixel(i) - bias) * plan->darkRatio;
+        }
+    }
+    else if (plan->bias != nullptr)
+    {
+        plan->offset.resize(count);
+        for (size_t i = 0; i < count; i++)
+            plan->offset[i] = plan->bias->pixel(i);
+    }
+
+    if (plan->flat != nullptr)
+    {
+        // Normalized per plane, so a colour cast of the flat light does not carry over
+        plan->scale.resize(count);
+        const size_t planeSize = static_cast<size_t>(width) * height;
+        for (size_t plane = 0; plane < channels; plane++)
+        {
+            double sum = 0;
+            size_t begin = plane * planeSize, end = begin + planeSize;
+            for (size_t i = begin; i < end; i++)
+            {
+                double zero = plan->darkFlat ? plan->darkFlat->pixel(i) : plan->bias ? plan->bias->pixel(i) : 0;
+                double value = plan->flat->pixel(i) - zero;
+                plan->scale[i] = value;
+                sum += value;
+            }
+
+            double mean = sum / planeSize;
+            for (size_t i = begin; i < end; i++)
+                plan->scale[i] = (plan->scale[i] > 0 && mean > 0) ? mean / plan->scale[i] : 1;
+        }
+    }
+
+    // Described now, the masters may be unmapped by the time the plan is logged
+    auto add = [&plan](const char *what, const Master *master)
+    {
+        if (master == nullptr)
+            return;
+        if (!plan->description.empty())
+            plan->description += ", ";
+        plan->description += std::string(what) + " " + master->path.substr(master->path.rfind('/') + 1);
+    };
+
+    if (plan->bias && (plan->darkRatio != 1 || (plan->flat && !plan->darkFlat) || !plan->dark))
+    {
+        add("bias", plan->bias);
+        plan->summary += "B";
+    }
+    add("dark", plan->dark);
+    if (plan->dark && plan->darkRatio != 1)
+        plan->description += " scaled x" + std::to_string(plan->darkRatio);
+    add("flat", plan->flat);
+    add("dark flat", plan->darkFlat);
+    if (plan->dark)
+        plan->summary += "D";
+    if (plan->flat)
+        plan->summary += "F";
+
+    m_Plan = plan;
+    return (plan->offset.empty() && plan->scale.empty()) ? nullptr : plan;
+}
+
+void Library::apply(const Plan &plan, uint16_t *pixels) const
+{
+    calibrate16(pixels, static_cast<size_t>(plan.width) * plan.height * plan.channels,
+                plan.offset.empty() ? nullptr : plan.offset.data(), plan.scale.empty() ? nullptr : plan.scale.data(),
+                m_Options.threads);
+}
+
+void Library::apply(const Plan &plan, uint8_t *pixels) const
+{
+    calibrate8(pixels, static_cast<size_t>(plan.width) * plan.height * plan.channels,
+               plan.offset.empty() ? nullptr : plan.offset.data(), plan.scale.empty() ? nullptr : plan.scale.data(),
+               m_Options.threads);
+}
+
+}
@@ -0,0 +1,182 @@
+/*******************************************************************************
+ Frame Calibration
+
+ Bias, dark and flat calibration of camera frames inside the driver, from
+ master frames memory mapped out of a directory of FITS files.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Calibration
+{
+
+enum class FrameType
+{
+    Bias,
+    Dark,
+    Flat,
+    /** Dark taken at the flat exposure, subtracted from the flat instead of the bias */
+    DarkFlat
+};
+
+/** What a frame was taken with. Unknown values never prevent a match. */
+struct FrameKey
+{
+    /** Exposure in seconds */
+    double exposure { 0 };
+    double gain { NAN };
+    /** Sensor temperature in Celsius */
+    double temperature { NAN };
+};
+
+struct Options
+{
+    /** Largest sensor temperature difference between a dark and the frame */
+    double temperatureTolerance { 2.0 };
+    /** Largest relative exposure difference for a dark to be used unscaled */
+    double exposureTolerance { 0.01 };
+    /** Split frames over this many threads, 0 uses one per core. Small frames always run on the caller. */
+    unsigned threads { 0 };
+};
+
+/** A master frame mapped from disk. */
+struct Master
+{
+    std::string path;
+    FrameType type { FrameType::Dark };
+    FrameKey key;
+    uint32_t width { 0 };
+    uint32_t height { 0 };
+    uint32_t channels { 1 };
+
+    /** FITS BITPIX of the mapped data, 8, 16, 32 or -32 */
+    int bitpix { 0 };
+    double bzero { 0 };
+    double bscale { 1 };
+
+    /** Big endian pixel data, inside the mapping */
+    const uint8_t *data { nullptr };
+
+    ~Master();
+
+    /** Pixel i converted to its physical value */
+    double pixel(size_t i) const;
+
+    void *map { nullptr };
+    size_t mapLength { 0 };
+};
+
+/**
+ * @brief Map a master frame.
+ *
+ * Only uncompressed primary images are supported, which is what INDI and the
+ * usual stacking tools write. The frame type is taken from IMAGETYP, the key
+ * from EXPTIME (or EXPOSURE), GAIN and CCD-TEMP.
+ *
+ * @return the master, or nullptr with error set.
+ */
+std::unique_ptr<Master> mapMaster(const std::string &path, std::string &error);
+
+/**
+ * @brief Master frames of one camera and the calibration built from them.
+ *
+ * open() maps every master in a directory once. select() picks the masters
+ * matching a frame and folds them into a plan of one offset and one scale per
+ * pixel, which is only rebuilt when the selection changes, so apply() is a
+ * single subtract and multiply pass:
+ *
+ *   out = (in - (bias + (dark - bias) * exposure / darkExposure)) * mean(flat - bias) / (flat - bias)
+ *
+ * A dark taken at another exposure is only scaled when a bias is available.
+ * A dark flat matching the flat exposure is used in place of the bias in the
+ * flat terms.
+ * All methods may be called from any thread. A plan holds everything apply()
+ * needs, so it stays valid while another thread selects for another geometry
+ * or the masters are reopened.
+ */
+class Library
+{
+    public:
+        /** The masters picked for one frame geometry and key, folded into offset and scale */
+        struct Plan
+        {
+            uint32_t width { 0 }, height { 0 }, channels { 0 };
+            // Only compared against the next selection, never dereferenced once built
+            const Master *bias { nullptr };
+            const Master *dark { nullptr };
+            const Master *flat { nullptr };
+            const Master *darkFlat { nullptr };
+            double darkRatio { 1 };
+
+            std::vector<float> offset;
+            std::vector<float> scale;
+
+            /** Masters used, for logs */
+            std::string description;
+            /** Short FITS style summary such as "BDF" */
+            std::string summary;
+
+            bool same(const Plan &other) const;
+        };
+
+        explicit Library(const Options &options = Options()) : m_Options(options) {}
+
+        /** Map the masters found in directory, replacing any previous ones. Returns how many were found. */
+        size_t open(const std::string &directory, std::string &error);
+        void close();
+
+        size_t size() const;
+
+        /**
+         * @brief Prepare calibration of width x height frames with the given planes and key.
+         * @return the plan to apply, or nullptr if no master applies.
+         */
+        std::shared_ptr<const Plan> select(uint32_t width, uint32_t height, uint32_t channels, const FrameKey &key);
+
+        /** Calibrate a frame of the plan's geometry in place. Pixels are in host order. */
+        void apply(const Plan &plan, uint16_t *pixels) const;
+        void apply(const Plan &plan, uint8_t *pixels) const;
+
+    private:
+        const Master *find(FrameType type, uint32_t width, uint32_t height, uint32_t channels, const FrameKey &key,
+                           bool nearestExposure) const;
+
+        Options m_Options;
+        mutable std::mutex m_Mutex;
+        std::vector<std::unique_ptr<Master>> m_Masters;
+        // Last plan built, reused while the selection does not change
+        std::shared_ptr<const Plan> m_Plan;
+};
+
+/**
+ * @brief Calibrate count pixels in place: (in - offset) * scale, rounded and saturated.
+ *
+ * Either of offset and scale may be null to skip that step. Exposed for tests
+ * and benchmarks, drivers go through Library.
+ */
+void calibrate16(uint16_t *pixels, size_t count, const float *offset, const float *scale, unsigned threads);
+void calibrate8(uint8_t *pixels, size_t count, const float *offset, const float *scale, unsigned threads);
+
+}
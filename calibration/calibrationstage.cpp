@@ -0,0 +1,179 @@
+/*******************************************************************************
+ Frame Calibration
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "calibrationstage.h"
+
+#include <indilogger.h>
+
+#include <cstring>
+
+namespace Calibration
+{
+
+void Stage::initProperties(const char *groupName)
+{
+    CalibrationSP[CALIBRATE_EXPOSURES].fill("CALIBRATE_EXPOSURES", "Exposures", ISS_OFF);
+    CalibrationSP[CALIBRATE_STREAM   ].fill("CALIBRATE_STREAM",    "Stream",    ISS_OFF);
+    CalibrationSP.fill(getDeviceName(), "CCD_CALIBRATION", "Calibrate", groupName, IP_RW, ISR_NOFMANY, 60, IPS_IDLE);
+
+    MastersTP[0].fill("DIR", "Directory", "");
+    MastersTP.fill(getDeviceName(), "CCD_CALIBRATION_MASTERS", "Master Frames", groupName, IP_RW, 60, IPS_IDLE);
+
+    ActiveTP[0].fill("MASTERS", "Masters", "");
+    ActiveTP.fill(getDeviceName(), "CCD_CALIBRATION_ACTIVE", "Calibrated With", groupName, IP_RO, 60, IPS_IDLE);
+}
+
+void Stage::updateProperties(bool connected)
+{
+    if (connected)
+    {
+        m_Device->defineProperty(MastersTP);
+        m_Device->loadConfig(true, MastersTP.getName());
+        m_Device->defineProperty(CalibrationSP);
+        m_Device->loadConfig(true, CalibrationSP.getName());
+        m_Device->defineProperty(ActiveTP);
+    }
+    else
+    {
+        m_Device->deleteProperty(MastersTP.getName());
+        m_Device->deleteProperty(CalibrationSP.getName());
+        m_Device->deleteProperty(ActiveTP.getName());
+    }
+}
+
+bool Stage::openMasters()
+{
+    const char *directory = MastersTP[0].getText();
+    if (directory == nullptr || directory[0] == '\0')
+    {
+        LOG_ERROR("Set the master frames directory before enabling calibration.");
+        return false;
+    }
+
+    std::string error;
+    size_t count = m_Library.open(directory, error);
+    if (!error.empty())
+        LOGF_WARN("Calibration: %s", error.c_str());
+    if (count == 0)
+    {
+        LOGF_ERROR("No master bias, dark or flat frames found in %s.", directory);
+        return false;
+    }
+
+    LOGF_INFO("Mapped %d master frame(s) from %s.", static_cast<int>(count), directory);
+    m_Opened = true;
+
+    std::lock_guard<std::mutex> lock(m_StateMutex);
+    m_Reported = false;
+    return true;
+}
+
+bool Stage::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n)
+{
+    if (dev == nullptr || strcmp(dev, getDeviceName()) || !CalibrationSP.isNameMatch(name))
+        return false;
+
+    CalibrationSP.update(states, names, n);
+    bool enabled = isEnabled(false) || isEnabled(true);
+    if (enabled && !m_Opened && !openMasters())
+    {
+        CalibrationSP.reset();
+        CalibrationSP.setState(IPS_ALERT);
+    }
+    else
+        CalibrationSP.setState(enabled ? IPS_OK : IPS_IDLE);
+    CalibrationSP.apply();
+    return true;
+}
+
+bool Stage::ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n)
+{
+    if (dev == nullptr || strcmp(dev, getDeviceName()) || !MastersTP.isNameMatch(name))
+        return false;
+
+    MastersTP.update(texts, names, n);
+
+    // A new directory is mapped right away while calibrating, otherwise when calibration is turned on
+    m_Opened = false;
+    m_Library.close();
+    if (isEnabled(false) || isEnabled(true))
+        MastersTP.setState(openMasters() ? IPS_OK : IPS_ALERT);
+    else
+        MastersTP.setState(IPS_OK);
+    MastersTP.apply();
+    return true;
+}
+
+void Stage::saveConfigItems(FILE *fp)
+{
+    MastersTP.save(fp);
+    CalibrationSP.save(fp);
+}
+
+bool Stage::isEnabled(bool stream) const
+{
+    return CalibrationSP[stream ? CALIBRATE_STREAM : CALIBRATE_EXPOSURES].getState() == ISS_ON;
+}
+
+bool Stage::process(uint8_t *buffer, uint32_t width, uint32_t height, uint32_t channels, uint32_t bpp,
+                    const FrameKey &key, INDI::CCDChip::CCD_FRAME frameType, bool stream)
+{
+    // Bias, dark and flat frames are left as taken, they may become the next masters
+    bool light = frameType == INDI::CCDChip::LIGHT_FRAME;
+    std::shared_ptr<const Library::Plan> plan;
+    if (light && isEnabled(stream) && m_Opened && (bpp == 8 || bpp == 16))
+        plan = m_Library.select(width, height, channels, key);
+
+    // Exposures and stream frames may select at once, each applies its own plan
+    bool applied = plan != nullptr;
+    if (applied)
+    {
+        if (bpp == 16)
+            m_Library.apply(*plan, reinterpret_cast<uint16_t *>(buffer));
+        else
+            m_Library.apply(*plan, buffer);
+    }
+
+    // Only report changes, stream frames come at full rate
+    std::string description = applied ? plan->description : std::string();
+    std::lock_guard<std::mutex> lock(m_StateMutex);
+    if (!stream)
+        m_LastSummary = applied ? plan->summary : std::string();
+    if (!m_Reported || description != m_LastDescription)
+    {
+        m_Reported = true;
+        m_LastDescription = description;
+        if (applied)
+            LOGF_INFO("Calibrating with %s.", description.c_str());
+        else if (light && isEnabled(stream) && m_Opened)
+            LOGF_WARN("No master frames match %ux%u frames at %gs.", width, height, key.exposure);
+        ActiveTP[0].setText(description);
+        ActiveTP.setState(applied ? IPS_OK : IPS_IDLE);
+        ActiveTP.apply();
+    }
+    return applied;
+}
+
+void Stage::addFITSKeywords(std::vector<INDI::FITSRecord> &fitsKeywords)
+{
+    std::lock_guard<std::mutex> lock(m_StateMutex);
+    if (!m_LastSummary.empty())
+        fitsKeywords.push_back({"CALSTAT", m_LastSummary.c_str(), "Calibrated in driver"});
+}
+
+}
@@ -0,0 +1,112 @@
+/*******************************************************************************
+ Frame Calibration
+
+ INDI properties and frame hook driving a Calibration::Library from a
+ camera driver.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include "calibration.h"
+
+#include <defaultdevice.h>
+#include <fitskeyword.h>
+#include <indiccdchip.h>
+#include <indipropertyswitch.h>
+#include <indipropertytext.h>
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Calibration
+{
+
+/**
+ * @brief Optional in-driver calibration of exposures and stream frames.
+ *
+ * The driver forwards its property and config calls, and calls process() on
+ * each frame from the thread that downloaded it, before the frame is handed to
+ * ExposureComplete or the streamer:
+ *
+ *  - CCD_CALIBRATION turns calibration of exposures and of streamed frames on.
+ *  - CCD_CALIBRATION_MASTERS names the directory of master bias, dark and flat
+ *    FITS files. They are mapped when calibration is first turned on.
+ *  - CCD_CALIBRATION_ACTIVE reports the masters used for the last frame.
+ *
+ * Only light frames are calibrated. Bias, dark and flat frames pass through
+ * untouched so they can be stacked into new masters.
+ */
+class Stage
+{
+    public:
+        explicit Stage(INDI::DefaultDevice *device) : m_Device(device) {}
+
+        void initProperties(const char *groupName);
+        void updateProperties(bool connected);
+
+        bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n);
+        bool ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n);
+        void saveConfigItems(FILE *fp);
+
+        /** Adds CALSTAT when the last exposure was calibrated. */
+        void addFITSKeywords(std::vector<INDI::FITSRecord> &fitsKeywords);
+
+        /**
+         * @brief Calibrate a frame in place if enabled and masters match it.
+         * @param buffer planar frame of width x height x channels pixels in host order
+         * @param bpp 8 or 16
+         * @param frameType only light frames are calibrated
+         * @param stream true for streamed frames, false for exposures
+         * @return true if the frame was calibrated
+         */
+        bool process(uint8_t *buffer, uint32_t width, uint32_t height, uint32_t channels, uint32_t bpp,
+                     const FrameKey &key, INDI::CCDChip::CCD_FRAME frameType, bool stream);
+
+        bool isEnabled(bool stream) const;
+
+    private:
+        const char *getDeviceName() const
+        {
+            return m_Device->getDeviceName();
+        }
+
+        bool openMasters();
+
+        INDI::DefaultDevice *m_Device;
+        Library m_Library;
+        std::atomic_bool m_Opened {false};
+
+        INDI::PropertySwitch CalibrationSP {2};
+        enum
+        {
+            CALIBRATE_EXPOSURES,
+            CALIBRATE_STREAM
+        };
+        INDI::PropertyText MastersTP {1};
+        INDI::PropertyText ActiveTP {1};
+
+        // Last frame's calibration, as the frame may be sent from another thread than the one changing it
+        std::mutex m_StateMutex;
+        std::string m_LastDescription;
+        std::string m_LastSummary;
+        bool m_Reported {false};
+};
+
+}
@@ -0,0 +1,404 @@
+#include <gtest/gtest.h>
+#include "calibration.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace Calibration;
+
+// Writes a minimal FITS image, as the stacking tools save masters
+class FitsWriter
+{
+    public:
+        void card(const std::string &keyword, const std::string &value)
+        {
+            char line[81];
+            snprintf(line, sizeof(line), "%-8s= %-70s", keyword.c_str(), value.c_str());
+            header += std::string(line, 80);
+        }
+
+        void write(const std::string &path, int bitpix, uint32_t width, uint32_t height, uint32_t channels,
+                   const std::vector<double> &pixels)
+        {
+            std::string cards = header;
+            header.clear();
+            card("SIMPLE", "T");
+            card("BITPIX", std::to_string(bitpix));
+            card("NAXIS", channels > 1 ? "3" : "2");
+            card("NAXIS1", std::to_string(width));
+            card("NAXIS2", std::to_string(height));
+            if (channels > 1)
+                card("NAXIS3", std::to_string(channels));
+            if (bitpix == 16)
+                card("BZERO", "32768");
+            header += cards;
+            header += std::string("END") + std::string(77, ' ');
+            header.resize((header.size() + 2879) / 2880 * 2880, ' ');
+
+            std::string data;
+            for (double p : pixels)
+            {
+                if (bitpix == 16)
+                {
+                    int16_t v = static_cast<int16_t>(p - 32768);
+                    data += static_cast<char>(v >> 8);
+                    data += static_cast<char>(v & 0xff);
+                }
+                else
+                {
+                    float f = p;
+                    uint32_t bits;
+                    memcpy(&bits, &f, 4);
+                    for (int shift = 24; shift >= 0; shift -= 8)
+                        data += static_cast<char>(bits >> shift);
+                }
+            }
+            data.resize((data.size() + 2879) / 2880 * 2880, '\0');
+
+            FILE *file = fopen(path.c_str(), "wb");
+            ASSERT_NE(file, nullptr);
+            fwrite(header.data(), 1, header.size(), file);
+            fwrite(data.data(), 1, data.size(), file);
+            fclose(file);
+            header.clear();
+        }
+
+        std::string header;
+};
+
+class CalibrationTest : public ::testing::Test
+{
+    protected:
+        void SetUp() override
+        {
+            char pattern[] = "/tmp/calibration-XXXXXX";
+            ASSERT_NE(mkdtemp(pattern), nullptr);
+            dir = pattern;
+        }
+
+        void TearDown() override
+        {
+            for (const auto &file : files)
+                unlink(file.c_str());
+            rmdir(dir.c_str());
+        }
+
+        std::string master(const std::string &name, const char *type, double exposure, double gain, double temperature,
+                           const std::vector<double> &pixels, int bitpix = -32, uint32_t width = W, uint32_t height = H)
+        {
+            FitsWriter fits;
+            fits.card("IMAGETYP", std::string("'") + type + "'");
+            fits.card("EXPTIME", std::to_string(exposure));
+            fits.card("GAIN", std::to_string(gain));
+            fits.card("CCD-TEMP", std::to_string(temperature));
+            std::string path = dir + "/" + name;
+            fits.write(path, bitpix, width, height, 1, pixels);
+            files.push_back(path);
+            return path;
+        }
+
+        enum : uint32_t { W = 37, H = 11 };
+        std::string dir;
+        std::vector<std::string> files;
+};
+
+static FrameKey frameKey(double exposure, double gain, double temperature)
+{
+    FrameKey key;
+    key.exposure = exposure;
+    key.gain = gain;
+    key.temperature = temperature;
+    return key;
+}
+
+static std::vector<double> filled(size_t count, double base, double step)
+{
+    std::vector<double> pixels(count);
+    for (size_t i = 0; i < count; i++)
+        pixels[i] = base + step * (i % 7);
+    return pixels;
+}
+
+TEST_F(CalibrationTest, map_master_header)
+{
+    auto pixels = filled(W * H, 1000, 3);
+    std::string path = master("dark.fits", "Dark Frame", 30, 120, -10, pixels, 16);
+
+    std::string error;
+    auto m = mapMaster(path, error);
+    ASSERT_TRUE(m) << error;
+    EXPECT_EQ(m->type, FrameType::Dark);
+    EXPECT_EQ(m->width, static_cast<uint32_t>(W));
+    EXPECT_EQ(m->height, static_cast<uint32_t>(H));
+    EXPECT_EQ(m->channels, 1u);
+    EXPECT_DOUBLE_EQ(m->key.exposure, 30);
+    EXPECT_DOUBLE_EQ(m->key.gain, 120);
+    EXPECT_DOUBLE_EQ(m->key.temperature, -10);
+    for (size_t i = 0; i < pixels.size(); i++)
+        ASSERT_DOUBLE_EQ(m->pixel(i), pixels[i]);
+}
+
+TEST_F(CalibrationTest, map_master_rejects)
+{
+    std::string error;
+    std::string light = master("light.fits", "Light Frame", 30, 120, -10, filled(W * H, 1, 0));
+    EXPECT_FALSE(mapMaster(light, error));
+    EXPECT_NE(error.find("not a bias"), std::string::npos);
+
+    // Cut into the data
+    std::string path = master("short.fits", "Master Dark", 30, 120, -10, filled(W * H, 1, 0));
+    ASSERT_EQ(truncate(path.c_str(), 2880 + 100), 0);
+    EXPECT_FALSE(mapMaster(path, error));
+
+    // Both are skipped when opening the directory
+    Library library;
+    EXPECT_EQ(library.open(dir, error), 0u);
+    EXPECT_FALSE(error.empty());
+}
+
+TEST_F(CalibrationTest, select_by_key)
+{
+    master("dark_10s.fits", "Dark", 10, 100, -10, filled(W * H, 100, 0));
+    master("dark_30s.fits", "Dark", 30, 100, -10, filled(W * H, 300, 0));
+    master("dark_30s_gain0.fits", "Dark", 30, 0, -10, filled(W * H, 200, 0));
+    master("dark_30s_warm.fits", "Dark", 30, 100, 15, filled(W * H, 900, 0));
+
+    std::string error;
+    Library library;
+    ASSERT_EQ(library.open(dir, error), 4u) << error;
+
+    std::vector<uint16_t> frame(W * H, 1000);
+
+    // Exact exposure and gain, the warm dark is out of tolerance
+    auto plan = library.select(W, H, 1, frameKey(30, 100, -9));
+    ASSERT_TRUE(plan);
+    EXPECT_EQ(plan->description, "dark dark_30s.fits");
+    library.apply(*plan, frame.data());
+    EXPECT_EQ(frame[5], 700);
+
+    // Unknown temperature lets any dark match
+    plan = library.select(W, H, 1, frameKey(10, 100, NAN));
+    ASSERT_TRUE(plan);
+    EXPECT_EQ(plan->description, "dark dark_10s.fits");
+
+    // Another exposure without a bias to scale from is not calibrated
+    EXPECT_FALSE(library.select(W, H, 1, frameKey(60, 100, -10)));
+
+    // Nor is another geometry
+    EXPECT_FALSE(library.select(W + 1, H, 1, frameKey(30, 100, -10)));
+}
+
+TEST_F(CalibrationTest, bias_dark_flat)
+{
+    const size_t count = W * H;
+    std::vector<double> bias(count), dark(count), flat(count);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> noise(0, 50);
+    for (size_t i = 0; i < count; i++)
+    {
+        bias[i] = 500 + noise(rng);
+        dark[i] = bias[i] + 100 + noise(rng);
+        flat[i] = bias[i] + 20000 + 100 * noise(rng);
+    }
+    master("bias.fits", "Bias Frame", 0, 100, -10, bias);
+    master("dark.fits", "Dark Frame", 60, 100, -10, dark);
+    master("flat.fits", "Flat Field", 2, 100, 5, flat);
+
+    std::string error;
+    Library library;
+    ASSERT_EQ(library.open(dir, error), 3u) << error;
+
+    // Half the dark exposure, scaled through the bias
+    auto plan = library.select(W, H, 1, frameKey(30, 100, -10));
+    ASSERT_TRUE(plan);
+    EXPECT_EQ(plan->summary, "BDF");
+
+    double mean = 0;
+    for (size_t i = 0; i < count; i++)
+        mean += flat[i] - bias[i];
+    mean /= count;
+
+    std::vector<uint16_t> frame(count);
+    for (size_t i = 0; i < count; i++)
+        frame[i] = static_cast<uint16_t>(3000 + i * 13 % 5000);
+    std::vector<uint16_t> input = frame;
+    library.apply(*plan, frame.data());
+
+    for (size_t i = 0; i < count; i++)
+    {
+        double offset = bias[i] + (dark[i] - bias[i]) * 0.5;
+        double expected = (input[i] - offset) * mean / (flat[i] - bias[i]);
+        ASSERT_NEAR(frame[i], expected, 1.0) << i;
+    }
+}
+
+TEST_F(CalibrationTest, dark_flat_replaces_bias_in_flat)
+{
+    const size_t count = W * H;
+    std::vector<double> bias(count, 500), darkFlat(count), flat(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        darkFlat[i] = 600 + (i % 5) * 10;
+        flat[i] = darkFlat[i] + 10000 + (i % 3) * 1000;
+    }
+    master("bias.fits", "Bias Frame", 0, 100, -10, bias);
+    master("darkflat.fits", "Dark Flat", 2, 100, 5, darkFlat);
+    master("darkflat_long.fits", "DARKFLAT", 20, 100, 5, filled(count, 5000, 0));
+    master("flat.fits", "Flat Field", 2, 100, 5, flat);
+
+    std::string error;
+    auto m = mapMaster(dir + "/darkflat.fits", error);
+    ASSERT_TRUE(m) << error;
+    EXPECT_EQ(m->type, FrameType::DarkFlat);
+
+    Library library;
+    ASSERT_EQ(library.open(dir, error), 4u) << error;
+
+    // The dark flat at the flat exposure is used, the bias still takes the offset
+    auto plan = library.select(W, H, 1, frameKey(30, 100, -10));
+    ASSERT_TRUE(plan);
+    EXPECT_EQ(plan->description, "bias bias.fits, flat flat.fits, dark flat darkflat.fits");
+
+    double mean = 0;
+    for (size_t i = 0; i < count; i++)
+        mean += flat[i] - darkFlat[i];
+    mean /= count;
+
+    std::vector<uint16_t> frame(count, 20500);
+    library.apply(*plan, frame.data());
+    for (size_t i = 0; i < count; i++)
+        ASSERT_NEAR(frame[i], 20000 * mean / (flat[i] - darkFlat[i]), 1.0) << i;
+}
+
+TEST_F(CalibrationTest, threads_with_other_geometries)
+{
+    master("dark.fits", "Dark", 30, 100, -10, filled(W * H, 300, 0));
+    master("dark_wide.fits", "Dark", 30, 100, -10, filled(W * 2 * H, 100, 0), -32, W * 2, H);
+
+    std::string error;
+    Library library;
+    ASSERT_EQ(library.open(dir, error), 2u) << error;
+
+    // As the exposure and stream paths of one driver, each selecting its own frame size every time
+    std::atomic<int> failures { 0 };
+    auto calibrate = [&](uint32_t width, uint16_t expected)
+    {
+        for (int i = 0; i < 200; i++)
+        {
+            std::vector<uint16_t> frame(width * H, 1000);
+            auto plan = library.select(width, H, 1, frameKey(30, 100, -10));
+            if (!plan || plan->width != width)
+            {
+                failures++;
+                continue;
+            }
+            library.apply(*plan, frame.data());
+            if (std::count(frame.begin(), frame.end(), expected) != static_cast<long>(frame.size()))
+                failures++;
+        }
+    };
+
+    std::thread wide(calibrate, W * 2, 900);
+    calibrate(W, 700);
+    wide.join();
+    EXPECT_EQ(failures, 0);
+}
+
+// Plain reference of the kernels
+template <typename T>
+static std::vector<T> reference(const std::vector<T> &pixels, const std::vector<float> &offset,
+                                const std::vector<float> &scale, float maxValue)
+{
+    std::vector<T> out(pixels.size());
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        float v = (static_cast<float>(pixels[i]) - offset[i]) * scale[i];
+        out[i] = static_cast<T>(std::min(std::max(v, 0.0f), maxValue) + 0.5f);
+    }
+    return out;
+}
+
+TEST(CalibrationKernels, calibrate16_matches_reference)
+{
+    // Odd count for the scalar tail, offsets and scales that saturate both ways
+    const size_t count = 1003;
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> pixel(0, 65535);
+    std::uniform_real_distribution<float> offset(-100, 3000), scale(0.5f, 2.5f);
+
+    std::vector<uint16_t> pixels(count);
+    std::vector<float> offsets(count), scales(count), zeros(count, 0), ones(count, 1);
+    for (size_t i = 0; i < count; i++)
+    {
+        pixels[i] = pixel(rng);
+        offsets[i] = offset(rng);
+        scales[i] = scale(rng);
+    }
+
+    auto out = pixels;
+    calibrate16(out.data(), count, offsets.data(), scales.data(), 1);
+    EXPECT_EQ(out, reference(pixels, offsets, scales, 65535.0f));
+
+    out = pixels;
+    calibrate16(out.data(), count, offsets.data(), nullptr, 1);
+    EXPECT_EQ(out, reference(pixels, offsets, ones, 65535.0f));
+
+    out = pixels;
+    calibrate16(out.data(), count, nullptr, scales.data(), 1);
+    EXPECT_EQ(out, reference(pixels, zeros, scales, 65535.0f));
+}
+
+TEST(CalibrationKernels, calibrate8_matches_reference)
+{
+    const size_t count = 517;
+    std::mt19937 rng(13);
+    std::uniform_int_distribution<int> pixel(0, 255);
+    std::uniform_real_distribution<float> offset(-10, 60), scale(0.5f, 2.5f);
+
+    std::vector<uint8_t> pixels(count);
+    std::vector<float> offsets(count), scales(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        pixels[i] = pixel(rng);
+        offsets[i] = offset(rng);
+        scales[i] = scale(rng);
+    }
+
+    auto out = pixels;
+    calibrate8(out.data(), count, offsets.data(), scales.data(), 1);
+    EXPECT_EQ(out, reference(pixels, offsets, scales, 255.0f));
+}
+
+TEST(CalibrationKernels, threads_match_single)
+{
+    const size_t count = 1280 * 960 + 5;
+    std::vector<uint16_t> pixels(count);
+    std::vector<float> offsets(count), scales(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        pixels[i] = static_cast<uint16_t>(i * 31);
+        offsets[i] = static_cast<float>(i % 300);
+        scales[i] = 0.9f + (i % 17) * 0.01f;
+    }
+
+    auto single = pixels, threaded = pixels;
+    calibrate16(single.data(), count, offsets.data(), scales.data(), 1);
+    calibrate16(threaded.data(), count, offsets.data(), scales.data(), 4);
+    EXPECT_EQ(single, threaded);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,19 @@
+# - Frame calibration
+# In-driver bias, dark and flat calibration shared by camera drivers.
+# Sources live in calibration/ at the top of the tree.
+#
+# Once included this defines
+#
+#  CALIBRATION_INCLUDE_DIR - directory of calibration.h and calibrationstage.h
+#  CALIBRATION_SOURCES     - sources to add to the driver executable
+#
+# The executable must also link ${CMAKE_THREAD_LIBS_INIT}.
+
+get_filename_component(CALIBRATION_INCLUDE_DIR "${CMAKE_CURRENT_LIST_DIR}/../calibration" ABSOLUTE)
+
+set(CALIBRATION_SOURCES
+    ${CALIBRATION_INCLUDE_DIR}/calibration.cpp
+    ${CALIBRATION_INCLUDE_DIR}/calibrationstage.cpp
+)
+
+find_package(Threads REQUIRED)
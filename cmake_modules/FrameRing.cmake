@@ -0,0 +1,13 @@
+# - Frame ring
+# Capture to delivery frame hand-off and SER timestamps shared by camera
+# drivers. The header lives in framering/ at the top of the tree.
+#
+# Once included this defines
+#
+#  FRAME_RING_INCLUDE_DIR - directory of framering.h
+#
+# The executable must also link ${CMAKE_THREAD_LIBS_INIT}.
+
+get_filename_component(FRAME_RING_INCLUDE_DIR "${CMAKE_CURRENT_LIST_DIR}/../framering" ABSOLUTE)
+
+find_package(Threads REQUIRED)
@@ -0,0 +1,18 @@
+# - Image kernels
+# Software binning, subframing and byte order conversion shared by camera
+# drivers. Sources live in imagekernels/ at the top of the tree.
+#
+# Once included this defines
+#
+#  IMAGE_KERNELS_INCLUDE_DIR - directory of imagekernels.h
+#  IMAGE_KERNELS_SOURCES     - sources to add to the driver executable
+#
+# The executable must also link ${CMAKE_THREAD_LIBS_INIT}.
+
+get_filename_component(IMAGE_KERNELS_INCLUDE_DIR "${CMAKE_CURRENT_LIST_DIR}/../imagekernels" ABSOLUTE)
+
+set(IMAGE_KERNELS_SOURCES
+    ${IMAGE_KERNELS_INCLUDE_DIR}/imagekernels.cpp
+)
+
+find_package(Threads REQUIRED)
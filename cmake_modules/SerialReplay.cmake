@@ -0,0 +1,19 @@
+# - Serial replay test bench
+# Pty based fake device and benchmark runner shared by the unit tests of
+# serial protocol drivers. Sources live in serialreplay/ at the top of the tree.
+#
+# Once included this defines
+#
+#  SERIAL_REPLAY_INCLUDE_DIR - directory of replaydevice.h and replaybench.h
+#  SERIAL_REPLAY_SOURCES     - sources to add to the test executable
+#
+# The test executable must also link ${CMAKE_THREAD_LIBS_INIT}.
+
+get_filename_component(SERIAL_REPLAY_INCLUDE_DIR "${CMAKE_CURRENT_LIST_DIR}/../serialreplay" ABSOLUTE)
+
+set(SERIAL_REPLAY_SOURCES
+    ${SERIAL_REPLAY_INCLUDE_DIR}/replaydevice.cpp
+    ${SERIAL_REPLAY_INCLUDE_DIR}/replaybench.cpp
+)
+
+find_package(Threads REQUIRED)
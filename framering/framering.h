@@ -0,0 +1,228 @@
+/*******************************************************************************
+ Frame Ring
+
+ Fixed set of frame buffers handed from a camera capture thread to a stream
+ delivery thread, and SER timestamps for the frames they carry.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace FrameRing
+{
+
+/** Offset of the UNIX epoch to the SER epoch (January 1, 1 AD) in microseconds */
+static constexpr uint64_t UNIX_SER_US_EPOCH = 62135596800000000ULL;
+
+/** Capture times in microseconds since SER epoch, from a monotonic clock anchored to UTC by start() */
+class Clock
+{
+    public:
+        /** Anchor to the current UTC time, typically when streaming starts */
+        void start()
+        {
+            m_StartMono = std::chrono::steady_clock::now();
+            m_StartUTC = std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::system_clock::now().time_since_epoch()).count() + UNIX_SER_US_EPOCH;
+        }
+
+        uint64_t timestamp(std::chrono::steady_clock::time_point captured) const
+        {
+            return m_StartUTC + std::chrono::duration_cast<std::chrono::microseconds>(captured - m_StartMono).count();
+        }
+
+    private:
+        std::chrono::steady_clock::time_point m_StartMono;
+        uint64_t m_StartUTC { 0 };
+};
+
+/**
+ * The capture thread takes a slot with acquire(), fills it and queues it with
+ * publish(), or gives it back with release() when the read failed. The
+ * delivery thread takes queued slots with wait() and gives each one back with
+ * release(). When no slot is free the oldest queued one is taken over by
+ * acquire() and counted as dropped, so a slow consumer costs frames, not
+ * latency.
+ *
+ * A slot belongs to whoever took it off the ring and only that thread may
+ * resize it, acquire() grows it to frameSize() before handing it out. Frame
+ * must have a std::vector<uint8_t> data member.
+ */
+template <typename Frame, size_t Slots>
+class Ring
+{
+    public:
+        Ring()
+        {
+            for (auto &frame : m_Frames)
+                m_Free.push_back(&frame);
+        }
+
+        /**
+         * Start a stream of frames of size bytes. Frames still queued from the
+         * previous stream are dropped without being counted. Slots taken by a
+         * thread stay with it and come back through publish() or release().
+         */
+        void open(size_t size)
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            flushLocked();
+            m_FrameSize = size;
+            m_Dropped = 0;
+            m_Open = true;
+        }
+
+        /** As open(), also taking back every slot. Only while no thread uses the ring. */
+        void reset(size_t size)
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Ready.clear();
+            m_Free.clear();
+            for (auto &frame : m_Frames)
+                m_Free.push_back(&frame);
+            m_FrameSize = size;
+            m_Dropped = 0;
+            m_Open = true;
+        }
+
+        /**
+         * Wake wait() up with nullptr and fail acquire() until the next open().
+         * Returns false if the ring was already closed.
+         */
+        bool close()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                if (!m_Open)
+                    return false;
+                m_Open = false;
+            }
+            m_CV.notify_all();
+            return true;
+        }
+
+        bool isOpen() const
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            return m_Open;
+        }
+
+        /** Give queued frames back without delivering them */
+        void flush()
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            flushLocked();
+        }
+
+        /**
+         * A slot of at least frameSize() bytes to capture into, or nullptr when
+         * the ring is closed or the delivery thread holds every slot.
+         */
+        Frame *acquire()
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (!m_Open)
+                return nullptr;
+
+            Frame *frame = nullptr;
+            if (!m_Free.empty())
+            {
+                frame = m_Free.front();
+                m_Free.pop_front();
+            }
+            else if (!m_Ready.empty())
+            {
+                frame = m_Ready.front();
+                m_Ready.pop_front();
+                m_Dropped++;
+            }
+
+            if (frame != nullptr && frame->data.size() < m_FrameSize)
+                frame->data.resize(m_FrameSize);
+            return frame;
+        }
+
+        /** Queue a captured frame for wait() */
+        void publish(Frame *frame)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Ready.push_back(frame);
+            }
+            m_CV.notify_one();
+        }
+
+        /** Give a slot back unused or once delivered */
+        void release(Frame *frame)
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Free.push_back(frame);
+        }
+
+        /** Oldest queued frame, blocking until there is one. Returns nullptr once closed. */
+        Frame *wait()
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_CV.wait(lock, [this] { return !m_Open || !m_Ready.empty(); });
+            if (!m_Open)
+                return nullptr;
+
+            Frame *frame = m_Ready.front();
+            m_Ready.pop_front();
+            return frame;
+        }
+
+        size_t frameSize() const
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            return m_FrameSize;
+        }
+
+        /** Frames taken over by acquire() since the last open() */
+        uint32_t dropped() const
+        {
+            return m_Dropped;
+        }
+
+    private:
+        void flushLocked()
+        {
+            while (!m_Ready.empty())
+            {
+                m_Free.push_back(m_Ready.front());
+                m_Ready.pop_front();
+            }
+        }
+
+        Frame m_Frames[Slots];
+        std::deque<Frame *> m_Free;
+        std::deque<Frame *> m_Ready;
+        mutable std::mutex m_Mutex;
+        std::condition_variable m_CV;
+        size_t m_FrameSize { 0 };
+        bool m_Open { false };
+        std::atomic<uint32_t> m_Dropped { 0 };
+};
+
+}
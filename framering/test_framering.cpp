@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include "framering.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace FrameRing;
+
+struct TestFrame
+{
+    std::vector<uint8_t> data;
+    uint32_t sequence { 0 };
+};
+
+typedef Ring<TestFrame, 3> TestRing;
+
+TEST(FrameRing, closed_until_opened)
+{
+    TestRing ring;
+    EXPECT_FALSE(ring.isOpen());
+    EXPECT_EQ(ring.acquire(), nullptr);
+    EXPECT_FALSE(ring.close());
+
+    ring.open(16);
+    EXPECT_TRUE(ring.isOpen());
+    TestFrame *frame = ring.acquire();
+    ASSERT_NE(frame, nullptr);
+    EXPECT_GE(frame->data.size(), 16u);
+    EXPECT_TRUE(ring.close());
+}
+
+TEST(FrameRing, frames_delivered_in_order)
+{
+    TestRing ring;
+    ring.open(4);
+    for (uint32_t i = 1; i <= 2; i++)
+    {
+        TestFrame *frame = ring.acquire();
+        ASSERT_NE(frame, nullptr);
+        frame->sequence = i;
+        ring.publish(frame);
+    }
+
+    TestFrame *first = ring.wait();
+    TestFrame *second = ring.wait();
+    EXPECT_EQ(first->sequence, 1u);
+    EXPECT_EQ(second->sequence, 2u);
+    EXPECT_EQ(ring.dropped(), 0u);
+}
+
+TEST(FrameRing, oldest_frame_dropped_when_full)
+{
+    TestRing ring;
+    ring.open(4);
+    for (uint32_t i = 1; i <= 5; i++)
+    {
+        TestFrame *frame = ring.acquire();
+        ASSERT_NE(frame, nullptr);
+        frame->sequence = i;
+        ring.publish(frame);
+    }
+
+    EXPECT_EQ(ring.dropped(), 2u);
+    EXPECT_EQ(ring.wait()->sequence, 3u);
+    EXPECT_EQ(ring.wait()->sequence, 4u);
+    EXPECT_EQ(ring.wait()->sequence, 5u);
+}
+
+TEST(FrameRing, nothing_to_acquire_while_every_slot_is_taken)
+{
+    TestRing ring;
+    ring.open(4);
+    TestFrame *frames[3];
+    for (auto &frame : frames)
+        frame = ring.acquire();
+    EXPECT_EQ(ring.acquire(), nullptr);
+    EXPECT_EQ(ring.dropped(), 0u);
+
+    ring.release(frames[1]);
+    EXPECT_EQ(ring.acquire(), frames[1]);
+}
+
+TEST(FrameRing, slots_grow_to_the_frame_size)
+{
+    TestRing ring;
+    ring.open(8);
+    TestFrame *frames[3];
+    for (auto &frame : frames)
+        frame = ring.acquire();
+    for (auto frame : frames)
+        ring.release(frame);
+
+    // A smaller frame keeps the memory, a larger one grows it on the next acquire
+    ring.open(4);
+    EXPECT_EQ(ring.frameSize(), 4u);
+    TestFrame *frame = ring.acquire();
+    EXPECT_GE(frame->data.size(), 8u);
+    ring.release(frame);
+
+    ring.open(64);
+    for (int i = 0; i < 3; i++)
+        EXPECT_GE(ring.acquire()->data.size(), 64u);
+}
+
+TEST(FrameRing, open_drops_queued_frames_and_keeps_taken_slots)
+{
+    TestRing ring;
+    ring.open(4);
+    TestFrame *held = ring.acquire();
+    TestFrame *queued = ring.acquire();
+    ring.publish(queued);
+    ring.publish(ring.acquire());
+
+    ring.open(4);
+    EXPECT_EQ(ring.dropped(), 0u);
+    std::vector<TestFrame *> taken;
+    while (TestFrame *frame = ring.acquire())
+        taken.push_back(frame);
+    EXPECT_EQ(taken.size(), 2u);
+    for (auto frame : taken)
+        EXPECT_NE(frame, held);
+
+    // Only reset() takes back a slot that was never returned
+    ring.reset(4);
+    taken.clear();
+    while (TestFrame *frame = ring.acquire())
+        taken.push_back(frame);
+    EXPECT_EQ(taken.size(), 3u);
+}
+
+TEST(FrameRing, close_wakes_the_delivery_thread)
+{
+    TestRing ring;
+    ring.open(4);
+    std::thread consumer([&ring]
+    {
+        EXPECT_EQ(ring.wait(), nullptr);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_TRUE(ring.close());
+    consumer.join();
+}
+
+TEST(FrameRing, capture_and_delivery_threads)
+{
+    const uint32_t count = 20000;
+    TestRing ring;
+    ring.open(64);
+
+    std::atomic<uint32_t> delivered { 0 };
+    uint32_t last = 0;
+    bool ordered = true;
+    std::thread consumer([&]
+    {
+        while (TestFrame *frame = ring.wait())
+        {
+            ordered = ordered && frame->sequence > last;
+            last = frame->sequence;
+            delivered++;
+            ring.release(frame);
+        }
+    });
+
+    uint32_t captured = 0;
+    for (uint32_t i = 1; i <= count; i++)
+    {
+        TestFrame *frame = ring.acquire();
+        if (frame == nullptr)
+            continue;
+        frame->sequence = i;
+        ring.publish(frame);
+        captured++;
+    }
+
+    // Let the consumer drain what is still queued
+    while (delivered + ring.dropped() < captured)
+        std::this_thread::yield();
+    ring.close();
+    consumer.join();
+
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(delivered + ring.dropped(), captured);
+}
+
+TEST(FrameRing, clock_counts_from_ser_epoch)
+{
+    Clock clock;
+    clock.start();
+    auto now = std::chrono::steady_clock::now();
+    uint64_t utc = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::system_clock::now().time_since_epoch()).count();
+
+    uint64_t stamp = clock.timestamp(now);
+    EXPECT_GT(stamp, UNIX_SER_US_EPOCH);
+    // Within a second of the wall clock
+    EXPECT_LT(stamp > utc + UNIX_SER_US_EPOCH ? stamp - utc - UNIX_SER_US_EPOCH : utc + UNIX_SER_US_EPOCH - stamp, 1000000u);
+    EXPECT_EQ(clock.timestamp(now + std::chrono::milliseconds(40)) - stamp, 40000u);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,232 @@
+#include <gtest/gtest.h>
+#include "imagekernels.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Compares the kernels with the per driver loops they replaced. The number of
+// iterations can be raised through IMAGE_BENCH_ITERATIONS.
+
+using namespace ImageKernels;
+
+struct Frame
+{
+    const char *name;
+    size_t width;
+    size_t height;
+};
+
+static const Frame FRAMES[] =
+{
+    { "1280x960", 1280, 960 },
+    { "4k", 3840, 2160 },
+};
+
+static size_t iterations(size_t fallback)
+{
+    const char *override = getenv("IMAGE_BENCH_ITERATIONS");
+    if (override != nullptr && atol(override) > 0)
+        return static_cast<size_t>(atol(override));
+    return fallback;
+}
+
+// Mean milliseconds per call, after one warm up call
+static double measure(size_t count, const std::function<void()> &fn)
+{
+    fn();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++)
+        fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / count;
+}
+
+static void report(const std::string &name, double legacy_ms, double kernel_ms)
+{
+    printf("[bench] %s: legacy %.3f ms, kernel %.3f ms, %.1fx\n", name.c_str(), legacy_ms, kernel_ms,
+           kernel_ms > 0 ? legacy_ms / kernel_ms : 0);
+    fflush(stdout);
+}
+
+// INovaCCD::grabImage before it used bin16/bin8
+static void legacyINovaBin(unsigned char *image, const unsigned char *RawData, int Bpp, int binX, int binY, int startX,
+                           int startY, int endX, int endY, int maxW)
+{
+    int p = 0;
+    for(int y = startY; y < endY; y += binY)
+    {
+        if(endY - y < binY)
+            break;
+        for(int x = startX * Bpp; x < endX * Bpp; x += Bpp * binX)
+        {
+            if(endX * Bpp - x < binX * Bpp)
+                break;
+            int t = 0;
+            for(int yy = y; yy < y + binY; yy++)
+            {
+                for(int xx = x; xx < x + Bpp * binX; xx += Bpp)
+                {
+                    if(Bpp > 1)
+                    {
+                        t += RawData[1 + xx + yy * maxW * Bpp] + (RawData[xx + yy * maxW * Bpp] << 8);
+                        t = (t < 0xffff ? t : 0xffff);
+                    }
+                    else
+                    {
+                        t += RawData[xx + yy * maxW * Bpp];
+                        t = (t < 0xff ? t : 0xff);
+                    }
+                }
+            }
+            image[p++] = (unsigned char)(t & 0xff);
+            if(Bpp > 1)
+            {
+                image[p++] = (unsigned char)((t >> 8) & 0xff);
+            }
+        }
+    }
+}
+
+// The mono subframe shared by the webcam, gphoto and libcamera drivers
+static void legacyCrop(uint8_t *memptr, int w, int bpp, int subX, int subY, int subW, int subH)
+{
+    int lineW = subW * bpp / 8;
+    for (int i = subY; i < subY + subH; i++)
+        memmove(memptr + (i - subY) * lineW, memptr + (i * w + subX) * bpp / 8, lineW);
+}
+
+static std::vector<uint8_t> testFrame(size_t size)
+{
+    std::vector<uint8_t> frame(size);
+    uint32_t state = 12345;
+    for (auto &b : frame)
+    {
+        state = state * 1103515245 + 12345;
+        b = static_cast<uint8_t>(state >> 16);
+    }
+    return frame;
+}
+
+TEST(ImageKernelsBench, inova_bin16)
+{
+    for (const Frame &frame : FRAMES)
+    {
+        auto raw = testFrame(frame.width * frame.height * 2);
+        std::vector<uint8_t> legacy(raw.size());
+        std::vector<uint16_t> kernel(raw.size() / 2);
+        size_t count = iterations(frame.width > 2000 ? 5 : 20);
+
+        for (unsigned bin : {2u, 4u})
+        {
+            const size_t out = (frame.width / bin) * (frame.height / bin);
+            double legacy_ms = measure(count, [&]()
+            {
+                legacyINovaBin(legacy.data(), raw.data(), 2, bin, bin, 0, 0, frame.width, frame.height, frame.width);
+            });
+
+            BinOptions options;
+            options.order = Endian::Big;
+            double kernel_ms = measure(count, [&]()
+            {
+                bin16(kernel.data(), raw.data(), frame.width * 2, frame.width, frame.height, bin, bin, options);
+            });
+
+            options.threads = 0;
+            double threaded_ms = measure(count, [&]()
+            {
+                bin16(kernel.data(), raw.data(), frame.width * 2, frame.width, frame.height, bin, bin, options);
+            });
+
+            // The legacy loop wrote little endian bytes
+            ASSERT_EQ(memcmp(legacy.data(), kernel.data(), out * 2), 0);
+
+            std::string name = std::string("bin16.") + frame.name + "." + std::to_string(bin) + "x" + std::to_string(bin);
+            report(name, legacy_ms, kernel_ms);
+            report(name + ".threads", legacy_ms, threaded_ms);
+        }
+    }
+}
+
+TEST(ImageKernelsBench, inova_bin8)
+{
+    for (const Frame &frame : FRAMES)
+    {
+        auto raw = testFrame(frame.width * frame.height);
+        std::vector<uint8_t> legacy(raw.size()), kernel(raw.size());
+        size_t count = iterations(frame.width > 2000 ? 5 : 20);
+
+        double legacy_ms = measure(count, [&]()
+        {
+            legacyINovaBin(legacy.data(), raw.data(), 1, 2, 2, 0, 0, frame.width, frame.height, frame.width);
+        });
+        double kernel_ms = measure(count, [&]()
+        {
+            bin8(kernel.data(), raw.data(), frame.width, frame.width, frame.height, 2, 2);
+        });
+
+        ASSERT_EQ(memcmp(legacy.data(), kernel.data(), (frame.width / 2) * (frame.height / 2)), 0);
+        report(std::string("bin8.") + frame.name + ".2x2", legacy_ms, kernel_ms);
+    }
+}
+
+TEST(ImageKernelsBench, subframe)
+{
+    for (const Frame &frame : FRAMES)
+    {
+        const size_t size = frame.width * frame.height * 2;
+        const size_t subX = frame.width / 4, subY = frame.height / 4, subW = frame.width / 2, subH = frame.height / 2;
+        auto source = testFrame(size);
+        std::vector<uint8_t> legacy(size), kernel(size);
+        size_t count = iterations(frame.width > 2000 ? 20 : 50);
+
+        // Each call starts from a fresh frame, as the drivers do
+        double legacy_ms = measure(count, [&]()
+        {
+            memcpy(legacy.data(), source.data(), size);
+            legacyCrop(legacy.data(), frame.width, 16, subX, subY, subW, subH);
+        });
+        double kernel_ms = measure(count, [&]()
+        {
+            memcpy(kernel.data(), source.data(), size);
+            crop(kernel.data(), kernel.data(), frame.width * 2, subX, subY, subW, subH, 2);
+        });
+
+        ASSERT_EQ(memcmp(legacy.data(), kernel.data(), subW * subH * 2), 0);
+        report(std::string("crop16.") + frame.name, legacy_ms, kernel_ms);
+    }
+}
+
+TEST(ImageKernelsBench, to_host16)
+{
+    for (const Frame &frame : FRAMES)
+    {
+        const size_t pixels = frame.width * frame.height;
+        auto raw = testFrame(pixels * 2);
+        std::vector<uint16_t> legacy(pixels), kernel(pixels);
+        size_t count = iterations(frame.width > 2000 ? 20 : 50);
+
+        double legacy_ms = measure(count, [&]()
+        {
+            for (size_t i = 0; i < pixels; i++)
+                legacy[i] = raw[i * 2] << 8 | raw[i * 2 + 1];
+        });
+        double kernel_ms = measure(count, [&]()
+        {
+            toHost16(kernel.data(), raw.data(), pixels, Endian::Big);
+        });
+
+        ASSERT_EQ(legacy, kernel);
+        report(std::string("be16.") + frame.name, legacy_ms, kernel_ms);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,327 @@
+/*******************************************************************************
+ Image Kernels
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "imagekernels.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IMAGE_KERNELS_SSE2
+#elif defined(__ARM_NEON) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#include <arm_neon.h>
+#define IMAGE_KERNELS_NEON
+#endif
+
+namespace ImageKernels
+{
+
+// Frames smaller than this per thread are not worth the thread start up.
+static const size_t MIN_PIXELS_PER_THREAD = 256 * 1024;
+
+static bool isBigEndian(Endian order)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return order != Endian::Little;
+#else
+    return order == Endian::Big;
+#endif
+}
+
+static inline uint32_t load16(const uint8_t *p, bool big)
+{
+    return big ? (p[0] << 8 | p[1]) : (p[0] | p[1] << 8);
+}
+
+// Add count 16 bit pixels to acc, or store them when first is set
+static void accumulate16(uint32_t *acc, const uint8_t *src, size_t count, bool big, bool first)
+{
+    size_t i = 0;
+#if defined(IMAGE_KERNELS_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2));
+        if (big)
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        __m128i *a = reinterpret_cast<__m128i *>(acc + i);
+        __m128i lo = _mm_unpacklo_epi16(v, zero);
+        __m128i hi = _mm_unpackhi_epi16(v, zero);
+        if (!first)
+        {
+            lo = _mm_add_epi32(_mm_loadu_si128(a), lo);
+            hi = _mm_add_epi32(_mm_loadu_si128(a + 1), hi);
+        }
+        _mm_storeu_si128(a, lo);
+        _mm_storeu_si128(a + 1, hi);
+    }
+#elif defined(IMAGE_KERNELS_NEON)
+    for (; i + 8 <= count; i += 8)
+    {
+        uint8x16_t b = vld1q_u8(src + i * 2);
+        if (big)
+            b = vrev16q_u8(b);
+        uint16x8_t v = vreinterpretq_u16_u8(b);
+        uint32x4_t lo = first ? vdupq_n_u32(0) : vld1q_u32(acc + i);
+        uint32x4_t hi = first ? vdupq_n_u32(0) : vld1q_u32(acc + i + 4);
+        vst1q_u32(acc + i, vaddw_u16(lo, vget_low_u16(v)));
+        vst1q_u32(acc + i + 4, vaddw_u16(hi, vget_high_u16(v)));
+    }
+#endif
+    for (; i < count; i++)
+        acc[i] = (first ? 0 : acc[i]) + load16(src + i * 2, big);
+}
+
+// Add count 8 bit pixels to acc, or store them when first is set
+static void accumulate8(uint32_t *acc, const uint8_t *src, size_t count, bool first)
+{
+    size_t i = 0;
+#if defined(IMAGE_KERNELS_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        __m128i *a = reinterpret_cast<__m128i *>(acc + i);
+        __m128i v0 = _mm_unpacklo_epi16(lo, zero);
+        __m128i v1 = _mm_unpackhi_epi16(lo, zero);
+        __m128i v2 = _mm_unpacklo_epi16(hi, zero);
+        __m128i v3 = _mm_unpackhi_epi16(hi, zero);
+        if (!first)
+        {
+            v0 = _mm_add_epi32(_mm_loadu_si128(a), v0);
+            v1 = _mm_add_epi32(_mm_loadu_si128(a + 1), v1);
+            v2 = _mm_add_epi32(_mm_loadu_si128(a + 2), v2);
+            v3 = _mm_add_epi32(_mm_loadu_si128(a + 3), v3);
+        }
+        _mm_storeu_si128(a, v0);
+        _mm_storeu_si128(a + 1, v1);
+        _mm_storeu_si128(a + 2, v2);
+        _mm_storeu_si128(a + 3, v3);
+    }
+#elif defined(IMAGE_KERNELS_NEON)
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8x16_t v = vld1q_u8(src + i);
+        uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+        uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+        const uint32x4_t zero = vdupq_n_u32(0);
+        vst1q_u32(acc + i, vaddw_u16(first ? zero : vld1q_u32(acc + i), vget_low_u16(lo)));
+        vst1q_u32(acc + i + 4, vaddw_u16(first ? zero : vld1q_u32(acc + i + 4), vget_high_u16(lo)));
+        vst1q_u32(acc + i + 8, vaddw_u16(first ? zero : vld1q_u32(acc + i + 8), vget_low_u16(hi)));
+        vst1q_u32(acc + i + 12, vaddw_u16(first ? zero : vld1q_u32(acc + i + 12), vget_high_u16(hi)));
+    }
+#endif
+    for (; i < count; i++)
+        acc[i] = (first ? 0 : acc[i]) + src[i];
+}
+
+// Sum pairs of acc into sums, the common 2x binning case
+static size_t sumPairs(uint32_t *sums, const uint32_t *acc, size_t count)
+{
+    size_t x = 0;
+#if defined(IMAGE_KERNELS_SSE2)
+    for (; x + 4 <= count; x += 4)
+    {
+        __m128 a = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + x * 2)));
+        __m128 b = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + x * 2 + 4)));
+        __m128i even = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i odd = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(sums + x), _mm_add_epi32(even, odd));
+    }
+#elif defined(IMAGE_KERNELS_NEON)
+    for (; x + 4 <= count; x += 4)
+    {
+        uint32x4x2_t v = vld2q_u32(acc + x * 2);
+        vst1q_u32(sums + x, vaddq_u32(v.val[0], v.val[1]));
+    }
+#endif
+    return x;
+}
+
+// Run rows [0, rows) through fn, split over up to threads threads
+static void forRows(size_t rows, size_t pixelsPerRow, unsigned threads, const std::function<void(size_t, size_t)> &fn)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    size_t useful = rows * pixelsPerRow / MIN_PIXELS_PER_THREAD;
+    size_t count = std::min<size_t>({threads, rows, std::max<size_t>(useful, 1)});
+    if (count <= 1)
+    {
+        fn(0, rows);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(count - 1);
+    size_t chunk = (rows + count - 1) / count;
+    for (size_t begin = chunk; begin < rows; begin += chunk)
+        workers.emplace_back(fn, begin, std::min(begin + chunk, rows));
+
+    // The first chunk runs on the caller
+    fn(0, std::min(chunk, rows));
+
+    for (auto &worker : workers)
+        worker.join();
+}
+
+template <typename T>
+static void binRows(T *dst, const uint8_t *src, size_t srcStride, size_t outW, size_t begin, size_t end,
+                    unsigned binX, unsigned binY, const BinOptions &options, size_t bytesPerPixel)
+{
+    const bool big = isBigEndian(options.order);
+    const uint32_t maxValue = (1u << (8 * sizeof(T))) - 1;
+    const uint32_t area = binX * binY;
+    const size_t width = outW * binX;
+
+    // Column sums of the bin rows, then the bin sums
+    std::vector<uint32_t> acc(width);
+    std::vector<uint32_t> sums(outW);
+
+    for (size_t row = begin; row < end; row++)
+    {
+        const uint8_t *line = src + row * binY * srcStride;
+        for (unsigned yy = 0; yy < binY; yy++, line += srcStride)
+        {
+            if (bytesPerPixel == 2)
+                accumulate16(acc.data(), line, width, big, yy == 0);
+            else
+                accumulate8(acc.data(), line, width, yy == 0);
+        }
+
+        const uint32_t *in = acc.data();
+        size_t x = 0;
+        if (binX == 1)
+            sums.assign(acc.begin(), acc.end());
+        else if (binX == 2)
+            x = sumPairs(sums.data(), in, outW);
+
+        for (in += x * binX; x < outW && binX > 1; x++, in += binX)
+        {
+            uint32_t sum = 0;
+            for (unsigned xx = 0; xx < binX; xx++)
+                sum += in[xx];
+            sums[x] = sum;
+        }
+
+        T *out = dst + row * outW;
+        if (options.mode == BinMode::Average)
+        {
+            for (x = 0; x < outW; x++)
+                out[x] = static_cast<T>(sums[x] / area);
+        }
+        else
+        {
+            for (x = 0; x < outW; x++)
+                out[x] = static_cast<T>(std::min(sums[x], maxValue));
+        }
+    }
+}
+
+template <typename T>
+static void bin(T *dst, const uint8_t *src, size_t srcStride, size_t width, size_t height, unsigned binX,
+                unsigned binY, const BinOptions &options)
+{
+    if (binX == 0 || binY == 0)
+        return;
+
+    size_t outW = width / binX;
+    size_t outH = height / binY;
+    if (outW == 0 || outH == 0)
+        return;
+
+    forRows(outH, outW * binX * binY, options.threads, [&](size_t begin, size_t end)
+    {
+        binRows<T>(dst, src, srcStride, outW, begin, end, binX, binY, options, sizeof(T));
+    });
+}
+
+void bin8(uint8_t *dst, const uint8_t *src, size_t srcStride, size_t width, size_t height, unsigned binX,
+          unsigned binY, const BinOptions &options)
+{
+    bin<uint8_t>(dst, src, srcStride, width, height, binX, binY, options);
+}
+
+void bin16(uint16_t *dst, const uint8_t *src, size_t srcStride, size_t width, size_t height, unsigned binX,
+           unsigned binY, const BinOptions &options)
+{
+    bin<uint16_t>(dst, src, srcStride, width, height, binX, binY, options);
+}
+
+void crop(uint8_t *dst, const uint8_t *src, size_t srcStride, size_t x, size_t y, size_t width, size_t height,
+          size_t bytesPerPixel)
+{
+    const size_t lineW = width * bytesPerPixel;
+    const uint8_t *in = src + y * srcStride + x * bytesPerPixel;
+
+    // Rows never move forward, so copying top down never reads a row that was already overwritten.
+    for (size_t row = 0; row < height; row++, in += srcStride)
+        memmove(dst + row * lineW, in, lineW);
+}
+
+void cropPlanes(uint8_t *buffer, size_t frameWidth, size_t frameHeight, size_t planes, size_t x, size_t y,
+                size_t width, size_t height, size_t bytesPerPixel)
+{
+    const size_t planeSize = frameWidth * frameHeight * bytesPerPixel;
+    const size_t cropSize = width * height * bytesPerPixel;
+
+    // One plane at a time. Cropped plane n ends before source plane n + 1 starts,
+    // so later planes are still intact when they are reached.
+    for (size_t plane = 0; plane < planes; plane++)
+        crop(buffer + plane * cropSize, buffer + plane * planeSize, frameWidth * bytesPerPixel, x, y, width, height,
+             bytesPerPixel);
+}
+
+void toHost16(uint16_t *dst, const uint8_t *src, size_t count, Endian order)
+{
+    const bool big = isBigEndian(order);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    const bool swap = !big;
+#else
+    const bool swap = big;
+#endif
+
+    if (!swap)
+    {
+        if (reinterpret_cast<const uint8_t *>(dst) != src)
+            memmove(dst, src, count * 2);
+        return;
+    }
+
+    size_t i = 0;
+#if defined(IMAGE_KERNELS_SSE2)
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+    }
+#elif defined(IMAGE_KERNELS_NEON)
+    for (; i + 8 <= count; i += 8)
+        vst1q_u8(reinterpret_cast<uint8_t *>(dst + i), vrev16q_u8(vld1q_u8(src + i * 2)));
+#endif
+    for (; i < count; i++)
+        dst[i] = static_cast<uint16_t>(load16(src + i * 2, big));
+}
+
+}
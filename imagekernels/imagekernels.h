@@ -0,0 +1,98 @@
+/*******************************************************************************
+ Image Kernels
+
+ Software binning, subframing and byte order conversion shared by camera
+ drivers whose hardware or SDK cannot do it themselves.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ImageKernels
+{
+
+/** Byte order of 16 bit source pixels. */
+enum class Endian
+{
+    Native,
+    Little,
+    Big
+};
+
+enum class BinMode
+{
+    /** Sum of the bin, saturated to the pixel range. */
+    Sum,
+    /** Mean of the bin, rounded down. */
+    Average
+};
+
+struct BinOptions
+{
+    BinMode mode { BinMode::Sum };
+    /** Byte order of the source, 16 bit binning only. */
+    Endian order { Endian::Native };
+    /** Split output rows over this many threads, 0 uses one per core. Small frames always run on the caller. */
+    unsigned threads { 1 };
+};
+
+/**
+ * @brief Bin a width x height region of 8 bit pixels by binX x binY.
+ *
+ * src points at the first pixel of the region and rows are srcStride bytes
+ * apart. The result is (width / binX) x (height / binY) tightly packed pixels;
+ * partial bins along the right and bottom edges are dropped.
+ */
+void bin8(uint8_t *dst, const uint8_t *src, size_t srcStride, size_t width, size_t height,
+          unsigned binX, unsigned binY, const BinOptions &options = BinOptions());
+
+/**
+ * @brief Bin a width x height region of 16 bit pixels by binX x binY.
+ *
+ * As bin8, with the source taken as raw bytes in options.order so SDK
+ * buffers can be binned without converting them first. src need not be
+ * aligned. The result is in host byte order.
+ */
+void bin16(uint16_t *dst, const uint8_t *src, size_t srcStride, size_t width, size_t height,
+           unsigned binX, unsigned binY, const BinOptions &options = BinOptions());
+
+/**
+ * @brief Copy a width x height region at (x, y) out of rows of srcStride bytes.
+ *
+ * dst receives tightly packed rows. dst may be src itself, or any buffer that
+ * does not start after the region, which covers subframing in place.
+ */
+void crop(uint8_t *dst, const uint8_t *src, size_t srcStride, size_t x, size_t y, size_t width, size_t height,
+          size_t bytesPerPixel);
+
+/**
+ * @brief Subframe a planar image in place.
+ *
+ * buffer holds planes consecutive frameWidth x frameHeight planes, as in the
+ * RGB frames of the webcam and DSLR drivers. Each plane is cropped to
+ * width x height at (x, y) and the cropped planes are packed one after the
+ * other from the start of the buffer.
+ */
+void cropPlanes(uint8_t *buffer, size_t frameWidth, size_t frameHeight, size_t planes, size_t x, size_t y,
+                size_t width, size_t height, size_t bytesPerPixel);
+
+/** Convert count 16 bit pixels stored in order to host order. dst may be the same buffer as src. */
+void toHost16(uint16_t *dst, const uint8_t *src, size_t count, Endian order);
+
+}
@@ -29,6 +29,7 @@ Anemometer code contributed by Joao Bento.
 #include "indiweather.h"
 #include "connectionplugins/connectionserial.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <iostream>
@@ -47,6 +48,11 @@ CloudWatcherController::CloudWatcherController(bool verbose) : verbose(verbose)
 {
 }
 
+CloudWatcherController::~CloudWatcherController()
+{
+    stopSampling();
+}
+
 const char *CloudWatcherController::getDeviceName()
 {
     return "AAG Cloud Watcher NG";
@@ -64,6 +70,8 @@ void CloudWatcherController::setAnemometerType(enum ANEMOMETER_TYPE type)
 
 bool CloudWatcherController::checkCloudWatcher()
 {
+    std::lock_guard<std::recursive_mutex> serialLock(serialMutex);
+
     sendCloudwatcherCommand("A!");
 
     char inputBuffer[BLOCK_SIZE * 2];
@@ -90,6 +98,8 @@ bool CloudWatcherController::checkCloudWatcher()
 
 bool CloudWatcherController::getSwitchStatus(int *switchStatus)
 {
+    std::lock_guard<std::recursive_mutex> serialLock(serialMutex);
+
     sendCloudwatcherCommand("F!");
 
     char inputBuffer[BLOCK_SIZE * 2];
@@ -119,19 +129,9 @@ bool CloudWatcherController::getSwitchStatus(int *switchStatus)
 
 bool CloudWatcherController::getAllData(CloudWatcherData *cwd)
 {
-    int skyTemperature[NUMBER_OF_READS] = {0};
-    int sensorTemperature[NUMBER_OF_READS] = {0};
-    int rainFrequency[NUMBER_OF_READS] = {0};
-    int internalSupplyVoltage[NUMBER_OF_READS] = {0};
-    int ambientTemperature[NUMBER_OF_READS] = {0};
-    int ldrValue[NUMBER_OF_READS] = {0};
-    int ldrFreqValue[NUMBER_OF_READS] = {0};
-    int rainSensorTemperature[NUMBER_OF_READS] = {0};
-    int windSpeed[NUMBER_OF_READS] = {0};
-    int humidity[NUMBER_OF_READS] = {0};
-    int pressure[NUMBER_OF_READS] = {0};
+    std::lock_guard<std::recursive_mutex> serialLock(serialMutex);
 
-    int check = 0;
+    SlidingAggregate window[SAMPLE_CHANNELS];
 
     totalReadings++;
 
@@ -140,126 +140,280 @@ bool CloudWatcherController::getAllData(CloudWatcherData *cwd)
 
     for (int i = 0; i < NUMBER_OF_READS; i++)
     {
-        check = getIRSkyTemperature(&skyTemperature[i]);
+        int sample[SAMPLE_CHANNELS] = {0};
 
-        if (!check)
+        if (!readSample(sample))
         {
-            LOG_ERROR( "ERROR in getIRSkyTemperature" );
             return false;
         }
 
-        check = getIRSensorTemperature(&sensorTemperature[i]);
-
-        if (!check)
+        for (int j = 0; j < SAMPLE_CHANNELS; j++)
         {
-            LOG_ERROR( "ERROR in getIRSensorTemperature" );
-            return false;
+            window[j].add(sample[j]);
         }
+    }
 
-        check = getRainFrequency(&rainFrequency[i]);
-        if (!check)
-        {
-            LOG_ERROR( "ERROR in getIRSensorTemperature" );
-            return false;
-        }
+    timeval end;
+    gettimeofday(&end, nullptr);
+
+    float rc = float(end.tv_sec - begin.tv_sec) + float(end.tv_usec - begin.tv_usec) / 1000000.0;
+
+    cwd->readCycle = rc;
+
+    fillAggregates(window, cwd);
+    cwd->totalReadings   = totalReadings;
+
+    return readStatus(cwd);
+}
+
+bool CloudWatcherController::readSample(int sample[])
+{
+    int check = getIRSkyTemperature(&sample[SAMPLE_SKY]);
+
+    if (!check)
+    {
+        LOG_ERROR( "ERROR in getIRSkyTemperature" );
+        return false;
+    }
+
+    check = getIRSensorTemperature(&sample[SAMPLE_SENSOR]);
+
+    if (!check)
+    {
+        LOG_ERROR( "ERROR in getIRSensorTemperature" );
+        return false;
+    }
+
+    check = getRainFrequency(&sample[SAMPLE_RAIN]);
+    if (!check)
+    {
+        LOG_ERROR( "ERROR in getIRSensorTemperature" );
+        return false;
+    }
+
+    check = getValues(&sample[SAMPLE_SUPPLY], &sample[SAMPLE_AMBIENT], &sample[SAMPLE_LDR], &sample[SAMPLE_LDR_FREQ],
+                      &sample[SAMPLE_RAIN_TEMPERATURE]);
+
+    if (!check)
+    {
+        LOG_ERROR( "ERROR in getValues" );
+        return false;
+    }
+
+    check = getWindSpeed(&sample[SAMPLE_WIND_SPEED]);
+
+    if (!check)
+    {
+        LOG_ERROR( "ERROR in getWindSpeed" );
+        return false;
+    }
 
-        check = getValues(&internalSupplyVoltage[i], &ambientTemperature[i], &ldrValue[i], &ldrFreqValue[i], &rainSensorTemperature[i]);
+    if (m_FirmwareVersion >= 5.6)
+    {
+        check = getHumidity(&sample[SAMPLE_HUMIDITY]);
 
         if (!check)
         {
-            LOG_ERROR( "ERROR in getValues" );
+            LOG_ERROR( "ERROR in getHumidity" );
             return false;
         }
+    }
 
-        check = getWindSpeed(&windSpeed[i]);
+    if (m_FirmwareVersion >= 5.8)
+    {
+
+        check = getPressure(&sample[SAMPLE_PRESSURE]);
 
         if (!check)
         {
-            LOG_ERROR( "ERROR in getWindSpeed" );
+            LOG_ERROR( "ERROR in getPressure" );
             return false;
         }
+    }
 
-        if (m_FirmwareVersion >= 5.6)
-        {
-            check = getHumidity(&humidity[i]);
+    return true;
+}
 
-            if (!check)
-            {
-                LOG_ERROR( "ERROR in getHumidity" );
-                return false;
-            }
-        }
+bool CloudWatcherController::readStatus(CloudWatcherData *cwd)
+{
+    int check = getIRErrors(&cwd->firstByteErrors, &cwd->commandByteErrors, &cwd->secondByteErrors, &cwd->pecByteErrors);
 
-        if (m_FirmwareVersion >= 5.8)
-        {
+    if (!check)
+    {
+        LOG_DEBUG( "ERROR in getIRErrors" );
+        return false;
+    }
 
-            check = getPressure(&pressure[i]);
+    cwd->internalErrors = cwd->firstByteErrors + cwd->commandByteErrors + cwd->secondByteErrors + cwd->pecByteErrors;
 
-            if (!check)
-            {
-                LOG_ERROR( "ERROR in getPressure" );
-                return false;
-            }
-        }
+    check = getPWMDutyCycle(&cwd->rainHeater);
+
+    if (!check)
+    {
+        LOG_DEBUG( "ERROR in getPWMDutyCycle" );
+        return false;
     }
 
-    timeval end;
-    gettimeofday(&end, nullptr);
+    check = getSwitchStatus(&cwd->switchStatus);
 
-    float rc = float(end.tv_sec - begin.tv_sec) + float(end.tv_usec - begin.tv_usec) / 1000000.0;
+    if (!check)
+    {
+        LOG_DEBUG( "ERROR in getSwitchStatus" );
+        return false;
+    }
 
-    cwd->readCycle = rc;
+    return true;
+}
 
-    cwd->sky             = aggregateInts(skyTemperature, NUMBER_OF_READS);
-    cwd->sensor          = aggregateInts(sensorTemperature, NUMBER_OF_READS);
-    cwd->rain            = aggregateInts(rainFrequency, NUMBER_OF_READS);
-    cwd->supply          = aggregateInts(internalSupplyVoltage, NUMBER_OF_READS);
-    cwd->ambient         = aggregateInts(ambientTemperature, NUMBER_OF_READS);
-    cwd->ldr             = aggregateInts(ldrValue, NUMBER_OF_READS);
-    cwd->ldrFreq          = aggregateInts(ldrFreqValue, NUMBER_OF_READS);
-    cwd->rainTemperature = aggregateInts(rainSensorTemperature, NUMBER_OF_READS);
-    cwd->windSpeed       = aggregateInts(windSpeed, NUMBER_OF_READS);
+void CloudWatcherController::fillAggregates(const SlidingAggregate window[], CloudWatcherData *cwd)
+{
+    cwd->sky             = window[SAMPLE_SKY].robustMean();
+    cwd->sensor          = window[SAMPLE_SENSOR].robustMean();
+    cwd->rain            = window[SAMPLE_RAIN].robustMean();
+    cwd->supply          = window[SAMPLE_SUPPLY].robustMean();
+    cwd->ambient         = window[SAMPLE_AMBIENT].robustMean();
+    cwd->ldr             = window[SAMPLE_LDR].robustMean();
+    cwd->ldrFreq         = window[SAMPLE_LDR_FREQ].robustMean();
+    cwd->rainTemperature = window[SAMPLE_RAIN_TEMPERATURE].robustMean();
+    cwd->windSpeed       = window[SAMPLE_WIND_SPEED].robustMean();
     if (m_FirmwareVersion >= 5.6)
-        cwd->humidity        = aggregateInts(humidity, NUMBER_OF_READS);
+        cwd->humidity        = window[SAMPLE_HUMIDITY].robustMean();
     else
         cwd->humidity = -1;
     if (m_FirmwareVersion >= 5.8)
-        cwd->pressure        = aggregateInts(pressure, NUMBER_OF_READS);
+        cwd->pressure        = window[SAMPLE_PRESSURE].robustMean();
     else
         cwd->pressure = -1;
-    cwd->totalReadings   = totalReadings;
+}
 
-    check = getIRErrors(&cwd->firstByteErrors, &cwd->commandByteErrors, &cwd->secondByteErrors, &cwd->pecByteErrors);
+void CloudWatcherController::startSampling()
+{
+    stopSampling();
 
-    if (!check)
     {
-        LOG_DEBUG( "ERROR in getIRErrors" );
-        return false;
+        std::lock_guard<std::mutex> lock(samplingMutex);
+        for (int i = 0; i < SAMPLE_CHANNELS; i++)
+        {
+            samplingWindow[i].clear();
+        }
+        snapshotReady = false;
+        samplingActive = true;
     }
 
-    cwd->internalErrors = cwd->firstByteErrors + cwd->commandByteErrors + cwd->secondByteErrors + cwd->pecByteErrors;
+    samplingThread = std::thread(&CloudWatcherController::samplingLoop, this);
+}
 
-    check = getPWMDutyCycle(&cwd->rainHeater);
+void CloudWatcherController::stopSampling()
+{
+    {
+        std::lock_guard<std::mutex> lock(samplingMutex);
+        samplingActive = false;
+    }
+    samplingCondition.notify_all();
 
-    if (!check)
+    if (samplingThread.joinable())
     {
-        LOG_DEBUG( "ERROR in getPWMDutyCycle" );
-        return false;
+        samplingThread.join();
     }
+}
 
-    check = getSwitchStatus(&cwd->switchStatus);
+void CloudWatcherController::setSamplingPeriod(double seconds)
+{
+    {
+        std::lock_guard<std::mutex> lock(samplingMutex);
+        samplingPeriod = std::chrono::milliseconds(static_cast<int>(seconds * 1000));
+    }
+    samplingCondition.notify_all();
+}
 
-    if (!check)
+bool CloudWatcherController::hasSnapshot()
+{
+    std::lock_guard<std::mutex> lock(samplingMutex);
+    return snapshotReady;
+}
+
+bool CloudWatcherController::getSnapshot(CloudWatcherData *cwd)
+{
+    std::lock_guard<std::mutex> lock(samplingMutex);
+
+    if (!snapshotReady)
     {
-        LOG_DEBUG( "ERROR in getSwitchStatus" );
         return false;
     }
 
+    // Do not hand out old readings as current if the device stopped answering
+    auto staleAfter = std::chrono::seconds(STALE_SNAPSHOT_SECONDS) + samplingPeriod * 3;
+    if (std::chrono::steady_clock::now() - snapshotTime > staleAfter)
+    {
+        LOG_ERROR( "Cloud Watcher readings are stale" );
+        return false;
+    }
+
+    *cwd = snapshot;
     return true;
 }
 
+void CloudWatcherController::samplingLoop()
+{
+    std::unique_lock<std::mutex> lock(samplingMutex);
+
+    while (samplingActive)
+    {
+        lock.unlock();
+
+        int sample[SAMPLE_CHANNELS] = {0};
+        CloudWatcherData status;
+
+        timeval begin;
+        gettimeofday(&begin, nullptr);
+
+        bool ok;
+        {
+            // Hold the port for one round only so switch/heater commands can get through in between
+            std::lock_guard<std::recursive_mutex> serialLock(serialMutex);
+            ok = readSample(sample) && readStatus(&status);
+        }
+
+        timeval end;
+        gettimeofday(&end, nullptr);
+
+        lock.lock();
+
+        if (ok)
+        {
+            for (int i = 0; i < SAMPLE_CHANNELS; i++)
+            {
+                samplingWindow[i].add(sample[i]);
+            }
+
+            totalReadings++;
+
+            fillAggregates(samplingWindow, &status);
+            status.readCycle = float(end.tv_sec - begin.tv_sec) + float(end.tv_usec - begin.tv_usec) / 1000000.0;
+            status.totalReadings = totalReadings;
+
+            snapshot = status;
+            snapshotTime = std::chrono::steady_clock::now();
+            snapshotReady = true;
+        }
+
+        auto pause = samplingPeriod;
+        if (!ok)
+        {
+            pause = std::max<std::chrono::milliseconds>(pause, std::chrono::milliseconds(ERROR_BACKOFF_MS));
+        }
+
+        samplingCondition.wait_for(lock, pause, [this]
+        {
+            return !samplingActive;
+        });
+    }
+}
+
 bool CloudWatcherController::getConstants(CloudWatcherConstants *cwc)
 {
+    std::lock_guard<std::recursive_mutex> serialLock(serialMutex);
+
     bool r = getFirmwareVersion(m_FirmwareVersion);
 
     if (!r)
@@ -303,6 +457,8 @@ bool CloudWatcherController::getConstants(CloudWatcherConstants *cwc)
 
 bool CloudWatcherController::closeSwitch()
 {
+    std::lock_guard<std::recursive_mutex> serialLock(serialMutex);
+
     sendCloudwatcherCommand("G!");
 
     char inputBuffer[BLOCK_SIZE * 2];
@@ -324,6 +480,8 @@ bool CloudWatcherController::closeSwitch()
 
 bool CloudWatcherController::openSwitch()
 {
+    std::lock_guard<std::recursive_mutex> serialLock(serialMutex);
+
     sendCloudwatcherCommand("H!");
 
     char inputBuffer[BLOCK_SIZE * 2];
@@ -345,6 +503,8 @@ bool CloudWatcherController::openSwitch()
 
 bool CloudWatcherController::setPWMDutyCycle(int pwmDutyCycle)
 {
+    std::lock_guard<std::recursive_mutex> serialLock(serialMutex);
+
     if (pwmDutyCycle < 0)
     {
         pwmDutyCycle = 0;
@@ -864,62 +1024,62 @@ bool CloudWatcherController::getIRErrors(int *firstAddressByteErrors, int *comma
     return true;
 }
 
-float CloudWatcherController::aggregateFloats(float values[], int numberOfValues)
+void SlidingAggregate::add(int value)
 {
-    float average = 0.0;
-
-    for (int i = 0; i < numberOfValues; i++)
+    if (count == SIZE)
     {
-        //    printMessage("%f\n", values[i]);
-
-        average += values[i];
+        int old = values[next];
+        sum   -= old;
+        sumSq -= double(old) * old;
+    }
+    else
+    {
+        count++;
     }
 
-    average /= numberOfValues;
+    values[next] = value;
+    sum   += value;
+    sumSq += double(value) * value;
+    next   = (next + 1) % SIZE;
+}
 
-    float stdD = 0.0;
+void SlidingAggregate::clear()
+{
+    count = 0;
+    next  = 0;
+    sum   = 0;
+    sumSq = 0;
+}
 
-    for (int i = 0; i < numberOfValues; i++)
+int SlidingAggregate::robustMean() const
+{
+    if (count == 0)
     {
-        stdD += (values[i] - average) * (values[i] - average);
+        return 0;
     }
 
-    stdD /= numberOfValues;
+    // Mean and deviation come from the running sums, only the trimming has to look at the window
+    double average = sum / count;
+    double stdD    = sqrt(std::max(0.0, sumSq / count - average * average));
 
-    stdD = sqrt(stdD);
-
-    //  printMessage("Average: %f, stdD: %f\n", average, stdD);
-
-    float newAverage  = 0.0;
+    double newAverage = 0.0;
     int numberOfItems = 0;
 
-    for (int i = 0; i < numberOfValues; i++)
+    for (int i = 0; i < count; i++)
     {
         if (fabs(values[i] - average) <= stdD)
         {
-            //      printMessage("%f\n", fabs(values[i] - average));
             newAverage += values[i];
             numberOfItems++;
         }
     }
 
-    newAverage /= numberOfItems;
-
-    printMessage("New average: %f\n", newAverage);
-
-    return newAverage;
-}
-
-int CloudWatcherController::aggregateInts(int values[], int numberOfValues)
-{
-    float newValues[numberOfValues];
-
-    for (int i = 0; i < numberOfValues; i++)
+    if (numberOfItems == 0)
     {
-        newValues[i] = (float)values[i];
+        return (int)average;
     }
 
-    return (int)aggregateFloats(newValues, numberOfValues);
+    return (int)(newAverage / numberOfItems);
 }
 
 bool CloudWatcherController::checkValidMessage(char *buffer, int nBlocks)
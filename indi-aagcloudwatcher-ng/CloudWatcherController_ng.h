@@ -24,6 +24,11 @@ Anemometer code contributed by Joao Bento.
 
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 /**
  *  A struct to group and send all AAG Cloud Watcher constants
  */
@@ -83,6 +88,45 @@ struct CloudWatcherData
     int pressure;          ///< atmospheric pressure
 };
 
+/**
+ * A sliding window of raw readings. Sum and sum of squares are kept up to date
+ * as readings come and go, so the robust mean only needs one pass to trim
+ * outliers.
+ */
+
+class SlidingAggregate
+{
+    public:
+        /**
+        * Number of readings kept in the window
+        */
+        const static int SIZE = 5;
+
+        /**
+        * Adds a reading, replacing the oldest one when the window is full
+        * @param value the raw reading
+        */
+        void add(int value);
+
+        /**
+        * Drops all readings
+        */
+        void clear();
+
+        /**
+        * Averages only the readings within [average - deviation, average + deviation]
+        * @return the aggregated value, 0 if the window is empty
+        */
+        int robustMean() const;
+
+    private:
+        int values[SIZE] = {0};
+        int count = 0;
+        int next = 0;
+        double sum = 0;
+        double sumSq = 0;
+};
+
 /**
  * A class  to communicate with the AAG Cloud Watcher. It is responsible to
  * send and recieve all the commands specified in the AAG Cloud Watcher
@@ -107,7 +151,7 @@ class CloudWatcherController
         /**
         * A destructor
         */
-        virtual ~CloudWatcherController() = default;
+        virtual ~CloudWatcherController();
 
         const char *getDeviceName();
 
@@ -148,6 +192,37 @@ class CloudWatcherController
         */
         bool getAllData(CloudWatcherData * cwd);
 
+        /**
+        * Starts the background sampling thread. It keeps querying the device and
+        * updates a sliding window of readings, see getSnapshot().
+        */
+        void startSampling();
+
+        /**
+        * Stops the background sampling thread and waits for it to finish
+        */
+        void stopSampling();
+
+        /**
+        * Sets the pause between two sampling rounds
+        * @param seconds the pause, 0 samples as fast as the device answers
+        */
+        void setSamplingPeriod(double seconds);
+
+        /**
+        * Gets the latest aggregated data gathered by the sampling thread. It does
+        * not talk to the device.
+        * @param cwd where the data will be stored.
+        * @return true if recent data is available. false otherwise.
+        */
+        bool getSnapshot(CloudWatcherData * cwd);
+
+        /**
+        * Tells whether the sampling thread completed a round since it was started.
+        * @return false until the first snapshot is available, true afterwards.
+        */
+        bool hasSnapshot();
+
         /**
         * Gets all constants from the AAG Cloud Watcher. Some of the constants are
         * retrieved from the device (from firmware version >3.0)
@@ -208,7 +283,55 @@ class CloudWatcherController
         /**
         * Number of reads to aggregate for the cloudwatcher data
         */
-        const static int NUMBER_OF_READS = 5;
+        const static int NUMBER_OF_READS = SlidingAggregate::SIZE;
+
+        /**
+        * Snapshots older than this (plus three sampling periods) are not reported
+        */
+        const static int STALE_SNAPSHOT_SECONDS = 10;
+
+        /**
+        * Shortest pause after a failed round, so a device that stopped answering is not retried in a tight loop
+        */
+        const static int ERROR_BACKOFF_MS = 1000;
+
+        /**
+        * Raw readings gathered in one sampling round
+        */
+        enum
+        {
+            SAMPLE_SKY,
+            SAMPLE_SENSOR,
+            SAMPLE_RAIN,
+            SAMPLE_SUPPLY,
+            SAMPLE_AMBIENT,
+            SAMPLE_LDR,
+            SAMPLE_LDR_FREQ,
+            SAMPLE_RAIN_TEMPERATURE,
+            SAMPLE_WIND_SPEED,
+            SAMPLE_HUMIDITY,
+            SAMPLE_PRESSURE,
+            SAMPLE_CHANNELS
+        };
+
+        /**
+        * Serializes command/answer exchanges between the sampling thread and
+        * the driver.
+        */
+        std::recursive_mutex serialMutex;
+
+        /**
+        * Sampling thread state, all guarded by samplingMutex
+        */
+        std::thread samplingThread;
+        std::mutex samplingMutex;
+        std::condition_variable samplingCondition;
+        bool samplingActive = false;
+        std::chrono::milliseconds samplingPeriod {0};
+        SlidingAggregate samplingWindow[SAMPLE_CHANNELS];
+        CloudWatcherData snapshot {};
+        std::chrono::steady_clock::time_point snapshotTime;
+        bool snapshotReady = false;
 
         /**
         * Hard coded constant. May be changed with internal device constants.
@@ -328,24 +451,30 @@ class CloudWatcherController
         bool getSerialNumber(int *serialNumber);
 
         /**
-        * Performs an aggregation of the values stored in a float array. It computes
-        * average and standard deviation of the array and averages only the values
-        * within [average - deviation, average + deviation]
-        * @param values the values to be aggregated
-        * @param numberOfValues the size of values
-        * @return the aggregated value
+        * Body of the sampling thread
+        */
+        void samplingLoop();
+
+        /**
+        * Reads one round of all sensors
+        * @param sample where the readings will be stored, indexed by SAMPLE_*
+        * @return true if succesfully read. false otherwise.
+        */
+        bool readSample(int sample[]);
+
+        /**
+        * Reads error counters, PWM duty cycle and switch status
+        * @param cwd where the values will be stored
+        * @return true if succesfully read. false otherwise.
         */
-        float aggregateFloats(float values[], int numberOfValues);
+        bool readStatus(CloudWatcherData *cwd);
 
         /**
-        * Performs an aggregation of the values stored in a int array. It computes
-        * average and standard deviation of the array and averages only the values
-        * within [average - deviation, average + deviation]
-        * @param values the values to be aggregated
-        * @param numberOfValues the size of values
-        * @return the aggregated value
+        * Fills the sensor values of cwd from the robust mean of each window
+        * @param window the readings, indexed by SAMPLE_*
+        * @param cwd where the values will be stored
         */
-        int aggregateInts(int values[], int numberOfValues);
+        void fillAggregates(const SlidingAggregate window[], CloudWatcherData *cwd);
 
         /**
         * Reads the current IR Sky Temperature value of the AAG Cloud Watcher
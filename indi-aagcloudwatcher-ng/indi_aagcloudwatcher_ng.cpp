@@ -74,6 +74,10 @@ bool AAGCloudWatcher::Handshake()
             setCriticalParameter("WEATHER_HUMIDITY");
         }
 
+        // Readings are gathered in the background, the weather poll only publishes them
+        cwc->setSamplingPeriod(getNumberValueFromVector(getNumber("samplingPeriod"), "period"));
+        cwc->startSampling();
+
         return true;
     }
     else
@@ -85,6 +89,12 @@ bool AAGCloudWatcher::Handshake()
 }
 
 
+bool AAGCloudWatcher::Disconnect()
+{
+    cwc->stopSampling();
+    return INDI::Weather::Disconnect();
+}
+
 /**********************************************************************
 ** Initialize all properties & set default values.
 **********************************************************************/
@@ -111,6 +121,12 @@ bool AAGCloudWatcher::initProperties()
 
 IPState AAGCloudWatcher::updateWeather()
 {
+    // The first sampling round after connecting has not finished yet
+    if (!cwc->hasSnapshot())
+    {
+        return IPS_BUSY;
+    }
+
     if (!sendData())
     {
         LOG_ERROR("Can not get data from device");
@@ -226,6 +242,17 @@ bool AAGCloudWatcher::ISNewNumber(const char *dev, const char *name, double valu
         return true;
     }
 
+    if (nvp.isNameMatch("samplingPeriod"))
+    {
+        nvp.update(values, names, n);
+        nvp.setState(IPS_OK);
+        nvp.apply();
+
+        cwc->setSamplingPeriod(nvp[0].getValue());
+
+        return true;
+    }
+
     if (nvp.isNameMatch("skyCorrection"))
     {
         for (int i = 0; i < 5; i++)
@@ -584,7 +611,7 @@ bool AAGCloudWatcher::sendData()
 {
     CloudWatcherData data;
 
-    if (cwc->getAllData(&data) == 0)
+    if (!cwc->getSnapshot(&data))
         return false;
 
     auto nvp = getNumber("readings");
@@ -763,9 +790,7 @@ bool AAGCloudWatcher::resetData()
 {
     CloudWatcherData data;
 
-    int r = cwc->getAllData(&data);
-
-    if (!r)
+    if (!cwc->getSnapshot(&data))
     {
         return false;
     }
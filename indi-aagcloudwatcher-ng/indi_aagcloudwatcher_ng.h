@@ -53,6 +53,7 @@ class AAGCloudWatcher : public INDI::Weather
 
     protected:
         virtual bool Handshake() override;
+        virtual bool Disconnect() override;
         virtual IPState updateWeather() override;
 
     private:
@@ -30,6 +30,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <vector>
 #include <map>
 #include <unistd.h>
@@ -88,8 +89,17 @@ void ASIBase::workerStreamVideo(const std::atomic_bool &isAboutToQuit)
         }
 
         if (mCurrentVideoFormat == ASI_IMG_RGB24)
+        {
             for (uint32_t i = 0; i < totalBytes; i += 3)
                 std::swap(targetFrame[i], targetFrame[i + 2]);
+        }
+        // Interleaved colour frames are streamed as is, masters are planar
+        else if (mCalibration.isEnabled(true))
+        {
+            mCalibration.process(targetFrame, PrimaryCCD.getSubW() / PrimaryCCD.getBinX(),
+                                 PrimaryCCD.getSubH() / PrimaryCCD.getBinY(), 1, PrimaryCCD.getBPP(),
+                                 calibrationKey(ExposureRequest), PrimaryCCD.getFrameType(), true);
+        }
 
         Streamer->newFrame(targetFrame, totalBytes);
     }
@@ -148,6 +158,110 @@ void ASIBase::workerBlinkExposure(const std::atomic_bool &isAboutToQuit, int bli
     }
 }
 
+void ASIBase::workerBurstExposure(const std::atomic_bool &isAboutToQuit, float duration, int frames)
+{
+    ASI_ERROR_CODE ret;
+    ASI_IMG_TYPE type = getImageType();
+    const double gapMS = BurstNP[BURST_GAP].getValue();
+
+    uint16_t subW = PrimaryCCD.getSubW() / PrimaryCCD.getBinX();
+    uint16_t subH = PrimaryCCD.getSubH() / PrimaryCCD.getBinY();
+    int nChannels = (type == ASI_IMG_RGB24) ? 3 : 1;
+    size_t nTotalBytes = subW * subH * nChannels * (PrimaryCCD.getBPP() / 8);
+    const bool is16Bit = (PrimaryCCD.getBPP() == 16);
+    const size_t nSamples = is16Bit ? nTotalBytes / 2 : nTotalBytes;
+
+    // Kept across bursts, only grows with the ROI
+    mBurstFrame.resize(nTotalBytes);
+    mBurstSum.assign(nSamples, 0);
+
+    PrimaryCCD.setExposureDuration(duration);
+
+    ret = ASISetControlValue(mCameraInfo.CameraID, ASI_EXPOSURE, duration * 1000 * 1000, ASI_FALSE);
+    if (ret != ASI_SUCCESS)
+    {
+        LOGF_ERROR("Failed to set exposure duration (%s).", Helpers::toString(ret));
+    }
+
+    ret = ASIStartVideoCapture(mCameraInfo.CameraID);
+    if (ret != ASI_SUCCESS)
+    {
+        LOGF_ERROR("Failed to start burst capture (%s).", Helpers::toString(ret));
+        PrimaryCCD.setExposureFailed();
+        return;
+    }
+
+    LOGF_INFO("Taking a burst of %d x %g seconds frames...", frames, duration);
+
+    const int waitMS = static_cast<int>((duration * 2000.0) + 500);
+    INDI::ElapsedTimer gapTimer;
+    int captured = 0, timeouts = 0;
+
+    while (captured < frames)
+    {
+        if (isAboutToQuit)
+        {
+            ASIStopVideoCapture(mCameraInfo.CameraID);
+            return;
+        }
+
+        PrimaryCCD.setExposureLeft(duration * (frames - captured));
+
+        ret = ASIGetVideoData(mCameraInfo.CameraID, mBurstFrame.data(), nTotalBytes, waitMS);
+        if (ret != ASI_SUCCESS)
+        {
+            if (ret == ASI_ERROR_TIMEOUT && ++timeouts < MAX_EXP_RETRIES)
+                continue;
+
+            LOGF_ERROR("Burst frame %d of %d failed (%s).", captured + 1, frames, Helpers::toString(ret));
+            ASIStopVideoCapture(mCameraInfo.CameraID);
+            PrimaryCCD.setExposureFailed();
+            return;
+        }
+        timeouts = 0;
+
+        // The camera keeps exposing, frames arriving within the gap are skipped
+        if (captured > 0 && gapMS > 0 && gapTimer.elapsed() < gapMS)
+            continue;
+        gapTimer.start();
+        captured++;
+
+        if (is16Bit)
+        {
+            const uint16_t *src = reinterpret_cast<const uint16_t *>(mBurstFrame.data());
+            for (size_t i = 0; i < nSamples; i++)
+                mBurstSum[i] += src[i];
+        }
+        else
+        {
+            for (size_t i = 0; i < nSamples; i++)
+                mBurstSum[i] += mBurstFrame[i];
+        }
+        LOGF_DEBUG("Burst frame %d of %d captured.", captured, frames);
+    }
+
+    ASIStopVideoCapture(mCameraInfo.CameraID);
+
+    // 16 bit data is MSB aligned, so only the mean fits the pixel range. It is rounded down.
+    std::unique_lock<std::mutex> guard(ccdBufferLock);
+    uint8_t *image = (type == ASI_IMG_RGB24) ? mBurstFrame.data() : PrimaryCCD.getFrameBuffer();
+    for (size_t i = 0; i < nSamples; i++)
+    {
+        uint32_t value = mBurstSum[i] / frames;
+        if (is16Bit)
+            reinterpret_cast<uint16_t *>(image)[i] = value;
+        else
+            image[i] = value;
+    }
+    if (type == ASI_IMG_RGB24)
+        Helpers::toPlanarRGB(PrimaryCCD.getFrameBuffer(), mBurstFrame.data(), subW * subH);
+    guard.unlock();
+
+    mBurstStacked = frames;
+    sendImage(type, duration);
+    mBurstStacked = 0;
+}
+
 void ASIBase::workerExposure(const std::atomic_bool &isAboutToQuit, float duration)
 {
     ASI_ERROR_CODE ret;
@@ -158,6 +272,19 @@ void ASIBase::workerExposure(const std::atomic_bool &isAboutToQuit, float durati
         BlinkNP[BLINK_DURATION].getValue()
     );
 
+    // Video capture cannot keep a mechanical shutter closed, so such darks are taken one at a time
+    int burstFrames = BurstNP[BURST_COUNT].getValue();
+    if (burstFrames > 1)
+    {
+        if (mCameraInfo.MechanicalShutter && PrimaryCCD.getFrameType() == INDI::CCDChip::DARK_FRAME)
+            LOG_WARN("Burst mode is not available for dark frames with a mechanical shutter, taking a single frame.");
+        else
+        {
+            workerBurstExposure(isAboutToQuit, duration, burstFrames);
+            return;
+        }
+    }
+
     PrimaryCCD.setExposureDuration(duration);
 
     LOGF_DEBUG("StartExposure->setexp : %.3fs", duration);
@@ -328,6 +455,13 @@ bool ASIBase::initProperties()
     BlinkNP[BLINK_DURATION].fill("BLINK_DURATION", "Blink duration",         "%2.3f", 0,  60, 0.001, 0);
     BlinkNP.fill(getDeviceName(), "BLINK", "Blink", CONTROL_TAB, IP_RW, 60, IPS_IDLE);
 
+    BurstNP[BURST_COUNT].fill("BURST_COUNT", "Frames per exposure", "%4.0f", 1, 1000, 1, 1);
+    BurstNP[BURST_GAP  ].fill("BURST_GAP",   "Frame gap (ms)",      "%6.0f", 0, 60000, 10, 0);
+    BurstNP.fill(getDeviceName(), "CCD_BURST", "Burst", CONTROL_TAB, IP_RW, 60, IPS_IDLE);
+
+
+    mCalibration.initProperties(IMAGE_SETTINGS_TAB);
+
     IUSaveText(&BayerT[2], getBayerString());
 
     ADCDepthNP[0].fill("BITS", "Bits", "%2.0f", 0, 32, 1, mCameraInfo.BitDepth);
@@ -453,6 +587,8 @@ bool ASIBase::updateProperties()
         }
 
         defineProperty(BlinkNP);
+        defineProperty(BurstNP);
+        mCalibration.updateProperties(true);
         defineProperty(ADCDepthNP);
         defineProperty(SDKVersionSP);
         if (!mSerialNumber.empty())
@@ -486,6 +622,8 @@ bool ASIBase::updateProperties()
             deleteProperty(VideoFormatSP.getName());
 
         deleteProperty(BlinkNP.getName());
+        deleteProperty(BurstNP.getName());
+        mCalibration.updateProperties(false);
         deleteProperty(SDKVersionSP.getName());
         if (!mSerialNumber.empty())
         {
@@ -769,6 +907,13 @@ bool ASIBase::ISNewNumber(const char *dev, const char *name, double values[], ch
             BlinkNP.apply();
             return true;
         }
+
+        if (BurstNP.isNameMatch(name))
+        {
+            BurstNP.setState(BurstNP.update(values, names, n) ? IPS_OK : IPS_ALERT);
+            BurstNP.apply();
+            return true;
+        }
     }
 
     return INDI::CCD::ISNewNumber(dev, name, values, names, n);
@@ -778,6 +923,9 @@ bool ASIBase::ISNewSwitch(const char *dev, const char *name, ISState *states, ch
 {
     if (dev != nullptr && !strcmp(dev, getDeviceName()))
     {
+        if (mCalibration.ISNewSwitch(dev, name, states, names, n))
+            return true;
+
         if (ControlSP.isNameMatch(name))
         {
             if (ControlSP.update(states, names, n) == false)
@@ -901,6 +1049,14 @@ bool ASIBase::ISNewSwitch(const char *dev, const char *name, ISState *states, ch
     return INDI::CCD::ISNewSwitch(dev, name, states, names, n);
 }
 
+bool ASIBase::ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n)
+{
+    if (mCalibration.ISNewText(dev, name, texts, names, n))
+        return true;
+
+    return INDI::CCD::ISNewText(dev, name, texts, names, n);
+}
+
 bool ASIBase::setVideoFormat(uint8_t index)
 {
     auto currentFormat = getImageType();
@@ -1170,26 +1326,28 @@ int ASIBase::grabImage(float duration)
 
     if (type == ASI_IMG_RGB24)
     {
-        uint8_t *dstR = image;
-        uint8_t *dstG = image + subW * subH;
-        uint8_t *dstB = image + subW * subH * 2;
-
-        const uint8_t *src = buffer;
-        const uint8_t *end = buffer + subW * subH * 3;
-
-        while (src != end)
-        {
-            *dstB++ = *src++;
-            *dstG++ = *src++;
-            *dstR++ = *src++;
-        }
-
+        Helpers::toPlanarRGB(image, buffer, subW * subH);
         free(buffer);
     }
     guard.unlock();
 
+    sendImage(type, duration);
+    return 0;
+}
+
+void ASIBase::sendImage(ASI_IMG_TYPE type, float duration)
+{
     PrimaryCCD.setNAxis(type == ASI_IMG_RGB24 ? 3 : 2);
 
+    // A burst is sent as its mean, which still matches the masters
+    if (mCalibration.isEnabled(false))
+    {
+        std::unique_lock<std::mutex> guard(ccdBufferLock);
+        mCalibration.process(PrimaryCCD.getFrameBuffer(), PrimaryCCD.getSubW() / PrimaryCCD.getBinX(),
+                             PrimaryCCD.getSubH() / PrimaryCCD.getBinY(), type == ASI_IMG_RGB24 ? 3 : 1,
+                             PrimaryCCD.getBPP(), calibrationKey(duration), PrimaryCCD.getFrameType(), false);
+    }
+
     // If mono camera or we're sending Luma or RGB, turn off bayering
     if (mCameraInfo.IsColorCam == false || type == ASI_IMG_Y8 || type == ASI_IMG_RGB24 || isMonoBinActive())
         SetCCDCapability(GetCCDCapability() & ~CCD_HAS_BAYER);
@@ -1200,7 +1358,20 @@ int ASIBase::grabImage(float duration)
         LOG_INFO("Download complete.");
 
     ExposureComplete(&PrimaryCCD);
-    return 0;
+}
+
+Calibration::FrameKey ASIBase::calibrationKey(double duration)
+{
+    Calibration::FrameKey key;
+    key.exposure = duration;
+
+    auto np = ControlNP.findWidgetByName("Gain");
+    if (np)
+        key.gain = np->getValue();
+
+    key.temperature = mCurrentTemperature;
+
+    return key;
 }
 
 bool ASIBase::isMonoBinActive()
@@ -1519,6 +1690,13 @@ void ASIBase::addFITSKeywords(INDI::CCDChip *targetChip, std::vector<INDI::FITSR
     {
         fitsKeywords.push_back({"OFFSET", np->value, 3, "Offset"});
     }
+
+    if (mBurstStacked > 0)
+    {
+        fitsKeywords.push_back({"NCOMBINE", mBurstStacked, "Number of burst frames combined"});
+    }
+
+    mCalibration.addFITSKeywords(fitsKeywords);
 }
 
 bool ASIBase::saveConfigItems(FILE *fp)
@@ -1541,6 +1719,8 @@ bool ASIBase::saveConfigItems(FILE *fp)
         VideoFormatSP.save(fp);
 
     BlinkNP.save(fp);
+    BurstNP.save(fp);
+    mCalibration.saveConfigItems(fp);
 
     return true;
 }
@@ -28,6 +28,7 @@
 #include "indipropertynumber.h"
 #include "indipropertytext.h"
 #include "indisinglethreadpool.h"
+#include "calibrationstage.h"
 
 #include <vector>
 
@@ -58,6 +59,7 @@ class ASIBase : public INDI::CCD
 
         virtual bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override;
         virtual bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n) override;
+        virtual bool ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n) override;
 
         // Streaming
         virtual bool StartStreaming() override;
@@ -88,13 +90,22 @@ class ASIBase : public INDI::CCD
         void workerStreamVideo(const std::atomic_bool &isAboutToQuit);
         void workerBlinkExposure(const std::atomic_bool &isAboutToQuit, int blinks, float duration);
         void workerExposure(const std::atomic_bool &isAboutToQuit, float duration);
+        /** Capture frames back to back through the video engine and send their mean, see BurstNP */
+        void workerBurstExposure(const std::atomic_bool &isAboutToQuit, float duration, int frames);
 
         /** Get image from CCD and send it to client */
         int grabImage(float duration);
 
+        /** Send the frame in the CCD buffer to the client */
+        void sendImage(ASI_IMG_TYPE type, float duration);
+
+        /** Key of the frames being taken, to pick calibration masters */
+        Calibration::FrameKey calibrationKey(double duration);
+
     protected:
         double mTargetTemperature;
-        double mCurrentTemperature;
+        /** Last sensor temperature read, NAN until the first reading */
+        double mCurrentTemperature {NAN};
         INDI::Timer mTimerTemperature;
         void temperatureTimerTimeout();
 
@@ -152,6 +163,22 @@ class ASIBase : public INDI::CCD
             BLINK_DURATION
         };
 
+        INDI::PropertyNumber  BurstNP {2};
+        enum
+        {
+            BURST_COUNT,
+            BURST_GAP
+        };
+
+        /** Burst frame as read from the SDK, and the running sum of the stack */
+        std::vector<uint8_t>  mBurstFrame;
+        std::vector<uint32_t> mBurstSum;
+        /** Number of frames combined into the image being sent, 0 if not stacked */
+        int mBurstStacked {0};
+
+        /** Optional bias, dark and flat calibration of exposures and stream frames */
+        Calibration::Stage mCalibration {this};
+
         INDI::PropertySwitch  FlipSP {2};
         enum
         {
@@ -299,7 +299,7 @@ bool ASICCD::ISNewText(const char *dev, const char *name, char *texts[], char *n
             return true;
         }
     }
-    return INDI::CCD::ISNewText(dev, name, texts, names, n);
+    return ASIBase::ISNewText(dev, name, texts, names, n);
 }
 
 ///////////////////////////////////////////////////////////////////////
@@ -23,6 +23,9 @@
 #include <ASICamera2.h>
 #include <indibasetypes.h>
 
+#include <cstddef>
+#include <cstdint>
+
 namespace Helpers
 {
 
@@ -126,4 +129,21 @@ INDI_PIXEL_FORMAT pixelFormat(ASI_IMG_TYPE type, ASI_BAYER_PATTERN pattern, bool
     return INDI_MONO;
 }
 
+// Split interleaved BGR pixels, as delivered for ASI_IMG_RGB24, into R, G and B planes
+void toPlanarRGB(uint8_t *dst, const uint8_t *src, size_t pixels)
+{
+    uint8_t *dstR = dst;
+    uint8_t *dstG = dst + pixels;
+    uint8_t *dstB = dst + pixels * 2;
+
+    const uint8_t *end = src + pixels * 3;
+
+    while (src != end)
+    {
+        *dstB++ = *src++;
+        *dstG++ = *src++;
+        *dstR++ = *src++;
+    }
+}
+
 }
@@ -31,12 +31,18 @@
 #include <unistd.h>
 #include <deque>
 #include <memory>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
 
 #define MAX_CONNECTION_RETRIES  5
 #define MAX_EXP_RETRIES         3
 #define VERBOSE_EXPOSURE        3
 #define TEMP_TIMER_MS           1000 /* Temperature polling time (ms) */
 #define TEMP_THRESHOLD          .25  /* Differential temperature threshold (C)*/
+#define ABORT_TIMEOUT_MS        10000 /* Longest wait for the imaging thread to leave an exposure (ms) */
 
 #define CONTROL_TAB "Controls"
 
@@ -302,6 +308,9 @@ bool ATIKCCD::setupParams()
     SetCCDParams(pProp.nPixelsX, pProp.nPixelsY, 16, pProp.PixelMicronsX, pProp.PixelMicronsY);
     // Set frame buffer size
     PrimaryCCD.setFrameBufferSize(PrimaryCCD.getXRes() * PrimaryCCD.getYRes() * PrimaryCCD.getBPP() / 8, false);
+    // Full frame is the largest image the camera can send, so downloads never allocate
+    for (auto &buffer : frameBuffers)
+        buffer.resize(PrimaryCCD.getFrameBufferSize());
 
     m_CameraFlags = pProp.cameraflags;
     LOGF_DEBUG("Camera flags: %d", m_CameraFlags);
@@ -522,20 +531,25 @@ bool ATIKCCD::setupParams()
     }
 
     // Create imaging thread
+    if (pipe(wakeFD) != 0)
+    {
+        LOGF_ERROR("Error creating imaging thread wake up pipe (%s)", strerror(errno));
+        return false;
+    }
+    fcntl(wakeFD[0], F_SETFL, fcntl(wakeFD[0], F_GETFL) | O_NONBLOCK);
+    fcntl(wakeFD[1], F_SETFL, fcntl(wakeFD[1], F_GETFL) | O_NONBLOCK);
+
     threadRequest = StateIdle;
-    threadState = StateNone;
+    threadState = StateIdle;
     int stat = pthread_create(&imagingThread, nullptr, &imagingHelper, this);
     if (stat != 0)
     {
         LOGF_ERROR("Error creating imaging thread (%d)", stat);
+        close(wakeFD[0]);
+        close(wakeFD[1]);
+        wakeFD[0] = wakeFD[1] = -1;
         return false;
     }
-    pthread_mutex_lock(&condMutex);
-    while (threadState == StateNone)
-    {
-        pthread_cond_wait(&cv, &condMutex);
-    }
-    pthread_mutex_unlock(&condMutex);
 
     return true;
 }
@@ -629,13 +643,19 @@ bool ATIKCCD::Disconnect()
     RemoveTimer(genTimerID);
     genTimerID = -1;
 
-    pthread_mutex_lock(&condMutex);
     tState = threadState;
     threadRequest = StateTerminate;
-    pthread_cond_signal(&cv);
-    pthread_mutex_unlock(&condMutex);
+    wakeImagingThread();
     pthread_join(imagingThread, nullptr);
+    close(wakeFD[0]);
+    close(wakeFD[1]);
+    wakeFD[0] = wakeFD[1] = -1;
     tState = StateNone;
+
+    // The frame buffer belongs to the driver, never let INDI release it
+    std::unique_lock<std::mutex> guard(ccdBufferLock);
+    PrimaryCCD.setFrameBuffer(nullptr);
+    guard.unlock();
     if (isSimulation() == false)
     {
         if (tState == StateExposure)
@@ -1029,10 +1049,8 @@ bool ATIKCCD::StartExposure(float duration)
         LOGF_INFO("Taking a %g seconds frame...", ExposureRequest);
 
     InExposure = true;
-    pthread_mutex_lock(&condMutex);
     threadRequest = StateExposure;
-    pthread_cond_signal(&cv);
-    pthread_mutex_unlock(&condMutex);
+    wakeImagingThread();
 
     return true;
 }
@@ -1044,15 +1062,14 @@ bool ATIKCCD::StartExposure(float duration)
 bool ATIKCCD::AbortExposure()
 {
     LOG_DEBUG("Aborting camera exposure...");
-    pthread_mutex_lock(&condMutex);
     threadRequest = StateAbort;
-    pthread_cond_signal(&cv);
-    while (threadState == StateExposure)
-    {
-        pthread_cond_wait(&cv, &condMutex);
-    }
-    pthread_mutex_unlock(&condMutex);
+    wakeImagingThread();
+    // The imaging thread wakes up at once and leaves the exposure loop, unless it is busy downloading
+    if (!waitThreadStateLeaves(StateExposure, ABORT_TIMEOUT_MS))
+        LOG_WARN("Imaging thread did not leave the exposure in time, stopping the exposure anyway.");
+    pthread_mutex_lock(&accessMutex);
     ArtemisStopExposure(hCam);
+    pthread_mutex_unlock(&accessMutex);
     InExposure = false;
     return true;
 }
@@ -1075,6 +1092,11 @@ bool ATIKCCD::UpdateCCDFrame(int x, int y, int w, int h)
 
     // Total bytes required for image buffer
     PrimaryCCD.setFrameBufferSize(w / PrimaryCCD.getBinX() * h / PrimaryCCD.getBinY() * PrimaryCCD.getBPP() / 8, false);
+    for (auto &buffer : frameBuffers)
+    {
+        if (buffer.size() < static_cast<size_t>(PrimaryCCD.getFrameBufferSize()))
+            buffer.resize(PrimaryCCD.getFrameBufferSize());
+    }
     return true;
 }
 
@@ -1098,12 +1120,15 @@ bool ATIKCCD::UpdateCCDBin(int binx, int biny)
 /////////////////////////////////////////////////////////
 bool ATIKCCD::grabImage()
 {
-    //uint8_t *image = PrimaryCCD.getFrameBuffer();
     int x, y, w, h, binx, biny;
 
+    pthread_mutex_lock(&accessMutex);
     int rc = ArtemisGetImageData(hCam, &x, &y, &w, &h, &binx, &biny);
     if (rc != ARTEMIS_OK)
+    {
+        pthread_mutex_unlock(&accessMutex);
         return false;
+    }
 
     int bufferSize = w * binx * h * biny * PrimaryCCD.getBPP() / 8;
     if ( bufferSize < PrimaryCCD.getFrameBufferSize())
@@ -1113,8 +1138,17 @@ bool ATIKCCD::grabImage()
         PrimaryCCD.setFrameBufferSize(bufferSize, false);
     }
 
+    // Copy the frame out of the SDK buffer, which the next exposure overwrites, into the next of our buffers.
+    // The previous buffer is left alone as it may still be in use by a fast exposure upload.
+    std::vector<uint8_t> &frame = frameBuffers[nextFrameBuffer];
+    nextFrameBuffer = (nextFrameBuffer + 1) % FRAME_BUFFER_COUNT;
+    if (frame.size() < static_cast<size_t>(PrimaryCCD.getFrameBufferSize()))
+        frame.resize(PrimaryCCD.getFrameBufferSize());
+    memcpy(frame.data(), ArtemisImageBuffer(hCam), PrimaryCCD.getFrameBufferSize());
+    pthread_mutex_unlock(&accessMutex);
+
     std::unique_lock<std::mutex> guard(ccdBufferLock);
-    PrimaryCCD.setFrameBuffer(reinterpret_cast<uint8_t*>(ArtemisImageBuffer(hCam)));
+    PrimaryCCD.setFrameBuffer(frame.data());
     guard.unlock();
 
     if (ExposureRequest > VERBOSE_EXPOSURE)
@@ -1361,45 +1395,101 @@ void *ATIKCCD::imagingHelper(void *context)
 /////////////////////////////////////////////////////////
 void *ATIKCCD::imagingThreadEntry()
 {
-    pthread_mutex_lock(&condMutex);
-    threadState = StateIdle;
-    pthread_cond_signal(&cv);
     while (true)
     {
-        while (threadRequest == StateIdle)
+        ImageState request = threadRequest;
+        if (request == StateIdle)
         {
-            pthread_cond_wait(&cv, &condMutex);
+            waitImagingThread(-1);
+            continue;
         }
-        threadState = threadRequest;
-        if (threadRequest == StateExposure)
+        setThreadState(request);
+        if (request == StateExposure)
         {
             checkExposureProgress();
         }
-        else if (threadRequest == StateRestartExposure)
+        else if (request == StateRestartExposure)
         {
-            threadRequest = StateIdle;
-            pthread_mutex_unlock(&condMutex);
+            threadRequest.compare_exchange_strong(request, StateIdle);
             StartExposure(ExposureRequest);
-            pthread_mutex_lock(&condMutex);
         }
-        else if (threadRequest == StateTerminate)
+        else if (request == StateTerminate)
         {
             break;
         }
         else
         {
-            threadRequest = StateIdle;
-            pthread_cond_signal(&cv);
+            // Only clear the request we served, a new one may have been posted meanwhile
+            threadRequest.compare_exchange_strong(request, StateIdle);
         }
-        threadState = StateIdle;
+        setThreadState(StateIdle);
     }
-    threadState = StateTerminated;
-    pthread_cond_signal(&cv);
-    pthread_mutex_unlock(&condMutex);
+    setThreadState(StateTerminated);
 
     return nullptr;
 }
 
+/////////////////////////////////////////////////////////
+/// Publish the imaging thread state to waiting threads
+/////////////////////////////////////////////////////////
+void ATIKCCD::setThreadState(ImageState state)
+{
+    pthread_mutex_lock(&stateMutex);
+    threadState = state;
+    pthread_cond_broadcast(&stateCond);
+    pthread_mutex_unlock(&stateMutex);
+}
+
+/////////////////////////////////////////////////////////
+/// Wait until the imaging thread is no longer in state,
+/// false if timeout (ms) expired first
+/////////////////////////////////////////////////////////
+bool ATIKCCD::waitThreadStateLeaves(ImageState state, int timeout)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout / 1000;
+    deadline.tv_nsec += (timeout % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    int rc = 0;
+    pthread_mutex_lock(&stateMutex);
+    while (threadState == state && rc != ETIMEDOUT)
+        rc = pthread_cond_timedwait(&stateCond, &stateMutex, &deadline);
+    bool left = threadState != state;
+    pthread_mutex_unlock(&stateMutex);
+    return left;
+}
+
+/////////////////////////////////////////////////////////
+/// Wake up the imaging thread after posting a request
+/////////////////////////////////////////////////////////
+void ATIKCCD::wakeImagingThread()
+{
+    const char byte = 0;
+    // A full pipe already holds a pending wake up
+    if (write(wakeFD[1], &byte, 1) < 0 && errno != EAGAIN)
+        LOGF_DEBUG("Failed to wake up imaging thread (%s)", strerror(errno));
+}
+
+/////////////////////////////////////////////////////////
+/// Sleep until woken up or timeout (ms) expires
+/////////////////////////////////////////////////////////
+void ATIKCCD::waitImagingThread(int timeout)
+{
+    struct pollfd pfd = { wakeFD[0], POLLIN, 0 };
+    if (poll(&pfd, 1, timeout) > 0)
+    {
+        char drain[16];
+        while (read(wakeFD[0], drain, sizeof(drain)) > 0)
+            ;
+    }
+}
+
 /////////////////////////////////////////////////////////
 /// Dedicated imaging thread
 /////////////////////////////////////////////////////////
@@ -1410,20 +1500,18 @@ void ATIKCCD::checkExposureProgress()
 
     while (threadRequest == StateExposure)
     {
-        pthread_mutex_unlock(&condMutex);
         pthread_mutex_lock(&accessMutex);
         if (ArtemisImageReady(hCam))
         {
+            pthread_mutex_unlock(&accessMutex);
             InExposure = false;
             PrimaryCCD.setExposureLeft(0.0);
             if (ExposureRequest > VERBOSE_EXPOSURE)
                 DEBUG(INDI::Logger::DBG_SESSION, "Exposure done, downloading image...");
-            pthread_mutex_lock(&condMutex);
             exposureSetRequest(StateIdle);
-            pthread_mutex_unlock(&condMutex);
+            // The SDK is only locked for the download, the frame is sent unlocked so
+            // cooler and filter polling and the next exposure are not held up by it.
             grabImage();
-            pthread_mutex_lock(&condMutex);
-            pthread_mutex_unlock(&accessMutex);
             break;
         }
 
@@ -1442,7 +1530,6 @@ void ATIKCCD::checkExposureProgress()
                 ArtemisStopExposure(hCam);
                 pthread_mutex_unlock(&accessMutex);
                 usleep(100000);
-                pthread_mutex_lock(&condMutex);
                 exposureSetRequest(StateRestartExposure);
                 break;
             }
@@ -1457,7 +1544,6 @@ void ATIKCCD::checkExposureProgress()
                 pthread_mutex_unlock(&accessMutex);
                 PrimaryCCD.setExposureFailed();
                 usleep(100000);
-                pthread_mutex_lock(&condMutex);
                 exposureSetRequest(StateIdle);
                 break;
             }
@@ -1487,8 +1573,8 @@ void ATIKCCD::checkExposureProgress()
             PrimaryCCD.setExposureLeft(timeLeft);
         }
 
-        usleep(uSecs);
-        pthread_mutex_lock(&condMutex);
+        // Returns early when an abort or a new request is posted
+        waitImagingThread(uSecs / 1000);
     }
 }
 
@@ -1497,10 +1583,8 @@ void ATIKCCD::checkExposureProgress()
 /////////////////////////////////////////////////////////
 void ATIKCCD::exposureSetRequest(ImageState request)
 {
-    if (threadRequest == StateExposure)
-    {
-        threadRequest = request;
-    }
+    ImageState expected = StateExposure;
+    threadRequest.compare_exchange_strong(expected, request);
 }
 
 /////////////////////////////////////////////////////////
@@ -26,6 +26,9 @@
 #include <indifilterinterface.h>
 #include <indiccd.h>
 
+#include <atomic>
+#include <vector>
+
 class ATIKCCD : public INDI::CCD, public INDI::FilterInterface
 {
     public:
@@ -123,6 +126,13 @@ class ATIKCCD : public INDI::CCD, public INDI::FilterInterface
         void checkExposureProgress();
         void exposureSetRequest(ImageState request);
 
+        // Imaging thread wake up, timeout in ms or -1 to wait until woken
+        void wakeImagingThread();
+        void waitImagingThread(int timeout);
+        // Imaging thread state, signalled to threads waiting for it to change
+        void setThreadState(ImageState state);
+        bool waitThreadStateLeaves(ImageState state, int timeout);
+
         // Guiding
         static void TimerHelperNS(void *context);
         static void TimerHelperWE(void *context);
@@ -239,13 +249,23 @@ class ATIKCCD : public INDI::CCD, public INDI::FilterInterface
         int genTimerID {-1};
 
         // Imaging thread
-        ImageState threadRequest;
-        ImageState threadState;
+        std::atomic<ImageState> threadRequest { StateNone };
+        std::atomic<ImageState> threadState { StateNone };
         pthread_t imagingThread;
-        pthread_cond_t cv         = PTHREAD_COND_INITIALIZER;
-        pthread_mutex_t condMutex = PTHREAD_MUTEX_INITIALIZER;
+        // Self pipe waking the imaging thread when a new request is posted
+        int wakeFD[2] { -1, -1 };
+        // Guards threadState changes for waitThreadStateLeaves()
+        pthread_mutex_t stateMutex = PTHREAD_MUTEX_INITIALIZER;
+        pthread_cond_t stateCond = PTHREAD_COND_INITIALIZER;
+        // Serializes SDK calls only, never held while a frame is sent
         pthread_mutex_t accessMutex = PTHREAD_MUTEX_INITIALIZER;
 
+        // Frames are copied out of the SDK buffer into these in turn, so the next exposure
+        // can be downloaded by the SDK while the previous frame is still being sent.
+        static constexpr int FRAME_BUFFER_COUNT = 2;
+        std::vector<uint8_t> frameBuffers[FRAME_BUFFER_COUNT];
+        int nextFrameBuffer {0};
+
         // Pulse Guiding
         int WEtimerID;
         int NStimerID;
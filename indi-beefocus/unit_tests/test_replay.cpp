@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "beeconnect.h"
+#include "beefocus.h"
+#include "replaybench.h"
+
+namespace BeeReplayTest {
+
+///
+/// @brief Send the status requests TimerHit sends and read back the replies
+///
+/// @param[in]  con      - Connection to the (replayed) focuser
+/// @param[out] position - Position reported by the focuser
+/// @return              - true if all three replies came back
+///
+bool StatusCycle( BeeFocusedCon::Interface& con, int& position )
+{
+  con << "SSTATUS\n";
+  con << "MSTATUS\n";
+  con << "PSTATUS\n";
+
+  for ( int i = 0; i < 3; ++i )
+  {
+    std::vector<std::string> tokens = BeeFocused::Tokenize( BeeFocusedCon::GetString( con ));
+    if ( con.Failed() || tokens.size() < 2 )
+    {
+      return false;
+    }
+    if ( tokens[0] == "Position:" )
+    {
+      position = std::stoi( tokens[1] );
+    }
+  }
+  return true;
+}
+
+///
+/// @brief Decode a recorded status exchange over a pty
+///
+TEST( REPLAY, StatusCycle )
+{
+  SerialReplay::Device device(
+    SerialReplay::Transcript::load( REPLAY_DIR "/status.txt" ));
+  ASSERT_TRUE( device.start() );
+
+  int fd = device.connect();
+  ASSERT_GE( fd, 0 );
+
+  BeeFocusedCon::TCP con( fd );
+  int position = 0;
+  ASSERT_TRUE( StatusCycle( con, position ));
+  ASSERT_EQ( position, 1234 );
+  ASSERT_EQ( device.mismatches(), 0u );
+
+  close( fd );
+}
+
+///
+/// @brief Round trip latency of a full status cycle
+///
+TEST( REPLAY, StatusCycleBenchmark )
+{
+  SerialReplay::Device device(
+    SerialReplay::Transcript::load( REPLAY_DIR "/status.txt" ));
+  device.setLoop( true );
+  device.setTimeScale( 0 );
+  ASSERT_TRUE( device.start() );
+
+  int fd = device.connect();
+  ASSERT_GE( fd, 0 );
+
+  BeeFocusedCon::TCP con( fd );
+  SerialReplay::Bench bench( device );
+  auto result = bench.run( "beefocus.status", 200, [&con]()
+  {
+    int position = 0;
+    return StatusCycle( con, position );
+  });
+
+  ASSERT_EQ( result.failures, 0u );
+  ASSERT_EQ( result.mismatches, 0u );
+
+  close( fd );
+}
+
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "auxproto.h"
+#include "replaybench.h"
+
+using SerialReplay::Bench;
+using SerialReplay::Device;
+using SerialReplay::Transcript;
+
+// Same one second limit the driver uses on the serial port
+static const int READ_TIMEOUT_MS = 1000;
+
+static bool readBytes(int fd, uint8_t *buf, size_t len)
+{
+    size_t got = 0;
+    while (got < len)
+    {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, READ_TIMEOUT_MS) <= 0)
+            return false;
+
+        ssize_t n = read(fd, buf + got, len - got);
+        if (n <= 0)
+            return false;
+        got += n;
+    }
+    return true;
+}
+
+// Read one AUX packet the way CelestronAUX::serialReadResponse does.
+static bool readPacket(int fd, AUXCommand &packet)
+{
+    uint8_t buf[32];
+
+    do
+    {
+        if (!readBytes(fd, buf, 1))
+            return false;
+    }
+    while (buf[0] != 0x3b);
+
+    if (!readBytes(fd, buf + 1, 1) || buf[1] + 3 > static_cast<int>(sizeof(buf)))
+        return false;
+
+    if (!readBytes(fd, buf + 2, buf[1] + 1))
+        return false;
+
+    packet.parseBuf(AUXBuffer(buf, buf + buf[1] + 3));
+    return true;
+}
+
+// Send a command and wait for the reply of its destination, skipping the echo.
+static bool roundTrip(int fd, AUXTargets target, uint32_t &value)
+{
+    AUXCommand command(MC_GET_POSITION, APP, target);
+    AUXBuffer buf;
+    command.fillBuf(buf);
+    if (write(fd, buf.data(), buf.size()) != static_cast<ssize_t>(buf.size()))
+        return false;
+
+    AUXCommand reply;
+    do
+    {
+        if (!readPacket(fd, reply))
+            return false;
+    }
+    while (reply.source() != target || reply.command() != MC_GET_POSITION);
+
+    value = reply.getData();
+    return true;
+}
+
+TEST(AUXReplay, Position)
+{
+    Device device(Transcript::load(REPLAY_DIR "/position.txt"));
+    ASSERT_TRUE(device.start());
+
+    int fd = device.connect();
+    ASSERT_GE(fd, 0);
+
+    uint32_t azm = 0, alt = 0;
+    ASSERT_TRUE(roundTrip(fd, AZM, azm));
+    ASSERT_TRUE(roundTrip(fd, ALT, alt));
+    EXPECT_EQ(azm, 0x123456u);
+    EXPECT_EQ(alt, 0x654321u);
+    EXPECT_EQ(device.mismatches(), 0u);
+
+    close(fd);
+}
+
+TEST(AUXReplay, PositionBenchmark)
+{
+    Device device(Transcript::load(REPLAY_DIR "/position.txt"));
+    device.setLoop(true);
+    // Bound only by the wire speed of the AUX bus
+    device.setTimeScale(0);
+    device.setBaudRate(19200);
+    ASSERT_TRUE(device.start());
+
+    int fd = device.connect();
+    ASSERT_GE(fd, 0);
+
+    Bench bench(device);
+    auto result = bench.run("celestronaux.position", 100, [fd]()
+    {
+        uint32_t azm, alt;
+        return roundTrip(fd, AZM, azm) && roundTrip(fd, ALT, alt);
+    });
+
+    EXPECT_EQ(result.failures, 0u);
+    EXPECT_EQ(result.mismatches, 0u);
+
+    close(fd);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
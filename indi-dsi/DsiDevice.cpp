@@ -13,6 +13,7 @@
 #include "DsiException.h"
 #include "Util.h"
 
+#include <algorithm>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
@@ -808,10 +809,188 @@ int DSI::Device::startExposure(int howlong, int gain, int offs)
     return 0;
 }
 
+/**
+ * Size the persistent field and frame buffers for the current binning mode.
+ *
+ * This is called when the camera is connected and whenever the binning (and
+ * hence the readout geometry) changes, so that downloadImage() never has to
+ * allocate memory while the camera is streaming a frame.
+ */
+void DSI::Device::reserveBuffers()
+{
+    unsigned int t_read_width      = ((read_bpp * read_width / 512) + 1) * 256;
+    unsigned int t_read_height_even = read_height_even;
+    unsigned int t_read_height_odd  = read_height_odd;
+
+    if (binning2x2)
+    {
+        t_read_width       = ((read_bpp * read_width / 512) + 1) * 128;
+        t_read_height_even = read_height_even / 2;
+        t_read_height_odd  = read_height_odd / 2;
+    }
+
+    allocateBuffers(read_bpp * t_read_width * t_read_height_even, read_bpp * t_read_width * t_read_height_odd,
+                    read_bpp * t_read_width * (t_read_height_even + t_read_height_odd));
+}
+
+/**
+ * Make sure the field and frame buffers can hold at least the requested
+ * number of bytes.  Buffers only ever grow, so switching back and forth
+ * between binning modes does not reallocate them.
+ */
+void DSI::Device::allocateBuffers(unsigned int even_size, unsigned int odd_size, unsigned int all_size)
+{
+    if (even_buffer.size() < even_size)
+        even_buffer.resize(even_size);
+    if (odd_buffer.size() < odd_size)
+        odd_buffer.resize(odd_size);
+    if (frame_buffer.size() < all_size)
+        frame_buffer.resize(all_size);
+
+    framebuffer = frame_buffer.data();
+}
+
+/**
+ * Estimate the libusb timeout in milliseconds for reading out size bytes.
+ *
+ * @param size number of bytes to read from the image endpoint
+ * @param pending exposure time (in 100us ticks) still to elapse before the
+ *        camera starts sending data
+ */
+unsigned int DSI::Device::readoutTimeout(unsigned int size, unsigned int pending)
+{
+    return pending / 10 + size / READOUT_BYTES_PER_MS + READOUT_MARGIN_MS;
+}
+
+static void LIBUSB_CALL field_transfer_done(struct libusb_transfer *transfer)
+{
+    *static_cast<int *>(transfer->user_data) = 1;
+}
+
+/**
+ * Read the even and odd fields from the image endpoint.
+ *
+ * Both fields are queued as asynchronous bulk transfers before waiting, so
+ * the second field is already pending on the host controller while the
+ * camera is still sending the first one.  A size of zero skips that field,
+ * which is how the progressive DSI III readout is handled.
+ */
+void DSI::Device::readFields(unsigned int even_size, unsigned int odd_size, unsigned int timeout)
+{
+    struct
+    {
+        const char *name;
+        unsigned char *data;
+        unsigned int size;
+        libusb_transfer *transfer;
+        int completed;
+    } fields[2] = { { "even", even_buffer.data(), even_size, nullptr, 1 },
+                    { "odd", odd_buffer.data(), odd_size, nullptr, 1 } };
+
+    std::stringstream error;
+
+    for (auto &field : fields)
+    {
+        if (field.size == 0)
+            continue;
+
+        field.transfer = libusb_alloc_transfer(0);
+        if (field.transfer == nullptr)
+        {
+            error << "read " << field.name << " data, unable to allocate transfer";
+            break;
+        }
+
+        field.completed = 0;
+        libusb_fill_bulk_transfer(field.transfer, handle, 0x86, field.data, field.size, field_transfer_done,
+                                  &field.completed, timeout * MILLISEC);
+
+        int status = libusb_submit_transfer(field.transfer);
+        if (status != 0)
+        {
+            field.completed = 1;
+            error << std::dec << "read " << field.name << " data, status = (" << status << ") " << libusb_error_name(status);
+            break;
+        }
+    }
+
+    /* If queueing failed half way, the field already submitted has to be
+     * cancelled and reaped before its transfer can be freed. */
+    if (!error.str().empty())
+    {
+        for (auto &field : fields)
+            if (!field.completed)
+                libusb_cancel_transfer(field.transfer);
+    }
+
+    for (auto &field : fields)
+    {
+        while (!field.completed)
+            libusb_handle_events_completed(nullptr, &field.completed);
+    }
+
+    for (auto &field : fields)
+    {
+        if (field.transfer == nullptr)
+            continue;
+
+        if (log_commands)
+        {
+            log_command_info(false, "r 86", field.transfer->actual_length, (char *)field.data, 0);
+            std::cerr << std::dec << "read " << field.name << " data, status = (" << field.transfer->status << ")"
+                      << std::endl
+                      << "Transferred: " << field.transfer->actual_length << " bytes" << std::endl;
+        }
+
+        if (error.str().empty() && field.transfer->status != LIBUSB_TRANSFER_COMPLETED)
+            error << std::dec << "read " << field.name << " data, transfer status = (" << field.transfer->status << ")";
+
+        libusb_free_transfer(field.transfer);
+    }
+
+    if (!error.str().empty())
+        throw device_read_error(error.str());
+}
+
+/**
+ * Copy the visible part of the raw field data into the frame buffer.
+ *
+ * Pixels are kept in the big-endian byte order the camera sends, so every
+ * image row is a single contiguous copy out of the even or odd field.
+ */
+void DSI::Device::deinterlace(bool interlaced, unsigned int t_read_width, unsigned int t_image_width,
+                              unsigned int t_image_height, unsigned int t_image_offset_x, unsigned int t_image_offset_y)
+{
+    const unsigned int row_bytes = t_image_width * 2;
+    unsigned char *write_ptr     = framebuffer;
+
+    for (unsigned int y_ptr = 0; y_ptr < t_image_height; y_ptr++)
+    {
+        unsigned int row = y_ptr + t_image_offset_y;
+        const unsigned char *field;
+        unsigned int line_start;
+
+        if (interlaced)
+        {
+            field      = (row % 2) ? odd_buffer.data() : even_buffer.data();
+            line_start = t_read_width * (row / 2);
+        }
+        else
+        {
+            field      = odd_buffer.data();
+            line_start = t_read_width * row;
+        }
+
+        memcpy(write_ptr, field + (line_start + t_image_offset_x) * 2, row_bytes);
+        write_ptr += row_bytes;
+    }
+
+    if (log_commands)
+        std::cerr << "write_ptr=" << (write_ptr - framebuffer) << std::endl;
+}
+
 unsigned char *DSI::Device::downloadImage()
 {
-    int status = 0;
-    int transferred = 0;
     int interlaced = 0;
     int rawtemp = 0;
     unsigned int t_read_width = 0;
@@ -858,79 +1037,25 @@ unsigned char *DSI::Device::downloadImage()
     unsigned int odd_size  = t_read_bpp * t_read_width * t_read_height_odd;
     unsigned int even_size = t_read_bpp * t_read_width * t_read_height_even;
     unsigned int all_size  = t_read_bpp * t_read_width * t_read_height;
-    unsigned char *odd_data = new unsigned char[odd_size];
-    unsigned char *even_data = nullptr;
-
-    if (interlaced)
-        even_data = new unsigned char[even_size];
 
-    framebuffer = new unsigned char[all_size];
+    allocateBuffers(interlaced ? even_size : 0, odd_size, all_size);
 
-    if (interlaced)
-    {
-        /* XXX: There has to be  a way to calculate a more optimal readout
-               time here. */
-        status = libusb_bulk_transfer(handle, 0x86, even_data, even_size, &transferred, 60000 * MILLISEC);
-        if (log_commands)
-        {
-            log_command_info(false, "r 86", (status > 0 ? status : 0), (char *)even_data, 0);
-
-            std::cerr << std::dec << "read even data, status = (" << status << ") " << (status > 0 ? "" : strerror(-status))
-                      << std::endl
-                      << "    requested " << even_size << " bytes " << t_read_width << " x " << t_read_height_even
-                      << " (even pixels)" << std::endl
-                      << "Transferred: " << transferred << " bytes" << std::endl;
-        }
-
-        if (status != 0)
-        {
-            std::stringstream ss;
-            ss << std::dec << "read even data, status = (" << status << ") " << strerror(-status);
-            throw device_read_error(ss.str());
-        }
-
-        status = libusb_bulk_transfer(handle, 0x86, odd_data, odd_size, &transferred, 60000 * MILLISEC);
-        if (log_commands)
-        {
-            log_command_info(false, "r 86", (status > 0 ? status : 0), (char *)odd_data, 0);
-
-            std::cerr << std::dec << "read odd data, status = (" << status << ") " << (status > 0 ? "" : strerror(-status))
-                      << std::endl
-                      << "    requested " << odd_size << " bytes " << t_read_width << " x " << t_read_height_odd
-                      << " (odd pixels)" << std::endl
-                      << "Transferred: " << transferred << " bytes" << std::endl;
-        }
-
-        if (status != 0)
-        {
-            std::stringstream ss;
-            ss << std::dec << "read odd data, status = (" << status << ") " << strerror(-status);
-            throw device_read_error(ss.str());
-        }
-    }
-    else // progressive mode for DSI III (gs)
+    if (!interlaced) // progressive mode for DSI III (gs)
     {
         if ((!vdd_on) && (exposure_time >= VDD_TRH))
             command(DeviceCommand::SET_VDD_MODE, VddMode::ON.value());
+    }
 
-        status = libusb_bulk_transfer(handle, 0x86, odd_data, odd_size, &transferred, 60000 * MILLISEC);
-        if (log_commands)
-        {
-            log_command_info(false, "r 86", (status > 0 ? status : 0), (char *)odd_data, 0);
-
-            std::cerr << std::dec << "read progressive data, status = (" << status << ") " << std::endl
-                      << "    requested " << odd_size << " bytes " << t_read_width << " x " << t_read_height_odd
-                      << " (pixels)" << std::endl
-                      << "Transferred: " << transferred << " bytes" << std::endl;
-        }
+    /* Short exposures are downloaded right after the trigger, long ones once
+     * the exposure timer is about to expire, so at most LONGEXP ticks of the
+     * exposure are still pending when the transfers are queued. */
+    readFields(interlaced ? even_size : 0, odd_size,
+               readoutTimeout(interlaced ? all_size : odd_size, std::min<unsigned int>(exposure_time, LONGEXP)));
 
-        if (status != 0)
-        {
-            std::stringstream ss;
-            ss << std::dec << "read progressive data, status = (" << status << ") ";
-            throw device_read_error(ss.str());
-        }
-    }
+    if (log_commands)
+        std::cerr << std::dec << "read " << (interlaced ? "interlaced" : "progressive") << " data" << std::endl
+                  << "    requested " << t_read_width << " x " << t_read_height_even << " (even pixels), "
+                  << t_read_width << " x " << t_read_height_odd << " (odd pixels)" << std::endl;
 
     /* Update temperature for devices with sensor (gs) */
 
@@ -945,11 +1070,6 @@ unsigned char *DSI::Device::downloadImage()
     /* disable 2x2 binning after downloading image (gs) */
     disable2x2Binning();
 
-    unsigned char msb = 0, lsb = 0, is_odd = 0;
-    unsigned int x_ptr = 0, line_start = 0, y_ptr = 0, read_ptr = 0, write_ptr = 0;
-    char *even = (char *)even_data;
-    char *odd  = (char *)odd_data;
-
     if (log_commands)
         std::cerr << "t_image_height  =" << t_image_height << std::endl
                   << "t_image_width   =" << t_image_width << std::endl
@@ -959,67 +1079,7 @@ unsigned char *DSI::Device::downloadImage()
                   << "t_read_height   =" << t_read_height << std::endl
                   << "t_read_bpp      =" << t_read_bpp << std::endl;
 
-    if (interlaced)
-    {
-        for (write_ptr = y_ptr = 0; y_ptr < t_image_height; y_ptr++)
-        {
-            line_start = t_read_width * ((y_ptr + t_image_offset_y) / 2);
-            is_odd     = (y_ptr + t_image_offset_y) % 2;
-
-            std::cerr << "starting image row " << y_ptr << ", write_ptr=" << write_ptr << ", line_start=" << line_start
-                      << ", is_odd=" << (is_odd == 0 ? 0 : 1) << ", read_ptr=" << (line_start + t_image_offset_x) * 2
-                      << std::endl;
-
-            for (x_ptr = 0; x_ptr < t_image_width; x_ptr++)
-            {
-                read_ptr = (line_start + x_ptr + t_image_offset_x) * 2;
-                if (is_odd == 1) // odd line
-                {
-                    msb = odd[read_ptr];
-                    lsb = odd[read_ptr + 1];
-                }
-                else
-                {
-                    // even line
-                    msb = even[read_ptr];
-                    lsb = even[read_ptr + 1];
-                }
-                framebuffer[write_ptr++] = msb;
-                framebuffer[write_ptr++] = lsb;
-            }
-        }
-    }
-    else
-    {
-        for (write_ptr = y_ptr = 0; y_ptr < t_image_height; y_ptr++)
-        {
-            line_start = t_read_width * (y_ptr + t_image_offset_y);
-
-            // std::cerr << "starting image row " << y_ptr
-            //      << ", write_ptr=" << write_ptr
-            //      << ", line_start=" << line_start
-            //      << ", read_ptr=" << (line_start+t_image_offset_x)*2
-            //      << std::endl;
-            for (x_ptr = 0; x_ptr < t_image_width; x_ptr++)
-            {
-                read_ptr = (line_start + x_ptr + t_image_offset_x) * 2;
-
-                msb = odd[read_ptr];
-                lsb = odd[read_ptr + 1];
-
-                framebuffer[write_ptr++] = msb;
-                framebuffer[write_ptr++] = lsb;
-            }
-        }
-    }
-
-    if (log_commands)
-        std::cerr << "write_ptr=" << write_ptr << std::endl;
-
-    delete[] odd_data;
-
-    if (interlaced)
-        delete[] even_data;
+    deinterlace(interlaced, t_read_width, t_image_width, t_image_height, t_image_offset_x, t_image_offset_y);
 
     return framebuffer;
 
@@ -1092,14 +1152,11 @@ void DSI::Device::disable2x2Binning()
 
 unsigned char *DSI::Device::getImage(DeviceCommand __command, int howlong)
 {
-    int transferred = 0;
-
     if (((__command == DeviceCommand::TRIGGER)) || (__command == DeviceCommand::TEST_PATTERN))
     {
         // Monkey code.  Monkey see (SniffUSB), monkey do).  Some part of this
         // is required because w/o it, I get segfaults on the second attempt
         // to run the code.
-        int status = 0;
         int interlaced = 0;
         int rawtemp = 0;
 
@@ -1306,13 +1363,8 @@ unsigned char *DSI::Device::getImage(DeviceCommand __command, int howlong)
         unsigned int odd_size  = t_read_bpp * t_read_width * t_read_height_odd;
         unsigned int even_size = t_read_bpp * t_read_width * t_read_height_even;
         unsigned int all_size  = t_read_bpp * t_read_width * t_read_height;
-        unsigned char *odd_data = new unsigned char[odd_size];
-        unsigned char *even_data = nullptr;
-
-        if (interlaced)
-            even_data = new unsigned char[even_size];
 
-        framebuffer = new unsigned char[all_size];
+        allocateBuffers(interlaced ? even_size : 0, odd_size, all_size);
 
         /* The Meade driver seems to only issue a GET_EXP_TIME_COUNT command
          * when the exposure is over about 2 seconds (count = 20,000).  From
@@ -1332,46 +1384,8 @@ unsigned char *DSI::Device::getImage(DeviceCommand __command, int howlong)
         if (last_time == 0)
             last_time = get_sysclock_ms();
 
-        if (interlaced)
-        {
-            /* XXX: There has to be  a way to calculate a more optimal readout
-               time here. */
-            status = libusb_bulk_transfer(handle, 0x86, even_data, even_size, &transferred, 60000 * MILLISEC);
-            if (log_commands)
-            {
-                log_command_info(false, "r 86", (status > 0 ? status : 0), (char *)even_data, 0);
-
-                std::cerr << std::dec << "read even data, status = (" << status << ") " << (status > 0 ? "" : strerror(-status))
-                          << std::endl
-                          << "    requested " << even_size << " bytes " << t_read_width << " x " << t_read_height_even
-                          << " (even pixels)" << std::endl;
-            }
-
-            if (status < 0)
-            {
-                std::stringstream ss;
-                ss << std::dec << "read even data, status = (" << status << ") " << strerror(-status);
-                throw device_read_error(ss.str());
-            }
-        }
-
-        status = libusb_bulk_transfer(handle, 0x86, odd_data, odd_size, &transferred, 60000 * MILLISEC);
-        if (log_commands)
-        {
-            log_command_info(false, "r 86", (status > 0 ? status : 0), (char *)even_data, 0);
-
-            std::cerr << std::dec << "read odd data, status = (" << status << ") " << (status > 0 ? "" : strerror(-status))
-                      << std::endl
-                      << "    requested " << odd_size << " bytes " << t_read_width << " x " << t_read_height_odd
-                      << " (odd pixels)" << std::endl;
-        }
-
-        if (status < 0)
-        {
-            std::stringstream ss;
-            ss << std::dec << "read odd data, status = (" << status << ") " << strerror(-status);
-            throw device_read_error(ss.str());
-        }
+        readFields(interlaced ? even_size : 0, odd_size,
+                   readoutTimeout(interlaced ? all_size : odd_size, std::min(time_left, 5000)));
 
         if (has_tempsensor)
         {
@@ -1383,11 +1397,6 @@ unsigned char *DSI::Device::getImage(DeviceCommand __command, int howlong)
 
         disable2x2Binning();
 
-        unsigned char msb = 0, lsb = 0, is_odd = 0;
-        unsigned int x_ptr = 0, line_start = 0, y_ptr = 0, read_ptr = 0, write_ptr = 0;
-        char *even = (char *)even_data;
-        char *odd  = (char *)odd_data;
-
         if (log_commands)
             std::cerr << "t_image_height  =" << t_image_height << std::endl
                       << "t_image_width   =" << t_image_width << std::endl
@@ -1397,65 +1406,7 @@ unsigned char *DSI::Device::getImage(DeviceCommand __command, int howlong)
                       << "t_read_height   =" << t_read_height << std::endl
                       << "t_read_bpp      =" << t_read_bpp << std::endl;
 
-        if (interlaced)
-        {
-            for (write_ptr = y_ptr = 0; y_ptr < t_image_height; y_ptr++)
-            {
-                line_start = t_read_width * ((y_ptr + t_image_offset_y) / 2);
-                is_odd     = (y_ptr + t_image_offset_y) % 2;
-
-                std::cerr << "starting image row " << y_ptr << ", write_ptr=" << write_ptr << ", line_start=" << line_start
-                          << ", is_odd=" << (is_odd == 0 ? 0 : 1) << ", read_ptr=" << (line_start + t_image_offset_x) * 2
-                          << std::endl;
-                for (x_ptr = 0; x_ptr < t_image_width; x_ptr++)
-                {
-                    read_ptr = (line_start + x_ptr + t_image_offset_x) * 2;
-                    if (is_odd == 1) // odd line
-                    {
-                        msb = odd[read_ptr];
-                        lsb = odd[read_ptr + 1];
-                    }
-                    else
-                    {
-                        // even line
-                        msb = even[read_ptr];
-                        lsb = even[read_ptr + 1];
-                    }
-                    framebuffer[write_ptr++] = msb;
-                    framebuffer[write_ptr++] = lsb;
-                }
-            }
-        }
-        else
-        {
-            for (write_ptr = y_ptr = 0; y_ptr < t_image_height; y_ptr++)
-            {
-                line_start = t_read_width * (y_ptr + t_image_offset_y);
-
-                //std::cerr << "starting image row " << y_ptr
-                //     << ", write_ptr=" << write_ptr
-                //     << ", line_start=" << line_start
-                //     << ", read_ptr=" << (line_start+t_image_offset_x)*2 << std::endl;
-                for (x_ptr = 0; x_ptr < t_image_width; x_ptr++)
-                {
-                    read_ptr = (line_start + x_ptr + t_image_offset_x) * 2;
-
-                    msb = odd[read_ptr];
-                    lsb = odd[read_ptr + 1];
-
-                    framebuffer[write_ptr++] = msb;
-                    framebuffer[write_ptr++] = lsb;
-                }
-            }
-        }
-
-        if (log_commands)
-            std::cerr << "write_ptr=" << write_ptr << std::endl;
-
-        delete[] odd_data;
-
-        if (interlaced)
-            delete[] even_data;
+        deinterlace(interlaced, t_read_width, t_image_width, t_image_height, t_image_offset_x, t_image_offset_y);
 
         return framebuffer;
     }
@@ -11,6 +11,7 @@
 #include <libusb-1.0/libusb.h>
 
 #include <string>
+#include <vector>
 
 #ifndef LONGEXP
 #define LONGEXP 20000
@@ -30,9 +31,15 @@ class Device
     std::string camera_name;
 
   protected:
-    /* image frame buffer (gs) */
+    /* image frame buffer (gs), points into frame_buffer */
     unsigned char *framebuffer;
 
+    /* Raw field buffers and the de-interlaced frame.  They are owned by the
+         * device and reused across exposures, see reserveBuffers(). */
+    std::vector<unsigned char> even_buffer;
+    std::vector<unsigned char> odd_buffer;
+    std::vector<unsigned char> frame_buffer;
+
     /* These are chip-specific sizes required to parameterize the image
          * retrieval.
          */
@@ -128,6 +135,12 @@ class Device
     static const unsigned int TIMEOUT_FULL_MAX_REQUEST  = 0x03e8;
     static const unsigned int TIMEOUT_HIGH_MAX_REQUEST  = 0x03e8;
 
+    /* Conservative lower bound of the image readout rate in bytes per
+         * millisecond (slow readout over a full speed bus), and the slack
+         * added on top of the computed image transfer time. */
+    static const unsigned int READOUT_BYTES_PER_MS = 100;
+    static const unsigned int READOUT_MARGIN_MS    = 5000;
+
     // Methods with "load" mean read and initialize the information from
     // the camera.
     void loadSerialNumber();
@@ -177,6 +190,12 @@ class Device
 
     void sendRegister(AdRegister adr, unsigned int arg);
 
+    void allocateBuffers(unsigned int even_size, unsigned int odd_size, unsigned int all_size);
+    unsigned int readoutTimeout(unsigned int size, unsigned int pending);
+    void readFields(unsigned int even_size, unsigned int odd_size, unsigned int timeout);
+    void deinterlace(bool interlaced, unsigned int t_read_width, unsigned int t_image_width,
+                     unsigned int t_image_height, unsigned int t_image_offset_x, unsigned int t_image_offset_y);
+
   public:
     Device(const char *devname = 0);
     virtual ~Device();
@@ -210,6 +229,7 @@ class Device
     virtual void setExposureTime(double exptime);
     virtual double getExposureTime();
     virtual unsigned char *downloadImage();
+    virtual void reserveBuffers();
     virtual int startExposure(int howlong, int gain = 0, int offs = 0x0ff);
     virtual int ExposureInProgress();
     virtual unsigned char *ccdFramebuffer();
@@ -105,6 +105,8 @@ bool DSICCD::Connect()
 
     SetCCDCapability(cap);
 
+    dsi->reserveBuffers();
+
     if (dsi->hasTempSensor())
     {
         CCDTempN[0].value = dsi->ccdTemp();
@@ -249,6 +251,7 @@ bool DSICCD::UpdateCCDBin(int hor, int ver)
     {
         PrimaryCCD.setBin(hor, ver);
         dsi->set1x1Binning();
+        dsi->reserveBuffers();
         // DSI III 1x1 binning results in a GBRG frame
         if (dsi->getCcdChipName() == "ICX285AQ")
             IUSaveText(&BayerT[2], "GBRG");
@@ -258,6 +261,7 @@ bool DSICCD::UpdateCCDBin(int hor, int ver)
     {
         PrimaryCCD.setBin(hor, ver);
         dsi->set2x2Binning();
+        dsi->reserveBuffers();
         // DSI III 1x1 binning results in a consolidated mono frame
         if (dsi->getCcdChipName() == "ICX285AQ")
             IUSaveText(&BayerT[2], "");
@@ -504,8 +508,6 @@ void DSICCD::grabImage()
         }
     }
 
-    delete buf;
-
     // Let INDI::CCD know we're done filling the image buffer
     ExposureComplete(&PrimaryCCD);
 
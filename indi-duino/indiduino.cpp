@@ -34,6 +34,7 @@
 
 #include <indicontroller.h>
 
+#include <cmath>
 #include <memory>
 #include <sys/stat.h>
 
@@ -92,7 +93,21 @@ void indiduino::TimerHit()
     if (isConnected() == false)
         return;
 
-    sf->OnIdle();
+    // Only vectors with a pin the reader thread saw change need to be looked at
+    std::bitset<128> dirty = sf->takeDirtyPins();
+    bool stringChanged = sf->takeStringDirty();
+    auto hasDirtyPin = [&](auto &vp)
+    {
+        for (auto &qp: vp)
+        {
+            IO *pin_config = (IO *)qp.getAux();
+            if (pin_config != nullptr && dirty.test(pin_config->pin))
+                return true;
+        }
+        return false;
+    };
+
+    std::unique_lock<std::mutex> stateLock = sf->lockState();
 
     for (const auto &it: *getProperties())
     {
@@ -104,7 +119,7 @@ void indiduino::TimerHit()
         {
             bool changed = false;
             auto lvp = getLight(name);
-            if (lvp.getLight()->getAux() != (void *)indiduino_id)
+            if (lvp.getLight()->getAux() != (void *)indiduino_id || !hasDirtyPin(lvp))
                 continue;
 
             for (auto &lqp: lvp)
@@ -145,7 +160,7 @@ void indiduino::TimerHit()
             int n_on = 0;
             auto svp = getSwitch(name);
 
-            if (svp.getSwitch()->getAux() != (void *)indiduino_id)
+            if (svp.getSwitch()->getAux() != (void *)indiduino_id || !hasDirtyPin(svp))
                 continue;
 
             for (auto &sqp: svp)
@@ -203,7 +218,7 @@ void indiduino::TimerHit()
             bool changed = false;
             auto nvp = getNumber(name);
 
-            if (nvp.getNumber()->getAux() != (void *)indiduino_id)
+            if (nvp.getNumber()->getAux() != (void *)indiduino_id || !hasDirtyPin(nvp))
                 continue;
 
             for (auto &eqp: nvp)
@@ -215,10 +230,12 @@ void indiduino::TimerHit()
                 if (pin_config->IOType == AI)
                 {
                     int pin = pin_config->pin;
-                    if (sf->pin_info[pin].mode == FIRMATA_MODE_ANALOG)
+                    if (sf->pin_info[pin].mode == FIRMATA_MODE_ANALOG && dirty.test(pin))
                     {
                         double new_value = pin_config->MulScale * (double)(sf->pin_info[pin].value) + pin_config->AddScale;
-                        changed = changed || (eqp.getValue() != new_value);
+                        if (std::fabs(new_value - eqp.getValue()) <= pin_config->Deadband)
+                            continue;
+                        changed = true;
                         eqp.setValue(new_value);
                         //LOGF_DEBUG("%f",eqp->value);
                     }
@@ -226,10 +243,12 @@ void indiduino::TimerHit()
                 if (pin_config->IOType == AO) // read back ANALOG OUTPUT values as reported by the board (FIRMATA_PIN_STATE_RESPONSE)
                 {
                     int pin = pin_config->pin;
-                    if (sf->pin_info[pin].mode == FIRMATA_MODE_PWM)
+                    if (sf->pin_info[pin].mode == FIRMATA_MODE_PWM && dirty.test(pin))
                     {
                         double new_value = ((double)(sf->pin_info[pin].value) - pin_config->AddScale) / pin_config->MulScale;
-                        changed = changed || (eqp.getValue() != new_value);
+                        if (std::fabs(new_value - eqp.getValue()) <= pin_config->Deadband)
+                            continue;
+                        changed = true;
                         eqp.setValue(new_value);
                         //LOGF_DEBUG("%f",eqp->value);
                     }
@@ -242,7 +261,7 @@ void indiduino::TimerHit()
         if (type == INDI_TEXT)
         {
             auto tvp = getText(name);
-            if (tvp.getText()->getAux() != (void *)indiduino_id)
+            if (tvp.getText()->getAux() != (void *)indiduino_id || !stringChanged)
                 continue;
 
             for (auto &eqp: tvp)
@@ -257,6 +276,8 @@ void indiduino::TimerHit()
             }
         }
     }
+    stateLock.unlock();
+
     // START: Switch of for debugging!
     time_t sec_since_reply = sf->secondsSinceVersionReply();
     time_t max_delay = static_cast<time_t>(5*getCurrentPollingPeriod() < 30000 ? 30 : 5*getCurrentPollingPeriod()/1000);
@@ -411,7 +432,8 @@ bool indiduino::updateProperties()
             this->serialConnection->Disconnect();
             return false;
         }
-
+        // Incoming reports are decoded in the background from here on
+        sf->startReader();
 
         // Mapping the controller according to the properties previously read from the XML file
         // We only map controls for pin of type AO and SERVO
@@ -596,7 +618,7 @@ bool indiduino::ISNewSwitch(const char *dev, const char *name, ISState *states,
                 if (sf->writeDigitalPin(pin, ARDUINO_HIGH) == 0)
                 {
                     //IDSetSwitch(svp, "%s.%s ON", svp->name, sqp->name); Seems not to work anymore!
-                    sf->pin_info[pin].value = 1; // Set Standard Firmata record, so time loop can set correct switch state!
+                    sf->setPinValue(pin, 1); // Set Standard Firmata record, so time loop can set correct switch state!
                     svp.setState(IPS_OK);
                 }
             }
@@ -606,7 +628,7 @@ bool indiduino::ISNewSwitch(const char *dev, const char *name, ISState *states,
                 if (sf->writeDigitalPin(pin, ARDUINO_LOW) ==0)
                 {
                     //IDSetSwitch(svp, "%s.%s OFF", svp->name, sqp->name); Seems not to work anymore!
-                    sf->pin_info[pin].value = 0; // Set Standard Firmata record, so time loop can set correct switch state!
+                    sf->setPinValue(pin, 0); // Set Standard Firmata record, so time loop can set correct switch state!
                     svp.setState(IPS_OK);
                 }
             }
@@ -1038,6 +1060,14 @@ bool indiduino::readInduinoXml(XMLEle *ioep, int npin)
             {
                 iopin[npin].buttonIncValue = 50;
             }
+            if (strcmp(findXMLAttValu(ioep, "deadband"), ""))
+            {
+                iopin[npin].Deadband = atof(findXMLAttValu(ioep, "deadband"));
+            }
+            else
+            {
+                iopin[npin].Deadband = 0;
+            }
         }
 
         if (false)
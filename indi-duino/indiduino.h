@@ -51,6 +51,7 @@ typedef struct
     double OnAngle;
     double OffAngle;
     double buttonIncValue;
+    double Deadband;
     const char *SwitchButton;
     const char *UpButton;
     const char *DownButton;
@@ -14,6 +14,7 @@
 #include <firmata.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <ctime>
 
 void (*firmata_debug_cb)(const char *file, int line, const char *msg, ...) = NULL;
@@ -44,6 +45,7 @@ Firmata::Firmata(int fd)
 
 Firmata::~Firmata()
 {
+    stopReader();
     delete arduino;
 }
 
@@ -408,7 +410,7 @@ void Firmata::DoMessage(void)
         {
             if (pin_info[pin].analog_channel == analog_ch)
             {
-                pin_info[pin].value = analog_val;
+                setPinValueLocked(pin, analog_val);
                 LOGF_DEBUG("ANALOG_MESSAGE: pin %d is A%d = %d", pin, analog_ch, analog_val);
                 return;
             }
@@ -429,7 +431,7 @@ void Firmata::DoMessage(void)
                 if (pin_info[pin].value != val)
                 {
                     LOGF_DEBUG("pin %d is %d", pin, val);
-                    pin_info[pin].value = val;
+                    setPinValueLocked(pin, val);
                 }
             }
         }
@@ -513,6 +515,7 @@ void Firmata::DoMessage(void)
                 pin_info[pin].value |= (parse_buf[5] << 7);
             if (parse_count > 7)
                 pin_info[pin].value |= (parse_buf[6] << 14);
+            dirty_pins.set(pin);
             LOGF_DEBUG("PIN_STATE_RESPONSE: pin:%u. Mode:%u. Value:%llu", pin, pin_info[pin].mode, static_cast<unsigned long long>(pin_info[pin].value));
             if (pin_info[pin].mode == FIRMATA_MODE_OUTPUT)
                 updateDigitalPort(pin, pin_info[pin].value ? ARDUINO_HIGH : ARDUINO_LOW);
@@ -532,7 +535,11 @@ void Firmata::DoMessage(void)
                 name[len++] = (parse_buf[i] & 0x7F) | ((parse_buf[i + 1] & 0x7F) << 7);
             }
             name[len++] = 0;
-            strcpy(string_buffer, name);
+            if (strcmp(string_buffer, name) != 0)
+            {
+                strcpy(string_buffer, name);
+                string_dirty = true;
+            }
             LOGF_DEBUG("STRING_DATA: %s", name);
         }
         else if (parse_buf[1] == FIRMATA_EXTENDED_ANALOG)
@@ -549,7 +556,7 @@ void Firmata::DoMessage(void)
             {
                 if (pin_info[pin].analog_channel == analog_ch)
                 {
-                    pin_info[pin].value = analog_val;
+                    setPinValueLocked(pin, analog_val);
                     LOGF_DEBUG("EXTENDED_ANALOG: pin %d is A%d = %lu", pin, analog_ch, analog_val);
                     break;
                 }
@@ -578,6 +585,13 @@ int Firmata::OnIdle()
     uint8_t buf[1024];
     int r = 1;
 
+    // The reader thread owns the port, keep the 10ms pacing callers rely on
+    if (reader_running)
+    {
+        usleep(10000);
+        return 0;
+    }
+
     //if (debug) LOGF_DEBUG("Idle event");
     if (r > 0)
     {
@@ -598,6 +612,7 @@ int Firmata::OnIdle()
             if (debug)
                 printf("\n");
 */
+            std::lock_guard<std::mutex> guard(state_lock);
             Parse(buf, r);
             return 0;
         }
@@ -613,5 +628,91 @@ time_t Firmata::secondsSinceVersionReply()
 {
     time_t now;
     time(&now);
+    std::lock_guard<std::mutex> guard(state_lock);
     return now - version_reply_time;
 }
+
+void Firmata::setPinValueLocked(int pin, uint64_t value)
+{
+    if (pin_info[pin].value != value)
+    {
+        pin_info[pin].value = value;
+        dirty_pins.set(pin);
+    }
+}
+
+void Firmata::setPinValue(int pin, uint64_t value)
+{
+    std::lock_guard<std::mutex> guard(state_lock);
+    setPinValueLocked(pin, value);
+}
+
+std::bitset<128> Firmata::takeDirtyPins()
+{
+    std::lock_guard<std::mutex> guard(state_lock);
+    std::bitset<128> dirty = dirty_pins;
+    dirty_pins.reset();
+    return dirty;
+}
+
+bool Firmata::takeStringDirty()
+{
+    std::lock_guard<std::mutex> guard(state_lock);
+    bool dirty = string_dirty;
+    string_dirty = false;
+    return dirty;
+}
+
+std::unique_lock<std::mutex> Firmata::lockState()
+{
+    return std::unique_lock<std::mutex>(state_lock);
+}
+
+int Firmata::startReader()
+{
+    if (reader_running)
+        return 0;
+
+    {
+        // Report everything once so the host starts from the current board state
+        std::lock_guard<std::mutex> guard(state_lock);
+        dirty_pins.set();
+        string_dirty = true;
+    }
+
+    reader_running = true;
+    reader_thread = std::thread(&Firmata::readerLoop, this);
+    return 0;
+}
+
+void Firmata::stopReader()
+{
+    if (!reader_running)
+        return;
+
+    reader_running = false;
+    if (reader_thread.joinable())
+        reader_thread.join();
+}
+
+void Firmata::readerLoop()
+{
+    // Large reads let a burst of analog reports be decoded in one pass
+    uint8_t buf[4096];
+
+    while (reader_running)
+    {
+        int r = arduino->readPort(buf, sizeof(buf));
+        if (r < 0)
+        {
+            LOGF_DEBUG("Firmata::readerLoop():arduino->readPort():%d", r);
+            usleep(100000);
+            continue;
+        }
+        if (r > 0)
+        {
+            std::lock_guard<std::mutex> guard(state_lock);
+            Parse(buf, r);
+        }
+    }
+}
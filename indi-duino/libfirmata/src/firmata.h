@@ -12,6 +12,10 @@
 */
 
 #include <vector>
+#include <bitset>
+#include <mutex>
+#include <thread>
+#include <atomic>
 #include <stdint.h>
 #include <arduino.h>
 
@@ -120,12 +124,32 @@ class Firmata
     int OnIdle();
     bool portOpen;
 
+    // Decode incoming messages on a background thread instead of in OnIdle()
+    int startReader();
+    void stopReader();
+    bool readerRunning() const { return reader_running; }
+    // Pins whose mode or value changed since the previous call, cleared on return
+    std::bitset<128> takeDirtyPins();
+    // True if string_buffer changed since the previous call
+    bool takeStringDirty();
+    // pin_info and string_buffer are stable while the returned lock is held
+    std::unique_lock<std::mutex> lockState();
+    // Record a value written by the host so the next readback reflects it
+    void setPinValue(int pin, uint64_t value);
+
   private:
     int parse_count { 0 };
     int parse_command_len { 0 };
     uint8_t parse_buf[4096];
     void Parse(const uint8_t *buf, int len);
     void DoMessage(void);
+    void setPinValueLocked(int pin, uint64_t value);
+    void readerLoop();
+    std::mutex state_lock;
+    std::bitset<128> dirty_pins;
+    bool string_dirty { false };
+    std::thread reader_thread;
+    std::atomic<bool> reader_running { false };
     int have_analog_mapping { 0 };
     int have_capabilities { 0 };
     time_t version_reply_time { 0 };
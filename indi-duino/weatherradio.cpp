@@ -1029,13 +1029,12 @@ void WeatherRadio::handleWeatherData(JsonValue value)
     JsonIterator deviceIter;
     for (deviceIter = begin(value); deviceIter != end(value); ++deviceIter)
     {
-        char *name {new char[strlen(deviceIter->key) + 1] {0}};
-        strncpy(name, deviceIter->key, static_cast<size_t>(strlen(deviceIter->key)));
+        const char *name = deviceIter->key;
 
         JsonIterator sensorIter;
-        INumberVectorProperty *deviceProp = findRawDeviceProperty(name);
+        auto indexEntry = rawDeviceIndex.find(name);
 
-        if (deviceProp == nullptr)
+        if (indexEntry == rawDeviceIndex.end())
         {
             // new device found
             std::vector<std::pair<char*, double>> sensorData;
@@ -1075,34 +1074,50 @@ void WeatherRadio::handleWeatherData(JsonValue value)
                         IUFillNumber(&sensors[i], sensorData[i].first, sensorData[i].first, "%.2f", -2000.0, 2000.0, 1., sensorData[i].second);
                 }
                 // create a new number vector for the device
-                deviceProp = new INumberVectorProperty;
+                INumberVectorProperty *deviceProp = new INumberVectorProperty;
                 IUFillNumberVector(deviceProp, sensors, static_cast<int>(sensorData.size()), getDeviceName(), name, name, "Raw Sensors",
                                    IP_RO, 60, IPS_OK);
                 // make it visible
                 if (isConnected())
                     defineProperty(deviceProp);
                 rawDevices.push_back(*deviceProp);
+
+                // index the sensors so that later readings do not need to search by name
+                raw_device_entry &entry = rawDeviceIndex[name];
+                entry.device = rawDevices.size() - 1;
+                for (size_t i = 0; i < sensorData.size(); i++)
+                    entry.sensors[sensors[i].name] = &sensors[i];
             }
         }
         else
         {
-            deviceProp->s = IPS_IDLE;
+            INumberVectorProperty *deviceProp = &rawDevices[indexEntry->second.device];
+            const auto &sensors = indexEntry->second.sensors;
+            IPState state = IPS_IDLE;
+            bool changed = false;
             // read all sensor data
             for (sensorIter = begin(deviceIter->value); sensorIter != end(deviceIter->value); ++sensorIter)
             {
                 if (strcmp(sensorIter->key, "init") == 0 || sensorIter->value.getTag() != JSON_NUMBER)
                     continue;
-                INumber *sensor = IUFindNumber(deviceProp, sensorIter->key);
-                if (sensor != nullptr && sensorIter->value.isDouble())
+                auto sensorEntry = sensors.find(sensorIter->key);
+                if (sensorEntry != sensors.end())
                 {
-                    sensor->value = sensorIter->value.toNumber();
+                    INumber *sensor = sensorEntry->second;
+                    double sensorValue = sensorIter->value.toNumber();
+                    changed = changed || (sensor->value != sensorValue);
+                    sensor->value = sensorValue;
                     // update the weather parameter {name, sensorIter->key} to sensorIter->value.toNumber()
-                    updateWeatherParameter({name, sensorIter->key}, sensorIter->value.toNumber());
-                    deviceProp->s = IPS_OK;
+                    updateWeatherParameter({name, sensorIter->key}, sensorValue);
+                    state = IPS_OK;
                 }
             }
-            // update device values
-            IDSetNumber(deviceProp, nullptr);
+            // only send device values that moved
+            if (changed || deviceProp->s != state)
+            {
+                deviceProp->s = state;
+                IDSetNumber(deviceProp, nullptr);
+            }
         }
 
     }
@@ -1288,36 +1303,43 @@ bool WeatherRadio::saveConfigItems(FILE *fp)
 ***************************************************************************************/
 INumberVectorProperty *WeatherRadio::findRawDeviceProperty(const char *name)
 {
-    for (size_t i = 0; i < rawDevices.size(); i++)
-    {
-        if (strcmp(name, rawDevices[i].name) == 0)
-            return &rawDevices[i];
-    }
+    auto entry = rawDeviceIndex.find(name);
+    if (entry != rawDeviceIndex.end())
+        return &rawDevices[entry->second.device];
 
     // not found
     return nullptr;
 }
 
-INumber *WeatherRadio::findRawSensorProperty(WeatherRadio::sensor_name sensor)
+INumber *WeatherRadio::findRawSensorProperty(const WeatherRadio::sensor_name &sensor)
 {
-    INumberVectorProperty *deviceProp = findRawDeviceProperty(sensor.device.c_str());
+    auto entry = rawDeviceIndex.find(sensor.device);
+    if (entry == rawDeviceIndex.end())
+        return nullptr;
 
-    INumber *sensorProp = nullptr;
-    if (deviceProp != nullptr)
-        sensorProp = IUFindNumber(deviceProp, sensor.sensor.c_str());
+    auto sensorEntry = entry->second.sensors.find(sensor.sensor);
+    if (sensorEntry == entry->second.sensors.end())
+        return nullptr;
 
-    return sensorProp;
+    return sensorEntry->second;
 }
 
-INumber *WeatherRadio::getWeatherParameter(std::string name)
+INumber *WeatherRadio::getWeatherParameter(const std::string &name)
 {
-    for (int i = 0; i < ParametersNP.nnp; i++)
+    auto entry = weatherParameterIndex.find(name);
+    // parameters may have been added or reallocated since the index was built
+    if (entry == weatherParameterIndex.end() || entry->second >= ParametersNP.nnp || name != ParametersN[entry->second].name)
     {
-        if (!strcmp(ParametersN[i].name, name.c_str()))
-            return &ParametersN[i];
+        weatherParameterIndex.clear();
+        for (int i = 0; i < ParametersNP.nnp; i++)
+            weatherParameterIndex[ParametersN[i].name] = i;
+
+        entry = weatherParameterIndex.find(name);
+        if (entry == weatherParameterIndex.end())
+            return nullptr;
     }
-    // not found
-    return nullptr;
+
+    return &ParametersN[entry->second];
 }
 
 
@@ -1439,9 +1461,10 @@ void WeatherRadio::handleResponse(wr_command cmd, const char *response, int leng
     if (length == 0 || strcmp(response, "\r\n") == 0 || (response[0] != '[' && response[0] != '{'))
         return;
 
-    char *source{new char[length + 1] {0}};
     // duplicate the buffer since the parser will modify it
-    strncpy(source, response, static_cast<size_t>(length));
+    jsonBuffer.assign(response, response + length);
+    jsonBuffer.push_back('\0');
+    char *source = jsonBuffer.data();
 
     // parse JSON string
     char *endptr;
@@ -25,6 +25,8 @@
 #include <map>
 #include <math.h>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include "gason/gason.h"
 
@@ -129,6 +131,26 @@ protected:
     };
 
     std::vector<INumberVectorProperty> rawDevices;
+
+    /**
+     * @brief Raw device and sensor properties by name, filled when a device is registered
+     */
+    struct raw_device_entry
+    {
+        size_t device;
+        std::unordered_map<std::string, INumber *> sensors;
+    };
+    std::unordered_map<std::string, raw_device_entry> rawDeviceIndex;
+
+    /**
+     * @brief Position of each weather parameter in ParametersN, rebuilt when it goes stale
+     */
+    std::unordered_map<std::string, int> weatherParameterIndex;
+
+    /**
+     * @brief Buffer for the JSON parser, reused between responses since the parser works in place
+     */
+    std::vector<char> jsonBuffer;
     /**
      * \brief Find the matching raw device INDI property vector.
     */
@@ -136,12 +158,12 @@ protected:
     /**
      * @brief find the matching sensor INDI property
      */
-    INumber *findRawSensorProperty(const sensor_name sensor);
+    INumber *findRawSensorProperty(const sensor_name &sensor);
 
     /**
      * @brief Find a given weather parameter.
      */
-    INumber *getWeatherParameter(std::string name);
+    INumber *getWeatherParameter(const std::string &name);
 
     /**
      * @brief TTY interface timeout
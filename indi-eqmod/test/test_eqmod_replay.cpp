@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "eqmodbase.h"
+#include "replaybench.h"
+
+using SerialReplay::Bench;
+using SerialReplay::Device;
+using SerialReplay::Transcript;
+
+class ReplayEQMod : public EQMod
+{
+public:
+    ReplayEQMod()
+    {
+        initProperties();
+    }
+
+    Skywatcher *skywatcher()
+    {
+        return mount;
+    }
+};
+
+TEST(EQModReplay, Encoders)
+{
+    Device device(Transcript::load(REPLAY_DIR "/encoders.txt"));
+    ASSERT_TRUE(device.start());
+
+    int fd = device.connect();
+    ASSERT_GE(fd, 0);
+
+    ReplayEQMod eqmod;
+    Skywatcher *mount = eqmod.skywatcher();
+    mount->setPortFD(fd);
+
+    EXPECT_EQ(mount->GetRAEncoder(), 0x80B0A0u);
+    EXPECT_EQ(mount->GetDEEncoder(), 0x800000u);
+    EXPECT_EQ(device.mismatches(), 0u);
+
+    mount->setPortFD(-1);
+    close(fd);
+}
+
+TEST(EQModReplay, EncodersBenchmark)
+{
+    Device device(Transcript::load(REPLAY_DIR "/encoders.txt"));
+    device.setLoop(true);
+    // Bound only by the wire speed of the motor controller
+    device.setTimeScale(0);
+    device.setBaudRate(9600);
+    ASSERT_TRUE(device.start());
+
+    int fd = device.connect();
+    ASSERT_GE(fd, 0);
+
+    ReplayEQMod eqmod;
+    Skywatcher *mount = eqmod.skywatcher();
+    mount->setPortFD(fd);
+
+    Bench bench(device);
+    auto result = bench.run("eqmod.encoders", 100, [mount]()
+    {
+        try
+        {
+            mount->GetRAEncoder();
+            mount->GetDEEncoder();
+        }
+        catch (EQModError &)
+        {
+            return false;
+        }
+        return true;
+    });
+
+    EXPECT_EQ(result.failures, 0u);
+    EXPECT_EQ(result.mismatches, 0u);
+
+    mount->setPortFD(-1);
+    close(fd);
+}
+
+int main(int argc, char **argv)
+{
+    INDI::Logger::getInstance().configure("", INDI::Logger::file_off,
+            INDI::Logger::DBG_ERROR, INDI::Logger::DBG_ERROR);
+    ::testing::InitGoogleTest(&argc, argv);
+
+    me = strdup("indi_eqmod_driver");
+
+    return RUN_ALL_TESTS();
+}
@@ -21,16 +21,69 @@
 #include <stdint.h>
 #include <arpa/inet.h>
 #include <math.h>
+#include <poll.h>
 #include <sys/time.h>
 #include <dc1394/dc1394.h>
 #include <indiapi.h>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#include <arm_neon.h>
+#endif
 
 #include "ffmv_ccd.h"
 #include "config.h"
 
+/* How often the capture thread checks whether it should stop */
+#define CAPTURE_POLL_MS 100
+
 std::unique_ptr<FFMVCCD> ffmvCCD(new FFMVCCD());
 
+/**
+ * Add a frame of big-endian 16 bit pixels to a 32 bit sum.
+ * The sum does not clip, so long stacks of subs only saturate once at the end.
+ */
+static void accumulateBE16(uint32_t *sum, const uint16_t *src, size_t count)
+{
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        v         = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+
+        __m128i *out = reinterpret_cast<__m128i *>(sum + i);
+        _mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), _mm_unpacklo_epi16(v, zero)));
+        _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), _mm_unpackhi_epi16(v, zero)));
+    }
+#elif defined(__ARM_NEON) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; i + 8 <= count; i += 8)
+    {
+        uint16x8_t v = vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(src + i))));
+        vst1q_u32(sum + i, vaddw_u16(vld1q_u32(sum + i), vget_low_u16(v)));
+        vst1q_u32(sum + i + 4, vaddw_u16(vld1q_u32(sum + i + 4), vget_high_u16(v)));
+    }
+#endif
+
+    for (; i < count; i++)
+        sum[i] += ntohs(src[i]);
+}
+
+/**
+ * Clamp the 32 bit sum into the 16 bit frame buffer.
+ */
+static void saturateU16(uint16_t *dst, const uint32_t *sum, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        dst[i] = sum[i] > 0xFFFF ? 0xFFFF : static_cast<uint16_t>(sum[i]);
+}
+
 /**
  * Write to registers in the MT9V022 chip.
  * This can be done by programming the address in 0x1A00 and writing to 0x1A04.
@@ -248,6 +301,12 @@ bool FFMVCCD::Connect()
     }
 
     err = dc1394_capture_setup(dcam, 10, DC1394_CAPTURE_FLAGS_DEFAULT);
+    if (err != DC1394_SUCCESS)
+    {
+        LOG_ERROR("Unable to set up capture!");
+        return false;
+    }
+    startCapture();
 
     LOGF_INFO("Detected camera model: %s vendor: %s (%#04X:%#04X)", dcam->model, dcam->model, dcam->vendor_id, dcam->model_id);
 
@@ -261,6 +320,7 @@ bool FFMVCCD::Disconnect()
 {
     if (dcam)
     {
+        stopCapture();
         dc1394_capture_stop(dcam);
         dc1394_camera_free(dcam);
     }
@@ -411,6 +471,7 @@ bool FFMVCCD::StartExposure(float duration)
     }
 
     /* Flush the DMA buffer */
+    std::unique_lock<std::mutex> capture(captureLock);
     while (1)
     {
         err = dc1394_capture_dequeue(dcam, DC1394_CAPTURE_POLICY_POLL, &frame);
@@ -425,6 +486,9 @@ bool FFMVCCD::StartExposure(float duration)
         }
         dc1394_capture_enqueue(dcam, frame);
     }
+    capture.unlock();
+
+    armCapture(sub_count, PrimaryCCD.getSubW() / PrimaryCCD.getBinX() * PrimaryCCD.getSubH() / PrimaryCCD.getBinY());
 
     /*-----------------------------------------------------------------------
      *  have the camera start sending us data
@@ -447,6 +511,7 @@ bool FFMVCCD::StartExposure(float duration)
 bool FFMVCCD::AbortExposure()
 {
     InExposure = false;
+    cancelCapture();
     return true;
 }
 
@@ -604,69 +669,219 @@ void FFMVCCD::TimerHit()
 }
 
 /**
- * Download image from FireFly
+ * Start the capture and accumulate threads
  */
-void FFMVCCD::grabImage()
+void FFMVCCD::startCapture()
 {
-    dc1394error_t err;
-    dc1394video_frame_t *frame;
-    uint32_t uheight, uwidth;
-    int sub;
-    uint16_t val;
-    struct timeval start, end;
+    captureRunning = true;
+    captureWorker = std::thread(&FFMVCCD::captureThread, this);
+    accumulateWorker = std::thread(&FFMVCCD::accumulateThread, this);
+}
 
-    std::unique_lock<std::mutex> guard(ccdBufferLock);
-    // Let's get a pointer to the frame buffer
-    uint8_t *image = PrimaryCCD.getFrameBuffer();
+/**
+ * Stop the threads and hand any frames they still hold back to the DMA ring
+ */
+void FFMVCCD::stopCapture()
+{
+    {
+        std::lock_guard<std::mutex> lock(subLock);
+        captureRunning = false;
+        subCondition.notify_all();
+    }
 
-    // Get width and height
-    int width  = PrimaryCCD.getSubW() / PrimaryCCD.getBinX();
-    int height = PrimaryCCD.getSubH() / PrimaryCCD.getBinY();
+    if (captureWorker.joinable())
+        captureWorker.join();
+    if (accumulateWorker.joinable())
+        accumulateWorker.join();
 
-    memset(image, 0, PrimaryCCD.getFrameBufferSize());
+    for (auto &sub : subQueue)
+        enqueueFrame(sub.frame);
+    subQueue.clear();
+}
 
-    /*-----------------------------------------------------------------------
-    *  stop data transmission
-    *-----------------------------------------------------------------------*/
+/**
+ * Expect a new set of subs, the threads start collecting them right away
+ */
+void FFMVCCD::armCapture(int subs, size_t pixels)
+{
+    std::lock_guard<std::mutex> sum(accumulateLock);
+    std::lock_guard<std::mutex> lock(subLock);
+
+    subGeneration++;
+    subSum.assign(pixels, 0);
+    subsExpected = subs;
+    subsPending  = subs;
+    subsDone     = 0;
+    subCondition.notify_all();
+}
 
-    gettimeofday(&start, nullptr);
-    for (sub = 0; sub < sub_count; ++sub)
+void FFMVCCD::cancelCapture()
+{
+    std::lock_guard<std::mutex> sum(accumulateLock);
+    std::lock_guard<std::mutex> lock(subLock);
+
+    subGeneration++;
+    subsPending = 0;
+    subCondition.notify_all();
+}
+
+/**
+ * Wait for all subs to be accumulated.
+ * Returns false if no sub arrived within timeout_ms.
+ */
+bool FFMVCCD::waitCapture(int timeout_ms)
+{
+    std::unique_lock<std::mutex> lock(subLock);
+
+    while (subsDone < subsExpected)
     {
-        LOGF_DEBUG("Getting sub %d of %d", sub, sub_count);
-        err = dc1394_capture_dequeue(dcam, DC1394_CAPTURE_POLICY_WAIT, &frame);
-        if (err != DC1394_SUCCESS)
+        int done = subsDone;
+        if (subCondition.wait_for(lock, std::chrono::milliseconds(timeout_ms)) == std::cv_status::timeout &&
+                subsDone == done)
+            return false;
+    }
+
+    return true;
+}
+
+void FFMVCCD::enqueueFrame(dc1394video_frame_t *frame)
+{
+    std::lock_guard<std::mutex> capture(captureLock);
+    dc1394_capture_enqueue(dcam, frame);
+}
+
+/**
+ * Dequeue DMA frames as soon as they arrive and queue them for accumulation
+ */
+void FFMVCCD::captureThread()
+{
+    int fd = dc1394_capture_get_fileno(dcam);
+    std::unique_lock<std::mutex> lock(subLock);
+
+    while (captureRunning)
+    {
+        if (subsPending <= 0)
+        {
+            subCondition.wait(lock);
+            continue;
+        }
+        uint32_t generation = subGeneration;
+        lock.unlock();
+
+        dc1394video_frame_t *frame = nullptr;
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, CAPTURE_POLL_MS) > 0)
+        {
+            std::lock_guard<std::mutex> capture(captureLock);
+            if (dc1394_capture_dequeue(dcam, DC1394_CAPTURE_POLICY_POLL, &frame) != DC1394_SUCCESS)
+            {
+                LOG_ERROR("Could not capture frame");
+                frame = nullptr;
+            }
+        }
+
+        lock.lock();
+        if (frame == nullptr)
+            continue;
+
+        if (generation != subGeneration || subsPending <= 0)
         {
-            LOG_ERROR("Could not capture frame");
+            // Exposure was aborted while we were waiting
+            lock.unlock();
+            enqueueFrame(frame);
+            lock.lock();
+            continue;
         }
-        dc1394_get_image_size_from_video_mode(dcam, DC1394_VIDEO_MODE_640x480_MONO16, &uwidth, &uheight);
 
-        if (DC1394_TRUE == dc1394_capture_is_frame_corrupt(dcam, frame))
+        subsPending--;
+        subQueue.push_back({ frame, generation });
+        subCondition.notify_all();
+    }
+}
+
+/**
+ * Add queued frames to the 32 bit sum and return them to the DMA ring
+ */
+void FFMVCCD::accumulateThread()
+{
+    std::unique_lock<std::mutex> lock(subLock);
+
+    while (captureRunning)
+    {
+        if (subQueue.empty())
         {
-            LOG_ERROR("Corrupt frame!");
+            subCondition.wait(lock);
             continue;
         }
-        // Fill buffer with random pattern
-        for (int i = 0; i < height; i++)
+        SubFrame sub = subQueue.front();
+        subQueue.pop_front();
+        lock.unlock();
+
+        bool counted = false;
         {
-            for (int j = 0; j < width; j++)
+            std::lock_guard<std::mutex> sum(accumulateLock);
+            if (sub.generation == subGeneration)
             {
-                /* Detect unsigned overflow */
-                val = ((uint16_t *)image)[i * width + j] + ntohs(((uint16_t *)(frame->image))[i * width + j]);
-                if (val > ((uint16_t *)image)[i * width + j])
+                if (DC1394_TRUE == dc1394_capture_is_frame_corrupt(dcam, sub.frame))
                 {
-                    ((uint16_t *)image)[i * width + j] = val;
+                    LOG_ERROR("Corrupt frame!");
                 }
                 else
                 {
-                    ((uint16_t *)image)[i * width + j] = 0xFFFF;
+                    size_t count = std::min<size_t>(subSum.size(), sub.frame->image_bytes / sizeof(uint16_t));
+                    accumulateBE16(subSum.data(), reinterpret_cast<const uint16_t *>(sub.frame->image), count);
                 }
+                counted = true;
             }
         }
+        enqueueFrame(sub.frame);
 
-        dc1394_capture_enqueue(dcam, frame);
+        lock.lock();
+        if (counted && sub.generation == subGeneration)
+        {
+            subsDone++;
+            LOGF_DEBUG("Got sub %d of %d", subsDone, subsExpected);
+            subCondition.notify_all();
+        }
+    }
+}
+
+/**
+ * Download image from FireFly
+ */
+void FFMVCCD::grabImage()
+{
+    struct timeval start, end;
+
+    gettimeofday(&start, nullptr);
+
+    // Subs have been coming in during the exposure, wait for the last ones
+    int timeout_ms = 5000 + static_cast<int>(2000 * ExposureRequest / std::max(sub_count, 1));
+    if (!waitCapture(timeout_ms))
+    {
+        LOGF_ERROR("Timed out waiting for sub frames, got %d of %d", subsDone, subsExpected);
+        cancelCapture();
+    }
+
+    std::unique_lock<std::mutex> guard(ccdBufferLock);
+    // Let's get a pointer to the frame buffer
+    uint16_t *image = reinterpret_cast<uint16_t *>(PrimaryCCD.getFrameBuffer());
+
+    // Get width and height
+    int width  = PrimaryCCD.getSubW() / PrimaryCCD.getBinX();
+    int height = PrimaryCCD.getSubH() / PrimaryCCD.getBinY();
+
+    memset(image, 0, PrimaryCCD.getFrameBufferSize());
+    {
+        std::lock_guard<std::mutex> sum(accumulateLock);
+        saturateU16(image, subSum.data(), std::min<size_t>(subSum.size(), width * height));
     }
     guard.unlock();
-    err = dc1394_video_set_transmission(dcam, DC1394_OFF);
+
+    /*-----------------------------------------------------------------------
+    *  stop data transmission
+    *-----------------------------------------------------------------------*/
+    dc1394_video_set_transmission(dcam, DC1394_OFF);
     gettimeofday(&end, nullptr);
     LOGF_DEBUG("Download took %d uS", (int)((end.tv_sec - start.tv_sec) * 1000000 + (end.tv_usec - start.tv_usec)));
 
@@ -23,6 +23,13 @@
 #include <indiccd.h>
 #include <dc1394/dc1394.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 using namespace std;
 
 class FFMVCCD : public INDI::CCD
@@ -56,6 +63,16 @@ class FFMVCCD : public INDI::CCD
     dc1394error_t setGainVref(ISState iss);
     dc1394error_t setDigitalGain(ISState state);
 
+    // Sub frames are dequeued and accumulated on separate threads
+    void startCapture();
+    void stopCapture();
+    void armCapture(int subs, size_t pixels);
+    void cancelCapture();
+    bool waitCapture(int timeout_ms);
+    void enqueueFrame(dc1394video_frame_t *frame);
+    void captureThread();
+    void accumulateThread();
+
     // Are we exposing?
     bool InExposure;
     bool capturing;
@@ -73,6 +90,30 @@ class FFMVCCD : public INDI::CCD
     dc1394_t *dc1394;
     dc1394camera_t *dcam;
 
+    struct SubFrame
+    {
+        dc1394video_frame_t *frame;
+        uint32_t generation;
+    };
+
+    std::thread captureWorker;
+    std::thread accumulateWorker;
+    bool captureRunning { false };
+    // Guards dc1394 capture dequeue/enqueue
+    std::mutex captureLock;
+    // Guards the sub frame queue and counters below
+    std::mutex subLock;
+    std::condition_variable subCondition;
+    std::deque<SubFrame> subQueue;
+    int subsExpected { 0 };
+    int subsPending { 0 };
+    int subsDone { 0 };
+    // Bumped when an exposure starts or is aborted, frames from older ones are dropped
+    std::atomic<uint32_t> subGeneration { 0 };
+    // Guards the 32 bit sum, held while accumulating
+    std::mutex accumulateLock;
+    std::vector<uint32_t> subSum;
+
 };
 
 #endif // FFMVCCD_H
@@ -20,6 +20,11 @@
 
 using namespace arv;
 
+/* aravis defaults, except for the pool which needs a few frames of slack for video */
+#define STREAM_DEFAULT_PACKET_TIMEOUT_US  (20000)
+#define STREAM_DEFAULT_FRAME_RETENTION_US (100000)
+#define STREAM_DEFAULT_BUFFER_COUNT       (8)
+
 const char *ArvGeneric::_str_val(const char *s)
 {
     return (s ? s : "None");
@@ -101,10 +106,32 @@ bool ArvGeneric::_stream_active()
 {
     return this->stream_active;
 }
+bool ArvGeneric::is_streaming()
+{
+    return this->streaming;
+}
+
+bool ArvGeneric::_clear_error(const char *what)
+{
+    if (this->error == nullptr)
+        return false;
+
+    printf("%s failed: %s\n", what, this->error->message);
+    g_clear_error(&this->error);
+    return true;
+}
 
 ArvGeneric::ArvGeneric(void *camera_device) : ArvCamera(camera_device)
 {
+    this->error = nullptr;
     this->_init();
+
+    this->stream_config.packet_resend      = true;
+    this->stream_config.socket_buffer_size = 0;
+    this->stream_config.packet_timeout_us  = STREAM_DEFAULT_PACKET_TIMEOUT_US;
+    this->stream_config.frame_retention_us = STREAM_DEFAULT_FRAME_RETENTION_US;
+    this->stream_config.buffer_count       = STREAM_DEFAULT_BUFFER_COUNT;
+
     this->camera = (::ArvCamera *)camera_device;
     this->dev    = arv_camera_get_device(this->camera);
 
@@ -148,9 +175,11 @@ bool ArvGeneric::_configure(void)
 void ArvGeneric::_init()
 {
     this->camera        = nullptr;
-    this->buffer        = nullptr;
     this->stream        = nullptr;
     this->stream_active = false;
+    this->streaming     = false;
+    this->pool_payload  = 0;
+    this->pool_size     = 0;
 
     /* Don't clear device_id, its needed to re-attach with connect() */
 }
@@ -160,6 +189,8 @@ bool ArvGeneric::disconnect()
     if (this->is_connected())
     {
         this->_test_exposure_and_abort();
+        this->stream_stop();
+        this->_stream_destroy();
         g_clear_object(&this->camera);
     }
     this->_init();
@@ -264,30 +295,92 @@ void ArvGeneric::set_exposure_time(double const val)
     this->_set_cam_exposure_property(arv_camera_set_exposure_time, &this->cam.exposure, val);
 }
 
-::ArvBuffer *ArvGeneric::_buffer_create(void)
+::ArvStream *ArvGeneric::_stream_create(void)
+{
+    ::ArvStream *stream = arv_camera_create_stream(this->camera, nullptr, nullptr, &(this->error));
+    if (this->_clear_error("arv_camera_create_stream"))
+        g_clear_object(&stream);
+    return stream;
+}
+
+void ArvGeneric::_stream_destroy(void)
 {
+    /* Buffers still queued on the stream are released along with it */
+    g_clear_object(&this->stream);
+    this->pool_payload = 0;
+    this->pool_size    = 0;
+}
+
+void ArvGeneric::_stream_apply_config(void)
+{
+    if (this->stream == nullptr || !ARV_IS_GV_STREAM(this->stream))
+        return;
+
+    arv_stream_config const &config = this->stream_config;
+    g_object_set(this->stream,
+                 "packet-resend", config.packet_resend ? ARV_GV_STREAM_PACKET_RESEND_ALWAYS :
+                 ARV_GV_STREAM_PACKET_RESEND_NEVER,
+                 "packet-timeout", (guint)config.packet_timeout_us,
+                 "frame-retention", (guint)config.frame_retention_us,
+                 "socket-buffer", config.socket_buffer_size > 0 ? ARV_GV_STREAM_SOCKET_BUFFER_FIXED :
+                 ARV_GV_STREAM_SOCKET_BUFFER_AUTO,
+                 nullptr);
+
+    if (config.socket_buffer_size > 0)
+        g_object_set(this->stream, "socket-buffer-size", (gint)config.socket_buffer_size, nullptr);
+}
+
+void ArvGeneric::_buffer_pool_recycle(void)
+{
+    /* Hand finished or aborted buffers back to the stream */
     ::ArvBuffer *buffer;
+    while ((buffer = arv_stream_try_pop_buffer(this->stream)) != nullptr)
+        arv_stream_push_buffer(this->stream, buffer);
+}
 
-    /* Ensure no buffers in stream */
-    while (1)
+void ArvGeneric::_buffer_pool_clear(void)
+{
+    ::ArvBuffer *buffer;
+    while ((buffer = arv_stream_try_pop_buffer(this->stream)) != nullptr)
+        g_object_unref(buffer);
+    while ((buffer = arv_stream_pop_input_buffer(this->stream)) != nullptr)
+        g_object_unref(buffer);
+
+    this->pool_payload = 0;
+    this->pool_size    = 0;
+}
+
+bool ArvGeneric::_stream_prepare(void)
+{
+    /* Camera setters do not check for errors, don't let an old one fail the stream */
+    g_clear_error(&this->error);
+
+    if (this->stream == nullptr)
     {
-        buffer = arv_stream_try_pop_buffer(this->stream);
-        if (buffer)
-            g_clear_object(&buffer);
-        else
-            break;
+        this->stream = this->_stream_create();
+        if (this->stream == nullptr)
+            return false;
+        this->_stream_apply_config();
     }
 
     gint const payload = arv_camera_get_payload(this->camera, &(this->error));
-    buffer             = arv_buffer_new(payload, nullptr);
-    arv_stream_push_buffer(this->stream, buffer);
-    return buffer;
-}
+    if (this->_clear_error("arv_camera_get_payload") || payload <= 0)
+        return false;
 
-::ArvStream *ArvGeneric::_stream_create(void)
-{
-    ::ArvStream *stream = arv_camera_create_stream(this->camera, nullptr, nullptr, &(this->error));
-    return stream;
+    if (payload == this->pool_payload && this->pool_size == this->stream_config.buffer_count)
+    {
+        this->_buffer_pool_recycle();
+        return true;
+    }
+
+    /* Geometry or pool size changed, buffers of the old size would only fail */
+    this->_buffer_pool_clear();
+    for (int i = 0; i < this->stream_config.buffer_count; i++)
+        arv_stream_push_buffer(this->stream, arv_buffer_new(payload, nullptr));
+
+    this->pool_payload = payload;
+    this->pool_size    = this->stream_config.buffer_count;
+    return true;
 }
 
 void ArvGeneric::_stream_start()
@@ -301,9 +394,8 @@ void ArvGeneric::_stream_start()
 
 void ArvGeneric::_stream_stop()
 {
-    /* stop the acquisition stream */
+    /* stop the acquisition stream, the stream itself is kept for the next exposure */
     arv_camera_stop_acquisition(this->camera, &(this->error));
-    g_object_unref(this->stream);
 
     this->stream_active = false;
 }
@@ -317,8 +409,8 @@ void ArvGeneric::_trigger_exposure()
 void ArvGeneric::exposure_start(void)
 {
     this->_test_exposure_and_abort();
-    this->stream = this->_stream_create();
-    this->buffer = this->_buffer_create();
+    if (this->streaming || !this->_stream_prepare())
+        return;
 
     this->_stream_start();
     this->_trigger_exposure();
@@ -333,22 +425,24 @@ void ArvGeneric::exposure_abort(void)
     }
 }
 
-void ArvGeneric::_get_image(void (*fn_image_callback)(void *const, uint8_t const *const, size_t), void *const usr_ptr)
+ARV_EXPOSURE_STATUS ArvGeneric::_get_image(::ArvBuffer *const buffer,
+                                           void (*fn_image_callback)(void *const, uint8_t const *const, size_t),
+                                           void *const usr_ptr)
 {
-    ArvBuffer *const popped_buf = arv_stream_timeout_pop_buffer(this->stream, 100000);
-    if ((popped_buf != nullptr) && (popped_buf == this->buffer) &&
-        arv_buffer_get_status(this->buffer) == ARV_BUFFER_STATUS_SUCCESS)
-    {
-        if (fn_image_callback != nullptr)
-        {
-            size_t size;
-            uint8_t const *const data = (uint8_t const *const)arv_buffer_get_data(this->buffer, &size);
-            fn_image_callback(usr_ptr, data, size);
-        }
-    }
-    else
+    switch (arv_buffer_get_status(buffer))
     {
-        //TODO: failure...
+        case ARV_BUFFER_STATUS_SUCCESS:
+            if (fn_image_callback != nullptr)
+            {
+                size_t size;
+                uint8_t const *const data = (uint8_t const *const)arv_buffer_get_data(buffer, &size);
+                fn_image_callback(usr_ptr, data, size);
+            }
+            return ARV_EXPOSURE_FINISHED;
+        case ARV_BUFFER_STATUS_UNKNOWN:
+            return ARV_EXPOSURE_UNKNOWN;
+        default:
+            return ARV_EXPOSURE_FAILED;
     }
 }
 
@@ -358,27 +452,118 @@ ARV_EXPOSURE_STATUS ArvGeneric::exposure_poll(void (*fn_image_callback)(void *co
     if (!this->_stream_active())
         return ARV_EXPOSURE_UNKNOWN;
 
-    ::ArvBufferStatus const status = arv_buffer_get_status(this->buffer);
-    switch (status)
+    ::ArvBuffer *const buffer = arv_stream_try_pop_buffer(this->stream);
+    if (buffer == nullptr)
     {
-        case ARV_BUFFER_STATUS_CLEARED:
-            return ARV_EXPOSURE_BUSY;
-        case ARV_BUFFER_STATUS_FILLING:
-            return ARV_EXPOSURE_FILLING;
-        case ARV_BUFFER_STATUS_UNKNOWN:
-            return ARV_EXPOSURE_UNKNOWN;
-        case ARV_BUFFER_STATUS_SUCCESS:
-            this->_get_image(fn_image_callback, usr_ptr);
-            this->_stream_stop();
-            return ARV_EXPOSURE_FINISHED;
-        case ARV_BUFFER_STATUS_TIMEOUT:
-        case ARV_BUFFER_STATUS_MISSING_PACKETS:
-        case ARV_BUFFER_STATUS_WRONG_PACKET_ID:
-        case ARV_BUFFER_STATUS_SIZE_MISMATCH:
-        case ARV_BUFFER_STATUS_ABORTED:
-            this->_stream_stop();
-            return ARV_EXPOSURE_FAILED;
-        default:
-            return ARV_EXPOSURE_UNKNOWN;
+        /* The stream takes a buffer off its input queue when the first packet of the frame arrives */
+        gint n_input, n_output;
+        arv_stream_get_n_buffers(this->stream, &n_input, &n_output);
+        return (n_input < this->pool_size) ? ARV_EXPOSURE_FILLING : ARV_EXPOSURE_BUSY;
+    }
+
+    ARV_EXPOSURE_STATUS const status = this->_get_image(buffer, fn_image_callback, usr_ptr);
+    arv_stream_push_buffer(this->stream, buffer);
+    this->_stream_stop();
+    return status;
+}
+
+bool ArvGeneric::stream_start(double const frame_rate)
+{
+    this->_test_exposure_and_abort();
+    if (this->streaming)
+        return true;
+    if (!this->_stream_prepare())
+        return false;
+
+    /* Free running, the camera paces itself at the frame rate */
+    arv_camera_clear_triggers(this->camera, &(this->error));
+    this->_clear_error("arv_camera_clear_triggers");
+    if (frame_rate > 0)
+    {
+        this->cam.frame_rate.set(frame_rate);
+        arv_camera_set_frame_rate(this->camera, this->cam.frame_rate.val(), &(this->error));
+        this->_clear_error("arv_camera_set_frame_rate");
+    }
+
+    arv_camera_set_acquisition_mode(this->camera, ARV_ACQUISITION_MODE_CONTINUOUS, &(this->error));
+    arv_camera_start_acquisition(this->camera, &(this->error));
+    if (this->_clear_error("arv_camera_start_acquisition"))
+    {
+        arv_camera_set_trigger(this->camera, "Software", &(this->error));
+        this->_clear_error("arv_camera_set_trigger");
+        return false;
+    }
+
+    this->streaming = true;
+    return true;
+}
+
+void ArvGeneric::stream_stop(void)
+{
+    if (!this->streaming)
+        return;
+
+    g_clear_error(&this->error);
+    arv_camera_stop_acquisition(this->camera, &(this->error));
+    this->_clear_error("arv_camera_stop_acquisition");
+
+    /* Back to single frames on the software trigger */
+    arv_camera_set_trigger(this->camera, "Software", &(this->error));
+    this->_clear_error("arv_camera_set_trigger");
+
+    this->_buffer_pool_recycle();
+    this->streaming = false;
+}
+
+ARV_EXPOSURE_STATUS ArvGeneric::stream_poll(void (*fn_image_callback)(void *const, uint8_t const *const, size_t),
+                                            void *const usr_ptr, uint32_t const timeout_us)
+{
+    if (!this->streaming)
+        return ARV_EXPOSURE_UNKNOWN;
+
+    ::ArvBuffer *const buffer = arv_stream_timeout_pop_buffer(this->stream, timeout_us);
+    if (buffer == nullptr)
+        return ARV_EXPOSURE_BUSY;
+
+    /* The frame is consumed by the callback, so the buffer goes straight back on the stream */
+    ARV_EXPOSURE_STATUS const status = this->_get_image(buffer, fn_image_callback, usr_ptr);
+    arv_stream_push_buffer(this->stream, buffer);
+    return status;
+}
+
+arv_stream_config ArvGeneric::get_stream_config()
+{
+    return this->stream_config;
+}
+
+void ArvGeneric::set_stream_config(arv_stream_config const &config)
+{
+    this->stream_config = config;
+    if (this->stream_config.buffer_count < 1)
+        this->stream_config.buffer_count = 1;
+
+    /* Transport settings apply to the running stream, the pool is resized on the next start */
+    this->_stream_apply_config();
+}
+
+arv_stream_stats ArvGeneric::get_stream_stats()
+{
+    arv_stream_stats stats = {};
+    if (this->stream == nullptr)
+        return stats;
+
+    guint64 completed, failures, underruns;
+    arv_stream_get_statistics(this->stream, &completed, &failures, &underruns);
+    stats.completed = completed;
+    stats.failures  = failures;
+    stats.underruns = underruns;
+
+    if (ARV_IS_GV_STREAM(this->stream))
+    {
+        guint64 resent, missing;
+        arv_gv_stream_get_statistics(ARV_GV_STREAM(this->stream), &resent, &missing);
+        stats.resent_packets  = resent;
+        stats.missing_packets = missing;
     }
+    return stats;
 }
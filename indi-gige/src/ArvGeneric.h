@@ -66,6 +66,16 @@ class ArvGeneric : public arv::ArvCamera
     ARV_EXPOSURE_STATUS exposure_poll(void (*fn_image_callback)(void *const, uint8_t const *const, size_t),
                                       void *const usr_ptr);
 
+    bool stream_start(double const frame_rate);
+    void stream_stop(void);
+    bool is_streaming();
+    ARV_EXPOSURE_STATUS stream_poll(void (*fn_image_callback)(void *const, uint8_t const *const, size_t),
+                                    void *const usr_ptr, uint32_t const timeout_us);
+
+    arv_stream_config get_stream_config();
+    void set_stream_config(arv_stream_config const &config);
+    arv_stream_stats get_stream_stats();
+
   protected:
     void _init(void);
     bool _configure(void);
@@ -78,24 +88,37 @@ class ArvGeneric : public arv::ArvCamera
     const char *_str_val(const char *s);
     bool _get_initial_config();
     bool _set_initial_config();
-    void _get_image(void (*fn_image_callback)(void *const, uint8_t const *const, size_t), void *const usr_ptr);
+    ARV_EXPOSURE_STATUS _get_image(::ArvBuffer *const buffer,
+                                   void (*fn_image_callback)(void *const, uint8_t const *const, size_t),
+                                   void *const usr_ptr);
+    bool _clear_error(const char *what);
 
     /* aravis library state variables */
     ::ArvCamera *camera;
     ::ArvDevice *dev;
     ::ArvStream *stream;
-    ::ArvBuffer *buffer;
     ::GError *error;
 
     /* streaming, capturing functions */
     ::ArvStream *_stream_create(void);
-    ::ArvBuffer *_buffer_create(void);
+    void _stream_destroy(void);
+    void _stream_apply_config(void);
+    bool _stream_prepare(void);
+    void _buffer_pool_recycle(void);
+    void _buffer_pool_clear(void);
     bool _stream_active();
     void _stream_start();
     void _stream_stop();
     void _trigger_exposure();
 
     bool stream_active;
+    bool streaming;
+
+    /* The stream and its buffers are kept across exposures, and only
+     * reallocated when the payload or the pool size changes */
+    gint pool_payload;
+    int pool_size;
+    arv_stream_config stream_config;
 
     /* Camera properties */
     struct
@@ -33,6 +33,24 @@ typedef enum {
 
 } ARV_EXPOSURE_STATUS;
 
+typedef struct
+{
+    bool packet_resend;          //!< Ask the camera to resend lost packets
+    int socket_buffer_size;      //!< Receive socket buffer in bytes, 0 sizes it to the frame
+    uint32_t packet_timeout_us;  //!< Wait this long for a missing packet before requesting it again
+    uint32_t frame_retention_us; //!< Give up on an incomplete frame after this long
+    int buffer_count;            //!< Buffers kept pushed on the stream
+} arv_stream_config;
+
+typedef struct
+{
+    uint64_t completed;
+    uint64_t failures;
+    uint64_t underruns;
+    uint64_t resent_packets;
+    uint64_t missing_packets;
+} arv_stream_stats;
+
 template <class T>
 class min_max_property
 {
@@ -109,6 +127,18 @@ class ArvCamera
     virtual void exposure_abort(void)                      = 0;
     virtual ARV_EXPOSURE_STATUS exposure_poll(void (*fn_image_callback)(void *const, uint8_t const *const, size_t),
                                               void *const) = 0;
+
+    /* Continuous acquisition */
+    virtual bool stream_start(double const frame_rate) = 0;
+    virtual void stream_stop(void)                     = 0;
+    virtual bool is_streaming()                        = 0;
+    virtual ARV_EXPOSURE_STATUS stream_poll(void (*fn_image_callback)(void *const, uint8_t const *const, size_t),
+                                            void *const, uint32_t const timeout_us) = 0;
+
+    /* Stream transport, only GigE Vision streams can be tuned */
+    virtual arv_stream_config get_stream_config()                    = 0;
+    virtual void set_stream_config(arv_stream_config const &config)  = 0;
+    virtual arv_stream_stats get_stream_stats()                      = 0;
 };
 
 class ArvFactory
@@ -43,7 +43,9 @@
 #define TIMER_US_TO_MS (1000)
 #define TIMER_US_TO_S  (1000000)
 #define TIMER_TICK_MS  (100)
-#define CAPS           (CCD_CAN_ABORT | CCD_CAN_BIN | CCD_CAN_SUBFRAME)
+#define CAPS           (CCD_CAN_ABORT | CCD_CAN_BIN | CCD_CAN_SUBFRAME | CCD_HAS_STREAMING)
+
+#define STREAM_POLL_TIMEOUT_US (100000UL) /* Lets the streaming thread notice a stop request */
 
 static class Loader
 {
@@ -71,6 +73,9 @@ GigECCD::GigECCD(arv::ArvCamera *camera)
 
 GigECCD::~GigECCD()
 {
+    this->stream_running = false;
+    if (this->stream_thread.joinable())
+        this->stream_thread.join();
 }
 
 bool GigECCD::initProperties()
@@ -79,6 +84,31 @@ bool GigECCD::initProperties()
     this->SetCCDCapability((CAPS));
     this->addConfigurationControl();
     this->addDebugControl();
+
+    arv::arv_stream_config const config = this->camera->get_stream_config();
+    IUFillSwitch(&this->indiprop_resend[STREAM_RESEND_ON], "On", "", config.packet_resend ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&this->indiprop_resend[STREAM_RESEND_OFF], "Off", "", config.packet_resend ? ISS_OFF : ISS_ON);
+    IUFillSwitchVector(&this->indiprop_resend_prop, this->indiprop_resend, 2, getDeviceName(), "Packet Resend", "",
+                       OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
+    IUFillNumber(&this->indiprop_transport[STREAM_SOCKET_BUFFER], "Socket Buffer", "Socket buffer (bytes, 0 auto)",
+                 "%.f", 0, 64 * 1024 * 1024, 65536, config.socket_buffer_size);
+    IUFillNumber(&this->indiprop_transport[STREAM_PACKET_TIMEOUT], "Packet Timeout", "Packet timeout (us)", "%.f",
+                 1000, 1000000, 1000, config.packet_timeout_us);
+    IUFillNumber(&this->indiprop_transport[STREAM_FRAME_RETENTION], "Frame Retention", "Frame retention (us)", "%.f",
+                 1000, 10000000, 1000, config.frame_retention_us);
+    IUFillNumber(&this->indiprop_transport[STREAM_BUFFER_COUNT], "Buffers", "Stream buffers", "%.f", 1, 64, 1,
+                 config.buffer_count);
+    IUFillNumberVector(&this->indiprop_transport_prop, this->indiprop_transport, 4, getDeviceName(), "Stream Transport",
+                       "", OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+
+    IUFillNumber(&this->indiprop_stats[STREAM_STATS_COMPLETED], "Completed", "", "%.f", 0, UINT32_MAX, 1, 0);
+    IUFillNumber(&this->indiprop_stats[STREAM_STATS_FAILURES], "Failures", "", "%.f", 0, UINT32_MAX, 1, 0);
+    IUFillNumber(&this->indiprop_stats[STREAM_STATS_UNDERRUNS], "Underruns", "", "%.f", 0, UINT32_MAX, 1, 0);
+    IUFillNumber(&this->indiprop_stats[STREAM_STATS_RESENT], "Resent Packets", "", "%.f", 0, UINT32_MAX, 1, 0);
+    IUFillNumber(&this->indiprop_stats[STREAM_STATS_MISSING], "Missing Packets", "", "%.f", 0, UINT32_MAX, 1, 0);
+    IUFillNumberVector(&this->indiprop_stats_prop, this->indiprop_stats, 5, getDeviceName(), "Stream Stats", "",
+                       MAIN_CONTROL_TAB, IP_RO, 0, IPS_IDLE);
     return true;
 }
 
@@ -127,12 +157,52 @@ void GigECCD::_update_indi_properties(void)
 
     defineProperty(&indiprop_info_prop);
     defineProperty(&this->indiprop_gain_prop);
+    defineProperty(&this->indiprop_resend_prop);
+    defineProperty(&this->indiprop_transport_prop);
+    defineProperty(&this->indiprop_stats_prop);
 }
 
 void GigECCD::_delete_indi_properties(void)
 {
     this->deleteProperty(this->indiprop_gain_prop.name);
     this->deleteProperty(this->indiprop_info_prop.name);
+    this->deleteProperty(this->indiprop_resend_prop.name);
+    this->deleteProperty(this->indiprop_transport_prop.name);
+    this->deleteProperty(this->indiprop_stats_prop.name);
+}
+
+void GigECCD::_update_stream_config(void)
+{
+    arv::arv_stream_config config;
+    config.packet_resend      = (this->indiprop_resend[STREAM_RESEND_ON].s == ISS_ON);
+    config.socket_buffer_size = (int)this->indiprop_transport[STREAM_SOCKET_BUFFER].value;
+    config.packet_timeout_us  = (uint32_t)this->indiprop_transport[STREAM_PACKET_TIMEOUT].value;
+    config.frame_retention_us = (uint32_t)this->indiprop_transport[STREAM_FRAME_RETENTION].value;
+    config.buffer_count       = (int)this->indiprop_transport[STREAM_BUFFER_COUNT].value;
+    this->camera->set_stream_config(config);
+}
+
+void GigECCD::_update_stream_stats(void)
+{
+    arv::arv_stream_stats const stats = this->camera->get_stream_stats();
+    double const values[5] = { (double)stats.completed, (double)stats.failures, (double)stats.underruns,
+                               (double)stats.resent_packets, (double)stats.missing_packets
+                             };
+
+    bool changed = false;
+    for (int i = 0; i < 5; i++)
+    {
+        if (this->indiprop_stats[i].value != values[i])
+        {
+            this->indiprop_stats[i].value = values[i];
+            changed                      = true;
+        }
+    }
+    if (!changed)
+        return;
+
+    this->indiprop_stats_prop.s = (stats.failures > 0 || stats.underruns > 0) ? IPS_BUSY : IPS_OK;
+    IDSetNumber(&this->indiprop_stats_prop, nullptr);
 }
 
 //Initial call
@@ -168,6 +238,8 @@ bool GigECCD::Connect()
 bool GigECCD::Disconnect()
 {
     LOGF_INFO("%s", __PRETTY_FUNCTION__);
+    if (this->stream_running)
+        this->StopStreaming();
 #if 0
     //TODO: re-iterate and acquire proper camera from AvrFactory (based on ID?)
     return camera->disconnect();
@@ -198,6 +270,57 @@ bool GigECCD::AbortExposure()
     return true;
 }
 
+bool GigECCD::StartStreaming()
+{
+    double const fps = Streamer->getTargetFPS();
+    LOGF_INFO("%s fps=%.2f", __PRETTY_FUNCTION__, fps);
+
+    /* Expose for as long as the frame rate allows */
+    if (fps > 0)
+        camera->set_exposure_time(1000000.0 / fps);
+
+    Streamer->setPixelFormat(INDI_MONO, this->camera->get_bpp().val());
+    Streamer->setSize(PrimaryCCD.getSubW(), PrimaryCCD.getSubH());
+
+    if (!camera->stream_start(fps))
+    {
+        LOG_ERROR("Failed to start continuous acquisition");
+        return false;
+    }
+
+    this->stream_running = true;
+    this->stream_thread  = std::thread(&GigECCD::_stream_loop, this);
+    return true;
+}
+
+bool GigECCD::StopStreaming()
+{
+    LOGF_INFO("%s", __PRETTY_FUNCTION__);
+
+    this->stream_running = false;
+    if (this->stream_thread.joinable())
+        this->stream_thread.join();
+
+    camera->stream_stop();
+    this->_update_stream_stats();
+    return true;
+}
+
+void GigECCD::_stream_loop(void)
+{
+    while (this->stream_running)
+    {
+        /* Failed frames are counted by the stream statistics */
+        (void)this->camera->stream_poll(this->_receive_frame_hook, this, STREAM_POLL_TIMEOUT_US);
+    }
+}
+
+void GigECCD::_receive_frame_hook(void *const class_ptr, uint8_t const *const data, size_t size)
+{
+    GigECCD *const cls = static_cast<GigECCD *const>(class_ptr);
+    cls->Streamer->newFrame(data, size);
+}
+
 void GigECCD::_update_image(uint8_t const *const data, size_t size)
 {
     LOGF_INFO("Receiving %i bytes image", size);
@@ -263,6 +386,8 @@ void GigECCD::_handle_timeout(struct timeval *const tv, uint32_t timeout_us)
 void GigECCD::TimerHit()
 {
     this->timer_id = this->SetTimer(TIMER_TICK_MS);
+    if (this->camera->is_connected() && this->camera->is_streaming())
+        this->_update_stream_stats();
     if (!this->camera->is_connected() || !this->camera->is_exposing())
         return;
 
@@ -302,15 +427,48 @@ bool GigECCD::ISNewNumber(const char *dev, const char *name, double values[], ch
             IDSetNumber(&this->indiprop_gain_prop, nullptr);
             return true;
         }
+
+        if (!strcmp(name, this->indiprop_transport_prop.name))
+        {
+            IUUpdateNumber(&this->indiprop_transport_prop, values, names, n);
+            this->_update_stream_config();
+            this->indiprop_transport_prop.s = IPS_OK;
+            IDSetNumber(&this->indiprop_transport_prop, nullptr);
+            return true;
+        }
     }
 
     return INDI::CCD::ISNewNumber(dev, name, values, names, n);
 }
 
+bool GigECCD::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n)
+{
+    if (!strcmp(dev, this->getDeviceName()))
+    {
+        if (!strcmp(name, this->indiprop_resend_prop.name))
+        {
+            IUUpdateSwitch(&this->indiprop_resend_prop, states, names, n);
+            this->_update_stream_config();
+            this->indiprop_resend_prop.s = IPS_OK;
+            IDSetSwitch(&this->indiprop_resend_prop, nullptr);
+            return true;
+        }
+    }
+
+    return INDI::CCD::ISNewSwitch(dev, name, states, names, n);
+}
+
 bool GigECCD::UpdateCCDFrame(int x, int y, int w, int h)
 {
     LOGF_INFO("%s x=%i y=%i w=%i h=%i", __PRETTY_FUNCTION__, x, y, w, h);
 
+    /* Pooled stream buffers are sized for the current frame */
+    if (this->camera->is_streaming())
+    {
+        LOG_ERROR("Cannot change the frame while streaming");
+        return false;
+    }
+
     this->camera->set_geometry(x, y, w, h);
     return this->_update_geometry();
 }
@@ -318,6 +476,11 @@ bool GigECCD::UpdateCCDFrame(int x, int y, int w, int h)
 bool GigECCD::UpdateCCDBin(int binx, int biny)
 {
     LOGF_INFO("%s binx=%i biny=%i", __PRETTY_FUNCTION__, binx, biny);
+    if (this->camera->is_streaming())
+    {
+        LOG_ERROR("Cannot change binning while streaming");
+        return false;
+    }
     camera->set_bin(binx, biny);
     return UpdateCCDFrame(PrimaryCCD.getSubX(), PrimaryCCD.getSubY(), PrimaryCCD.getSubW(), PrimaryCCD.getSubH());
 }
@@ -328,3 +491,12 @@ bool GigECCD::UpdateCCDFrameType(INDI::CCDChip::CCD_FRAME fType)
     PrimaryCCD.setFrameType(fType);
     return true;
 }
+
+bool GigECCD::saveConfigItems(FILE *fp)
+{
+    INDI::CCD::saveConfigItems(fp);
+
+    IUSaveConfigSwitch(fp, &this->indiprop_resend_prop);
+    IUSaveConfigNumber(fp, &this->indiprop_transport_prop);
+    return true;
+}
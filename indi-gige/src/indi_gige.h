@@ -21,7 +21,9 @@
 #define GENERIC_CCD_H
 
 #include <indiccd.h>
+#include <atomic>
 #include <iostream>
+#include <thread>
 
 #include "ArvInterface.h"
 
@@ -44,11 +46,15 @@ class GigECCD : public INDI::CCD
     bool StartExposure(float duration);
     bool AbortExposure();
 
+    bool StartStreaming();
+    bool StopStreaming();
+
   protected:
     void TimerHit();
     virtual bool UpdateCCDFrame(int x, int y, int w, int h);
     virtual bool UpdateCCDBin(int binx, int biny);
     virtual bool UpdateCCDFrameType(INDI::CCDChip::CCD_FRAME fType);
+    virtual bool saveConfigItems(FILE *fp);
 
   private:
     void _delete_indi_properties(void);
@@ -60,12 +66,21 @@ class GigECCD : public INDI::CCD
     void _handle_failed(void);
     void _handle_timeout(struct timeval *const tv, uint32_t timeout_us);
 
+    void _stream_loop(void);
+    static void _receive_frame_hook(void *const class_ptr, uint8_t const *const data, size_t size);
+    void _update_stream_config(void);
+    void _update_stream_stats(void);
+
     arv::ArvCamera *camera;
     char name[32];
     int timer_id;
     struct timeval exposure_start_time;
     struct timeval exposure_transfer_time;
 
+    /* Frames are popped off the aravis stream on their own thread while streaming */
+    std::thread stream_thread;
+    std::atomic<bool> stream_running { false };
+
     /* Indi properties */
 
     INumber indiprop_gain[1];
@@ -73,7 +88,37 @@ class GigECCD : public INDI::CCD
     IText indiprop_info[3] {};
     ITextVectorProperty indiprop_info_prop;
 
+    enum
+    {
+        STREAM_RESEND_ON,
+        STREAM_RESEND_OFF,
+    };
+    ISwitch indiprop_resend[2];
+    ISwitchVectorProperty indiprop_resend_prop;
+
+    enum
+    {
+        STREAM_SOCKET_BUFFER,
+        STREAM_PACKET_TIMEOUT,
+        STREAM_FRAME_RETENTION,
+        STREAM_BUFFER_COUNT,
+    };
+    INumber indiprop_transport[4];
+    INumberVectorProperty indiprop_transport_prop;
+
+    enum
+    {
+        STREAM_STATS_COMPLETED,
+        STREAM_STATS_FAILURES,
+        STREAM_STATS_UNDERRUNS,
+        STREAM_STATS_RESENT,
+        STREAM_STATS_MISSING,
+    };
+    INumber indiprop_stats[5];
+    INumberVectorProperty indiprop_stats_prop;
+
     virtual bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n);
+    virtual bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n);
 
     friend void ::ISGetProperties(const char *dev);
     friend void ::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int num);
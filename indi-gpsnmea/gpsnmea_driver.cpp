@@ -38,9 +38,11 @@
 #include <time.h>
 #include <string.h>
 #include <pthread.h>
+#include <atomic>
 
 #define MAX_NMEA_PARSES     50              // Read 50 streams before giving up
 #define MAX_TIMEOUT_COUNT   5               // Maximum timeout before auto-connect
+#define NMEA_TIMEOUT        3               // Seconds to wait for data before counting a timeout
 
 // We declare an auto pointer to GPSD.
 static std::unique_ptr<GPSNMEA> gpsnema(new GPSNMEA());
@@ -101,26 +103,96 @@ bool GPSNMEA::updateProperties()
     return true;
 }
 
+// Seconds elapsed on the monotonic clock since the sentence was read
+static double sentenceAge(const struct timespec &received)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - received.tv_sec) + (now.tv_nsec - received.tv_nsec) / 1e9;
+}
+
 IPState GPSNMEA::updateGPS()
 {
-    IPState rc = IPS_BUSY;
+    GPSFix fix = readFix();
 
-    pthread_mutex_lock(&lock);
-    if (locationPending == false && timePending == false)
+    if (fix.fixMode != lastFixMode)
     {
-        rc = IPS_OK;
-        locationPending = true;
-        timePending = true;
+        lastFixMode = fix.fixMode;
+        if (fix.fixMode == 1)
+        {
+            GPSstatusTP.s = IPS_BUSY;
+            IUSaveText(&GPSstatusT[0], "NO FIX");
+        }
+        else if (fix.fixMode == 2)
+        {
+            GPSstatusTP.s = IPS_OK;
+            IUSaveText(&GPSstatusT[0], "2D FIX");
+        }
+        else if (fix.fixMode == 3)
+        {
+            GPSstatusTP.s = IPS_OK;
+            IUSaveText(&GPSstatusT[0], "3D FIX");
+        }
+        IDSetText(&GPSstatusTP, nullptr);
     }
-    pthread_mutex_unlock(&lock);
 
-    return rc;
+    if (fix.locationUpdates == lastLocationUpdate || fix.timeUpdates == lastTimeUpdate)
+        return IPS_BUSY;
+
+    lastLocationUpdate = fix.locationUpdates;
+    lastTimeUpdate = fix.timeUpdates;
+
+    LocationNP[LOCATION_LATITUDE].value  = fix.latitude;
+    LocationNP[LOCATION_LONGITUDE].value = fix.longitude;
+    LocationNP[LOCATION_ELEVATION].value = fix.elevation;
+
+    char ts[32] = {0};
+    struct tm *utc, *local;
+    // Report the GPS time as of now, not as of when the sentence arrived
+    time_t raw_time = fix.time + static_cast<time_t>(sentenceAge(fix.received) + 0.5);
+
+    utc = gmtime(&raw_time);
+    strftime(ts, 32, "%Y-%m-%dT%H:%M:%S", utc);
+    TimeTP[0].setText(ts);
+
+    local = localtime(&raw_time);
+    snprintf(ts, 32, "%4.2f", (local->tm_gmtoff / 3600.0));
+    TimeTP[1].setText(ts);
+
+    return IPS_OK;
+}
+
+void GPSNMEA::publishFix()
+{
+    uint32_t sequence = fixSequence.load(std::memory_order_relaxed);
+    fixSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    publishedFix = pendingFix;
+    fixSequence.store(sequence + 2, std::memory_order_release);
+}
+
+GPSNMEA::GPSFix GPSNMEA::readFix() const
+{
+    GPSFix fix;
+    uint32_t before, after;
+    do
+    {
+        before = fixSequence.load(std::memory_order_acquire);
+        fix = publishedFix;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = fixSequence.load(std::memory_order_relaxed);
+    }
+    while (before != after || (before & 1));
+
+    return fix;
 }
 
 bool GPSNMEA::isNMEA()
 {
     char line[MINMEA_MAX_LENGTH];
 
+    rxLength = 0;
+
     int bytes_read = 0;
     int tty_rc = tty_nread_section(PortFD, line, MINMEA_MAX_LENGTH, 0xA, 3, &bytes_read);
     if (tty_rc < 0)
@@ -139,16 +211,62 @@ void* GPSNMEA::parseNMEAHelper(void *obj)
     return nullptr;
 }
 
-void GPSNMEA::parseNEMA()
+int GPSNMEA::readSentences()
 {
-    static char ts[32] = {0};
+    int tty_rc = tty_timeout(PortFD, NMEA_TIMEOUT);
+    if (tty_rc != TTY_OK)
+        return tty_rc;
 
-    char line[MINMEA_MAX_LENGTH];
+    // Timestamp the burst as soon as it is available, before any parsing
+    clock_gettime(CLOCK_MONOTONIC, &rxTime);
+
+    ssize_t bytes_read = read(PortFD, rxBuffer + rxLength, RX_BUFFER_SIZE - rxLength);
+    if (bytes_read < 0)
+        return TTY_READ_ERROR;
+    if (bytes_read == 0)
+    {
+        errno = ECONNRESET;
+        return TTY_READ_ERROR;
+    }
+
+    char *start = rxBuffer;
+    char *end = rxBuffer + rxLength + bytes_read;
+    char *eol;
+    bool updated = false;
+
+    while ((eol = static_cast<char *>(memchr(start, '\n', end - start))) != nullptr)
+    {
+        *eol = '\0';
+        if (eol > start && eol[-1] == '\r')
+            eol[-1] = '\0';
+
+        parseSentence(start);
+        updated = true;
+        start = eol + 1;
+    }
+
+    if (updated)
+        publishFix();
+
+    rxLength = end - start;
+    // A full buffer without a single terminator is not an NMEA stream
+    if (rxLength == RX_BUFFER_SIZE)
+    {
+        rxLength = 0;
+        return TTY_OVERFLOW;
+    }
+    memmove(rxBuffer, start, rxLength);
+
+    return TTY_OK;
+}
+
+void GPSNMEA::parseNEMA()
+{
+    rxLength = 0;
 
     while (isConnected())
     {
-        int bytes_read = 0;
-        int tty_rc = tty_nread_section(PortFD, line, MINMEA_MAX_LENGTH, 0xA, 3, &bytes_read);
+        int tty_rc = readSentences();
         if (tty_rc < 0)
         {
             if (tty_rc == TTY_OVERFLOW)
@@ -160,17 +278,16 @@ void GPSNMEA::parseNEMA()
             }
             else
             {
-                char errmsg[MAXRBUF];
-                tty_error_msg(tty_rc, errmsg, MAXRBUF);
-                if (tty_rc == TTY_TIME_OUT || errno == ECONNREFUSED)
+                if (tty_rc == TTY_TIME_OUT || errno == ECONNREFUSED || errno == ECONNRESET)
                 {
-                    if (errno == ECONNREFUSED)
+                    if (errno == ECONNREFUSED || errno == ECONNRESET)
                     {
                         // sleep for 10 seconds
                         tcpConnection->Disconnect();
                         usleep(10 * 1e6);
                         tcpConnection->Connect();
                         PortFD = tcpConnection->getPortFD();
+                        rxLength = 0;
                     }
                     else if (timeoutCounter++ > MAX_TIMEOUT_COUNT)
                     {
@@ -182,195 +299,141 @@ void GPSNMEA::parseNEMA()
                         tcpConnection->Connect();
                         PortFD = tcpConnection->getPortFD();
                         timeoutCounter = 0;
+                        rxLength = 0;
                     }
                 }
                 continue;
             }
         }
-        line[bytes_read] = '\0';
+    }
+
+    pthread_exit(nullptr);
+}
 
-        LOGF_DEBUG("%s", line);
-        switch (minmea_sentence_id(line, false))
+void GPSNMEA::parseSentence(const char *line)
+{
+    switch (minmea_sentence_id(line, false))
+    {
+        case MINMEA_SENTENCE_RMC:
         {
-            case MINMEA_SENTENCE_RMC:
+            struct minmea_sentence_rmc frame;
+            if (minmea_parse_rmc(&frame, line))
             {
-                struct minmea_sentence_rmc frame;
-                if (minmea_parse_rmc(&frame, line))
-                {
-                    if (frame.valid)
-                    {
-                        LocationNP[LOCATION_LATITUDE].value  = minmea_tocoord(&frame.latitude);
-                        LocationNP[LOCATION_LONGITUDE].value = minmea_tocoord(&frame.longitude);
-                        if (LocationNP[LOCATION_LONGITUDE].value < 0)
-                            LocationNP[LOCATION_LONGITUDE].value += 360;
-
-                        struct timespec timesp;
-                        time_t raw_time;
-                        struct tm *utc, *local;
-
-                        if (minmea_gettime(&timesp, &frame.date, &frame.time) == -1)
-                            break;
-
-                        raw_time = timesp.tv_sec;
-                        utc = gmtime(&raw_time);
-                        strftime(ts, 32, "%Y-%m-%dT%H:%M:%S", utc);
-                        TimeTP[0].setText(ts);
-
-                        setSystemTime(raw_time);
-
-                        local = localtime(&raw_time);
-                        snprintf(ts, 32, "%4.2f", (local->tm_gmtoff / 3600.0));
-                        TimeTP[1].setText(ts);
-
-                        pthread_mutex_lock(&lock);
-                        locationPending = false;
-                        timePending = false;
-                        LOG_DEBUG("Threaded Location and Time updates complete.");
-                        pthread_mutex_unlock(&lock);
-                    }
-                }
-                else
+                if (frame.valid)
                 {
-                    LOG_DEBUG("$xxRMC sentence is not parsed");
+                    struct timespec timesp;
+
+                    if (minmea_gettime(&timesp, &frame.date, &frame.time) == -1)
+                        break;
+
+                    pendingFix.latitude  = minmea_tocoord(&frame.latitude);
+                    pendingFix.longitude = minmea_tocoord(&frame.longitude);
+                    if (pendingFix.longitude < 0)
+                        pendingFix.longitude += 360;
+
+                    pendingFix.time = timesp.tv_sec;
+                    pendingFix.received = rxTime;
+                    pendingFix.locationUpdates++;
+                    pendingFix.timeUpdates++;
+
+                    setSystemTime(timesp.tv_sec + static_cast<time_t>(sentenceAge(rxTime) + 0.5));
                 }
             }
-            break;
-
-            case MINMEA_SENTENCE_GGA:
+            else
             {
-                struct minmea_sentence_gga frame;
-                if (minmea_parse_gga(&frame, line))
-                {
-                    if (frame.fix_quality == 1)
-                    {
-                        LocationNP[LOCATION_LATITUDE].value  = minmea_tocoord(&frame.latitude);
-                        LocationNP[LOCATION_LONGITUDE].value = minmea_tocoord(&frame.longitude);
-                        if (LocationNP[LOCATION_LONGITUDE].value < 0)
-                            LocationNP[LOCATION_LONGITUDE].value += 360;
-
-                        LocationNP[LOCATION_ELEVATION].value = minmea_tofloat(&frame.altitude);
-
-                        struct timespec timesp;
-                        time_t raw_time;
-                        struct tm *utc, *local;
-                        minmea_date gmt_date;
-
-                        time(&raw_time);
-                        utc = gmtime(&raw_time);
-                        gmt_date.day = utc->tm_mday;
-                        gmt_date.month = utc->tm_mon + 1;
-                        gmt_date.year = utc->tm_year;
-
-                        minmea_gettime(&timesp, &gmt_date, &frame.time);
-
-                        raw_time = timesp.tv_sec;
-                        utc = gmtime(&raw_time);
-                        strftime(ts, 32, "%Y-%m-%dT%H:%M:%S", utc);
-                        TimeTP[0].setText(ts);
-                        setSystemTime(raw_time);
-
-                        local = localtime(&raw_time);
-                        snprintf(ts, 32, "%4.2f", (local->tm_gmtoff / 3600.0));
-                        TimeTP[1].setText(ts);
-
-                        pthread_mutex_lock(&lock);
-                        timePending = false;
-                        locationPending = false;
-                        LOG_DEBUG("Threaded Location and Time updates complete.");
-                        pthread_mutex_unlock(&lock);
-                    }
-                }
-                else
-                {
-                    LOG_DEBUG("$xxGGA sentence is not parsed");
-                }
+                LOG_DEBUG("$xxRMC sentence is not parsed");
             }
-            break;
+        }
+        break;
 
-            case MINMEA_SENTENCE_GSA:
+        case MINMEA_SENTENCE_GGA:
+        {
+            struct minmea_sentence_gga frame;
+            if (minmea_parse_gga(&frame, line))
             {
-                struct minmea_sentence_gsa frame;
-                if (minmea_parse_gsa(&frame, line))
+                if (frame.fix_quality == 1)
                 {
-                    if (frame.fix_type == 1)
-                    {
-                        GPSstatusTP.s = IPS_BUSY;
-                        IUSaveText(&GPSstatusT[0], "NO FIX");
-                    }
-                    else if (frame.fix_type == 2)
-                    {
-                        GPSstatusTP.s = IPS_OK;
-                        IUSaveText(&GPSstatusT[0], "2D FIX");
-                    }
-                    else if (frame.fix_type == 3)
-                    {
-                        GPSstatusTP.s = IPS_OK;
-                        IUSaveText(&GPSstatusT[0], "3D FIX");
-                    }
-                    IDSetText(&GPSstatusTP, nullptr);
+                    pendingFix.latitude  = minmea_tocoord(&frame.latitude);
+                    pendingFix.longitude = minmea_tocoord(&frame.longitude);
+                    if (pendingFix.longitude < 0)
+                        pendingFix.longitude += 360;
 
-                }
-                else
-                {
-                    LOG_DEBUG("$xxGSA sentence is not parsed.");
-                }
-            }
-            break;
-            case MINMEA_SENTENCE_ZDA:
-            {
-                struct minmea_sentence_zda frame;
-                if (minmea_parse_zda(&frame, line))
-                {
-                    LOGF_DEBUG("$xxZDA: %d:%d:%d %02d.%02d.%d UTC%+03d:%02d",
-                               frame.time.hours,
-                               frame.time.minutes,
-                               frame.time.seconds,
-                               frame.date.day,
-                               frame.date.month,
-                               frame.date.year,
-                               frame.hour_offset,
-                               frame.minute_offset);
+                    pendingFix.elevation = minmea_tofloat(&frame.altitude);
 
                     struct timespec timesp;
                     time_t raw_time;
-                    struct tm *utc, *local;
+                    struct tm utc;
+                    minmea_date gmt_date;
 
-                    minmea_gettime(&timesp, &frame.date, &frame.time);
+                    time(&raw_time);
+                    gmtime_r(&raw_time, &utc);
+                    gmt_date.day = utc.tm_mday;
+                    gmt_date.month = utc.tm_mon + 1;
+                    gmt_date.year = utc.tm_year;
 
-                    raw_time = timesp.tv_sec;
-                    utc = gmtime(&raw_time);
-                    strftime(ts, 32, "%Y-%m-%dT%H:%M:%S", utc);
-                    TimeTP[0].setText(ts);
-                    setSystemTime(raw_time);
+                    minmea_gettime(&timesp, &gmt_date, &frame.time);
 
-                    local = localtime(&raw_time);
-                    snprintf(ts, 32, "%4.2f", (local->tm_gmtoff / 3600.0));
-                    TimeTP[1].setText(ts);
+                    pendingFix.time = timesp.tv_sec;
+                    pendingFix.received = rxTime;
+                    pendingFix.locationUpdates++;
+                    pendingFix.timeUpdates++;
 
-                    pthread_mutex_lock(&lock);
-                    timePending = false;
-                    LOG_DEBUG("Threaded Time update complete.");
-                    pthread_mutex_unlock(&lock);
-                }
-                else
-                {
-                    LOG_DEBUG("$xxZDA sentence is not parsed");
+                    setSystemTime(timesp.tv_sec + static_cast<time_t>(sentenceAge(rxTime) + 0.5));
                 }
             }
-            break;
+            else
+            {
+                LOG_DEBUG("$xxGGA sentence is not parsed");
+            }
+        }
+        break;
+
+        case MINMEA_SENTENCE_GSA:
+        {
+            struct minmea_sentence_gsa frame;
+            if (minmea_parse_gsa(&frame, line))
+            {
+                if (frame.fix_type >= 1 && frame.fix_type <= 3)
+                    pendingFix.fixMode = frame.fix_type;
+            }
+            else
+            {
+                LOG_DEBUG("$xxGSA sentence is not parsed.");
+            }
+        }
+        break;
 
-            case MINMEA_INVALID:
+        case MINMEA_SENTENCE_ZDA:
+        {
+            struct minmea_sentence_zda frame;
+            if (minmea_parse_zda(&frame, line))
             {
-                //LOG_WARN("$xxxxx sentence is not valid");
-            } break;
+                struct timespec timesp;
+
+                minmea_gettime(&timesp, &frame.date, &frame.time);
+
+                pendingFix.time = timesp.tv_sec;
+                pendingFix.received = rxTime;
+                pendingFix.timeUpdates++;
 
-            default:
+                setSystemTime(timesp.tv_sec + static_cast<time_t>(sentenceAge(rxTime) + 0.5));
+            }
+            else
             {
-                LOG_DEBUG("$xxxxx sentence is not parsed");
+                LOG_DEBUG("$xxZDA sentence is not parsed");
             }
-            break;
         }
-    }
+        break;
 
-    pthread_exit(nullptr);
+        case MINMEA_INVALID:
+        {
+            //LOG_WARN("$xxxxx sentence is not valid");
+        } break;
+
+        default:
+        {
+            LOG_DEBUG("$xxxxx sentence is not parsed");
+        }
+        break;
+    }
 }
@@ -26,6 +26,9 @@
 
 #include <indigps.h>
 
+#include <atomic>
+#include <time.h>
+
 class GPSNMEA : public INDI::GPS
 {
   public:
@@ -45,14 +48,49 @@ class GPSNMEA : public INDI::GPS
     virtual IPState updateGPS() override;
 
 private:
+    // Latest solution decoded by the NMEA thread, published to updateGPS through a seqlock
+    struct GPSFix
+    {
+        double latitude { 0 };
+        double longitude { 0 };
+        double elevation { 0 };
+        // GPS UTC time of the last time-bearing sentence
+        time_t time { 0 };
+        // Local clock when the bytes carrying that sentence were read
+        struct timespec received { 0, 0 };
+        // 0 unknown, 1 no fix, 2 2D fix, 3 3D fix (GSA)
+        int fixMode { 0 };
+        uint32_t locationUpdates { 0 };
+        uint32_t timeUpdates { 0 };
+    };
+
     Connection::TCP *tcpConnection { nullptr };
     bool isNMEA();
     void parseNEMA();
+    int readSentences();
+    void parseSentence(const char *line);
+    void publishFix();
+    GPSFix readFix() const;
 
     int PortFD { -1 };
     uint8_t timeoutCounter=0;
-    bool locationPending = true, timePending=true;
 
-    pthread_mutex_t lock;
+    // Receive buffer, several sentences are framed and parsed in place per read()
+    static constexpr size_t RX_BUFFER_SIZE = 4096;
+    char rxBuffer[RX_BUFFER_SIZE];
+    size_t rxLength { 0 };
+    struct timespec rxTime { 0, 0 };
+
+    // Working copy owned by the NMEA thread
+    GPSFix pendingFix;
+    // Published copy and its sequence counter, odd while a write is in progress
+    GPSFix publishedFix;
+    std::atomic<uint32_t> fixSequence { 0 };
+
+    // Last published state consumed by updateGPS
+    uint32_t lastLocationUpdate { 0 };
+    uint32_t lastTimeUpdate { 0 };
+    int lastFixMode { 0 };
+
     pthread_t nmeaThread;
 };
@@ -9,6 +9,7 @@
 #include <sys/file.h>
 #include <memory>
 #include "inovaplx_ccd.h"
+#include "imagekernels.h"
 
 int timerNS = -1;
 int timerWE = -1;
@@ -376,7 +377,6 @@ void INovaCCD::grabImage()
     if(image != nullptr)
     {
         int Bpp = iNovaSDK_GetDataWide() > 0 ? 2 : 1;
-        int p = 0;
 
         int binX = PrimaryCCD.getBinX();
         int binY = PrimaryCCD.getBinY();
@@ -389,38 +389,18 @@ void INovaCCD::grabImage()
         endX = (endX > maxW ? maxW : endX);
         endY = (endY > maxH ? maxH : endY);
 
-        for(int y = startY; y < endY; y += binY)
-        {
-            if(endY - y < binY)
-                break;
-            for(int x = startX * Bpp; x < endX * Bpp; x += Bpp * binX)
-            {
-                if(endX * Bpp - x < binX * Bpp)
-                    break;
-                int t = 0;
-                for(int yy = y; yy < y + binY; yy++)
-                {
-                    for(int xx = x; xx < x + Bpp * binX; xx += Bpp)
-                    {
-                        if(Bpp > 1)
-                        {
-                            t += RawData[1 + xx + yy * maxW * Bpp] + (RawData[xx + yy * maxW * Bpp] << 8);
-                            t = (t < 0xffff ? t : 0xffff);
-                        }
-                        else
-                        {
-                            t += RawData[xx + yy * maxW * Bpp];
-                            t = (t < 0xff ? t : 0xff);
-                        }
-                    }
-                }
-                image[p++] = (unsigned char)(t & 0xff);
-                if(Bpp > 1)
-                {
-                    image[p++] = (unsigned char)((t >> 8) & 0xff);
-                }
-            }
-        }
+        // Raw 16 bit data is big endian, binned bins are summed and saturated.
+        const uint8_t *roi = RawData + (startY * maxW + startX) * Bpp;
+        ImageKernels::BinOptions options;
+        options.order = ImageKernels::Endian::Big;
+        options.threads = 0;
+
+        if(Bpp > 1)
+            ImageKernels::bin16(reinterpret_cast<uint16_t *>(image), roi, maxW * Bpp, endX - startX, endY - startY,
+                                binX, binY, options);
+        else
+            ImageKernels::bin8(image, roi, maxW, endX - startX, endY - startY, binX, binY, options);
+
         guard.unlock();
         // Let INDI::CCD know we're done filling the image buffer
         LOG_INFO("Download complete.");
@@ -21,6 +21,7 @@
 #include "indi_libcamera.h"
 
 #include "config.h"
+#include "imagekernels.h"
 
 #include <stream/streammanager.h>
 #include <indielapsedtimer.h>
@@ -58,6 +59,13 @@ void INDILibCamera::shutdownVideo()
 
 void INDILibCamera::workerStreamVideo(const std::atomic_bool &isAboutToQuit, double framerate)
 {
+    // MJPEG encoding is only needed when the client asked for compressed video
+    if (CaptureFormatSP.findOnSwitchIndex() != CAPTURE_JPG)
+    {
+        workerStreamRaw(isAboutToQuit, framerate);
+        return;
+    }
+
     m_CameraApp->SetEncodeOutputReadyCallback(std::bind(&INDILibCamera::outputReady, this,
             std::placeholders::_1,
             std::placeholders::_2,
@@ -112,15 +120,10 @@ void INDILibCamera::outputReady(void *mem, size_t size, int64_t timestamp_us, bo
 {
     INDI_UNUSED(timestamp_us);
     INDI_UNUSED(keyframe);
-    uint8_t * cameraBuffer = PrimaryCCD.getFrameBuffer();
-    size_t cameraBufferSize = 0;
-    int w = 0, h = 0, naxis = 0;
-
-    // Read jpeg from memory
-    std::unique_lock<std::mutex> ccdguard(ccdBufferLock);
 
     if (m_LiveVideoWidth <= 0)
     {
+        std::unique_lock<std::mutex> ccdguard(ccdBufferLock);
         auto info = m_CameraApp->GetStreamInfo(m_CameraApp->VideoStream());
         m_LiveVideoWidth = info.width;
         m_LiveVideoHeight = info.height;
@@ -129,37 +132,262 @@ void INDILibCamera::outputReady(void *mem, size_t size, int64_t timestamp_us, bo
         Streamer->setSize(m_LiveVideoWidth, m_LiveVideoHeight);
     }
 
-    if (CaptureFormatSP.findOnSwitchIndex() == CAPTURE_JPG)
+    Streamer->newFrame(static_cast<uint8_t*>(mem), size);
+}
+
+void INDILibCamera::workerStreamRaw(const std::atomic_bool &isAboutToQuit, double framerate)
+{
+    VideoOptions* options = m_CameraApp->GetOptions();
+    initOptions(true);
+    options->framerate = framerate;
+
+    bool bayer = StreamSourceSP.findOnSwitchIndex() == STREAM_BAYER;
+
+    try
+    {
+        if(REOPEN__CAMERA) m_CameraApp->OpenCamera();
+        m_CameraApp->ConfigureVideo(bayer ? LibcameraEncoder::FLAG_VIDEO_RAW : LibcameraEncoder::FLAG_VIDEO_NONE);
+        m_CameraApp->StartCamera();
+    }
+    catch (std::exception &e)
     {
-        // We are done with writing to CCD buffer
-        ccdguard.unlock();
-        Streamer->newFrame(static_cast<uint8_t*>(mem), size);
+        LOGF_ERROR("Error opening camera: %s", e.what());
+        shutdownVideo();
         return;
     }
 
-    int rc = processJPEGMemory(reinterpret_cast<uint8_t*>(mem), size, &cameraBuffer, &cameraBufferSize, &naxis, &w, &h);
+    StreamInfo info;
+    libcamera::Stream *stream = bayer ? m_CameraApp->RawStream(&info) : m_CameraApp->VideoStream(&info);
 
-    if (rc != 0)
+    char bayer_pattern[8] = {};
+    int bpp = 8;
+    bool packed = false;
+    if (bayer && !parseRawFormat(info.pixel_format, bayer_pattern, &bpp, &packed))
     {
-        LOG_ERROR("Error getting live video frame.");
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        LOGF_ERROR("Unsupported raw stream format %s", info.pixel_format.toString().c_str());
+        shutdownVideo();
         return;
     }
 
-    PrimaryCCD.setFrameBuffer(cameraBuffer);
-    if (naxis != PrimaryCCD.getNAxis())
+    // YUV420 luma plane goes out as 8 bit mono, raw Bayer is left aligned to 16 bits for the streamer.
+    int depth = bayer ? 16 : 8;
+    size_t frameSize = info.width * info.height * depth / 8;
+    m_StreamBuffer.resize(frameSize);
+
+    {
+        std::unique_lock<std::mutex> ccdguard(ccdBufferLock);
+        m_LiveVideoWidth = info.width;
+        m_LiveVideoHeight = info.height;
+        PrimaryCCD.setBin(1, 1);
+        PrimaryCCD.setFrame(0, 0, m_LiveVideoWidth, m_LiveVideoHeight);
+        PrimaryCCD.setNAxis(2);
+    }
+
+    if (bayer)
+    {
+        const std::map<std::string, INDI_PIXEL_FORMAT> bayerFormats =
+        {
+            { "RGGB", INDI_BAYER_RGGB },
+            { "GRBG", INDI_BAYER_GRBG },
+            { "GBRG", INDI_BAYER_GBRG },
+            { "BGGR", INDI_BAYER_BGGR }
+        };
+        Streamer->setPixelFormat(bayerFormats.at(bayer_pattern), depth);
+    }
+    else
+        Streamer->setPixelFormat(INDI_MONO, depth);
+    Streamer->setSize(info.width, info.height);
+
+    LOGF_DEBUG("Streaming %s %dx%d stride %d without encoding.", info.pixel_format.toString().c_str(),
+               info.width, info.height, info.stride);
+
+    while (!isAboutToQuit)
+    {
+        LibcameraEncoder::Msg msg = m_CameraApp->Wait();
+        if (msg.type == LibcameraEncoder::MsgType::Quit)
+        {
+            shutdownVideo();
+            return;
+        }
+        else if (msg.type != LibcameraEncoder::MsgType::RequestComplete)
+        {
+            LOGF_ERROR("Video Streaming failed: %d", msg.type);
+            shutdownVideo();
+            return;
+        }
+
+        auto completed_request = std::get<CompletedRequestPtr>(msg.payload);
+        const std::vector<libcamera::Span<uint8_t>> mem = m_CameraApp->Mmap(completed_request->buffers[stream]);
+        if (mem.empty())
+            continue;
+
+        if (bayer)
+            unpackRaw(mem[0].data(), info, bpp, packed, 16 - bpp, reinterpret_cast<uint16_t *>(m_StreamBuffer.data()));
+        else
+        {
+            // Y plane comes first in YUV420, rows are padded to the stride.
+            for (unsigned int y = 0; y < info.height; y++)
+                memcpy(m_StreamBuffer.data() + y * info.width, mem[0].data() + y * info.stride, info.width);
+        }
+
+        Streamer->newFrame(m_StreamBuffer.data(), frameSize);
+    }
+
+    m_CameraApp->StopCamera();
+    m_CameraApp->Teardown();
+    if(REOPEN__CAMERA) m_CameraApp->CloseCamera();
+}
+
+bool INDILibCamera::parseRawFormat(const libcamera::PixelFormat &format, char *bayer_pattern, int *bitsperpixel,
+                                   bool *packed)
+{
+    // Bayer formats are named S<pattern><depth>[_CSI2P], e.g. SRGGB10_CSI2P or SGBRG12
+    std::string name = format.toString();
+    if (name.size() < 6 || name[0] != 'S')
+        return false;
+
+    int bits = atoi(name.substr(5).c_str());
+    std::string suffix = name.substr(5 + std::to_string(bits).size());
+    bool isPacked = (suffix == "_CSI2P");
+    if (!isPacked && !suffix.empty())
+        return false;
+
+    if (bits != 8 && bits != 10 && bits != 12 && bits != 14 && bits != 16)
+        return false;
+    // Only the 10 and 12 bit CSI-2 packings are produced by Raspberry Pi sensors
+    if (isPacked && bits != 10 && bits != 12)
+        return false;
+
+    std::string pattern = name.substr(1, 4);
+    if (pattern != "RGGB" && pattern != "GRBG" && pattern != "GBRG" && pattern != "BGGR")
+        return false;
+
+    strncpy(bayer_pattern, pattern.c_str(), 8);
+    *bitsperpixel = bits;
+    *packed = isPacked;
+    return true;
+}
+
+void INDILibCamera::unpackRaw(const uint8_t *src, const StreamInfo &info, int bitsperpixel, bool packed, int shift,
+                              uint16_t *dst)
+{
+    const unsigned int w = info.width;
+
+    for (unsigned int y = 0; y < info.height; y++)
+    {
+        const uint8_t *in = src + y * info.stride;
+        uint16_t *out = dst + y * w;
+        unsigned int x = 0;
+
+        if (!packed && bitsperpixel == 8)
+        {
+            for (; x < w; x++)
+                out[x] = in[x] << shift;
+        }
+        else if (!packed)
+        {
+            // Unpacked formats are little endian 16 bit words with the data in the low bits
+            for (; x < w; x++)
+                out[x] = (in[2 * x] | (in[2 * x + 1] << 8)) << shift;
+        }
+        else if (bitsperpixel == 10)
+        {
+            // CSI-2 RAW10: four pixels in five bytes, the fifth byte holds the 2 LSBs of each pixel
+            for (; x + 4 <= w; x += 4, in += 5)
+            {
+                out[x]     = ((in[0] << 2) | (in[4] & 0x03)) << shift;
+                out[x + 1] = ((in[1] << 2) | ((in[4] >> 2) & 0x03)) << shift;
+                out[x + 2] = ((in[2] << 2) | ((in[4] >> 4) & 0x03)) << shift;
+                out[x + 3] = ((in[3] << 2) | (in[4] >> 6)) << shift;
+            }
+            for (unsigned int i = 0; x < w; x++, i++)
+                out[x] = ((in[i] << 2) | ((in[4] >> (2 * i)) & 0x03)) << shift;
+        }
+        else
+        {
+            // CSI-2 RAW12: two pixels in three bytes, the third byte holds the 4 LSBs of each pixel
+            for (; x + 2 <= w; x += 2, in += 3)
+            {
+                out[x]     = ((in[0] << 4) | (in[2] & 0x0F)) << shift;
+                out[x + 1] = ((in[1] << 4) | (in[2] >> 4)) << shift;
+            }
+            if (x < w)
+                out[x] = ((in[0] << 4) | (in[2] & 0x0F)) << shift;
+        }
+    }
+}
+
+bool INDILibCamera::processRawStream(const std::vector<libcamera::Span<uint8_t>> &mem, const StreamInfo &info,
+                                     uint8_t **memptr, size_t *memsize, int *n_axis, int *w, int *h, int *bitsperpixel, char *bayer_pattern)
+{
+    int bits = 0;
+    bool packed = false;
+    if (mem.empty() || !parseRawFormat(info.pixel_format, bayer_pattern, &bits, &packed))
     {
-        if (naxis == 1)
-            Streamer->setPixelFormat(INDI_MONO);
+        LOGF_ERROR("Unsupported raw stream format %s", info.pixel_format.toString().c_str());
+        return false;
+    }
 
-        PrimaryCCD.setNAxis(naxis);
+    *n_axis       = 2;
+    *w            = info.width;
+    *h            = info.height;
+    *bitsperpixel = 16;
+
+    *memsize = info.width * info.height * sizeof(uint16_t);
+    *memptr  = static_cast<uint8_t *>(IDSharedBlobRealloc(*memptr, *memsize));
+    if (*memptr == nullptr)
+        *memptr = static_cast<uint8_t *>(IDSharedBlobAlloc(*memsize));
+    if (*memptr == nullptr)
+    {
+        LOGF_ERROR("%s: Failed to allocate %d bytes of memory!", __PRETTY_FUNCTION__, *memsize);
+        return false;
     }
-    if (PrimaryCCD.getFrameBufferSize() != static_cast<int>(cameraBufferSize))
-        PrimaryCCD.setFrameBufferSize(cameraBufferSize, false);
 
-    // We are done with writing to CCD buffer
-    ccdguard.unlock();
-    Streamer->newFrame(cameraBuffer, cameraBufferSize);
+    LOGF_DEBUG("raw stream: %s width %d height %d stride %d memsize %d bayer_pattern %s",
+               info.pixel_format.toString().c_str(), info.width, info.height, info.stride, *memsize, bayer_pattern);
+
+    // Keep the sensor's native ADU range, same as the DNG path did
+    unpackRaw(mem[0].data(), info, bits, packed, 0, reinterpret_cast<uint16_t *>(*memptr));
+    return true;
+}
+
+bool INDILibCamera::processRGBStream(const std::vector<libcamera::Span<uint8_t>> &mem, const StreamInfo &info,
+                                     uint8_t **memptr, size_t *memsize, int *naxis, int *w, int *h)
+{
+    if (mem.empty())
+        return false;
+
+    *naxis = 3;
+    *w     = info.width;
+    *h     = info.height;
+
+    size_t planeSize = info.width * info.height;
+    *memsize = planeSize * 3;
+    *memptr  = static_cast<uint8_t *>(IDSharedBlobRealloc(*memptr, *memsize));
+    if (*memptr == nullptr)
+        *memptr = static_cast<uint8_t *>(IDSharedBlobAlloc(*memsize));
+    if (*memptr == nullptr)
+    {
+        LOGF_ERROR("%s: Failed to allocate %d bytes of memory!", __PRETTY_FUNCTION__, *memsize);
+        return false;
+    }
+
+    // BGR888 is stored as interleaved R, G, B bytes, FITS wants one plane per channel
+    uint8_t *r = *memptr;
+    uint8_t *g = r + planeSize;
+    uint8_t *b = g + planeSize;
+    for (unsigned int y = 0; y < info.height; y++)
+    {
+        const uint8_t *in = mem[0].data() + y * info.stride;
+        for (unsigned int x = 0; x < info.width; x++, in += 3)
+        {
+            *r++ = in[0];
+            *g++ = in[1];
+            *b++ = in[2];
+        }
+    }
+
+    return true;
 }
 
 void INDILibCamera::shutdownExposure()
@@ -177,7 +405,14 @@ void INDILibCamera::workerExposure(const std::atomic_bool &isAboutToQuit, float
     options->shutter = duration * 1e6;
     options->framerate = 1/duration;
 
+    bool raw = CaptureFormatSP.findOnSwitchIndex() == CAPTURE_DNG;
+    // DNG/JPEG files are only written when the client wants the native format uploaded,
+    // otherwise the stream buffers are converted straight into the CCD buffer.
+    bool native = EncodeFormatSP[FORMAT_NATIVE].getState() == ISS_ON;
+
     unsigned int still_flags = LibcameraApp::FLAG_STILL_RAW;
+    if (!raw && !native)
+        still_flags |= LibcameraApp::FLAG_STILL_BGR;
 
     try
     {
@@ -203,7 +438,6 @@ void INDILibCamera::workerExposure(const std::atomic_bool &isAboutToQuit, float
     else if (isAboutToQuit)
         return;
 
-    bool raw = IUFindOnSwitchIndex(&CaptureFormatSP) == CAPTURE_DNG;
     auto stream = raw ? m_CameraApp->RawStream() : m_CameraApp->StillStream();
     auto payload = std::get<CompletedRequestPtr>(msg.payload);
     StreamInfo info = m_CameraApp->GetStreamInfo(stream);
@@ -214,13 +448,13 @@ void INDILibCamera::workerExposure(const std::atomic_bool &isAboutToQuit, float
         char filename[MAXINDIFORMAT] {0};
         StillOptions stillOptions = StillOptions();
 
-        if (raw)
+        if (native && raw)
         {
             strncpy(filename, "/tmp/output.dng", MAXINDIFORMAT);
             // stillOptions isn't actually used there, but I don't want to gove it nullptr
             dng_save(mem, info, payload->metadata, filename, m_CameraApp->CameraId(), &stillOptions);
         }
-        else
+        else if (native)
         {
             strncpy(filename, "/tmp/output.jpg", MAXINDIFORMAT);
             stillOptions.quality = 100;
@@ -234,15 +468,16 @@ void INDILibCamera::workerExposure(const std::atomic_bool &isAboutToQuit, float
         size_t memsize = 0;
         int naxis = 2, w = 0, h = 0, bpp = 8;
 
-        if (EncodeFormatSP[FORMAT_FITS].getState() == ISS_ON)
+        if (!native)
         {
-            if (IUFindOnSwitchIndex(&CaptureFormatSP) == CAPTURE_DNG)
+            std::unique_lock<std::mutex> guard(ccdBufferLock);
+            if (raw)
             {
-                if (!processRAW(filename, &memptr, &memsize, &naxis, &w, &h, &bpp, bayer_pattern))
+                if (!processRawStream(mem, info, &memptr, &memsize, &naxis, &w, &h, &bpp, bayer_pattern))
                 {
-                    LOG_ERROR("Exposure failed to parse raw image.");
+                    LOG_ERROR("Exposure failed to unpack raw image.");
+                    guard.unlock();
                     shutdownExposure();
-                    unlink(filename);
                     return;
                 }
 
@@ -252,15 +487,15 @@ void INDILibCamera::workerExposure(const std::atomic_bool &isAboutToQuit, float
             }
             else
             {
-                if (!processJPEG(filename, &memptr, &memsize, &naxis, &w, &h))
+                if (!processRGBStream(mem, info, &memptr, &memsize, &naxis, &w, &h))
                 {
-                    LOG_ERROR("Exposure failed to parse jpeg.");
+                    LOG_ERROR("Exposure failed to convert RGB image.");
+                    guard.unlock();
                     shutdownExposure();
-                    unlink(filename);
                     return;
                 }
 
-                LOGF_DEBUG("read_jpeg: memsize (%d) naxis (%d) w (%d) h (%d) bpp (%d)", memsize, naxis, w, h, bpp);
+                LOGF_DEBUG("RGB still: memsize (%d) naxis (%d) w (%d) h (%d) bpp (%d)", memsize, naxis, w, h, bpp);
 
                 SetCCDCapability(GetCCDCapability() & ~CCD_HAS_BAYER);
             }
@@ -282,36 +517,15 @@ void INDILibCamera::workerExposure(const std::atomic_bool &isAboutToQuit, float
                 int subFrameSize     = subW * subH * bpp / 8 * ((naxis == 3) ? 3 : 1);
                 int oneFrameSize     = subW * subH * bpp / 8;
 
-                int lineW  = subW * bpp / 8;
-
                 LOGF_DEBUG("Subframing... subFrameSize: %d - oneFrameSize: %d - subX: %d - subY: %d - subW: %d - subH: %d",
                            subFrameSize, oneFrameSize,
                            subX, subY, subW, subH);
 
+                // Rows and planes are moved down in place, see ImageKernels::crop.
                 if (naxis == 2)
-                {
-                    // JM 2020-08-29: Using memmove since regions are overlaping
-                    // as proposed by Camiel Severijns on INDI forums.
-                    for (int i = subY; i < subY + subH; i++)
-                        memmove(memptr + (i - subY) * lineW, memptr + (i * w + subX) * bpp / 8, lineW);
-                }
+                    ImageKernels::crop(memptr, memptr, w * bpp / 8, subX, subY, subW, subH, bpp / 8);
                 else
-                {
-                    uint8_t * subR = memptr;
-                    uint8_t * subG = memptr + oneFrameSize;
-                    uint8_t * subB = memptr + oneFrameSize * 2;
-
-                    uint8_t * startR = memptr;
-                    uint8_t * startG = memptr + (w * h * bpp / 8);
-                    uint8_t * startB = memptr + (w * h * bpp / 8 * 2);
-
-                    for (int i = subY; i < subY + subH; i++)
-                    {
-                        memcpy(subR + (i - subY) * lineW, startR + (i * w + subX) * bpp / 8, lineW);
-                        memcpy(subG + (i - subY) * lineW, startG + (i * w + subX) * bpp / 8, lineW);
-                        memcpy(subB + (i - subY) * lineW, startB + (i * w + subX) * bpp / 8, lineW);
-                    }
-                }
+                    ImageKernels::cropPlanes(memptr, w, h, 3, subX, subY, subW, subH, bpp / 8);
 
                 PrimaryCCD.setFrameBuffer(memptr);
                 PrimaryCCD.setFrameBufferSize(memsize, false);
@@ -526,6 +740,17 @@ bool INDILibCamera::initProperties()
     AdjustmentNP[AdjustAwbBlue].fill("AwbBlue", "AWB Blue", "%.2f", 0.00, 2.00, .1, 0.00);
     AdjustmentNP.fill(getDeviceName(), "Adjustments", "Adjustments", IMAGE_CONTROLS_TAB, IP_RW, 60, IPS_IDLE);
 
+    // Uncompressed streaming source, used unless JPG capture format is selected
+    StreamSourceSP[STREAM_LUMA].fill("STREAM_LUMA", "YUV420 Luma", ISS_ON);
+    StreamSourceSP[STREAM_BAYER].fill("STREAM_BAYER", "Raw Bayer", ISS_OFF);
+    StreamSourceSP.fill(getDeviceName(), "STREAM_SOURCE", "Stream Source", IMAGE_SETTINGS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    int sourceIndex = -1;
+    if (IUGetConfigOnSwitchIndex(getDeviceName(), "STREAM_SOURCE", &sourceIndex) == 0 && sourceIndex >= 0)
+    {
+        StreamSourceSP.reset();
+        StreamSourceSP[sourceIndex].setState(ISS_ON);
+    }
+
     GainNP[0].fill("GAIN", "Gain", "%.2f", 0.00, 100.00, 1.00, 0.00);
     GainNP.fill(getDeviceName(), "CCD_GAIN", "Gain", IMAGE_CONTROLS_TAB, IP_RW, 60, IPS_IDLE);
 
@@ -563,6 +788,7 @@ void INDILibCamera::ISGetProperties(const char *dev)
     defineProperty(AdjustAwbModeSP);
     defineProperty(AdjustMeteringModeSP);
     defineProperty(AdjustDenoiseModeSP);
+    defineProperty(StreamSourceSP);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -797,6 +1023,22 @@ bool INDILibCamera::ISNewSwitch(const char *dev, const char *name, ISState * sta
             saveConfig(CameraSP);
             return true;
         }
+        if (StreamSourceSP.isNameMatch(name))
+        {
+            if (Streamer->isBusy())
+            {
+                LOG_WARN("Cannot change stream source while streaming.");
+                StreamSourceSP.setState(IPS_ALERT);
+                StreamSourceSP.apply();
+                return true;
+            }
+
+            StreamSourceSP.update(states, names, n);
+            StreamSourceSP.setState(IPS_OK);
+            StreamSourceSP.apply();
+            saveConfig(StreamSourceSP);
+            return true;
+        }
         auto options = static_cast<VideoOptions *>(m_CameraApp->GetOptions());
         for(int i = 0; i < n; i++)
         {
@@ -971,6 +1213,7 @@ bool INDILibCamera::saveConfigItems(FILE * fp)
     IUSaveConfigSwitch(fp, &AdjustAwbModeSP);
     IUSaveConfigSwitch(fp, &AdjustMeteringModeSP);
     IUSaveConfigSwitch(fp, &AdjustDenoiseModeSP);
+    IUSaveConfigSwitch(fp, &StreamSourceSP);
 
     return true;
 }
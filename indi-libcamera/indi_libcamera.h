@@ -79,6 +79,7 @@ class INDILibCamera : public INDI::CCD
     protected:
         INDI::SingleThreadPool m_Worker;
         void workerStreamVideo(const std::atomic_bool &isAboutToQuit, double framerate);
+        void workerStreamRaw(const std::atomic_bool &isAboutToQuit, double framerate);
         void workerExposure(const std::atomic_bool &isAboutToQuit, float duration);
         void outputReady(void *mem, size_t size, int64_t timestamp_us, bool keyframe);
         bool SetCaptureFormat(uint8_t index) override;
@@ -96,6 +97,12 @@ class INDILibCamera : public INDI::CCD
             CAPTURE_JPG
         };
 
+        enum
+        {
+            STREAM_LUMA,
+            STREAM_BAYER
+        };
+
         bool processRAW(const char *filename, uint8_t **memptr, size_t *memsize, int *n_axis, int *w, int *h, int *bitsperpixel,
                         char *bayer_pattern);
 
@@ -104,6 +111,18 @@ class INDILibCamera : public INDI::CCD
         int processJPEGMemory(unsigned char *inBuffer, unsigned long inSize, uint8_t **memptr, size_t *memsize, int *naxis, int *w,
                           int *h);
 
+        /** Parse a libcamera raw pixel format (e.g. SRGGB10_CSI2P) into bayer pattern, bit depth and CSI-2 packing */
+        static bool parseRawFormat(const libcamera::PixelFormat &format, char *bayer_pattern, int *bitsperpixel, bool *packed);
+
+        /** Unpack a raw plane honoring the stream stride into 16 bit pixels, each shifted left by shift bits */
+        static void unpackRaw(const uint8_t *src, const StreamInfo &info, int bitsperpixel, bool packed, int shift, uint16_t *dst);
+
+        /** Convert mmapped stream buffers straight into the CCD buffer, no intermediate DNG/JPEG file */
+        bool processRawStream(const std::vector<libcamera::Span<uint8_t>> &mem, const StreamInfo &info, uint8_t **memptr,
+                              size_t *memsize, int *n_axis, int *w, int *h, int *bitsperpixel, char *bayer_pattern);
+        bool processRGBStream(const std::vector<libcamera::Span<uint8_t>> &mem, const StreamInfo &info, uint8_t **memptr,
+                              size_t *memsize, int *naxis, int *w, int *h);
+
         void shutdownVideo();
         void shutdownExposure();
 
@@ -118,6 +137,7 @@ class INDILibCamera : public INDI::CCD
         };
 
         INDI::PropertySwitch CameraSP {0};
+        INDI::PropertySwitch StreamSourceSP {2};
         INDI::PropertySwitch AdjustExposureModeSP {0}, AdjustAwbModeSP {0}, AdjustMeteringModeSP {0}, AdjustDenoiseModeSP {0} ;
         INDI::PropertyNumber AdjustmentNP {AdjustAwbBlue+1};
         INDI::PropertyNumber GainNP {1};
@@ -125,5 +145,7 @@ class INDILibCamera : public INDI::CCD
         std::unique_ptr<LibcameraEncoder> m_CameraApp;
 
         int m_LiveVideoWidth {-1}, m_LiveVideoHeight {-1};
+        // Uncompressed streaming frame, reused across frames
+        std::vector<uint8_t> m_StreamBuffer;
 
 };
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include "maxdomeiidriver.h"
+#include "replaybench.h"
+
+using SerialReplay::Bench;
+using SerialReplay::Device;
+using SerialReplay::Transcript;
+
+TEST(MaxDomeIIReplay, Status)
+{
+    Device device(Transcript::load(REPLAY_DIR "/status.txt"));
+    ASSERT_TRUE(device.start());
+
+    int fd = device.connect();
+    ASSERT_GE(fd, 0);
+
+    MaxDomeIIDriver driver;
+    driver.SetPortFD(fd);
+
+    ShStatus shutter;
+    AzStatus azimuth;
+    unsigned position = 0, home = 0;
+    ASSERT_EQ(driver.Status(&shutter, &azimuth, &position, &home), 0);
+    EXPECT_EQ(shutter, SS_CLOSED);
+    EXPECT_EQ(azimuth, AS_IDLE);
+    EXPECT_EQ(position, 291u);
+    EXPECT_EQ(home, 0u);
+    EXPECT_EQ(device.mismatches(), 0u);
+
+    close(fd);
+}
+
+TEST(MaxDomeIIReplay, StatusBenchmark)
+{
+    Device device(Transcript::load(REPLAY_DIR "/status.txt"));
+    device.setLoop(true);
+    // Bound only by the wire speed of the real controller
+    device.setTimeScale(0);
+    device.setBaudRate(19200);
+    ASSERT_TRUE(device.start());
+
+    int fd = device.connect();
+    ASSERT_GE(fd, 0);
+
+    MaxDomeIIDriver driver;
+    driver.SetPortFD(fd);
+
+    Bench bench(device);
+    auto result = bench.run("maxdomeii.status", 200, [&driver]()
+    {
+        ShStatus shutter;
+        AzStatus azimuth;
+        unsigned position, home;
+        return driver.Status(&shutter, &azimuth, &position, &home) == 0;
+    });
+
+    EXPECT_EQ(result.failures, 0u);
+    EXPECT_EQ(result.mismatches, 0u);
+
+    close(fd);
+}
+
+TEST(MaxDomeIIReplay, AckBenchmark)
+{
+    Device device(Transcript::load(REPLAY_DIR "/ack.txt"));
+    device.setLoop(true);
+    device.setTimeScale(0);
+    device.setBaudRate(19200);
+    ASSERT_TRUE(device.start());
+
+    int fd = device.connect();
+    ASSERT_GE(fd, 0);
+
+    MaxDomeIIDriver driver;
+    driver.SetPortFD(fd);
+
+    Bench bench(device);
+    auto result = bench.run("maxdomeii.ack", 200, [&driver]()
+    {
+        return driver.Ack() == 0;
+    });
+
+    EXPECT_EQ(result.failures, 0u);
+    EXPECT_EQ(result.mismatches, 0u);
+
+    close(fd);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -43,6 +43,7 @@
 #include <vector>
 #include <queue>
 #include <array>
+#include <algorithm>
 
 #include "indidevapi.h"
 #include "indilogger.h"
@@ -85,6 +86,10 @@ bool MGenAutoguider::ISNewSwitch(const char *dev, const char *name, ISState *sta
                 {
                     ui.is_enabled = key_switch->aux == nullptr ? false : true;
                     ui.remote.property.s = IPS_OK;
+
+                    /* Publish the next frame even if it did not change while disabled */
+                    std::unique_lock<std::mutex> guard(ccdBufferLock);
+                    ui.last_frame.clear();
                 }
                 else ui.remote.property.s = IPS_ALERT;
                 IDSetSwitch(&ui.remote.property, NULL);
@@ -96,9 +101,9 @@ bool MGenAutoguider::ISNewSwitch(const char *dev, const char *name, ISState *sta
                 if (key_switch)
                 {
                     MGIO_INSERT_BUTTON::Button button = *(reinterpret_cast<MGIO_INSERT_BUTTON::Button *>(key_switch->aux));
-                    MGIO_INSERT_BUTTON(button).ask(*device);
+                    queueRequest(IOR_BUTTON, 0, button);
                     key_switch->s              = ISS_OFF;
-                    ui.buttons.properties[0].s = IPS_OK;
+                    ui.buttons.properties[0].s = IPS_BUSY;
                 }
                 else ui.buttons.properties[0].s = IPS_ALERT;
                 IDSetSwitch(&ui.buttons.properties[0], NULL);
@@ -110,9 +115,9 @@ bool MGenAutoguider::ISNewSwitch(const char *dev, const char *name, ISState *sta
                 if (key_switch)
                 {
                     MGIO_INSERT_BUTTON::Button button = *(reinterpret_cast<MGIO_INSERT_BUTTON::Button *>(key_switch->aux));
-                    MGIO_INSERT_BUTTON(button).ask(*device);
+                    queueRequest(IOR_BUTTON, 1, button);
                     key_switch->s              = ISS_OFF;
-                    ui.buttons.properties[1].s = IPS_OK;
+                    ui.buttons.properties[1].s = IPS_BUSY;
                 }
                 else ui.buttons.properties[1].s = IPS_ALERT;
                 IDSetSwitch(&ui.buttons.properties[1], NULL);
@@ -124,9 +129,9 @@ bool MGenAutoguider::ISNewSwitch(const char *dev, const char *name, ISState *sta
                 if (key_switch)
                 {
                     MGIO_INSERT_BUTTON::Button button = *(reinterpret_cast<MGIO_INSERT_BUTTON::Button *>(key_switch->aux));
-                    MGIO_INSERT_BUTTON(button).ask(*device);
+                    queueRequest(IOR_BUTTON, 2, button);
                     key_switch->s              = ISS_OFF;
-                    ui.buttons.properties[2].s = IPS_OK;
+                    ui.buttons.properties[2].s = IPS_BUSY;
                 }
                 else ui.buttons.properties[2].s = IPS_ALERT;
                 IDSetSwitch(&ui.buttons.properties[2], NULL);
@@ -138,9 +143,9 @@ bool MGenAutoguider::ISNewSwitch(const char *dev, const char *name, ISState *sta
                 if (key_switch)
                 {
                     MGIO_INSERT_BUTTON::Button button = *(reinterpret_cast<MGIO_INSERT_BUTTON::Button *>(key_switch->aux));
-                    MGIO_INSERT_BUTTON(button).ask(*device);
+                    queueRequest(IOR_BUTTON, 3, button);
                     key_switch->s              = ISS_OFF;
-                    ui.buttons.properties[3].s = IPS_OK;
+                    ui.buttons.properties[3].s = IPS_BUSY;
                 }
                 else ui.buttons.properties[3].s = IPS_ALERT;
                 IDSetSwitch(&ui.buttons.properties[3], NULL);
@@ -414,6 +419,7 @@ bool MGenAutoguider::Connect()
                         if (getHeartbeat())
                         {
                             _S("considering device connected", "");
+                            startIOThread();
                             /* FIXME: currently no way to tell which timer hit, so set one for the UI only */
                             TimerHit();
                             return device->isConnected();
@@ -442,6 +448,9 @@ bool MGenAutoguider::Connect()
 ***************************************************************************************/
 bool MGenAutoguider::Disconnect()
 {
+    /* The I/O thread may have stopped on its own after losing the device */
+    stopIOThread();
+
     if (device->isConnected())
     {
         _D("initiating disconnection.", "");
@@ -474,108 +483,239 @@ IOMode MGenAutoguider::getOpMode() const
  **************************************************************************************/
 void MGenAutoguider::TimerHit()
 {
-    if (device->isConnected())
+    /* The I/O thread cannot update properties on its own, do it for it */
+    if (io.lost)
+    {
+        io.lost = false;
+        stopIOThread();
+        setConnected(false, IPS_ALERT);
+        updateProperties();
+        return;
+    }
+
+    if (!device->isConnected())
+        return;
+
+    struct timespec tm = { .tv_sec = 0, .tv_nsec = 0 };
+    if (clock_gettime(CLOCK_MONOTONIC, &tm))
+        return;
+
+    /* If we didn't get the firmware version, ask */
+    if (0 == version.timestamp.tv_sec)
+    {
+        queueRequest(IOR_VERSION);
+        version.timestamp = tm;
+    }
+
+    /* Heartbeat */
+    if (heartbeat.timestamp.tv_sec + 5 < tm.tv_sec)
+    {
+        queueRequest(IOR_HEARTBEAT);
+        heartbeat.timestamp = tm;
+    }
+
+    /* Update ADC values */
+    if (0 == voltage.timestamp.tv_sec || voltage.timestamp.tv_sec + 20 < tm.tv_sec)
+    {
+        queueRequest(IOR_VOLTAGES);
+        voltage.timestamp = tm;
+    }
+
+    /* Update UI frame - I'm trading efficiency for code clarity, sorry for the computation with doubles */
+    if (ui.is_enabled && (0 == ui.timestamp.tv_sec || 0 < ui.framerate.number.value))
+    {
+        double const ui_period = 1.0f / ui.framerate.number.value;
+        double const ui_next =
+            (double)ui.timestamp.tv_sec + (double)ui.timestamp.tv_nsec / 1000000000.0f + ui_period;
+        double const now = tm.tv_sec + tm.tv_nsec / 1000000000.0f;
+
+        if (ui_next < now)
+        {
+            queueRequest(IOR_UI_FRAME);
+            ui.timestamp = tm;
+        }
+    }
+
+    /* Rearm the timer, use a minimal timer period of 1s, and shorter if frame rate is higher than 1fps */
+    ui.timer = SetTimer(1.0f < ui.framerate.number.value ? (long)(1000.0f / ui.framerate.number.value) : 1000);
+}
+
+/**************************************************************************************
+ * I/O thread
+ **************************************************************************************/
+void MGenAutoguider::queueRequest(IORequest type, int property, int button)
+{
+    std::lock_guard<std::mutex> guard(io.lock);
+
+    if (type != IOR_BUTTON)
+    {
+        if (io.pending & (1u << type))
+            return;
+        io.pending |= 1u << type;
+    }
+
+    io.queue.push({ type, io.sequence++, property, button });
+    io.wakeup.notify_one();
+}
+
+void MGenAutoguider::startIOThread()
+{
+    stopIOThread();
+
+    io.stop = false;
+    io.lost = false;
+    io.thread = std::thread(&MGenAutoguider::runIOThread, this);
+}
+
+void MGenAutoguider::stopIOThread()
+{
+    {
+        std::lock_guard<std::mutex> guard(io.lock);
+        io.stop = true;
+        io.queue = decltype(io.queue)();
+        io.pending = 0;
+    }
+    io.wakeup.notify_one();
+
+    if (io.thread.joinable() && io.thread.get_id() != std::this_thread::get_id())
+        io.thread.join();
+}
+
+void MGenAutoguider::runIOThread()
+{
+    _D("I/O thread started", "");
+
+    while (true)
+    {
+        io::request request;
+        {
+            std::unique_lock<std::mutex> guard(io.lock);
+            io.wakeup.wait(guard, [this]() { return io.stop || !io.queue.empty(); });
+            if (io.stop)
+                break;
+            request = io.queue.top();
+            io.queue.pop();
+            if (request.type != IOR_BUTTON)
+                io.pending &= ~(1u << request.type);
+        }
+
         try
         {
-            struct timespec tm = { .tv_sec = 0, .tv_nsec = 0 };
-            if (clock_gettime(CLOCK_MONOTONIC, &tm))
-                return;
+            serveRequest(request);
+        }
+        catch (IOError &e)
+        {
+            _S("device disconnected (%s)", e.what());
+            device->disable();
+        }
 
-            /* If we didn't get the firmware version, ask */
-            if (0 == version.timestamp.tv_sec)
-            {
-                MGCMD_GET_FW_VERSION cmd;
-                if (CR_SUCCESS == cmd.ask(*device))
-                {
-                    sprintf(version.firmware.text.text, "%04X", cmd.fw_version());
-                    _D("received version %4.4s", version.firmware.text.text);
-                    IDSetText(&version.firmware.property, NULL);
-                }
-                else
-                    _E("failed retrieving firmware version", "");
+        /* Either an I/O error or too many missed heartbeats, let the timer disconnect */
+        if (!device->isConnected())
+        {
+            io.lost = true;
+            break;
+        }
+    }
 
-                version.timestamp = tm;
-            }
+    _D("I/O thread stopped", "");
+}
+
+void MGenAutoguider::serveRequest(io::request const &request)
+{
+    switch (request.type)
+    {
+        case IOR_BUTTON:
+        {
+            ISwitchVectorProperty &property = ui.buttons.properties[request.property];
+            property.s = CR_SUCCESS == MGIO_INSERT_BUTTON((MGIO_INSERT_BUTTON::Button) request.button).ask(*device) ?
+                         IPS_OK : IPS_ALERT;
+            IDSetSwitch(&property, NULL);
+
+            /* Show the effect of the button without waiting for the next refresh */
+            if (ui.is_enabled)
+                queueRequest(IOR_UI_FRAME);
+            break;
+        }
+
+        case IOR_HEARTBEAT:
+            getHeartbeat();
+            break;
 
-            /* Heartbeat */
-            if (heartbeat.timestamp.tv_sec + 5 < tm.tv_sec)
+        case IOR_VERSION:
+        {
+            MGCMD_GET_FW_VERSION cmd;
+            if (CR_SUCCESS == cmd.ask(*device))
             {
-                getHeartbeat();
-                heartbeat.timestamp = tm;
+                sprintf(version.firmware.text.text, "%04X", cmd.fw_version());
+                _D("received version %4.4s", version.firmware.text.text);
+                IDSetText(&version.firmware.property, NULL);
             }
+            else
+                _E("failed retrieving firmware version", "");
+            break;
+        }
 
-            /* Update ADC values */
-            if (0 == voltage.timestamp.tv_sec || voltage.timestamp.tv_sec + 20 < tm.tv_sec)
-            {
-                MGCMD_READ_ADCS adcs;
+        case IOR_VOLTAGES:
+        {
+            MGCMD_READ_ADCS adcs;
 
-                if (CR_SUCCESS == adcs.ask(*device))
-                {
-                    voltage.levels.logic.value = adcs.logic_voltage();
-                    _D("received logic voltage %fV (spec is between 4.8V and 5.1V)", voltage.levels.logic.value);
-                    voltage.levels.input.value = adcs.input_voltage();
-                    _D("received input voltage %fV (spec is between 9V and 15V)", voltage.levels.input.value);
-                    voltage.levels.reference.value = adcs.refer_voltage();
-                    _D("received reference voltage %fV (spec is around 1.23V)", voltage.levels.reference.value);
-
-                    /* FIXME: my device has input at 15.07... */
-                    if (4.8f <= voltage.levels.logic.value && voltage.levels.logic.value <= 5.1f)
-                        if (9.0f <= voltage.levels.input.value && voltage.levels.input.value <= 15.0f)
-                            if (1.1 <= voltage.levels.reference.value && voltage.levels.reference.value <= 1.3)
-                                voltage.property.s = IPS_OK;
-                            else
-                                voltage.property.s = IPS_ALERT;
+            if (CR_SUCCESS == adcs.ask(*device))
+            {
+                voltage.levels.logic.value = adcs.logic_voltage();
+                _D("received logic voltage %fV (spec is between 4.8V and 5.1V)", voltage.levels.logic.value);
+                voltage.levels.input.value = adcs.input_voltage();
+                _D("received input voltage %fV (spec is between 9V and 15V)", voltage.levels.input.value);
+                voltage.levels.reference.value = adcs.refer_voltage();
+                _D("received reference voltage %fV (spec is around 1.23V)", voltage.levels.reference.value);
+
+                /* FIXME: my device has input at 15.07... */
+                if (4.8f <= voltage.levels.logic.value && voltage.levels.logic.value <= 5.1f)
+                    if (9.0f <= voltage.levels.input.value && voltage.levels.input.value <= 15.0f)
+                        if (1.1 <= voltage.levels.reference.value && voltage.levels.reference.value <= 1.3)
+                            voltage.property.s = IPS_OK;
                         else
                             voltage.property.s = IPS_ALERT;
                     else
                         voltage.property.s = IPS_ALERT;
-
-                    IDSetNumber(&voltage.property, NULL);
-                }
                 else
-                    _E("failed retrieving voltages", "");
+                    voltage.property.s = IPS_ALERT;
 
-                voltage.timestamp = tm;
+                IDSetNumber(&voltage.property, NULL);
             }
+            else
+                _E("failed retrieving voltages", "");
+            break;
+        }
 
-            /* Update UI frame - I'm trading efficiency for code clarity, sorry for the computation with doubles */
-            if (ui.is_enabled && (0 == ui.timestamp.tv_sec || 0 < ui.framerate.number.value))
-            {
-                double const ui_period = 1.0f / ui.framerate.number.value;
-                double const ui_next =
-                    (double)ui.timestamp.tv_sec + (double)ui.timestamp.tv_nsec / 1000000000.0f + ui_period;
-                double const now = tm.tv_sec + tm.tv_nsec / 1000000000.0f;
+        case IOR_UI_FRAME:
+            readUIFrame();
+            break;
+    }
+}
 
-                if (ui_next < now)
-                {
-                    MGIO_READ_DISPLAY_FRAME read_frame;
-
-                    if (CR_SUCCESS == read_frame.ask(*device))
-                    {
-                        std::unique_lock<std::mutex> guard(ccdBufferLock);
-                        MGIO_READ_DISPLAY_FRAME::ByteFrame frame;
-                        read_frame.get_frame(frame);
-                        memcpy(PrimaryCCD.getFrameBuffer(), frame.data(), frame.size());
-                        guard.unlock();
-                        ExposureComplete(&PrimaryCCD);
-                    }
-                    else
-                        _E("failed reading remote UI frame", "");
+void MGenAutoguider::readUIFrame()
+{
+    MGIO_READ_DISPLAY_FRAME read_frame;
 
-                    ui.timestamp = tm;
-                }
-            }
+    if (CR_SUCCESS != read_frame.ask(*device))
+    {
+        _E("failed reading remote UI frame", "");
+        return;
+    }
 
-            /* Rearm the timer, use a minimal timer period of 1s, and shorter if frame rate is higher than 1fps */
-            ui.timer = SetTimer(1.0f < ui.framerate.number.value ? (long)(1000.0f / ui.framerate.number.value) : 1000);
-        }
-        catch (IOError &e)
-        {
-            _S("device disconnected (%s)", e.what());
-            device->disable();
-            setConnected(false, IPS_ALERT);
-            updateProperties();
-        }
+    std::unique_lock<std::mutex> guard(ccdBufferLock);
+
+    /* The display rarely changes while idle, don't push the same image again to the client */
+    IOBuffer const &bitmap = read_frame.bitmap();
+    if (bitmap.size() == ui.last_frame.size() && std::equal(bitmap.begin(), bitmap.end(), ui.last_frame.begin()))
+        return;
+    ui.last_frame = bitmap;
+
+    MGIO_READ_DISPLAY_FRAME::ByteFrame frame;
+    read_frame.get_frame(frame);
+    memcpy(PrimaryCCD.getFrameBuffer(), frame.data(), frame.size());
+    guard.unlock();
+    ExposureComplete(&PrimaryCCD);
 }
 
 /**************************************************************************************
@@ -589,11 +729,7 @@ bool MGenAutoguider::getHeartbeat()
         heartbeat.no_ack_count++;
         _E("%d times no ack to heartbeat (NOP1 command)", heartbeat.no_ack_count);
         if (5 < heartbeat.no_ack_count)
-        {
             device->disable();
-            setConnected(false, IPS_ALERT);
-            updateProperties();
-        }
         return false;
     }
     else
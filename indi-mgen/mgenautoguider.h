@@ -113,6 +113,13 @@
 #include "indidevapi.h"
 #include "indiccd.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
 class MGenAutoguider : public INDI::CCD
 {
   public:
@@ -187,6 +194,7 @@ class MGenAutoguider : public INDI::CCD
             ISwitch switches[6];                 /*!< Button switches for ESC, SET, UP, LEFT, RIGHT and DOWN. */
             ISwitchVectorProperty properties[4]; /*!< Button INDI properties, {ESC,SET}, {UP}, {LEFT,RIGHT} and {DOWN}. */
         } buttons;
+        IOBuffer last_frame;       /*!< The last bitmap published, the frame is only sent again when it changes. */
         ui(): timer(0), is_enabled(false), timestamp({ .tv_sec = 0, .tv_nsec = 0 }) {}
     } ui;
 
@@ -198,6 +206,70 @@ class MGenAutoguider : public INDI::CCD
         heartbeat(): timestamp({ .tv_sec = 0, .tv_nsec = 0 }), no_ack_count(0) {}
     } heartbeat;
 
+  protected:
+    /** \internal Requests served by the I/O thread, in priority order.
+     * Buttons are served first as the end-user is waiting for them, the remote UI frame last as it is the
+     * longest exchange on the serial line.
+     */
+    enum IORequest
+    {
+        IOR_BUTTON,    /*!< Insert a button press. */
+        IOR_HEARTBEAT, /*!< Send a NOP1 as connection keepalive. */
+        IOR_VERSION,   /*!< Read the firmware version. */
+        IOR_VOLTAGES,  /*!< Read the ADCs. */
+        IOR_UI_FRAME,  /*!< Read the remote UI frame. */
+    };
+
+    struct io
+    {
+        struct request
+        {
+            IORequest type;         /*!< What to do, also the priority of the request. */
+            unsigned long sequence; /*!< Order of arrival, requests of the same type are served in order. */
+            int property;           /*!< Index of the button property, for IOR_BUTTON. */
+            int button;             /*!< MGIO_INSERT_BUTTON::Button to insert, for IOR_BUTTON. */
+        };
+        struct later
+        {
+            bool operator()(request const &a, request const &b) const
+            {
+                return a.type != b.type ? a.type > b.type : a.sequence > b.sequence;
+            }
+        };
+        std::thread thread;                /*!< The thread doing all device I/O once connected. */
+        std::mutex lock;                   /*!< Protects the queue and the flags below. */
+        std::condition_variable wakeup;    /*!< Signalled when a request is queued or the thread must stop. */
+        std::priority_queue<request, std::vector<request>, later> queue;
+        unsigned int pending;              /*!< Mask of the periodic requests already queued, they are not queued twice. */
+        unsigned long sequence;            /*!< Sequence number of the next request. */
+        bool stop;                         /*!< Whether the thread must exit. */
+        std::atomic_bool lost;             /*!< Set by the thread when the device stopped answering. */
+        io(): pending(0), sequence(0), stop(false), lost(false) {}
+    } io;
+
+  protected:
+    /** \internal Queueing a request for the I/O thread.
+     * Periodic requests already waiting in the queue are not queued again.
+     */
+    void queueRequest(IORequest type, int property = -1, int button = -1);
+
+    /** \internal Starting and stopping the I/O thread, stopping drops pending requests. */
+    /** @{ */
+    void startIOThread();
+    void stopIOThread();
+    /** @} */
+
+    /** \internal Body of the I/O thread, serving requests by priority until stopped or the device is lost. */
+    void runIOThread();
+
+    /** \internal Running one request on the device.
+     * \throw IOError when device communication is malfunctioning.
+     */
+    void serveRequest(io::request const &request);
+
+    /** \internal Reading the remote UI and publishing it if it changed since the last frame. */
+    void readUIFrame();
+
   protected:
     virtual bool initProperties();
     virtual bool updateProperties();
@@ -214,7 +286,7 @@ class MGenAutoguider : public INDI::CCD
     /** \internal Sending a NOP1 to the device to check it is still acknowledging.
      * This function will be called periodically to check if the device is still alive.
      * \return true if command was acknoldeged.
-     * \return false if command was not acknowledged, and disconnect the device after 5 failures.
+     * \return false if command was not acknowledged, and disable the device after 5 failures.
      */
     bool getHeartbeat();
 };
@@ -92,6 +92,9 @@ class MGIO_READ_DISPLAY_FRAME : MGC
         return frame;
     };
 
+    /** \brief Returning the display bitmap as read from the device, 8 lines per byte. */
+    IOBuffer const &bitmap() const { return bitmap_frame; }
+
   public:
     virtual IOResult ask(MGenDevice &root) //throw(IOError)
     {
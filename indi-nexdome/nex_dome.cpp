@@ -30,11 +30,15 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <memory>
 #include <regex>
 #include <termios.h>
 
 #include <indicom.h>
+#include <eventloop.h>
 #include <cmath>
 
 #include "config.h"
@@ -54,6 +58,14 @@ NexDome::NexDome()
                       DOME_CAN_SYNC);
 }
 
+//////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////
+NexDome::~NexDome()
+{
+    stopReader();
+}
+
 //////////////////////////////////////////////////////////////////////////////
 ///
 //////////////////////////////////////////////////////////////////////////////
@@ -163,6 +175,9 @@ bool NexDome::Handshake()
     std::string value;
     bool rotatorOK = false;
 
+    // All responses and events are framed by the reader thread from now on.
+    startReader();
+
     if (getParameter(ND::SEMANTIC_VERSION, ND::ROTATOR, value))
     {
         LOGF_INFO("Detected rotator firmware version %s", value.c_str());
@@ -170,6 +185,7 @@ bool NexDome::Handshake()
         {
             LOGF_ERROR("Rotator version %s is not supported. Please upgrade to version %s or higher.", value.c_str(),
                        ND::MINIMUM_VERSION.c_str());
+            stopReader();
             return false;
         }
 
@@ -185,6 +201,7 @@ bool NexDome::Handshake()
         {
             LOGF_ERROR("Shutter version %s is not supported. Please upgrade to version %s or higher.", value.c_str(),
                        ND::MINIMUM_VERSION.c_str());
+            stopReader();
             return false;
         }
 
@@ -196,9 +213,21 @@ bool NexDome::Handshake()
     else
         LOG_WARN("No shutter detected.");
 
+    if (!rotatorOK)
+        stopReader();
+
     return rotatorOK;
 }
 
+//////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////
+bool NexDome::Disconnect()
+{
+    stopReader();
+    return INDI::Dome::Disconnect();
+}
+
 //////////////////////////////////////////////////////////////////////////////
 ///
 //////////////////////////////////////////////////////////////////////////////
@@ -591,25 +620,30 @@ bool NexDome::Sync(double az)
 ///////////////////////////////////////////////////////////////////////////////
 void NexDome::TimerHit()
 {
-    std::string response;
+    // Normally handled as soon as the reader wakes the main loop, this only catches leftovers.
+    processEvents();
 
-    if (checkEvents(response))
-        processEvent(response);
-
-    if (getDomeState() == DOME_MOVING || getDomeState() == DOME_PARKING)
+    // The reader stopped on a serial error, nothing will answer until the dome is reconnected.
+    if (m_ReaderFailed.exchange(false))
     {
-        std::string value;
-        if (getParameter(ND::REPORT, ND::ROTATOR, value))
-            processEvent(value);
+        LOG_ERROR("Lost connection to the dome controller. Please reconnect.");
+        auto connectionSP = getSwitch("CONNECTION");
+        connectionSP.setState(IPS_ALERT);
+        connectionSP.apply();
     }
 
-    if (HasShutter() && getShutterState() == SHUTTER_MOVING)
+    if (!m_ReaderRunning)
     {
-        std::string value;
-        if (getParameter(ND::POSITION, ND::SHUTTER, value))
-            processEvent(value);
+        SetTimer(getCurrentPollingPeriod());
+        return;
     }
 
+    // Status requests are not waited on, their replies are handled as events once they arrive.
+    if (getDomeState() == DOME_MOVING || getDomeState() == DOME_PARKING)
+        pollParameter(ND::REPORT, ND::ROTATOR, ND::ROTATOR_REPORT);
+
+    if (HasShutter() && getShutterState() == SHUTTER_MOVING)
+        pollParameter(ND::POSITION, ND::SHUTTER, ND::SHUTTER_POSITION);
 
     SetTimer(getCurrentPollingPeriod());
 }
@@ -766,18 +800,35 @@ bool NexDome::getStartupValues()
 {
     std::string value;
 
+    // Send all queries at once and collect the replies as they come back.
+    auto rotatorPosition = requestParameter(ND::POSITION, ND::ROTATOR);
+    auto rotatorRamp = requestParameter(ND::ACCELERATION_RAMP, ND::ROTATOR);
+    auto rotatorVelocity = requestParameter(ND::VELOCITY, ND::ROTATOR);
+    auto rotatorZone = requestParameter(ND::DEAD_ZONE, ND::ROTATOR);
+    auto rotatorRange = requestParameter(ND::RANGE, ND::ROTATOR);
+    auto homePosition = requestParameter(ND::HOME_POSITION, ND::ROTATOR);
+    auto rotatorReport = requestParameter(ND::REPORT, ND::ROTATOR);
+    std::shared_ptr<Request> shutterPosition, shutterRamp, shutterVelocity, shutterReport;
+    if (HasShutter())
+    {
+        shutterPosition = requestParameter(ND::POSITION, ND::SHUTTER);
+        shutterRamp = requestParameter(ND::ACCELERATION_RAMP, ND::SHUTTER);
+        shutterVelocity = requestParameter(ND::VELOCITY, ND::SHUTTER);
+        shutterReport = requestParameter(ND::REPORT, ND::SHUTTER);
+    }
+
     try
     {
         // Rotator Position
-        if (getParameter(ND::POSITION, ND::ROTATOR, value))
+        if (waitResponse(rotatorPosition, value))
             RotatorSyncN[0].value = std::stoi(value);
 
         // Rotator Settings
-        if (getParameter(ND::ACCELERATION_RAMP, ND::ROTATOR, value))
+        if (waitResponse(rotatorRamp, value))
             RotatorSettingsN[S_RAMP].value = std::stoi(value);
-        if (getParameter(ND::VELOCITY, ND::ROTATOR, value))
+        if (waitResponse(rotatorVelocity, value))
             RotatorSettingsN[S_VELOCITY].value = std::stoi(value);
-        if (getParameter(ND::DEAD_ZONE, ND::ROTATOR, value))
+        if (waitResponse(rotatorZone, value))
         {
             RotatorSettingsN[S_ZONE].value = std::stoi(value);
             //            double minAutoSyncThreshold = RotatorSettingsN[S_ZONE].value / StepsPerDegree;
@@ -790,7 +841,7 @@ bool NexDome::getStartupValues()
             //                          DomeParamN[0].value, RotatorSettingsN[S_ZONE].value);
             //            }
         }
-        if (getParameter(ND::RANGE, ND::ROTATOR, value))
+        if (waitResponse(rotatorRange, value))
         {
             RotatorSettingsN[S_RANGE].value = std::stoi(value);
             RotatorSyncN[0].max = RotatorSettingsN[S_RANGE].value;
@@ -800,17 +851,17 @@ bool NexDome::getStartupValues()
         // Shutter Settings
         if (HasShutter())
         {
-            if (getParameter(ND::POSITION, ND::SHUTTER, value))
+            if (waitResponse(shutterPosition, value))
                 ShutterSyncN[0].value = std::stoi(value);
 
-            if (getParameter(ND::ACCELERATION_RAMP, ND::SHUTTER, value))
+            if (waitResponse(shutterRamp, value))
                 ShutterSettingsN[S_RAMP].value = std::stoi(value);
-            if (getParameter(ND::VELOCITY, ND::SHUTTER, value))
+            if (waitResponse(shutterVelocity, value))
                 ShutterSettingsN[S_VELOCITY].value = std::stoi(value);
         }
 
         // Home Setting
-        if (getParameter(ND::HOME_POSITION, ND::ROTATOR, value))
+        if (waitResponse(homePosition, value))
             HomePositionN[0].value = std::stoi(value) / StepsPerDegree;
 
     }
@@ -820,14 +871,14 @@ bool NexDome::getStartupValues()
     }
 
     // Rotator State
-    if (getParameter(ND::REPORT, ND::ROTATOR, value))
-        processEvent(value);
+    if (waitResponse(rotatorReport, value))
+        processRotatorReport(value);
 
     // Shutter State
     if (HasShutter())
     {
-        if (getParameter(ND::REPORT, ND::SHUTTER, value))
-            processEvent(value);
+        if (waitResponse(shutterReport, value))
+            processShutterReport(value);
     }
 
     if (InitPark())
@@ -871,14 +922,17 @@ bool NexDome::setParameter(ND::Commands command, ND::Targets target, int32_t val
         cmd << "W";
     cmd << ((target == ND::ROTATOR) ? "R" : "S");
 
+    // The firmware echoes the command back without the value.
+    std::string echo = cmd.str().substr(1) + "([^#]*)";
+
     if (value != -1e6)
     {
         cmd << ",";
         cmd << value;
     }
 
-    char res[ND::DRIVER_LEN] = {0};
-    return sendCommand(cmd.str().c_str(), res);
+    std::string response;
+    return waitResponse(sendRequest(cmd.str(), echo), response);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -916,226 +970,526 @@ bool NexDome::executeFactoryCommand(uint8_t command, ND::Targets target)
 //////////////////////////////////////////////////////////////////////////////
 bool NexDome::getParameter(ND::Commands command, ND::Targets target, std::string &value)
 {
-    char res[ND::DRIVER_LEN] = {0};
-    bool response_found = false;
+    return waitResponse(requestParameter(command, target), value);
+}
 
-    std::string verb = ND::CommandsMap.at(command) + "R";
+//////////////////////////////////////////////////////////////////////////////
+/// Send a get command without waiting, use waitResponse to collect the value.
+//////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<NexDome::Request> NexDome::requestParameter(ND::Commands command, ND::Targets target)
+{
+    return sendRequest(getCommand(command, target), getPattern(command, target));
+}
 
+//////////////////////////////////////////////////////////////////////////////
+/// Send a get command whose reply is delivered as an event.
+//////////////////////////////////////////////////////////////////////////////
+void NexDome::pollParameter(ND::Commands command, ND::Targets target, ND::Events event)
+{
+    sendRequest(getCommand(command, target), getPattern(command, target), true, event);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////
+std::string NexDome::getCommand(ND::Commands command, ND::Targets target)
+{
     std::ostringstream cmd;
     // Magic start character
     cmd << "@";
     // Command verb
-    cmd << verb;
+    cmd << ND::CommandsMap.at(command) << "R";
     // Target (Rotator or Shutter)
     cmd << ((target == ND::ROTATOR) ? "R" : "S");
+    return cmd.str();
+}
 
-    if (sendCommand(cmd.str().c_str(), res))
-    {
-        std::string response(res);
+//////////////////////////////////////////////////////////////////////////////
+/// Regex matching the reply to a get command, the value is the first group.
+//////////////////////////////////////////////////////////////////////////////
+std::string NexDome::getPattern(ND::Commands command, ND::Targets target)
+{
+    std::string verb = ND::CommandsMap.at(command) + "R";
 
-        // Since we can get many unrelated responses from the firmware
-        // i.e. events, we need to parse all responses, and see which
-        // one is related to our get command.
-        std::vector<std::string> all = split(response, "\r\n");
+    // Reports are answered with the same frame the firmware sends unsolicited.
+    if (command == ND::REPORT)
+        return ND::EventsMap.at((target == ND::ROTATOR) ? ND::ROTATOR_REPORT : ND::SHUTTER_REPORT) + "([^#]+)";
 
-        // Let's find our match using this regex
-        std::regex re;
+    // Firmware is exception since the response does not include the target
+    // for everything else, the echo back includes the target.
+    if (command == ND::SEMANTIC_VERSION)
+        return verb + "([^#]+)";
 
-        // Firmware is exception since the response does not include the target
-        // for everything else, the echo back includes the target.
-        if (command != ND::SEMANTIC_VERSION)
-            re = (verb + ((target == ND::ROTATOR) ? "R" : "S") + "([^#]+)");
-        else
-            re = (verb + "([^#]+)");
+    return verb + ((target == ND::ROTATOR) ? "R" : "S") + "([^#]+)";
+}
 
-        std::smatch match;
+//////////////////////////////////////////////////////////////////////////////
+/// Register a request and write its command. Several requests may be
+/// outstanding at once, the reader thread matches replies in order.
+//////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<NexDome::Request> NexDome::sendRequest(const std::string &cmd, const std::string &pattern, bool async,
+        ND::Events event)
+{
+    // Nothing would read the reply.
+    if (!m_ReaderRunning)
+        return nullptr;
+
+    auto now = std::chrono::steady_clock::now();
+
+    auto request = std::make_shared<Request>();
+    request->key = cmd;
+    request->pattern = std::regex(pattern);
+    request->deadline = now + std::chrono::seconds(ND::DRIVER_TIMEOUT);
+    request->async = async;
+    request->event = event;
+    request->done = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_RequestLock);
 
-        // Not iterate over all responses
-        for (auto &oneEvent : all)
+        // Forget requests the firmware never answered.
+        m_Requests.remove_if([now](const std::shared_ptr<Request> &one)
         {
-            std::string trimmedEvent = trim(oneEvent);
+            return one->deadline < now;
+        });
 
-            // If we find the match, tag it.
-            if (std::regex_search(trimmedEvent, match, re))
+        // Do not pile up status polls while the previous one is still in flight.
+        if (async)
+        {
+            for (auto &one : m_Requests)
             {
-                value = match.str(1);
-                response_found = true;
+                if (one->async && one->key == cmd)
+                    return one;
             }
-            // Otherwise process the event
-            else
-                processEvent(trimmedEvent);
         }
+
+        // Register before writing so a quick reply is not mistaken for an event.
+        m_Requests.push_back(request);
+    }
+
+    if (!sendCommand(cmd.c_str()))
+    {
+        std::lock_guard<std::mutex> lock(m_RequestLock);
+        m_Requests.remove(request);
+        return nullptr;
     }
 
-    return response_found;
+    return request;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 ///
 //////////////////////////////////////////////////////////////////////////////
-bool NexDome::checkEvents(std::string &response)
+bool NexDome::waitResponse(const std::shared_ptr<Request> &request, std::string &value)
 {
-    int nbytes_read = 0;
-    char res[ND::DRIVER_LEN] = {0};
-
-    int rc = tty_nread_section(PortFD, res, ND::DRIVER_LEN, ND::DRIVER_EVENT_CHAR, ND::DRIVER_EVENT_TIMEOUT, &nbytes_read);
+    if (!request)
+        return false;
 
-    if (rc != TTY_OK || nbytes_read < 3)
+    std::unique_lock<std::mutex> lock(m_RequestLock);
+    bool woken = m_RequestCV.wait_until(lock, request->deadline, [this, &request]()
+    {
+        return request->done || !m_ReaderRunning;
+    });
+    if (!request->done)
+    {
+        m_Requests.remove(request);
+        if (woken)
+            LOGF_ERROR("Serial connection lost waiting for response to <%s>.", request->key.c_str());
+        else
+            LOGF_ERROR("Timeout waiting for response to <%s>.", request->key.c_str());
         return false;
+    }
+
+    value = request->value;
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////
+void NexDome::startReader()
+{
+    stopReader();
 
-    std::string raw_response = res;
+    {
+        std::lock_guard<std::mutex> lock(m_EventLock);
+        m_Events.clear();
+    }
 
-    // Trim
-    response = trim(raw_response);
+    if (pipe(m_WakeFD) == 0)
+    {
+        fcntl(m_WakeFD[0], F_SETFL, O_NONBLOCK);
+        fcntl(m_WakeFD[1], F_SETFL, O_NONBLOCK);
+        m_WakeCallback = IEAddCallback(m_WakeFD[0], &NexDome::wakeHelper, this);
+    }
+    else
+        LOGF_WARN("Failed to create wake pipe: %s. Events are handled on the next poll.", strerror(errno));
 
-    return true;
+    m_WakePending = false;
+    m_ReaderFailed = false;
+    m_ReaderRunning = true;
+    m_ReaderThread = std::thread(&NexDome::readerLoop, this);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 ///
 //////////////////////////////////////////////////////////////////////////////
-bool NexDome::processEvent(const std::string &event)
+void NexDome::stopReader()
 {
-    for (const auto &kv : ND::EventsMap)
+    m_ReaderRunning = false;
+    if (m_ReaderThread.joinable())
+        m_ReaderThread.join();
+
+    if (m_WakeCallback >= 0)
     {
-        std::regex re(kv.second + "([^#]+)");
-        std::smatch match;
-        std::string value;
+        IERmCallback(m_WakeCallback);
+        m_WakeCallback = -1;
+    }
+    for (auto &fd : m_WakeFD)
+    {
+        if (fd >= 0)
+            close(fd);
+        fd = -1;
+    }
 
-        if (event == kv.second)
-            value = event;
-        else if (std::regex_search(event, match, re))
-            value = match.str(1);
-        else
+    std::lock_guard<std::mutex> lock(m_RequestLock);
+    m_Requests.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// Called from the main loop when the reader queued events.
+//////////////////////////////////////////////////////////////////////////////
+void NexDome::wakeHelper(int fd, void *context)
+{
+    char buffer[16];
+    while (read(fd, buffer, sizeof(buffer)) > 0)
+        ;
+
+    NexDome *dome = static_cast<NexDome *>(context);
+    dome->m_WakePending = false;
+    dome->processEvents();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// Frame everything the firmware sends. Responses end with # and events
+/// with \n, both are dispatched as soon as they are complete.
+//////////////////////////////////////////////////////////////////////////////
+void NexDome::readerLoop()
+{
+    char buffer[ND::DRIVER_LEN];
+    std::string frame;
+
+    tcflush(PortFD, TCIFLUSH);
+
+    while (m_ReaderRunning)
+    {
+        struct pollfd pfd = { PortFD, POLLIN, 0 };
+        int rc = poll(&pfd, 1, ND::DRIVER_READ_POLL_MS);
+        if (rc < 0 && errno != EINTR)
+        {
+            LOGF_ERROR("Serial read error: %s.", strerror(errno));
+            break;
+        }
+        if (rc <= 0)
             continue;
 
-        LOGF_DEBUG("Processing event <%s> with value <%s>", event.c_str(), value.c_str());
+        ssize_t nbytes_read = read(PortFD, buffer, sizeof(buffer));
+        if (nbytes_read < 0)
+        {
+            if (errno == EAGAIN || errno == EINTR)
+                continue;
+            LOGF_ERROR("Serial read error: %s.", strerror(errno));
+            break;
+        }
+        if (nbytes_read == 0)
+        {
+            LOG_ERROR("Serial read error: port closed.");
+            break;
+        }
 
-        switch (kv.first)
+        for (ssize_t i = 0; i < nbytes_read; i++)
         {
-            case ND::XBEE_STATE:
-                if (!m_ShutterConnected && value == "Online")
-                {
-                    m_ShutterConnected = true;
-                    LOG_INFO("Shutter is connected.");
-                }
-                else if (m_ShutterConnected && value != "Online")
-                {
-                    m_ShutterConnected = false;
-                    LOG_WARN("Lost connection to the shutter!");
-                }
-                return true;
+            if (buffer[i] == ND::DRIVER_STOP_CHAR || buffer[i] == ND::DRIVER_EVENT_CHAR)
+            {
+                trim(frame);
+                if (!frame.empty())
+                    dispatchFrame(frame);
+                frame.clear();
+            }
+            else if (frame.size() < ND::DRIVER_LEN)
+                frame.push_back(buffer[i]);
+        }
+    }
+
+    // Left on an error rather than by stopReader(): fail every pending request now
+    // instead of letting each wait out its timeout, and let TimerHit report it.
+    if (m_ReaderRunning.exchange(false))
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_RequestLock);
+            m_Requests.clear();
+        }
+        m_RequestCV.notify_all();
+        m_ReaderFailed = true;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// Called from the reader thread for every complete frame.
+//////////////////////////////////////////////////////////////////////////////
+void NexDome::dispatchFrame(const std::string &frame)
+{
+    LOGF_DEBUG("RES <%s>", frame.c_str());
+
+    Event event;
+    bool matched = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_RequestLock);
+        for (auto it = m_Requests.begin(); it != m_Requests.end(); ++it)
+        {
+            std::smatch match;
+            if (!std::regex_search(frame, match, (*it)->pattern))
+                continue;
+
+            std::shared_ptr<Request> request = *it;
+            m_Requests.erase(it);
+            request->value = match.str(1);
+            request->done = true;
+            m_RequestCV.notify_all();
+
+            if (!request->async)
+                return;
+
+            event.type = request->event;
+            event.value = request->value;
+            matched = true;
+            break;
+        }
+    }
+
+    if (!matched && !parseEvent(frame, event))
+    {
+        LOGF_DEBUG("Unhandled frame: %s", frame.c_str());
+        return;
+    }
 
-            case ND::ROTATOR_POSITION:
+    {
+        std::lock_guard<std::mutex> lock(m_EventLock);
+
+        // Properties are only touched from the main loop. The dome streams its position
+        // while moving, so only the latest one waiting there is kept.
+        bool coalesced = false;
+        if (event.type == ND::ROTATOR_POSITION)
+        {
+            for (auto &one : m_Events)
             {
-                try
+                if (one.type == ND::ROTATOR_POSITION)
                 {
-                    // 153 = full_steps_circumference / 360 = 55080 / 360
-                    double newAngle = range360(std::stoi(value) / StepsPerDegree);
-                    if (std::fabs(DomeAbsPosN[0].value - newAngle) > 0.001)
-                    {
-                        DomeAbsPosN[0].value = newAngle;
-                        IDSetNumber(&DomeAbsPosNP, nullptr);
-                    }
-                }
-                catch (...)
-                {
-                    return false;
+                    one.value = event.value;
+                    coalesced = true;
+                    break;
                 }
             }
+        }
+
+        if (!coalesced)
+            m_Events.push_back(event);
+    }
+
+    // One byte is enough until the main loop drained the pipe.
+    if (m_WakeFD[1] >= 0 && !m_WakePending.exchange(true))
+    {
+        const char wake = 1;
+        if (write(m_WakeFD[1], &wake, 1) != 1)
+            m_WakePending = false;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////
+bool NexDome::parseEvent(const std::string &frame, Event &event)
+{
+    // Compiled once, checked in the same order as EventsMap.
+    static const std::vector<std::pair<ND::Events, std::regex>> patterns = []()
+    {
+        std::vector<std::pair<ND::Events, std::regex>> all;
+        for (const auto &kv : ND::EventsMap)
+            all.emplace_back(kv.first, std::regex(kv.second + "([^#]+)"));
+        return all;
+    }();
+
+    for (const auto &one : patterns)
+    {
+        std::smatch match;
+        if (frame == ND::EventsMap.at(one.first))
+            event.value = frame;
+        else if (std::regex_search(frame, match, one.second))
+            event.value = match.str(1);
+        else
+            continue;
+
+        event.type = one.first;
+        return true;
+    }
+
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////
+void NexDome::processEvents()
+{
+    std::deque<Event> events;
+    {
+        std::lock_guard<std::mutex> lock(m_EventLock);
+        events.swap(m_Events);
+    }
+
+    for (const auto &event : events)
+        processEvent(event);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////
+bool NexDome::setAzimuth(const std::string &value)
+{
+    try
+    {
+        // 153 = full_steps_circumference / 360 = 55080 / 360
+        double newAngle = range360(std::stoi(value) / StepsPerDegree);
+        if (std::fabs(DomeAbsPosN[0].value - newAngle) > 0.001)
+        {
+            DomeAbsPosN[0].value = newAngle;
+            IDSetNumber(&DomeAbsPosNP, nullptr);
+        }
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////
+bool NexDome::processEvent(const Event &event)
+{
+    const std::string &value = event.value;
+
+    LOGF_DEBUG("Processing event <%s> with value <%s>", ND::EventsMap.at(event.type).c_str(), value.c_str());
+
+    switch (event.type)
+    {
+        case ND::XBEE_STATE:
+            if (!m_ShutterConnected && value == "Online")
+            {
+                m_ShutterConnected = true;
+                LOG_INFO("Shutter is connected.");
+            }
+            else if (m_ShutterConnected && value != "Online")
+            {
+                m_ShutterConnected = false;
+                LOG_WARN("Lost connection to the shutter!");
+            }
             return true;
 
-            case ND::SHUTTER_POSITION:
+        case ND::ROTATOR_POSITION:
+            return setAzimuth(value);
+
+        case ND::SHUTTER_POSITION:
+        {
+            try
             {
-                try
-                {
-                    int32_t position = std::stoi(value);
-                    if (std::abs(position - ShutterSyncN[0].value) > 0)
-                    {
-                        ShutterSyncN[0].value = position;
-                        IDSetNumber(&ShutterSyncNP, nullptr);
-                    }
-                }
-                catch (...)
+                int32_t position = std::stoi(value);
+                if (std::abs(position - ShutterSyncN[0].value) > 0)
                 {
-                    return false;
+                    ShutterSyncN[0].value = position;
+                    IDSetNumber(&ShutterSyncNP, nullptr);
                 }
             }
-            return true;
+            catch (...)
+            {
+                return false;
+            }
+        }
+        return true;
 
-            case ND::ROTATOR_REPORT:
-                return processRotatorReport(value);
+        case ND::ROTATOR_REPORT:
+            return processRotatorReport(value);
 
-            case ND::SHUTTER_REPORT:
-                return processShutterReport(value);
+        case ND::SHUTTER_REPORT:
+            return processShutterReport(value);
 
-            case ND::ROTATOR_LEFT:
-            case ND::ROTATOR_RIGHT:
-                if (getDomeState() != DOME_MOVING && getDomeState() != DOME_PARKING)
-                {
-                    setDomeState(DOME_MOVING);
-                    LOGF_INFO("Dome is rotating %s.", ((kv.first == ND::ROTATOR_LEFT) ? "counter-clock wise" : "clock-wise"));
-                }
-                return true;
+        case ND::ROTATOR_LEFT:
+        case ND::ROTATOR_RIGHT:
+            if (getDomeState() != DOME_MOVING && getDomeState() != DOME_PARKING)
+            {
+                setDomeState(DOME_MOVING);
+                LOGF_INFO("Dome is rotating %s.", ((event.type == ND::ROTATOR_LEFT) ? "counter-clock wise" : "clock-wise"));
+            }
+            return true;
 
-            case ND::ROTATOR_STOPPED:
-                if (getDomeState() == DOME_MOVING)
-                {
-                    LOG_INFO("Dome reached target position.");
-                    setDomeState(DOME_SYNCED);
-                }
-                else if (getDomeState() == DOME_PARKING)
-                {
-                    LOG_INFO("Dome is parked.");
-                    setDomeState(DOME_PARKED);
-                }
-                else
-                    setDomeState(DOME_IDLE);
-                return true;
+        case ND::ROTATOR_STOPPED:
+            if (getDomeState() == DOME_MOVING)
+            {
+                LOG_INFO("Dome reached target position.");
+                setDomeState(DOME_SYNCED);
+            }
+            else if (getDomeState() == DOME_PARKING)
+            {
+                LOG_INFO("Dome is parked.");
+                setDomeState(DOME_PARKED);
+            }
+            else
+                setDomeState(DOME_IDLE);
+            return true;
 
-            case ND::SHUTTER_OPENING:
-                if (getShutterState() != SHUTTER_MOVING)
-                {
-                    setShutterState(SHUTTER_MOVING);
-                    LOG_INFO("Shutter is opening...");
-                    break;
-                }
-                return true;
+        case ND::SHUTTER_OPENING:
+            if (getShutterState() != SHUTTER_MOVING)
+            {
+                setShutterState(SHUTTER_MOVING);
+                LOG_INFO("Shutter is opening...");
+            }
+            return true;
 
-            case ND::SHUTTER_CLOSING:
-                if (getShutterState() != SHUTTER_MOVING)
-                {
-                    setShutterState(SHUTTER_MOVING);
-                    LOG_INFO("Shutter is closing...");
-                    break;
-                }
-                return true;
+        case ND::SHUTTER_CLOSING:
+            if (getShutterState() != SHUTTER_MOVING)
+            {
+                setShutterState(SHUTTER_MOVING);
+                LOG_INFO("Shutter is closing...");
+            }
+            return true;
 
-            case ND::SHUTTER_BATTERY:
+        case ND::SHUTTER_BATTERY:
+        {
+            try
             {
-                try
+                uint32_t battery_adu = std::stoul(value);
+                double vref = battery_adu * ND::ADU_TO_VREF;
+                if (std::fabs(vref - ShutterBatteryLevelN[0].value) > 0.01)
                 {
-                    uint32_t battery_adu = std::stoul(value);
-                    double vref = battery_adu * ND::ADU_TO_VREF;
-                    if (std::fabs(vref - ShutterBatteryLevelN[0].value) > 0.01)
-                    {
-                        ShutterBatteryLevelN[0].value = vref;
-                        // TODO: Must check if batter is OK, warning, or in critical level
-                        ShutterBatteryLevelNP.s = IPS_OK;
-                        IDSetNumber(&ShutterBatteryLevelNP, nullptr);
-                    }
-                }
-                catch(...)
-                {
-                    return false;
+                    ShutterBatteryLevelN[0].value = vref;
+                    // TODO: Must check if batter is OK, warning, or in critical level
+                    ShutterBatteryLevelNP.s = IPS_OK;
+                    IDSetNumber(&ShutterBatteryLevelNP, nullptr);
                 }
             }
-            break;
-
-            default:
-                LOGF_DEBUG("Unhandled event: %s", value.c_str());
-                break;
+            catch(...)
+            {
+                return false;
+            }
         }
+        return true;
+
+        default:
+            LOGF_DEBUG("Unhandled event: %s", value.c_str());
+            break;
     }
 
     return false;
@@ -1298,30 +1652,17 @@ bool NexDome::processShutterReport(const std::string &report)
     return true;
 }
 
-
 //////////////////////////////////////////////////////////////////////////////
 ///
 //////////////////////////////////////////////////////////////////////////////
-bool NexDome::sendCommand(const char * cmd, char * res, int cmd_len, int res_len)
+bool NexDome::sendCommand(const char * cmd)
 {
-    int nbytes_written = 0, nbytes_read = 0, rc = -1;
-
-    tcflush(PortFD, TCIOFLUSH);
+    int nbytes_written = 0, rc = -1;
 
-    if (cmd_len > 0)
-    {
-        char hex_cmd[ND::DRIVER_LEN * 3] = {0};
-        hexDump(hex_cmd, cmd, cmd_len);
-        LOGF_DEBUG("CMD <%s>", hex_cmd);
-        rc = tty_write(PortFD, cmd, cmd_len, &nbytes_written);
-    }
-    else
-    {
-        LOGF_DEBUG("CMD <%s>", cmd);
-        char cmd_terminated[ND::DRIVER_LEN * 2] = {0};
-        snprintf(cmd_terminated, ND::DRIVER_LEN * 2, "%s\r\n", cmd);
-        rc = tty_write_string(PortFD, cmd_terminated, &nbytes_written);
-    }
+    LOGF_DEBUG("CMD <%s>", cmd);
+    char cmd_terminated[ND::DRIVER_LEN * 2] = {0};
+    snprintf(cmd_terminated, ND::DRIVER_LEN * 2, "%s\r\n", cmd);
+    rc = tty_write_string(PortFD, cmd_terminated, &nbytes_written);
 
     if (rc != TTY_OK)
     {
@@ -1331,64 +1672,9 @@ bool NexDome::sendCommand(const char * cmd, char * res, int cmd_len, int res_len
         return false;
     }
 
-    if (res == nullptr)
-        return true;
-
-    if (res_len > 0)
-        rc = tty_read(PortFD, res, res_len, ND::DRIVER_TIMEOUT, &nbytes_read);
-    else
-        rc = tty_nread_section(PortFD, res, ND::DRIVER_LEN, ND::DRIVER_STOP_CHAR, ND::DRIVER_TIMEOUT, &nbytes_read);
-
-    if (rc != TTY_OK)
-    {
-        char errstr[MAXRBUF] = {0};
-        tty_error_msg(rc, errstr, MAXRBUF);
-        LOGF_ERROR("Serial read error: %s.", errstr);
-        return false;
-    }
-
-    if (res_len > 0)
-    {
-        char hex_res[ND::DRIVER_LEN * 3] = {0};
-        hexDump(hex_res, res, res_len);
-        LOGF_DEBUG("RES <%s>", hex_res);
-    }
-    else
-    {
-        res[nbytes_read - 1] = 0;
-        LOGF_DEBUG("RES <%s>", res);
-    }
-
-    tcflush(PortFD, TCIOFLUSH);
-
     return true;
 }
 
-//////////////////////////////////////////////////////////////////////////////
-///
-//////////////////////////////////////////////////////////////////////////////
-void NexDome::hexDump(char * buf, const char * data, int size)
-{
-    for (int i = 0; i < size; i++)
-        sprintf(buf + 3 * i, "%02X ", static_cast<uint8_t>(data[i]));
-
-    if (size > 0)
-        buf[3 * size - 1] = '\0';
-}
-
-//////////////////////////////////////////////////////////////////////
-///
-//////////////////////////////////////////////////////////////////////
-std::vector<std::string> NexDome::split(const std::string &input, const std::string &regex)
-{
-    // passing -1 as the submatch index parameter performs splitting
-    std::regex re(regex);
-    std::sregex_token_iterator
-    first{input.begin(), input.end(), re, -1},
-          last;
-    return {first, last};
-}
-
 //////////////////////////////////////////////////////////////////////
 ///
 //////////////////////////////////////////////////////////////////////
@@ -29,8 +29,17 @@
 #include <indidome.h>
 
 #include <math.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <regex>
 #include <string>
+#include <thread>
 #include <sys/time.h>
 
 #include "nex_dome_constants.h"
@@ -39,6 +48,7 @@ class NexDome : public INDI::Dome
 {
     public:
         NexDome();
+        virtual ~NexDome() override;
 
         virtual bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n) override;
         virtual bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override;
@@ -50,6 +60,7 @@ class NexDome : public INDI::Dome
 
     protected:
         bool Handshake() override;
+        virtual bool Disconnect() override;
         void TimerHit() override;
 
         // Motion
@@ -129,6 +140,26 @@ class NexDome : public INDI::Dome
         INumber ShutterSyncN[1];
 
     private:
+        // Frame parsed by the reader thread, waiting to be handled in TimerHit
+        typedef struct
+        {
+            ND::Events type;
+            std::string value;
+        } Event;
+
+        // Command waiting for its echo from the firmware
+        typedef struct
+        {
+            std::string key;
+            std::regex pattern;
+            std::chrono::steady_clock::time_point deadline;
+            // Replies nobody waits for are queued as this event instead
+            bool async;
+            ND::Events event;
+            bool done;
+            std::string value;
+        } Request;
+
         ///////////////////////////////////////////////////////////////////////////////
         /// Startup
         ///////////////////////////////////////////////////////////////////////////////
@@ -146,22 +177,54 @@ class NexDome : public INDI::Dome
         ///////////////////////////////////////////////////////////////////////////////
         bool setParameter(ND::Commands command, ND::Targets target, int32_t value = -1e6);
         bool getParameter(ND::Commands command, ND::Targets target, std::string &value);
-        bool checkEvents(std::string &response);
-        bool processEvent(const std::string &event);
-        bool sendCommand(const char * cmd, char * res = nullptr, int cmd_len = -1, int res_len = -1);
-        void hexDump(char * buf, const char * data, int size);
+        std::shared_ptr<Request> requestParameter(ND::Commands command, ND::Targets target);
+        void pollParameter(ND::Commands command, ND::Targets target, ND::Events event);
+        std::shared_ptr<Request> sendRequest(const std::string &cmd, const std::string &pattern, bool async = false,
+                                             ND::Events event = ND::XBEE_STATE);
+        bool waitResponse(const std::shared_ptr<Request> &request, std::string &value);
+        std::string getCommand(ND::Commands command, ND::Targets target);
+        std::string getPattern(ND::Commands command, ND::Targets target);
+        bool parseEvent(const std::string &frame, Event &event);
+        void processEvents();
+        bool processEvent(const Event &event);
+        bool setAzimuth(const std::string &value);
+        bool sendCommand(const char * cmd);
+
+        ///////////////////////////////////////////////////////////////////////////////
+        /// Reader Thread
+        ///////////////////////////////////////////////////////////////////////////////
+        void startReader();
+        void stopReader();
+        void readerLoop();
+        void dispatchFrame(const std::string &frame);
+        static void wakeHelper(int fd, void *context);
 
         std::string &ltrim(std::string &str, const std::string &chars = "\t\n\v\f\r ");
         std::string &rtrim(std::string &str, const std::string &chars = "\t\n\v\f\r ");
         std::string &trim(std::string &str, const std::string &chars = "\t\n\v\f\r ");
-        std::vector<std::string> split(const std::string &input, const std::string &regex);
 
         ///////////////////////////////////////////////////////////////////////////////
         /// Private Members
         ///////////////////////////////////////////////////////////////////////////////
         bool m_ShutterConnected { false };
         int32_t m_TargetAZSteps {1000000};
-        double StepsPerDegree { 153.0 };
+        std::atomic<double> StepsPerDegree { 153.0 };
+
+        std::thread m_ReaderThread;
+        std::atomic_bool m_ReaderRunning { false };
+        // Set when the reader stopped on a serial error
+        std::atomic_bool m_ReaderFailed { false };
+
+        std::mutex m_EventLock;
+        std::deque<Event> m_Events;
+        // Written by the reader to have the main loop handle queued events right away
+        int m_WakeFD[2] { -1, -1 };
+        int m_WakeCallback { -1 };
+        std::atomic_bool m_WakePending { false };
+
+        std::mutex m_RequestLock;
+        std::condition_variable m_RequestCV;
+        std::list<std::shared_ptr<Request>> m_Requests;
 
 };
 
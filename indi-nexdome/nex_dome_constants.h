@@ -144,8 +144,8 @@ const char DRIVER_STOP_CHAR { '#' };
 const char DRIVER_EVENT_CHAR { '\n' };
 // Wait up to a maximum of 3 seconds for serial input
 const uint8_t DRIVER_TIMEOUT {3};
-// Wait up to a maximum of 1 for event input
-const uint8_t DRIVER_EVENT_TIMEOUT {1};
+// Reader thread wakes up every 100ms to check if it should stop
+const int DRIVER_READ_POLL_MS {100};
 // Maximum buffer for sending/receving.
 const uint16_t DRIVER_LEN {512};
 // ADU to VRef
@@ -23,6 +23,7 @@
 #include <inttypes.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "orion_ssg3.h"
 #ifdef __APPLE__
 #include <libkern/OSByteOrder.h>
@@ -36,6 +37,10 @@
 #define ORION_SSG3_PID 0x0502
 #define ORION_SSG3_INTERFACE_NUM 0
 #define ORION_SSG3_BULK_EP 0x82
+/* Each queued readout transfer asks for up to this many bytes */
+#define ORION_SSG3_XFER_SIZE (128 * 1024)
+/* Give up on a download when no data arrived for this long */
+#define ORION_SSG3_XFER_IDLE_MS 5000
 
 /* These are the defaults that Orion Camera Studio sets */
 #define ORION_SSG3_DEFAULT_OFFSET 127
@@ -205,6 +210,11 @@ int orion_ssg3_open(struct orion_ssg3 *ssg3, struct orion_ssg3_info *info)
     ssg3->x_count = ICX419_EFFECTIVE_X_COUNT;
     ssg3->y1 = ICX419_EFFECTIVE_Y_START;
     ssg3->y_count = ICX419_EFFECTIVE_Y_COUNT;
+    memset(ssg3->xfers, 0, sizeof(ssg3->xfers));
+    ssg3->xfer_buf = NULL;
+    ssg3->xfer_size = 0;
+    ssg3->row_map = NULL;
+    ssg3->row_map_count = 0;
 
 	rc = libusb_open(info->dev, &ssg3->devh);
 	if (rc) {
@@ -231,6 +241,18 @@ int orion_ssg3_open(struct orion_ssg3 *ssg3, struct orion_ssg3_info *info)
  */
 int orion_ssg3_close(struct orion_ssg3 *ssg3)
 {
+    int i;
+
+    for (i = 0; i < ORION_SSG3_XFER_COUNT; i++) {
+        libusb_free_transfer(ssg3->xfers[i]);
+        ssg3->xfers[i] = NULL;
+    }
+    free(ssg3->xfer_buf);
+    ssg3->xfer_buf = NULL;
+    free(ssg3->row_map);
+    ssg3->row_map = NULL;
+    ssg3->row_map_count = 0;
+
     if (ssg3->devh) {
         libusb_release_interface(ssg3->devh, ORION_SSG3_INTERFACE_NUM);
 	    libusb_close(ssg3->devh);
@@ -455,73 +477,272 @@ int orion_ssg3_subframe(struct orion_ssg3 *ssg3, uint16_t x1, uint16_t x_count,
     return rc;
 }
 
+/* State of one image download, shared with the transfer callbacks */
+struct orion_ssg3_download {
+    struct orion_ssg3 *ssg3;
+    uint8_t *frame;
+    int line_sz;
+    int needed;      /* Bytes in the frame */
+    int received;    /* Bytes received and converted so far */
+    int outstanding; /* Bytes asked for by transfers still in flight */
+    int in_flight;
+    int packet_sz;
+    int rc;
+};
+
+/**
+ * Build the map from download rows to frame rows.
+ * The SSG3 has an interlaced CCD, so the lines don't come out in order. The
+ * even field is sent first, followed by the odd field.
+ */
+static int orion_ssg3_row_map(struct orion_ssg3 *ssg3)
+{
+    int even_rows;
+    int r;
+
+    if (ssg3->row_map && ssg3->row_map_count == ssg3->y_count) {
+        return 0;
+    }
+
+    free(ssg3->row_map);
+    ssg3->row_map_count = 0;
+    ssg3->row_map = malloc(ssg3->y_count * sizeof(*ssg3->row_map));
+    if (!ssg3->row_map) {
+        return -ENOMEM;
+    }
+
+    even_rows = (ssg3->y_count + 1) / 2;
+    for (r = 0; r < ssg3->y_count; r++) {
+        if (r < even_rows) {
+            ssg3->row_map[r] = 2 * r;
+        } else {
+            ssg3->row_map[r] = 2 * (r - even_rows) + 1;
+        }
+    }
+    ssg3->row_map_count = ssg3->y_count;
+
+    return 0;
+}
+
+/**
+ * Copy big-endian pixels to host order.
+ * Kept as a plain loop over bytes so the compiler can vectorize it.
+ */
+static void orion_ssg3_copy_be16(uint16_t *dst, const uint8_t *src, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        dst[i] = (uint16_t) ((src[2 * i] << 8) | src[2 * i + 1]);
+    }
+}
+
+/**
+ * Move freshly received bytes to their place in the frame.
+ * Transfers complete in order, so the data continues where the last one
+ * stopped, regardless of how short a transfer came back.
+ */
+static void orion_ssg3_deinterlace(struct orion_ssg3_download *dl, const uint8_t *src, int len)
+{
+    int pos = dl->received;
+    int end = pos + len;
+
+    if (end > dl->needed) {
+        end = dl->needed;
+    }
+
+    while (pos < end) {
+        int row = pos / dl->line_sz;
+        int col = pos - row * dl->line_sz;
+        int n = dl->line_sz - col;
+
+        if (n > end - pos) {
+            n = end - pos;
+        }
+        orion_ssg3_copy_be16((uint16_t *) (dl->frame + dl->ssg3->row_map[row] * dl->line_sz + col), src, n / 2);
+        src += n;
+        pos += n;
+    }
+}
+
+static int orion_ssg3_submit(struct orion_ssg3_download *dl, struct libusb_transfer *xfer)
+{
+    int len;
+    int rc;
+
+    len = dl->needed - dl->received - dl->outstanding;
+    if (len <= 0) {
+        return 0;
+    }
+    if (len > dl->ssg3->xfer_size) {
+        len = dl->ssg3->xfer_size;
+    }
+    /* Whole packets only, or a full packet at the end would overflow */
+    len = (len + dl->packet_sz - 1) / dl->packet_sz * dl->packet_sz;
+    if (len > dl->ssg3->xfer_size) {
+        len = dl->ssg3->xfer_size;
+    }
+
+    xfer->length = len;
+    rc = libusb_submit_transfer(xfer);
+    if (rc) {
+        return -libusb_to_errno(rc);
+    }
+    dl->outstanding += len;
+    dl->in_flight++;
+
+    return 0;
+}
+
+static void LIBUSB_CALL orion_ssg3_xfer_cb(struct libusb_transfer *xfer)
+{
+    struct orion_ssg3_download *dl = xfer->user_data;
+    int rc;
+
+    dl->in_flight--;
+    dl->outstanding -= xfer->length;
+
+    if (xfer->status == LIBUSB_TRANSFER_CANCELLED) {
+        return;
+    }
+    if (xfer->status != LIBUSB_TRANSFER_COMPLETED) {
+        if (!dl->rc) {
+            dl->rc = -EIO;
+        }
+        return;
+    }
+
+    orion_ssg3_deinterlace(dl, xfer->buffer, xfer->actual_length);
+    dl->received += xfer->actual_length;
+
+    if (!dl->rc && dl->received < dl->needed) {
+        rc = orion_ssg3_submit(dl, xfer);
+        if (rc) {
+            dl->rc = rc;
+        }
+    }
+}
+
+/**
+ * Allocate the readout transfers, once per connection
+ */
+static int orion_ssg3_alloc_xfers(struct orion_ssg3 *ssg3)
+{
+    int i;
+
+    if (ssg3->xfer_buf) {
+        return 0;
+    }
+
+    ssg3->xfer_buf = malloc(ORION_SSG3_XFER_COUNT * ORION_SSG3_XFER_SIZE);
+    if (!ssg3->xfer_buf) {
+        return -ENOMEM;
+    }
+    ssg3->xfer_size = ORION_SSG3_XFER_SIZE;
+
+    for (i = 0; i < ORION_SSG3_XFER_COUNT; i++) {
+        ssg3->xfers[i] = libusb_alloc_transfer(0);
+        if (!ssg3->xfers[i]) {
+            /* Leave nothing half allocated, the next download starts over */
+            for (i = 0; i < ORION_SSG3_XFER_COUNT; i++) {
+                libusb_free_transfer(ssg3->xfers[i]);
+                ssg3->xfers[i] = NULL;
+            }
+            free(ssg3->xfer_buf);
+            ssg3->xfer_buf = NULL;
+            ssg3->xfer_size = 0;
+            return -ENOMEM;
+        }
+    }
+
+    return 0;
+}
+
 /**
  * Download an image
+ * The whole frame is read with a few large bulk transfers kept queued on the
+ * endpoint. Each transfer is deinterlaced and converted to host byte order
+ * straight into the frame buffer as it completes.
  * @param ssg3: The ssg3 structure used to communicate with the camera
  * @param buf: The buffer to store the frame in
  * @param len: The number of bytes available in buf
+ * @return: 0 on success, -errno on failure
  */
 int orion_ssg3_image_download(struct orion_ssg3 *ssg3, uint8_t *buf, int len)
 {
-    int line_sz;
-    int got;
-    uint16_t *tmp;
-    int x, y;
-    uint16_t *frame;
-    int rc = 0;
+    struct orion_ssg3_download dl;
+    struct timeval idle_deadline;
+    struct timeval now;
+    struct timeval tv;
+    int last_received;
+    int rc;
     int i;
-    int fail_cnt;
-    int needed;
-    int total;
 
-    frame = (uint16_t *) buf;
-    
-    needed = ssg3->x_count * ssg3->y_count * 2; /* 2 bytes/pixel */
-    if (needed < len) {
+    memset(&dl, 0, sizeof(dl));
+    dl.ssg3 = ssg3;
+    dl.frame = buf;
+    dl.line_sz = ssg3->x_count * 2; /* 2 bytes/pixel */
+    dl.needed = dl.line_sz * ssg3->y_count;
+    if (dl.needed > len) {
         return -ENOSPC;
     }
 
-    tmp = malloc(needed);
-    if (!tmp) {
-        return -ENOMEM;
+    rc = orion_ssg3_alloc_xfers(ssg3);
+    if (rc) {
+        return rc;
+    }
+    rc = orion_ssg3_row_map(ssg3);
+    if (rc) {
+        return rc;
     }
 
-    line_sz = ssg3->x_count * 2; /* 2 bytes/pixel */
+    dl.packet_sz = libusb_get_max_packet_size(libusb_get_device(ssg3->devh), ORION_SSG3_BULK_EP);
+    if (dl.packet_sz <= 0) {
+        dl.packet_sz = 512;
+    }
 
-    for (i = 0, fail_cnt = 0, total = 0; i < ssg3->y_count && fail_cnt < 10;) {
-        rc = libusb_bulk_transfer(ssg3->devh, ORION_SSG3_BULK_EP, &(((unsigned char *) tmp)[i * line_sz]), line_sz, &got, 5000);
-        if (!rc) {
-            total += got;
-            i++;
-            fail_cnt = 0;
-        } else {
-            fail_cnt++;
+    for (i = 0; i < ORION_SSG3_XFER_COUNT; i++) {
+        libusb_fill_bulk_transfer(ssg3->xfers[i], ssg3->devh, ORION_SSG3_BULK_EP,
+                ssg3->xfer_buf + i * ssg3->xfer_size, ssg3->xfer_size, orion_ssg3_xfer_cb, &dl, 0);
+        rc = orion_ssg3_submit(&dl, ssg3->xfers[i]);
+        if (rc) {
+            dl.rc = rc;
+            break;
         }
     }
 
-    fprintf(stderr, "needed = %d, total = %d, len = %d\n", needed, total, len);
-
-    /* The SSG3 has an interlace CCD, so the horizontal lines don't come out in order. Instead,
-       they are split into an even and odd field. We get the even lines first and then the odd
-       lines. This loop below de-interlaces the image to put the lines in the correct order
-       in the frame buffer. */
-    for (y = 0; y < ssg3->y_count; y++) {
-        int download_y; /* The y line in the download buffer */
-        if (y % 2 == 0) {
-            download_y = (y / 2);
-        } else {
-            download_y = (ssg3->y_count / 2) + (y / 2);
+    timerclear(&idle_deadline);
+    last_received = -1;
+    while (!dl.rc && dl.received < dl.needed && dl.in_flight > 0) {
+        gettimeofday(&now, NULL);
+        if (dl.received != last_received) {
+            last_received = dl.received;
+            idle_deadline = now;
+            idle_deadline.tv_sec += ORION_SSG3_XFER_IDLE_MS / 1000;
+        } else if (!timercmp(&now, &idle_deadline, <)) {
+            dl.rc = -ETIMEDOUT;
+            break;
         }
 
-        for (x = 0; x < ssg3->x_count; x++) {
-            /* The raw pixel data is sent big-endian */
-            frame[x + y * ssg3->x_count] = be16toh(tmp[x + download_y * ssg3->x_count]);
+        tv.tv_sec = 0;
+        tv.tv_usec = 100000;
+        rc = libusb_handle_events_timeout_completed(NULL, &tv, NULL);
+        if (rc && rc != LIBUSB_ERROR_INTERRUPTED) {
+            dl.rc = -libusb_to_errno(rc);
         }
     }
 
-    free(tmp);
+    /* Transfers for data that will not come have to be reaped before dl goes away */
+    for (i = 0; i < ORION_SSG3_XFER_COUNT; i++) {
+        libusb_cancel_transfer(ssg3->xfers[i]);
+    }
+    while (dl.in_flight > 0) {
+        tv.tv_sec = 0;
+        tv.tv_usec = 100000;
+        libusb_handle_events_timeout_completed(NULL, &tv, NULL);
+    }
 
-    return rc;
+    return dl.rc;
 }
 
 int orion_ssg3_get_gain(struct orion_ssg3 *ssg3, uint8_t *gain)
@@ -40,6 +40,9 @@ struct orion_ssg3_info {
     const struct orion_ssg3_model *model;
 };
 
+/* Number of bulk transfers kept queued during image readout */
+#define ORION_SSG3_XFER_COUNT 4
+
 struct orion_ssg3 {
     libusb_device_handle *devh;
     const struct orion_ssg3_model *model;
@@ -52,6 +55,13 @@ struct orion_ssg3 {
     uint16_t y1;
     uint16_t y_count;
     struct timeval exp_done_time;
+    /* Readout transfers and buffers, allocated on first download and kept until close */
+    struct libusb_transfer *xfers[ORION_SSG3_XFER_COUNT];
+    uint8_t *xfer_buf;
+    int xfer_size;
+    /* Frame row for each row of the download, the CCD sends the even field first */
+    uint16_t *row_map;
+    int row_map_count;
 };
 
 enum {
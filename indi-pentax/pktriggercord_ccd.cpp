@@ -25,7 +25,9 @@
 #define MINISO 100
 #define MAXISO 102400
 
-#define TMPFILEBASE (char *)"/tmp/indipentax.tmp"
+// The image buffer only opens once the camera has finished processing the shot
+#define BUFFER_OPEN_POLL_US 100000
+#define BUFFER_OPEN_TIMEOUT_US 60000000
 
 PkTriggerCordCCD::PkTriggerCordCCD(const char * name)
 {
@@ -305,14 +307,9 @@ bool PkTriggerCordCCD::shutterPress(pslr_rational_t shutter_speed)
     LOG_DEBUG("Shutter pressed.");
     pslr_get_status(device, &status);
 
-    user_file_format_t ufft = *pslr_get_user_file_format_t(uff);
-    char * output_file = TMPFILEBASE;
-    int fd = open_file(output_file, 1, ufft);
-
-    int cnt = 0;
-    while ( save_buffer(device, 0, fd, &status, uff, quality ) )
+    if (!downloadImage())
     {
-        LOGF_DEBUG("Saved buffer (%d)", cnt++);
+        LOG_ERROR("Failed to download image from camera.");
     }
 
     pslr_delete_buffer(device, 0);
@@ -328,6 +325,55 @@ bool PkTriggerCordCCD::shutterPress(pslr_rational_t shutter_speed)
     return 1;
 }
 
+bool PkTriggerCordCCD::downloadImage()
+{
+    pslr_buffer_type imagetype;
+    if (uff == USER_FILE_FORMAT_PEF)
+    {
+        imagetype = PSLR_BUF_PEF;
+    }
+    else if (uff == USER_FILE_FORMAT_DNG)
+    {
+        imagetype = PSLR_BUF_DNG;
+    }
+    else
+    {
+        imagetype = pslr_get_jpeg_buffer_type(device, quality);
+    }
+
+    downloadSize = 0;
+    int waited = 0;
+    while (pslr_buffer_open(device, 0, imagetype, status.jpeg_resolution) != PSLR_OK)
+    {
+        if (waited >= BUFFER_OPEN_TIMEOUT_US)
+        {
+            LOGF_ERROR("Image buffer did not become ready within %d seconds.", BUFFER_OPEN_TIMEOUT_US / 1000000);
+            return false;
+        }
+        usleep(BUFFER_OPEN_POLL_US);
+        waited += BUFFER_OPEN_POLL_US;
+    }
+    LOGF_DEBUG("Image buffer ready after %d ms.", waited / 1000);
+
+    uint32_t length = pslr_buffer_get_size(device);
+    // Only ever grow the buffer, K-1/K-3 raw files are tens of MB
+    if (downloadBuffer.size() < length)
+    {
+        downloadBuffer.resize(length);
+    }
+
+    int ret = pslr_buffer_download(device, downloadBuffer.data(), length);
+    pslr_buffer_close(device);
+    if (ret != PSLR_OK)
+    {
+        return false;
+    }
+
+    downloadSize = length;
+    LOGF_DEBUG("Downloaded %u bytes to memory.", length);
+    return true;
+}
+
 
 bool PkTriggerCordCCD::StartExposure(float duration)
 {
@@ -553,8 +599,14 @@ void PkTriggerCordCCD::TimerHit()
             InDownload = false;
             InExposure = false;
 
-            grabImage();
-            ExposureComplete(&PrimaryCCD);
+            if (grabImage())
+            {
+                ExposureComplete(&PrimaryCCD);
+            }
+            else
+            {
+                PrimaryCCD.setExposureFailed();
+            }
         }
         else if (InDownload && isDebug())
         {
@@ -569,22 +621,11 @@ void PkTriggerCordCCD::TimerHit()
 
 bool PkTriggerCordCCD::grabImage()
 {
-    //set correct tmpfile location
-    char tmpfile[256];
-    if (uff == USER_FILE_FORMAT_JPEG)
-    {
-        snprintf(tmpfile, 256, "%s-0001.jpg", TMPFILEBASE);
-    }
-    else if (uff == USER_FILE_FORMAT_DNG)
-    {
-        snprintf(tmpfile, 256, "%s-0001.dng", TMPFILEBASE);
-    }
-    else
+    if (downloadSize == 0)
     {
-        snprintf(tmpfile, 256, "%s-0001.pef", TMPFILEBASE);
+        LOG_ERROR("No image was downloaded from the camera.");
+        return false;
     }
-    LOGF_DEBUG("Reading temp file from: %s", tmpfile);
-
 
     // fits handling code
     // if (transferFormatS[0].s == ISS_ON)    
@@ -597,15 +638,14 @@ bool PkTriggerCordCCD::grabImage()
 
         if (uff == USER_FILE_FORMAT_JPEG)
         {
-            if (read_jpeg(tmpfile, &memptr, &memsize, &naxis, &w, &h))
+            if (read_jpeg_mem(downloadBuffer.data(), downloadSize, &memptr, &memsize, &naxis, &w, &h))
             {
                 LOG_ERROR("Exposure failed to parse jpeg.");
-                unlink(tmpfile);
                 return false;
             }
 
 
-            LOGF_DEBUG("read_jpeg: memsize (%d) naxis (%d) w (%d) h (%d) bpp (%d)", memsize, naxis,
+            LOGF_DEBUG("read_jpeg_mem: memsize (%d) naxis (%d) w (%d) h (%d) bpp (%d)", memsize, naxis,
                        w, h, bpp);
 
             SetCCDCapability(GetCCDCapability() & ~CCD_HAS_BAYER);
@@ -614,14 +654,13 @@ bool PkTriggerCordCCD::grabImage()
         {
             char bayer_pattern[8] = {};
 
-            if (read_libraw(tmpfile, &memptr, &memsize, &naxis, &w, &h, &bpp, bayer_pattern))
+            if (read_libraw_mem(downloadBuffer.data(), downloadSize, &memptr, &memsize, &naxis, &w, &h, &bpp, bayer_pattern))
             {
                 LOG_ERROR("Exposure failed to parse raw image.");
-                unlink(tmpfile);
                 return false;
             }
 
-            LOGF_DEBUG("read_libraw: memsize (%d) naxis (%d) w (%d) h (%d) bpp (%d) bayer pattern (%s)",
+            LOGF_DEBUG("read_libraw_mem: memsize (%d) naxis (%d) w (%d) h (%d) bpp (%d) bayer pattern (%s)",
                        memsize, naxis, w, h, bpp, bayer_pattern);
 
             IUSaveText(&BayerT[2], bayer_pattern);
@@ -652,18 +691,19 @@ bool PkTriggerCordCCD::grabImage()
             prefix = std::regex_replace(prefix, std::regex("XXX"), string(ts));
             char newname[255];
             snprintf(newname, 255, "%s.%s", prefix.c_str(), getFormatFileExtension(uff));
-            if (std::rename(tmpfile, newname))
+            FILE* f = fopen(newname, "w");
+            if (f == nullptr || fwrite(downloadBuffer.data(), 1, downloadSize, f) != downloadSize)
             {
-                LOGF_ERROR("File system error prevented saving original image to %s.  Saved to %s instead.", newname, tmpfile);
+                LOGF_ERROR("File system error prevented saving original image to %s.", newname);
             }
             else
             {
                 LOGF_INFO("Saved original image to %s.", newname);
             }
-        }
-        else
-        {
-            std::remove(tmpfile);
+            if (f != nullptr)
+            {
+                fclose(f);
+            }
         }
 
     }
@@ -672,25 +712,9 @@ bool PkTriggerCordCCD::grabImage()
     {
         PrimaryCCD.setImageExtension(getFormatFileExtension(uff));
 
-        FILE* f = fopen(tmpfile, "r");
-        fseek(f, 0, SEEK_END);
-        size_t size = ftell(f);
-        rewind(f);
-
-        PrimaryCCD.setFrameBufferSize(size);
-        char * memptr = (char *)PrimaryCCD.getFrameBuffer();
-        size_t readSize = fread(memptr, sizeof(char), size, f);
-        if (readSize != size)
-        {
-            LOGF_ERROR("Error, %u bytes of data read instead of %u.", readSize, size);
-        }
-        PrimaryCCD.setFrameBuffer((unsigned char *)memptr);
-        fclose(f);
-        LOG_DEBUG("Copied to frame buffer.  Leaving temp file for debug purposes.");
-        if (!isDebug())
-        {
-            std::remove(tmpfile);
-        }
+        PrimaryCCD.setFrameBufferSize(downloadSize);
+        memcpy(PrimaryCCD.getFrameBuffer(), downloadBuffer.data(), downloadSize);
+        LOG_DEBUG("Copied to frame buffer.");
     }
 
     return true;
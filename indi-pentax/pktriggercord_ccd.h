@@ -26,6 +26,7 @@
 #include <unistd.h>
 #include <regex>
 #include <future>
+#include <vector>
 
 #include "config.h"
 #include "eventloop.h"
@@ -73,6 +74,10 @@ protected:
     bool InDownload, need_bulb_new_cleanup;
     bool bufferIsBayered;
 
+    // Image downloaded from the camera buffer, decoded without a temporary file
+    std::vector<uint8_t> downloadBuffer;
+    uint32_t downloadSize = 0;
+
     int timerID;
 
     INDI::CCDChip::CCD_FRAME imageFrameType;
@@ -116,6 +121,7 @@ protected:
 
     void updateCaptureSettingSwitch(ISwitchVectorProperty *sw, ISState *states, char *names[], int n);
     bool grabImage();
+    bool downloadImage();
     string getUploadFilePrefix();
     const char * getFormatFileExtension(user_file_format format);
     void refreshBatteryStatus();
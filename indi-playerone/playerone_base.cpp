@@ -30,6 +30,7 @@
 #include <indielapsedtimer.h>
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <vector>
 #include <map>
@@ -68,12 +69,25 @@ void POABase::workerStreamVideo(const std::atomic_bool &isAbortToQuit)
         LOGF_ERROR("Failed to start video capture (%s).", Helpers::toString(ret));
     }
 
-    uint8_t *targetFrame = PrimaryCCD.getFrameBuffer();
     uint32_t totalBytes  = PrimaryCCD.getFrameBufferSize();
     int waitMS           = static_cast<int>((ExposureRequest * 1000.0) + 500);
 
+    // Slots keep their memory between streams
+    mStreamFrames.open(totalBytes);
+    mStreamClock.start();
+
+    mStreamDelivery = std::thread(&POABase::workerDeliverVideo, this);
+
     while (!isAbortToQuit)
     {
+        // Recycles the oldest undelivered frame when the streamer is behind
+        StreamFrame *frame = mStreamFrames.acquire();
+        if (frame == nullptr)
+        {
+            usleep(100);
+            continue;
+        }
+
         POABool pIsReady = POA_FALSE;
 		while (pIsReady == POA_FALSE)
 	    {
@@ -84,9 +98,13 @@ void POABase::workerStreamVideo(const std::atomic_bool &isAbortToQuit)
 			POAImageReady(mCameraInfo.cameraID, &pIsReady);
 		}
 		
-        ret = POAGetImageData(mCameraInfo.cameraID, targetFrame, totalBytes, waitMS);
+        ret = POAGetImageData(mCameraInfo.cameraID, frame->data.data(), totalBytes, waitMS);
+        // The SDK does not report when a frame was captured, so take the host time as soon as it is read
+        auto captured = std::chrono::steady_clock::now();
         if (ret != POA_OK)
         {
+            mStreamFrames.release(frame);
+
             if (ret != POA_ERROR_TIMEOUT)
             {
                 Streamer->setStream(false);
@@ -98,15 +116,39 @@ void POABase::workerStreamVideo(const std::atomic_bool &isAbortToQuit)
             continue;
         }
 
-        if (mCurrentVideoFormat == POA_RGB24)
-            for (uint32_t i = 0; i < totalBytes; i += 3)
-                std::swap(targetFrame[i], targetFrame[i + 2]);
-
-        Streamer->newFrame(targetFrame, totalBytes);
+        frame->timestamp = mStreamClock.timestamp(captured);
+        mStreamFrames.publish(frame);
     }
 
     // stop video capture
     POAStopExposure(mCameraInfo.cameraID);
+
+    mStreamFrames.close();
+    mStreamDelivery.join();
+
+    if (mStreamFrames.dropped() > 0)
+        LOGF_DEBUG("Dropped %u video frame(s) while the streamer was busy.", mStreamFrames.dropped());
+}
+
+void POABase::workerDeliverVideo()
+{
+    const bool swapRB = (mCurrentVideoFormat == POA_RGB24);
+    const size_t frameSize = mStreamFrames.frameSize();
+
+    while (StreamFrame *frame = mStreamFrames.wait())
+    {
+        // BGR to RGB, off the capture thread
+        if (swapRB)
+        {
+            uint8_t *data = frame->data.data();
+            for (size_t i = 0; i + 2 < frameSize; i += 3)
+                std::swap(data[i], data[i + 2]);
+        }
+
+        Streamer->newFrame(frame->data.data(), frameSize, frame->timestamp);
+
+        mStreamFrames.release(frame);
+    }
 }
 
 void POABase::workerBlinkExposure(const std::atomic_bool &isAbortToQuit, int blinks, float duration)
@@ -1156,6 +1198,10 @@ bool POABase::UpdateCCDFrame(int x, int y, int w, int h)
     LOGF_DEBUG("Setting frame buffer size to %d bytes.", nbuf);
     PrimaryCCD.setFrameBufferSize(nbuf);
 
+    // RGB24 frames are downloaded interleaved and split into planes by grabImage
+    if (getImageType() == POA_RGB24)
+        mRGBBuffer.resize(nbuf);
+
     // Always set BINNED size
     Streamer->setSize(subW, subH);
 
@@ -1190,12 +1236,10 @@ int POABase::grabImage(float duration)
 
     if (type == POA_RGB24)
     {
-        buffer = static_cast<uint8_t *>(malloc(nTotalBytes));
-        if (buffer == nullptr)
-        {
-            LOGF_ERROR("%s: %d malloc failed (RGB 24).", getDeviceName());
-            return -1;
-        }
+        // Normally sized by UpdateCCDFrame already
+        if (mRGBBuffer.size() < nTotalBytes)
+            mRGBBuffer.resize(nTotalBytes);
+        buffer = mRGBBuffer.data();
     }
 
     ret = POAGetImageData(mCameraInfo.cameraID, buffer, nTotalBytes, -1);
@@ -1205,8 +1249,6 @@ int POABase::grabImage(float duration)
             "Failed to get data after exposure (%dx%d #%d channels) (%s).",
             subW, subH, nChannels, Helpers::toString(ret)
         );
-        if (type == POA_RGB24)
-            free(buffer);
         return -1;
     }
 
@@ -1225,8 +1267,6 @@ int POABase::grabImage(float duration)
             *dstG++ = *src++;
             *dstR++ = *src++;
         }
-
-        free(buffer);
     }
     guard.unlock();
 
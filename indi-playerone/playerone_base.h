@@ -26,7 +26,9 @@
 #include "indipropertynumber.h"
 #include "indipropertytext.h"
 #include "indisinglethreadpool.h"
+#include "framering.h"
 
+#include <thread>
 #include <vector>
 
 #include <indiccd.h>
@@ -84,12 +86,34 @@ class POABase : public INDI::CCD
     protected:
         INDI::SingleThreadPool mWorker;
         void workerStreamVideo(const std::atomic_bool &isAbortToQuit);
+        void workerDeliverVideo();
         void workerBlinkExposure(const std::atomic_bool &isAbortToQuit, int blinks, float duration);
         void workerExposure(const std::atomic_bool &isAbortToQuit, float duration);
 
         /** Get image from CCD and send it to client */
         int grabImage(float duration);
 
+        /** Interleaved RGB24 download buffer, kept across exposures and sized to the ROI */
+        std::vector<uint8_t> mRGBBuffer;
+
+        /** Streaming frame ring
+         *  workerStreamVideo() reads each frame into a free slot and queues it,
+         *  workerDeliverVideo() converts it and hands it to the streamer, so capture
+         *  and encoding overlap. The oldest queued frame is dropped when the
+         *  streamer falls behind. */
+        struct StreamFrame
+        {
+            std::vector<uint8_t> data;
+            /** Capture time in microseconds since SER epoch */
+            uint64_t timestamp {0};
+        };
+        static constexpr int STREAM_RING_SIZE = 4;
+        FrameRing::Ring<StreamFrame, STREAM_RING_SIZE> mStreamFrames;
+        std::thread mStreamDelivery;
+
+        /** Capture timestamps: monotonic clock anchored to UTC when streaming starts */
+        FrameRing::Clock mStreamClock;
+
     protected:
         double mTargetTemperature;
         double mCurrentTemperature;
@@ -24,10 +24,164 @@
 #include <sys/time.h>
 #include <time.h>
 #include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
 #include "pthread.h"
 
-int  main()
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "framering.h"
+
+// Frame ring shared by the capture and consumer threads, mirroring the driver
+#define RING_SIZE 4
+
+using steady = std::chrono::steady_clock;
+using usec = std::chrono::duration<double, std::micro>;
+
+struct Frame
+{
+    std::vector<uint8_t> data;
+    steady::time_point captured;
+};
+
+static FrameRing::Ring<Frame, RING_SIZE> ring;
+
+// Swap R and B as the driver does before streaming, and report the capture to consumer latency
+static void consumeThread(long imgSize, bool isRGB)
+{
+    uint32_t frames = 0;
+    double total = 0, worst = 0;
+
+    while (Frame *frame = ring.wait())
+    {
+        if (isRGB)
+            for (long i = 0; i + 2 < imgSize; i += 3)
+                std::swap(frame->data[i], frame->data[i + 2]);
+
+        double latency = usec(steady::now() - frame->captured).count();
+        total += latency;
+        worst = std::max(worst, latency);
+
+        ring.release(frame);
+
+        if (++frames == 100)
+        {
+            printf("Handoff latency over %d frames: avg %.1f us max %.1f us\n", frames, total / frames, worst);
+            frames = 0;
+            total = worst = 0;
+        }
+    }
+}
+
+// Stream in video mode for the given number of seconds and report the frame rate
+static int benchmark(int CamNum, long imgSize, bool isRGB, int seconds, int exp_us)
+{
+    ring.open(imgSize);
+
+    POAConfigValue confVal;
+    confVal.intValue = exp_us;
+    POASetConfig(CamNum, POA_EXPOSURE, confVal, POA_FALSE);
+
+    printf("\nBenchmarking %d seconds of %d us video frames, %ld bytes each...\n", seconds, exp_us, imgSize);
+
+    if (POAStartExposure(CamNum, POA_FALSE) != POA_OK)
+    {
+        printf("Failed to start video capture.\n");
+        return -1;
+    }
+
+    std::thread consumer(&consumeThread, imgSize, isRGB);
+
+    const int waitMS = exp_us / 1000 + 500;
+    uint32_t frames = 0, totalFrames = 0, timeouts = 0;
+    double maxInterval = 0;
+    auto begin = steady::now();
+    auto start = begin;
+    auto last = begin;
+
+    while (std::chrono::duration<double>(steady::now() - begin).count() < seconds)
+    {
+        Frame *frame = ring.acquire();
+        if (frame == nullptr)
+        {
+            usleep(100);
+            continue;
+        }
+
+        POABool pIsReady = POA_FALSE;
+        while (pIsReady == POA_FALSE)
+            POAImageReady(CamNum, &pIsReady);
+
+        POAErrors ret = POAGetImageData(CamNum, frame->data.data(), imgSize, waitMS);
+        auto now = steady::now();
+        if (ret != POA_OK)
+        {
+            ring.release(frame);
+            if (ret != POA_ERROR_TIMEOUT)
+            {
+                printf("Failed to read video data (%d).\n", ret);
+                break;
+            }
+            timeouts++;
+            continue;
+        }
+
+        frame->captured = now;
+        ring.publish(frame);
+
+        maxInterval = std::max(maxInterval, usec(now - last).count());
+        last = now;
+        frames++;
+        totalFrames++;
+
+        std::chrono::duration<double> duration = now - start;
+        if (duration.count() >= 3)
+        {
+            printf("Frames: %d Duration: %.3f seconds FPS: %.3f Max interval: %.0f us Dropped: %u Timeouts: %u\n",
+                   frames, duration.count(), frames / duration.count(), maxInterval, ring.dropped(), timeouts);
+            start = now;
+            frames = 0;
+            maxInterval = 0;
+        }
+    }
+
+    double elapsed = std::chrono::duration<double>(steady::now() - begin).count();
+    POAStopExposure(CamNum);
+
+    ring.close();
+    consumer.join();
+
+    printf("Total: %d frames in %.3f seconds, %.3f FPS, %u dropped, %u timeouts\n", totalFrames, elapsed,
+           totalFrames / elapsed, ring.dropped(), timeouts);
+
+    return 0;
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [-f seconds [exposure_us]]\n", name);
+    printf("  -f  benchmark video mode frames per second instead of capturing a single image\n");
+}
+
+int  main(int argc, char *argv[])
 {
+    int benchSeconds = 0, benchExposure = 1000;
+    if (argc > 1)
+    {
+        if (strcmp(argv[1], "-f") != 0 || argc < 3 || atoi(argv[2]) <= 0)
+        {
+            usage(argv[0]);
+            return -1;
+        }
+        benchSeconds = atoi(argv[2]);
+        if (argc > 3)
+            benchExposure = std::max(1, atoi(argv[3]));
+    }
+
     int width, height;
     const char *formats[] = {"RAW 8-bit", "RAW 16-bit", "RGB 24-bit", "Luma 8-bit" };
     int CamNum = 0;
@@ -123,7 +277,10 @@ int  main()
     }
     while(ret1 != POA_OK || ret2 != POA_OK || ret3 != POA_OK);
 
-    printf("\nset image format %d %d %d %d success, Will capture now a 100ms image.\n", width, height, bin, imageFormat);
+    if (benchSeconds == 0)
+        printf("\nset image format %d %d %d %d success, Will capture now a 100ms image.\n", width, height, bin, imageFormat);
+    else
+        printf("\nset image format %d %d %d %d success.\n", width, height, bin, imageFormat);
 
     POAGetImageSize(CamNum, &width, &height);
     POAGetImageBin(CamNum, &bin);
@@ -133,6 +290,18 @@ int  main()
     if (imageFormat == POA_RAW16) imgSize *= 2;
     else if (imageFormat == POA_RGB24) imgSize *= 3;
 
+    if (benchSeconds > 0)
+    {
+        POAConfigValue bandwidth;
+        bandwidth.intValue = 100;
+        POASetConfig(CamNum, POA_USB_BANDWIDTH_LIMIT, bandwidth, POA_FALSE);
+
+        int rc = benchmark(CamNum, imgSize, imageFormat == POA_RGB24, benchSeconds, benchExposure);
+        POACloseCamera(CamNum);
+        printf(rc == 0 ? "PlayerOne Camera Test completed successfully\n" : "PlayerOne Camera Test failed.\n");
+        return rc;
+    }
+
     unsigned char* imgBuf = new unsigned char[imgSize];
 
     POAConfigValue confVal;
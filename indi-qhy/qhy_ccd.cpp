@@ -220,6 +220,8 @@ bool QHYCCD::initProperties()
     IUFillSwitchVector(&OverscanAreaSP, OverscanAreaS, 2, getDeviceName(), "OVERSCAN_MODE", "Overscan Area", MAIN_CONTROL_TAB,
                        IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
 
+    m_Calibration.initProperties(IMAGE_SETTINGS_TAB);
+
     /////////////////////////////////////////////////////////////////////////////
     /// Properties: Utility Controls
     /////////////////////////////////////////////////////////////////////////////
@@ -627,6 +629,8 @@ bool QHYCCD::updateProperties()
         if (HasOverscanArea)
             defineProperty(&OverscanAreaSP);
 
+        m_Calibration.updateProperties(true);
+
         // Let's get parameters now from CCD
         setupParams();
     }
@@ -702,6 +706,8 @@ bool QHYCCD::updateProperties()
         //NEW CODE - Add support for overscan/calibration area
         if (HasOverscanArea)
             deleteProperty(OverscanAreaSP.name);
+
+        m_Calibration.updateProperties(false);
     }
 
     return true;
@@ -1149,6 +1155,7 @@ bool QHYCCD::Disconnect()
     pthread_cond_signal(&cv);
     pthread_mutex_unlock(&condMutex);
     pthread_join(m_ImagingThread, nullptr);
+    stopStreamDelivery();
     //tState = StateNone;
     if (isSimulation() == false)
     {
@@ -1548,13 +1555,34 @@ int QHYCCD::grabImage()
         LOG_DEBUG("Download complete.");
 
     if (HasGPS && GPSControlS[INDI_ENABLED].s == ISS_ON)
-        decodeGPSHeader();
+        decodeGPSHeader(PrimaryCCD.getFrameBuffer());
+
+    // After the GPS header is read, as it is stored in the first pixels
+    if (m_Calibration.isEnabled(false))
+    {
+        guard.lock();
+        m_Calibration.process(PrimaryCCD.getFrameBuffer(), PrimaryCCD.getSubW() / PrimaryCCD.getBinX(),
+                              PrimaryCCD.getSubH() / PrimaryCCD.getBinY(), 1, PrimaryCCD.getBPP(), calibrationKey(),
+                              PrimaryCCD.getFrameType(), false);
+        guard.unlock();
+    }
 
     ExposureComplete(&PrimaryCCD);
 
     return 0;
 }
 
+Calibration::FrameKey QHYCCD::calibrationKey()
+{
+    Calibration::FrameKey key;
+    key.exposure = m_ExposureRequest;
+    if (HasGain)
+        key.gain = GainN[0].value;
+    if (HasCooler())
+        key.temperature = TemperatureN[0].value;
+    return key;
+}
+
 void QHYCCD::TimerHit()
 {
     if (isConnected() == false)
@@ -1653,6 +1681,9 @@ bool QHYCCD::ISNewSwitch(const char *dev, const char *name, ISState *states, cha
 {
     if (dev != nullptr && strcmp(dev, getDeviceName()) == 0)
     {
+        if (m_Calibration.ISNewSwitch(dev, name, states, names, n))
+            return true;
+
         //////////////////////////////////////////////////////////////////////
         /// Cooler On/Off Control
         //////////////////////////////////////////////////////////////////////
@@ -1900,6 +1931,9 @@ bool QHYCCD::ISNewText(const char *dev, const char *name, char *texts[], char *n
             INDI::FilterInterface::processText(dev, name, texts, names, n);
             return true;
         }
+
+        if (m_Calibration.ISNewText(dev, name, texts, names, n))
+            return true;
     }
 
     return INDI::CCD::ISNewText(dev, name, texts, names, n);
@@ -2359,6 +2393,8 @@ bool QHYCCD::saveConfigItems(FILE *fp)
 
     IUSaveConfigNumber(fp, &USBBufferNP);
 
+    m_Calibration.saveConfigItems(fp);
+
     return true;
 }
 
@@ -2475,6 +2511,7 @@ bool QHYCCD::StartStreaming()
 
     LOGF_INFO("Starting video streaming with exposure %.f seconds (%.f FPS), w=%d h=%d", m_ExposureRequest,
               Streamer->getTargetFPS(), subW, subH);
+    startStreamDelivery();
     BeginQHYCCDLive(m_CameraHandle);
     pthread_mutex_lock(&condMutex);
     m_ThreadRequest = StateStream;
@@ -2494,6 +2531,7 @@ bool QHYCCD::StopStreaming()
         pthread_cond_wait(&cv, &condMutex);
     }
     pthread_mutex_unlock(&condMutex);
+    stopStreamDelivery();
     StopQHYCCDLive(m_CameraHandle);
 
     //LOG_INFO("stopped live mode"); //DEBUG
@@ -2573,44 +2611,118 @@ void *QHYCCD::imagingThreadEntry()
 
 void QHYCCD::streamVideo()
 {
-    uint32_t ret = 0, w, h, bpp, channels;
-    //uint32_t t_start = time(NULL), frames = 0;
+    uint32_t ret = 0;
+    // Frames cannot arrive faster than the exposure, so poll around the expected
+    // frame period and back off exponentially while a late frame is pending.
+    const uint32_t minWait = LIVE_FRAME_MIN_WAIT, maxWait = LIVE_FRAME_MAX_WAIT;
+    const uint32_t framePeriod = std::max(static_cast<uint32_t>(m_ExposureRequest * 1e6), minWait);
+    const uint32_t maxBackoff = std::min(std::max(framePeriod / 4, minWait), maxWait);
+    uint32_t backoff = minWait;
+    struct timeval lastFrame, now;
+    gettimeofday(&lastFrame, nullptr);
+
     while (m_ThreadRequest == StateStream)
     {
         pthread_mutex_unlock(&condMutex);
-        uint32_t retries = 0;
-        std::unique_lock<std::mutex> guard(ccdBufferLock);
-        uint8_t *buffer = PrimaryCCD.getFrameBuffer();
-        while (retries++ < 10)
+
+        // Grab a free slot, or recycle the oldest frame the streamer has not picked up yet
+        LiveFrame *frame = m_LiveFrames.acquire();
+
+        if (frame == nullptr)
+            ret = QHYCCD_ERROR;
+        else
+            ret = GetQHYCCDLiveFrame(m_CameraHandle, &frame->w, &frame->h, &frame->bpp, &frame->channels, frame->data.data());
+
+        gettimeofday(&now, nullptr);
+        uint32_t elapsed = (now.tv_sec - lastFrame.tv_sec) * 1000000 + (now.tv_usec - lastFrame.tv_usec);
+
+        if (ret == QHYCCD_SUCCESS)
         {
+            frame->timestamp = static_cast<uint64_t>(now.tv_sec) * 1000000 + now.tv_usec + FrameRing::UNIX_SER_US_EPOCH;
+            m_LiveFrames.publish(frame);
 
-            ret = GetQHYCCDLiveFrame(m_CameraHandle, &w, &h, &bpp, &channels, buffer);
-            if (ret == QHYCCD_ERROR)
-                usleep(1000);
-            else
-                break;
+            lastFrame = now;
+            backoff = minWait;
+            // Next frame is at least one period away
+            usleep(std::min(framePeriod / 2, maxWait));
         }
-        guard.unlock();
-        if (ret == QHYCCD_SUCCESS)
+        else
         {
-            uint64_t timestamp = 0;
-            if (HasGPS && GPSControlS[INDI_ENABLED].s == ISS_ON)
+            if (frame != nullptr)
+                m_LiveFrames.release(frame);
+
+            if (elapsed < framePeriod)
+                usleep(std::min(std::max(framePeriod - elapsed, minWait), maxWait));
+            else
             {
-                decodeGPSHeader();
-                timestamp = (uint64_t)GPSHeader.start_sec * 1e6;
-                timestamp += GPSHeader.start_us + QHY_SER_US_EPOCH;
+                usleep(backoff);
+                backoff = std::min(backoff * 2, maxBackoff);
             }
+        }
 
-            Streamer->newFrame(buffer, w * h * bpp / 8 * channels, timestamp);
+        pthread_mutex_lock(&condMutex);
+    }
+}
+
+void QHYCCD::startStreamDelivery()
+{
+    uint32_t length = PrimaryCCD.getFrameBufferSize();
+    if (!isSimulation())
+        length = std::max(length, GetQHYCCDMemLength(m_CameraHandle));
+
+    m_LiveFrames.open(length);
+
+    int stat = pthread_create(&m_DeliveryThread, nullptr, &streamDeliveryHelper, this);
+    if (stat != 0)
+    {
+        LOGF_ERROR("Error creating stream delivery thread (%d)", stat);
+        m_LiveFrames.close();
+    }
+}
+
+void QHYCCD::stopStreamDelivery()
+{
+    if (!m_LiveFrames.close())
+        return;
+
+    pthread_join(m_DeliveryThread, nullptr);
+
+    if (m_LiveFrames.dropped() > 0)
+        LOGF_DEBUG("Dropped %u live frames while streaming.", m_LiveFrames.dropped());
+}
 
-            //DEBUG
-            //if(!frames)
-            //    LOGF_DEBUG("Receiving frames ...");
-            //if(!(++frames % 30))
-            //    LOGF_DEBUG("Frames received: %d (%.1f fps)", frames, 1.0 * frames / (time(NULL) - t_start));
+void *QHYCCD::streamDeliveryHelper(void *context)
+{
+    return static_cast<QHYCCD *>(context)->streamDeliveryEntry();
+}
+
+/*
+ * Hands captured live frames to the streamer, so that GPS header decoding
+ * and encoding never delay the next GetQHYCCDLiveFrame call.
+ */
+void *QHYCCD::streamDeliveryEntry()
+{
+    while (LiveFrame *frame = m_LiveFrames.wait())
+    {
+        uint64_t timestamp = frame->timestamp;
+        if (HasGPS && GPSControlS[INDI_ENABLED].s == ISS_ON)
+        {
+            decodeGPSHeader(frame->data.data());
+            timestamp = (uint64_t)GPSHeader.start_sec * 1e6;
+            timestamp += GPSHeader.start_us + QHY_SER_US_EPOCH;
         }
-        pthread_mutex_lock(&condMutex);
+
+        // Colour live frames are interleaved, masters are planar
+        if (frame->channels == 1 && m_Calibration.isEnabled(true))
+            m_Calibration.process(frame->data.data(), frame->w, frame->h, 1, frame->bpp, calibrationKey(),
+                                  PrimaryCCD.getFrameType(), true);
+
+        Streamer->newFrame(frame->data.data(), frame->w * frame->h * frame->bpp / 8 * frame->channels, timestamp);
+
+        m_LiveFrames.release(frame);
     }
+
+    return nullptr;
 }
 
 void QHYCCD::getExposure()
@@ -2809,6 +2921,8 @@ void QHYCCD::addFITSKeywords(INDI::CCDChip *targetChip, std::vector<INDI::FITSRe
         fitsKeywords.push_back({"GPS_TMP", GPSHeader.tempNumber, "Temporary Sequence Number"});
     }
 
+    m_Calibration.addFITSKeywords(fitsKeywords);
+
 }
 
 INumberVectorProperty QHYCCD::getLEDStartPosNP() const
@@ -2821,12 +2935,12 @@ void QHYCCD::setLEDStartPosNP(const INumberVectorProperty &value)
     GPSLEDStartPosNP = value;
 }
 
-void QHYCCD::decodeGPSHeader()
+void QHYCCD::decodeGPSHeader(const uint8_t *buffer)
 {
     char ts[64] = {0}, iso8601[64] = {0}, data[64] = {0};
 
     uint8_t gpsarray[64] = {0};
-    memcpy(gpsarray, PrimaryCCD.getFrameBuffer(), 64);
+    memcpy(gpsarray, buffer, 64);
 
     // Sequence Number
     GPSHeader.seqNumber = gpsarray[0] << 24 | gpsarray[1] << 16 | gpsarray[2] << 8 | gpsarray[3];
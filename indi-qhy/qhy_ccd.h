@@ -24,9 +24,12 @@
 #include <qhyccd.h>
 #include <indiccd.h>
 #include <indifilterinterface.h>
+#include <calibrationstage.h>
+#include <framering.h>
 #include <unistd.h>
 #include <functional>
 #include <pthread.h>
+#include <vector>
 
 #define DEVICE struct usb_device *
 
@@ -389,9 +392,15 @@ class QHYCCD : public INDI::CCD, public INDI::FilterInterface
         static void *imagingHelper(void *context);
         void *imagingThreadEntry();
         void streamVideo();
+        static void *streamDeliveryHelper(void *context);
+        void *streamDeliveryEntry();
+        void startStreamDelivery();
+        void stopStreamDelivery();
         void getExposure();
         void exposureSetRequest(ImageState request);
         int grabImage();
+        // Key of the frames being taken, to pick calibration masters
+        Calibration::FrameKey calibrationKey();
 
         /////////////////////////////////////////////////////////////////////////////
         /// Cooling
@@ -414,8 +423,8 @@ class QHYCCD : public INDI::CCD, public INDI::FilterInterface
         bool isQHY5PIIC();
         // Call when max filter count is known
         bool updateFilterProperties();
-        // Decode GPS Header
-        void decodeGPSHeader();
+        // Decode GPS Header from the first bytes of the given frame
+        void decodeGPSHeader(const uint8_t *buffer);
         /**
          * @brief JStoJD Convert Julian Second to Julian Date
          * @param JS Julian Second
@@ -489,6 +498,31 @@ class QHYCCD : public INDI::CCD, public INDI::FilterInterface
         pthread_cond_t cv         = PTHREAD_COND_INITIALIZER;
         pthread_mutex_t condMutex = PTHREAD_MUTEX_INITIALIZER;
 
+        /////////////////////////////////////////////////////////////////////////////
+        /// Live frame ring
+        /// The imaging thread polls GetQHYCCDLiveFrame into a free slot without
+        /// holding ccdBufferLock, the delivery thread decodes the GPS header and
+        /// hands the slot to the streamer. The oldest undelivered frame is dropped
+        /// when the streamer falls behind.
+        /////////////////////////////////////////////////////////////////////////////
+        // Live frame slots, enough to absorb a slow encoder for a few frames
+        static constexpr uint8_t LIVE_FRAME_RING_SIZE = 4;
+        // Bounds of the adaptive live frame polling interval in microseconds
+        static constexpr uint32_t LIVE_FRAME_MIN_WAIT = 200;
+        static constexpr uint32_t LIVE_FRAME_MAX_WAIT = 20000;
+        struct LiveFrame
+        {
+            std::vector<uint8_t> data;
+            uint32_t w {0}, h {0}, bpp {0}, channels {0};
+            // Host capture time in microseconds since SER epoch
+            uint64_t timestamp {0};
+        };
+        FrameRing::Ring<LiveFrame, LIVE_FRAME_RING_SIZE> m_LiveFrames;
+        pthread_t m_DeliveryThread;
+
+        // Optional bias, dark and flat calibration of exposures and live frames
+        Calibration::Stage m_Calibration {this};
+
         void logQHYMessages(const std::string &message);
         std::function<void(const std::string &)> m_QHYLogCallback;
 
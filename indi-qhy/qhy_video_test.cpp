@@ -26,46 +26,123 @@
 #include <string.h>
 #include <qhyccd.h>
 
+#include <algorithm>
 #include <iostream>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "framering.h"
 
 #define VERSION 1.00
 
 static std::atomic<bool> exit_thread { false };
 
-int videoThread(qhyccd_handle *pCamHandle, unsigned char *pImgData)
+// Live frame ring shared by the poller and consumer threads, mirroring the driver
+#define RING_SIZE 4
+
+using steady = std::chrono::steady_clock;
+using usec = std::chrono::duration<double, std::micro>;
+
+struct LiveFrame
+{
+    std::vector<uint8_t> data;
+    steady::time_point captured;
+};
+
+static FrameRing::Ring<LiveFrame, RING_SIZE> ring;
+
+// Poll the camera with an adaptive wait based on the frame period
+int pollThread(qhyccd_handle *pCamHandle, uint32_t framePeriod)
 {
-    std::chrono::high_resolution_clock timer;
-    using fsec = std::chrono::duration<float>;
-    uint32_t frames = 0, w, h, bpp, channels;
+    const uint32_t minWait = 200, maxWait = 20000;
+    uint32_t frames = 0, polls = 0, w, h, bpp, channels;
+    uint32_t backoff = minWait;
+    double maxInterval = 0;
 
-    auto start = timer.now();
+    auto start = steady::now();
+    auto last = start;
 
     while (!exit_thread)
     {
-        if (GetQHYCCDLiveFrame(pCamHandle, &w, &h, &bpp, &channels, pImgData) == QHYCCD_SUCCESS)
+        LiveFrame *frame = ring.acquire();
+        if (frame == nullptr)
+        {
+            usleep(minWait);
+            continue;
+        }
+
+        polls++;
+        int rc = GetQHYCCDLiveFrame(pCamHandle, &w, &h, &bpp, &channels, frame->data.data());
+        auto now = steady::now();
+        uint32_t elapsed = usec(now - last).count();
+
+        if (rc == QHYCCD_SUCCESS)
         {
+            frame->captured = now;
+            ring.publish(frame);
+
             frames++;
+            maxInterval = std::max(maxInterval, static_cast<double>(elapsed));
+            last = now;
+            backoff = minWait;
 
-            auto stop = timer.now();
-            fsec duration = (stop - start);
+            std::chrono::duration<float> duration = now - start;
             if (duration.count() >= 3)
             {
-                fprintf(stderr, "Frames: %d Duration: %.3f seconds FPS: %.3f\n", frames, duration.count(), frames / duration.count());
-                start = timer.now();
-                frames = 0;
+                fprintf(stderr, "Frames: %d Duration: %.3f seconds FPS: %.3f Polls/frame: %.2f Max interval: %.0f us Dropped: %u\n",
+                        frames, duration.count(), frames / duration.count(), static_cast<double>(polls) / frames, maxInterval,
+                        ring.dropped());
+                start = now;
+                frames = polls = 0;
+                maxInterval = 0;
             }
-            usleep(3000);
+            usleep(std::min(framePeriod / 2, maxWait));
         }
         else
-            usleep(1000);
+        {
+            ring.release(frame);
+
+            if (elapsed < framePeriod)
+                usleep(std::min(std::max(framePeriod - elapsed, minWait), maxWait));
+            else
+            {
+                usleep(backoff);
+                backoff = std::min(backoff * 2, std::min(std::max(framePeriod / 4, minWait), maxWait));
+            }
+        }
     }
 
     return 0;
 }
 
-int main(int, char **)
+// Consume frames and report the capture to consumer handoff latency
+int consumeThread()
+{
+    uint32_t frames = 0;
+    double total = 0, worst = 0;
+
+    while (LiveFrame *frame = ring.wait())
+    {
+        double latency = usec(steady::now() - frame->captured).count();
+        total += latency;
+        worst = std::max(worst, latency);
+
+        ring.release(frame);
+
+        if (++frames == 100)
+        {
+            fprintf(stderr, "Handoff latency over %d frames: avg %.1f us max %.1f us\n", frames, total / frames, worst);
+            frames = 0;
+            total = worst = 0;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
 {
     int USB_TRAFFIC = 20;
     int USB_SPEED = 2;
@@ -100,13 +177,15 @@ int main(int, char **)
     unsigned int bpp;
     //unsigned int channels;
 
-    unsigned char *pImgData = nullptr;
-
     EnableQHYCCDLogFile(false);
     EnableQHYCCDMessage(false);
 
     fprintf(stderr, "QHY Video Test using VideoFrameMode, Version: %.2f\n", VERSION);
 
+    // optional exposure time in microseconds, used as the expected frame period
+    if (argc > 1)
+        EXPOSURE_TIME = std::max(1, atoi(argv[1]));
+
     // init SDK
     int rc = InitQHYCCDResource();
     if (QHYCCD_SUCCESS == rc)
@@ -386,9 +465,8 @@ int main(int, char **)
 
     if (length > 0)
     {
-        pImgData = new unsigned char[length];
-        memset(pImgData, 0, length);
-        fprintf(stderr, "Allocated memory for frame: %d [uchar].\n", length);
+        ring.open(length);
+        fprintf(stderr, "Using %d frames: %d [uchar] each.\n", RING_SIZE, length);
     }
     else
     {
@@ -405,7 +483,8 @@ int main(int, char **)
     fprintf(stderr, "Press any key to exit...\n");
 
     // Video Frame
-    std::thread t(&videoThread, pCamHandle, pImgData);
+    std::thread poller(&pollThread, pCamHandle, static_cast<uint32_t>(std::max(EXPOSURE_TIME, 200)));
+    std::thread consumer(&consumeThread);
 
     // wait for user key
     std::getchar();
@@ -413,7 +492,9 @@ int main(int, char **)
     if (!exit_thread)
     {
         exit_thread = true;
-        t.join();
+        poller.join();
+        ring.close();
+        consumer.join();
     }
 
     StopQHYCCDLive(pCamHandle);
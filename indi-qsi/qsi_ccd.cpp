@@ -97,6 +97,8 @@ QSICCD::QSICCD() : FilterInterface(this)
     canSetAB              = false;
     canFlush              = false;
     canChangeReadoutSpeed = false;
+    canMaskPixels         = false;
+    imageFrameType        = INDI::CCDChip::LIGHT_FRAME;
 
     // Initial setting. Updated after connction to camera.
     FilterSlotN[0].min = 1;
@@ -163,6 +165,21 @@ bool QSICCD::initProperties()
     IUFillSwitchVector(&ABSP, ABS, 2, getDeviceName(), "AntiBlooming", "", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60,
                        IPS_IDLE);
 
+    // Hot pixel map kept by the camera library, corrected as the image is read out
+    IUFillSwitch(&HotPixelS[HOT_PIXELS_ON], "HOT_PIXELS_ON", "On", ISS_OFF);
+    IUFillSwitch(&HotPixelS[HOT_PIXELS_OFF], "HOT_PIXELS_OFF", "Off", ISS_ON);
+    IUFillSwitchVector(&HotPixelSP, HotPixelS, 2, getDeviceName(), "CCD_HOT_PIXELS", "Hot Pixels", OPTIONS_TAB, IP_RW,
+                       ISR_1OFMANY, 60, IPS_IDLE);
+
+    IUFillNumber(&HotPixelThresholdN[0], "HOT_PIXEL_THRESHOLD", "Above median (ADU)", "%.f", 1, 65535, 100, 1000);
+    IUFillNumberVector(&HotPixelThresholdNP, HotPixelThresholdN, 1, getDeviceName(), "CCD_HOT_PIXEL_THRESHOLD",
+                       "Hot Threshold", OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+
+    IUFillSwitch(&HotPixelMapS[HOT_MAP_ADD_DARK], "HOT_MAP_ADD_DARK", "Add last dark", ISS_OFF);
+    IUFillSwitch(&HotPixelMapS[HOT_MAP_CLEAR], "HOT_MAP_CLEAR", "Clear", ISS_OFF);
+    IUFillSwitchVector(&HotPixelMapSP, HotPixelMapS, 2, getDeviceName(), "CCD_HOT_PIXEL_MAP", "Hot Pixel Map",
+                       OPTIONS_TAB, IP_RW, ISR_ATMOST1, 60, IPS_IDLE);
+
     INDI::FilterInterface::initProperties(FILTER_TAB);
 
     addDebugControl();
@@ -211,6 +228,13 @@ bool QSICCD::updateProperties()
         if (canChangeReadoutSpeed)
             deleteProperty(ReadOutSP.name);
 
+        if (canMaskPixels)
+        {
+            deleteProperty(HotPixelSP.name);
+            deleteProperty(HotPixelThresholdNP.name);
+            deleteProperty(HotPixelMapSP.name);
+        }
+
         if (filterCount > 0)
         {
             INDI::FilterInterface::updateProperties();
@@ -375,6 +399,28 @@ bool QSICCD::setupParams()
         }
     }
 
+    bool maskPixels = false;
+    canMaskPixels   = true;
+
+    try
+    {
+        QSICam.get_MaskPixels(&maskPixels);
+    }
+    catch (std::runtime_error &err)
+    {
+        LOGF_DEBUG("Camera does not support hot pixel mapping. %s.", err.what());
+        canMaskPixels = false;
+    }
+
+    if (canMaskPixels)
+    {
+        IUResetSwitch(&HotPixelSP);
+        HotPixelS[maskPixels ? HOT_PIXELS_ON : HOT_PIXELS_OFF].s = ISS_ON;
+        defineProperty(&HotPixelSP);
+        defineProperty(&HotPixelThresholdNP);
+        defineProperty(&HotPixelMapSP);
+    }
+
     QSICamera::FanMode fMode = QSICamera::fanOff;
     canControlFan            = true;
 
@@ -654,6 +700,72 @@ bool QSICCD::ISNewSwitch(const char *dev, const char *name, ISState *states, cha
             return true;
         }
 
+        /* Hot Pixels */
+        if (!strcmp(name, HotPixelSP.name))
+        {
+            int prevMask = IUFindOnSwitchIndex(&HotPixelSP);
+            IUUpdateSwitch(&HotPixelSP, states, names, n);
+
+            try
+            {
+                QSICam.put_MaskPixels(HotPixelS[HOT_PIXELS_ON].s == ISS_ON);
+            }
+            catch (std::runtime_error &err)
+            {
+                IUResetSwitch(&HotPixelSP);
+                HotPixelS[prevMask].s = ISS_ON;
+                HotPixelSP.s          = IPS_ALERT;
+                LOGF_ERROR("put_MaskPixels failed. %s.", err.what());
+                IDSetSwitch(&HotPixelSP, nullptr);
+                return false;
+            }
+
+            HotPixelSP.s = IPS_OK;
+            IDSetSwitch(&HotPixelSP, nullptr);
+            return true;
+        }
+
+        if (!strcmp(name, HotPixelMapSP.name))
+        {
+            IUUpdateSwitch(&HotPixelMapSP, states, names, n);
+            int action = IUFindOnSwitchIndex(&HotPixelMapSP);
+            IUResetSwitch(&HotPixelMapSP);
+
+            try
+            {
+                if (action == HOT_MAP_ADD_DARK)
+                {
+                    if (PrimaryCCD.isExposing() || imageFrameType != INDI::CCDChip::DARK_FRAME)
+                    {
+                        LOG_ERROR("Hot pixels can only be added from a completed dark frame.");
+                        HotPixelMapSP.s = IPS_ALERT;
+                        IDSetSwitch(&HotPixelMapSP, nullptr);
+                        return false;
+                    }
+
+                    int count = 0;
+                    QSICam.AddPixelMaskFromDark(static_cast<unsigned short>(HotPixelThresholdN[0].value), &count);
+                    LOGF_INFO("Added %d hot pixels from the last dark frame.", count);
+                }
+                else if (action == HOT_MAP_CLEAR)
+                {
+                    QSICam.put_PixelMask(std::vector<Pixel>());
+                    LOG_INFO("Hot pixel map cleared.");
+                }
+            }
+            catch (std::runtime_error &err)
+            {
+                HotPixelMapSP.s = IPS_ALERT;
+                LOGF_ERROR("Updating the hot pixel map failed. %s.", err.what());
+                IDSetSwitch(&HotPixelMapSP, nullptr);
+                return false;
+            }
+
+            HotPixelMapSP.s = IPS_OK;
+            IDSetSwitch(&HotPixelMapSP, nullptr);
+            return true;
+        }
+
         /* Filter Wheel */
         if (!strcmp(name, FilterSP.name))
         {
@@ -694,6 +806,14 @@ bool QSICCD::ISNewNumber(const char *dev, const char *name, double values[], cha
             INDI::FilterInterface::processNumber(dev, name, values, names, n);
             return true;
         }
+
+        if (strcmp(name, HotPixelThresholdNP.name) == 0)
+        {
+            IUUpdateNumber(&HotPixelThresholdNP, values, names, n);
+            HotPixelThresholdNP.s = IPS_OK;
+            IDSetNumber(&HotPixelThresholdNP, nullptr);
+            return true;
+        }
     }
 
     //  if we didn't process it, continue up the chain, let somebody else
@@ -1595,6 +1715,8 @@ bool QSICCD::saveConfigItems(FILE *fp)
         IUSaveConfigSwitch(fp, &FanSP);
     if (canSetAB)
         IUSaveConfigSwitch(fp, &ABSP);
+    if (canMaskPixels)
+        IUSaveConfigNumber(fp, &HotPixelThresholdNP);
 
     return true;
 }
@@ -105,11 +105,22 @@ protected:
     ISwitch ABS[2];
     ISwitchVectorProperty ABSP;
 
+    ISwitch HotPixelS[2];
+    ISwitchVectorProperty HotPixelSP;
+    enum { HOT_PIXELS_ON, HOT_PIXELS_OFF };
+
+    INumber HotPixelThresholdN[1];
+    INumberVectorProperty HotPixelThresholdNP;
+
+    ISwitch HotPixelMapS[2];
+    ISwitchVectorProperty HotPixelMapSP;
+    enum { HOT_MAP_ADD_DARK, HOT_MAP_CLEAR };
+
 private:
 
     QSICamera QSICam;
 
-    bool canAbort, canSetGain, canSetAB, canControlFan, canChangeReadoutSpeed, canFlush;
+    bool canAbort, canSetGain, canSetAB, canControlFan, canChangeReadoutSpeed, canFlush, canMaskPixels;
 
     // Filter Wheel
     int filterCount=0;
@@ -0,0 +1,50 @@
+/*
+ * Minimal stand-in for pigpiod_if2.h used by the wave unit tests.
+ * Only the calls made by rpigpio_wave.cpp are provided; they record
+ * what would have been sent to pigpiod instead of talking to it.
+ */
+
+#ifndef PIGPIOD_IF2_MOCK_H
+#define PIGPIOD_IF2_MOCK_H
+
+#include <stdint.h>
+#include <vector>
+
+#define PI_OUTPUT 1
+#define PI_LOW    0
+#define PI_HIGH   1
+
+typedef struct
+{
+    uint32_t gpioOn;
+    uint32_t gpioOff;
+    uint32_t usDelay;
+} gpioPulse_t;
+
+int set_mode(int pi, unsigned gpio, unsigned mode);
+int wave_add_new(int pi);
+int wave_add_generic(int pi, unsigned numPulses, gpioPulse_t *pulses);
+int wave_create(int pi);
+int wave_delete(int pi, unsigned wave_id);
+int wave_chain(int pi, char *buf, unsigned bufSize);
+int wave_tx_busy(int pi);
+int wave_tx_stop(int pi);
+int wave_get_max_micros(int pi);
+
+namespace pigpiod_mock
+{
+struct State
+{
+    std::vector<std::vector<gpioPulse_t>> waves;   // indexed by wave id
+    std::vector<gpioPulse_t> pending;
+    std::vector<unsigned> deleted;
+    std::vector<char> chain;
+    int busy { 0 };
+    int stopped { 0 };
+    int maxMicros { 1800 * 1000000 };
+};
+State &state();
+void reset();
+}
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * Recording implementation of the pigpiod_if2 calls used by rpigpio_wave.cpp.
+ */
+
+#include <pigpiod_if2.h>
+
+namespace pigpiod_mock
+{
+State &state()
+{
+    static State s;
+    return s;
+}
+
+void reset()
+{
+    state() = State();
+}
+}
+
+using pigpiod_mock::state;
+
+int set_mode(int, unsigned, unsigned)
+{
+    return 0;
+}
+
+int wave_add_new(int)
+{
+    state().pending.clear();
+    return 0;
+}
+
+int wave_add_generic(int, unsigned numPulses, gpioPulse_t *pulses)
+{
+    state().pending.insert(state().pending.end(), pulses, pulses + numPulses);
+    return state().pending.size();
+}
+
+int wave_create(int)
+{
+    state().waves.push_back(state().pending);
+    state().pending.clear();
+    return state().waves.size() - 1;
+}
+
+int wave_delete(int, unsigned wave_id)
+{
+    state().deleted.push_back(wave_id);
+    return 0;
+}
+
+int wave_chain(int, char *buf, unsigned bufSize)
+{
+    state().chain.assign(buf, buf + bufSize);
+    state().busy = 1;
+    return 0;
+}
+
+int wave_tx_busy(int)
+{
+    return state().busy;
+}
+
+int wave_tx_stop(int)
+{
+    state().busy = 0;
+    state().stopped++;
+    return 0;
+}
+
+int wave_get_max_micros(int)
+{
+    return state().maxMicros;
+}
@@ -62,6 +62,8 @@ IndiRpiGpio::~IndiRpiGpio()
         deleteProperty(DutyCycleNP[i].name);
         deleteProperty(TimerOnNP[i].name);
     }
+    deleteProperty(TimingSP.name);
+    m_wave.stop();
     pigpio_stop(m_piId);
 }
 
@@ -77,6 +79,7 @@ int IndiRpiGpio::InitPiModel()
         DEBUGF(INDI::Logger::DBG_ERROR, "pigpio initialisation failed: %d", m_piId);
         return -1;
     }
+    m_wave.setPi(m_piId);
     uint32_t hw_rev=get_hardware_revision(m_piId);
     DEBUGF(INDI::Logger::DBG_DEBUG, "pigpio version %lu.", get_pigpio_version(m_piId));
     DEBUGF(INDI::Logger::DBG_DEBUG, "Hardware revision %x.", hw_rev);
@@ -241,6 +244,9 @@ bool IndiRpiGpio::initProperties()
         IUFillNumber(&TimerOnN[i][2], (delay + std::to_string(i)).c_str(), "Delay (s)", "%1.1f", 0, 60, 1, 0);
         IUFillNumberVector(&TimerOnNP[i], TimerOnN[i], 3, getDeviceName(), (timedpulse + std::to_string(i)).c_str(), (port +std::to_string(i+1)).c_str(), TIMER_TAB, IP_RW, 0, IPS_IDLE);
     }
+    IUFillSwitch(&TimingS[TIMING_WAVE], "TIMING_WAVE", "Hardware (DMA)", ISS_ON);
+    IUFillSwitch(&TimingS[TIMING_SOFTWARE], "TIMING_SOFTWARE", "Software", ISS_OFF);
+    IUFillSwitchVector(&TimingSP, TimingS, 2, getDeviceName(), "TIMING_MODE", "Pulse timing", TIMER_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
     loadConfig();
 
     return true;
@@ -263,6 +269,7 @@ bool IndiRpiGpio::updateProperties()
             defineProperty(&ActiveSP[i]);
             defineProperty(&TimerOnNP[i]);
         }
+        defineProperty(&TimingSP);
     }
     else
     {
@@ -277,6 +284,7 @@ bool IndiRpiGpio::updateProperties()
             deleteProperty(DutyCycleNP[i].name);
             deleteProperty(TimerOnNP[i].name);
         }
+        deleteProperty(TimingSP.name);
     }
     return true;
 }
@@ -420,6 +428,15 @@ bool IndiRpiGpio::ISNewSwitch (const char *dev, const char *name, ISState *state
     // first we check if it's for our device
     if (!strcmp(dev, getDeviceName()))
     {
+        // Timing mode applies to sequences started afterwards
+        if (!strcmp(name, TimingSP.name))
+        {
+            IUUpdateSwitch(&TimingSP, states, names, n);
+            TimingSP.s = IPS_OK;
+            IDSetSwitch(&TimingSP, nullptr);
+            DEBUGF(INDI::Logger::DBG_SESSION, "Timed pulses use %s timing", TimingS[TIMING_WAVE].s == ISS_ON ? "hardware" : "software");
+            return true;
+        }
         for(int i=0; i<n_gpio_pin; i++)
         {
             // handle GPIO assignment
@@ -670,11 +687,21 @@ bool IndiRpiGpio::saveConfigItems(FILE *fp)
         IUSaveConfigNumber(fp, &DutyCycleNP[i]);
         IUSaveConfigNumber(fp, &TimerOnNP[i]);
     }
+    IUSaveConfigSwitch(fp, &TimingSP);
     return true;
 }
 
 void IndiRpiGpio::TimerChange(int i, bool isInit, bool abort)
 {
+    // A running wave sequence only needs its completion handled
+    if (i == m_wavePort)
+    {
+        FinishWaveSequence(i, abort);
+        return;
+    }
+    if (isInit && !abort && TimingS[TIMING_WAVE].s == ISS_ON && StartWaveSequence(i))
+        return;
+
     unsigned user_gpio = m_gpio_pin[i];
     gpio_write(m_piId, user_gpio, (ActiveS[i][0].s == ISS_ON)? PI_LOW: PI_HIGH);
     stopTimer(i);
@@ -712,12 +739,7 @@ void IndiRpiGpio::TimerChange(int i, bool isInit, bool abort)
     if (timer_counter[i] <= 0)
     {
         DEBUGF(INDI::Logger::DBG_SESSION, "Timer SEQ END: Port %d %s Counter %d", ip, timer_isexp[i] ? "Expose":"Delay", timer_counter[i]);
-        OnOffS[i][0].s = ISS_ON;
-        OnOffS[i][1].s = ISS_OFF;
-        OnOffSP[i].s = IPS_IDLE;
-        IDSetSwitch(&OnOffSP[i], nullptr);
-        TimerOnNP[i].s = IPS_IDLE;
-        IDSetNumber(&TimerOnNP[i], nullptr);
+        EndTimerSequence(i);
         return;
     }
     uint32_t l_duration = (timer_isexp[i] ? TimerOnN[i][0].value : TimerOnN[i][2].value)*1000;
@@ -757,3 +779,63 @@ void IndiRpiGpio::TimerCallback(int i)
     TimerChange(i);  // Handle end of timer
     return;
 }
+
+void IndiRpiGpio::EndTimerSequence(int i)
+{
+    OnOffS[i][0].s = ISS_ON;
+    OnOffS[i][1].s = ISS_OFF;
+    OnOffSP[i].s = IPS_IDLE;
+    IDSetSwitch(&OnOffSP[i], nullptr);
+    TimerOnNP[i].s = IPS_IDLE;
+    IDSetNumber(&TimerOnNP[i], nullptr);
+}
+
+bool IndiRpiGpio::StartWaveSequence(int i)
+{
+    const int ip = i+1; // Port number
+
+    // pigpiod plays one wave chain at a time, other ports fall back to INDI timers
+    if (m_wavePort >= 0)
+    {
+        DEBUGF(INDI::Logger::DBG_DEBUG, "Wave SEQ: Port %d busy with port %d, using software timing", ip, m_wavePort+1);
+        return false;
+    }
+
+    uint32_t duration_us = TimerOnN[i][0].value * 1e6;
+    uint32_t delay_us = TimerOnN[i][2].value * 1e6;
+    uint32_t count = TimerOnN[i][1].value;
+    if (!m_wave.start(m_gpio_pin[i], ActiveS[i][0].s == ISS_ON, duration_us, delay_us, count))
+    {
+        DEBUGF(INDI::Logger::DBG_DEBUG, "Wave SEQ: Port %d sequence cannot be hardware timed, using software timing", ip);
+        return false;
+    }
+
+    m_wavePort = i;
+    timer_start[i] = std::chrono::system_clock::now();
+    startTimer(i, static_cast<int>(std::min<uint64_t>(m_wave.totalMicros() / 1000 + 1, max_timer_ms)));
+    DEBUGF(INDI::Logger::DBG_SESSION, "Wave SEQ START: Port %d Duration %u us Delay %u us Count %u", ip, duration_us, delay_us, count);
+    return true;
+}
+
+void IndiRpiGpio::FinishWaveSequence(int i, bool abort)
+{
+    const int ip = i+1; // Port number
+
+    if (!abort && m_wave.isBusy())
+    {
+        // Not done yet, check again once the remainder should have elapsed
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - timer_start[i]).count();
+        int64_t remaining = static_cast<int64_t>(m_wave.totalMicros() / 1000) - elapsed;
+        startTimer(i, static_cast<int>(std::max<int64_t>(std::min<int64_t>(remaining, max_timer_ms), 10)));
+        return;
+    }
+
+    stopTimer(i);
+    m_wave.stop();
+    m_wavePort = -1;
+    gpio_write(m_piId, m_gpio_pin[i], (ActiveS[i][0].s == ISS_ON)? PI_LOW: PI_HIGH);
+
+    auto int_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - timer_start[i]);
+    DEBUGF(INDI::Logger::DBG_SESSION, "Wave SEQ %s: Port %d after %d ms", abort ? "ABORT" : "END", ip, static_cast<int>(int_ms.count()));
+    EndTimerSequence(i);
+}
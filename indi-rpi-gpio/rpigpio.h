@@ -25,6 +25,7 @@
 #include <algorithm>
 #include <chrono>
 #include <inditimer.h>
+#include <rpigpio_wave.h>
 
 #include <defaultdevice.h>
     static const int max_gpio_pin = 32;
@@ -102,6 +103,11 @@ private:
     INumber TimerOnN[n_gpio_pin][3];
     INumberVectorProperty TimerOnNP[n_gpio_pin];
 
+    // Timed pulses played from pigpiod DMA waves or with INDI timers
+    ISwitch TimingS[2];
+    ISwitchVectorProperty TimingSP;
+    enum { TIMING_WAVE, TIMING_SOFTWARE };
+
     std::chrono::time_point<std::chrono::system_clock> timer_start[n_gpio_pin];
     bool timer_isexp[n_gpio_pin];
     int timer_counter[n_gpio_pin];
@@ -109,6 +115,11 @@ private:
     int FindPinIndex(unsigned user_gpio);
     int InitPiModel();
     INDI::Timer timer[n_gpio_pin];
+    RpiGpioWave m_wave;
+    int m_wavePort { -1 };
+    bool StartWaveSequence(int id);
+    void FinishWaveSequence(int id, bool abort);
+    void EndTimerSequence(int id);
     void startTimer(int id, int msec); 
     void stopTimer(int id); 
 
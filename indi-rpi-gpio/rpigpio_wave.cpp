@@ -0,0 +1,142 @@
+/*******************************************************************************
+  Copyright(c) 2021 Ken Self <ken.kgself AT gmail DOT com>
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <rpigpio_wave.h>
+
+RpiGpioWave::~RpiGpioWave()
+{
+    stop();
+}
+
+std::vector<gpioPulse_t> RpiGpioWave::cyclePulses(unsigned gpio, bool activeHigh, uint32_t duration_us, uint32_t delay_us)
+{
+    const uint32_t mask = 1u << gpio;
+    const uint32_t on = activeHigh ? mask : 0;
+    const uint32_t off = activeHigh ? 0 : mask;
+
+    // Each exposure is preceded by its delay, as with the software timer
+    std::vector<gpioPulse_t> pulses(2);
+    pulses[0].gpioOn = off;
+    pulses[0].gpioOff = on;
+    pulses[0].usDelay = delay_us;
+    pulses[1].gpioOn = on;
+    pulses[1].gpioOff = off;
+    pulses[1].usDelay = duration_us;
+    return pulses;
+}
+
+std::vector<gpioPulse_t> RpiGpioWave::endPulses(unsigned gpio, bool activeHigh)
+{
+    const uint32_t mask = 1u << gpio;
+
+    std::vector<gpioPulse_t> pulses(1);
+    pulses[0].gpioOn = activeHigh ? 0 : mask;
+    pulses[0].gpioOff = activeHigh ? mask : 0;
+    pulses[0].usDelay = 1;
+    return pulses;
+}
+
+std::vector<char> RpiGpioWave::chain(int cycleWave, int endWave, uint32_t count)
+{
+    std::vector<char> buf;
+    if (count > 1)
+    {
+        // loop start, wave, loop repeat x + 256 * y times
+        buf.push_back(static_cast<char>(255));
+        buf.push_back(0);
+        buf.push_back(static_cast<char>(cycleWave));
+        buf.push_back(static_cast<char>(255));
+        buf.push_back(1);
+        buf.push_back(static_cast<char>(count & 0xff));
+        buf.push_back(static_cast<char>((count >> 8) & 0xff));
+    }
+    else
+    {
+        buf.push_back(static_cast<char>(cycleWave));
+    }
+    buf.push_back(static_cast<char>(endWave));
+    return buf;
+}
+
+int RpiGpioWave::createWave(const std::vector<gpioPulse_t> &pulses)
+{
+    wave_add_new(m_pi);
+    std::vector<gpioPulse_t> buf(pulses);
+    if (wave_add_generic(m_pi, buf.size(), buf.data()) < 0)
+        return -1;
+    return wave_create(m_pi);
+}
+
+bool RpiGpioWave::start(unsigned gpio, bool activeHigh, uint32_t duration_us, uint32_t delay_us, uint32_t count)
+{
+    stop();
+
+    if (m_pi < 0 || duration_us == 0 || count == 0 || count > max_chain_count)
+        return false;
+
+    // A single wave cannot be longer than pigpiod allows
+    int max_micros = wave_get_max_micros(m_pi);
+    if (max_micros <= 0 || static_cast<uint64_t>(duration_us) + delay_us > static_cast<uint64_t>(max_micros))
+        return false;
+
+    if (set_mode(m_pi, gpio, PI_OUTPUT) < 0)
+        return false;
+
+    m_cycleWave = createWave(cyclePulses(gpio, activeHigh, duration_us, delay_us));
+    m_endWave = createWave(endPulses(gpio, activeHigh));
+    if (m_cycleWave < 0 || m_endWave < 0)
+    {
+        deleteWaves();
+        return false;
+    }
+
+    std::vector<char> buf = chain(m_cycleWave, m_endWave, count);
+    if (wave_chain(m_pi, buf.data(), buf.size()) < 0)
+    {
+        deleteWaves();
+        return false;
+    }
+
+    m_totalMicros = (static_cast<uint64_t>(duration_us) + delay_us) * count;
+    return true;
+}
+
+bool RpiGpioWave::isBusy() const
+{
+    return isActive() && wave_tx_busy(m_pi) == 1;
+}
+
+void RpiGpioWave::stop()
+{
+    if (!isActive() && m_endWave < 0)
+        return;
+
+    wave_tx_stop(m_pi);
+    deleteWaves();
+}
+
+void RpiGpioWave::deleteWaves()
+{
+    if (m_cycleWave >= 0)
+        wave_delete(m_pi, m_cycleWave);
+    if (m_endWave >= 0)
+        wave_delete(m_pi, m_endWave);
+    m_cycleWave = -1;
+    m_endWave = -1;
+    m_totalMicros = 0;
+}
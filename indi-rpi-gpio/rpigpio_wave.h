@@ -0,0 +1,66 @@
+/*******************************************************************************
+  Copyright(c) 2021 Ken Self <ken.kgself AT gmail DOT com>
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#ifndef RPIGPIO_WAVE_H
+#define RPIGPIO_WAVE_H
+
+#include <stdint.h>
+#include <vector>
+#include <pigpiod_if2.h>
+
+// Timed pulse sequences played by pigpiod from DMA waves.
+// pigpiod transmits a single wave chain at a time, so one sequence may run at once.
+class RpiGpioWave
+{
+public:
+    explicit RpiGpioWave(int pi = -1) : m_pi(pi) {}
+    ~RpiGpioWave();
+
+    void setPi(int pi) { m_pi = pi; }
+
+    // Pulses for one delay/exposure cycle: idle for delay_us then active for duration_us
+    static std::vector<gpioPulse_t> cyclePulses(unsigned gpio, bool activeHigh, uint32_t duration_us, uint32_t delay_us);
+    // Pulse returning the pin to its idle level once the last exposure ends
+    static std::vector<gpioPulse_t> endPulses(unsigned gpio, bool activeHigh);
+    // Chain playing cycleWave count times followed by endWave
+    static std::vector<char> chain(int cycleWave, int endWave, uint32_t count);
+
+    // Build the waves and start transmitting. Returns false, leaving no wave behind,
+    // if the sequence cannot be hardware timed.
+    bool start(unsigned gpio, bool activeHigh, uint32_t duration_us, uint32_t delay_us, uint32_t count);
+    // True while the chain is still being transmitted
+    bool isBusy() const;
+    // Stop any transmission and release the waves
+    void stop();
+    bool isActive() const { return m_cycleWave >= 0; }
+    // Total length of the running sequence
+    uint64_t totalMicros() const { return m_totalMicros; }
+
+    static const uint32_t max_chain_count = 65535;
+
+private:
+    int createWave(const std::vector<gpioPulse_t> &pulses);
+    void deleteWaves();
+
+    int m_pi;
+    int m_cycleWave { -1 };
+    int m_endWave { -1 };
+    uint64_t m_totalMicros { 0 };
+};
+
+#endif
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include "rpigpio_wave.h"
+
+TEST(RpiGpioWave, cycle_active_high)
+{
+    auto pulses = RpiGpioWave::cyclePulses(17, true, 250000, 1000000);
+    ASSERT_EQ(pulses.size(), 2u);
+    // idle (low) for the delay, then high for the exposure
+    EXPECT_EQ(pulses[0].gpioOn, 0u);
+    EXPECT_EQ(pulses[0].gpioOff, 1u << 17);
+    EXPECT_EQ(pulses[0].usDelay, 1000000u);
+    EXPECT_EQ(pulses[1].gpioOn, 1u << 17);
+    EXPECT_EQ(pulses[1].gpioOff, 0u);
+    EXPECT_EQ(pulses[1].usDelay, 250000u);
+
+    auto end = RpiGpioWave::endPulses(17, true);
+    ASSERT_EQ(end.size(), 1u);
+    EXPECT_EQ(end[0].gpioOn, 0u);
+    EXPECT_EQ(end[0].gpioOff, 1u << 17);
+}
+
+TEST(RpiGpioWave, cycle_active_low)
+{
+    auto pulses = RpiGpioWave::cyclePulses(4, false, 500, 0);
+    ASSERT_EQ(pulses.size(), 2u);
+    EXPECT_EQ(pulses[0].gpioOn, 1u << 4);
+    EXPECT_EQ(pulses[0].gpioOff, 0u);
+    EXPECT_EQ(pulses[1].gpioOn, 0u);
+    EXPECT_EQ(pulses[1].gpioOff, 1u << 4);
+    EXPECT_EQ(pulses[1].usDelay, 500u);
+
+    auto end = RpiGpioWave::endPulses(4, false);
+    EXPECT_EQ(end[0].gpioOn, 1u << 4);
+    EXPECT_EQ(end[0].gpioOff, 0u);
+}
+
+TEST(RpiGpioWave, chain)
+{
+    auto single = RpiGpioWave::chain(3, 4, 1);
+    EXPECT_EQ(single, std::vector<char>({3, 4}));
+
+    auto looped = RpiGpioWave::chain(3, 4, 300);
+    std::vector<char> expected = {static_cast<char>(255), 0, 3, static_cast<char>(255), 1, 44, 1, 4};
+    EXPECT_EQ(looped, expected);
+}
+
+TEST(RpiGpioWave, start_and_stop)
+{
+    pigpiod_mock::reset();
+    RpiGpioWave wave(0);
+
+    ASSERT_TRUE(wave.start(18, true, 100000, 50000, 5));
+    EXPECT_TRUE(wave.isActive());
+    EXPECT_TRUE(wave.isBusy());
+    EXPECT_EQ(wave.totalMicros(), 750000u);
+
+    auto &state = pigpiod_mock::state();
+    ASSERT_EQ(state.waves.size(), 2u);
+    EXPECT_EQ(state.waves[0].size(), 2u);
+    EXPECT_EQ(state.waves[1].size(), 1u);
+    std::vector<char> expected = {static_cast<char>(255), 0, 0, static_cast<char>(255), 1, 5, 0, 1};
+    EXPECT_EQ(state.chain, expected);
+
+    wave.stop();
+    EXPECT_FALSE(wave.isActive());
+    EXPECT_EQ(state.stopped, 1);
+    EXPECT_EQ(state.deleted, std::vector<unsigned>({0, 1}));
+}
+
+TEST(RpiGpioWave, rejects_untimed)
+{
+    pigpiod_mock::reset();
+    pigpiod_mock::state().maxMicros = 1000000;
+    RpiGpioWave wave(0);
+
+    // zero length exposure
+    EXPECT_FALSE(wave.start(18, true, 0, 1000, 1));
+    // cycle longer than one wave may be
+    EXPECT_FALSE(wave.start(18, true, 900000, 200000, 1));
+    // not connected to pigpiod
+    RpiGpioWave unconnected;
+    EXPECT_FALSE(unconnected.start(18, true, 1000, 0, 1));
+
+    EXPECT_TRUE(pigpiod_mock::state().waves.empty());
+    EXPECT_FALSE(wave.isActive());
+}
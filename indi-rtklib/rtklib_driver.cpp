@@ -38,9 +38,11 @@
 #include <time.h>
 #include <string.h>
 #include <pthread.h>
+#include <atomic>
 
 #define MAX_RTKRCV_PARSES     50              // Read 50 streams before giving up
 #define MAX_TIMEOUT_COUNT   5               // Maximum timeout before auto-connect
+#define RTKRCV_TIMEOUT      3               // Seconds to wait for data before counting a timeout
 
 // We declare an auto pointer to GPSD.
 static std::unique_ptr<RTKLIB> rtkrcv(new RTKLIB());
@@ -101,26 +103,115 @@ bool RTKLIB::updateProperties()
     return true;
 }
 
+// Seconds elapsed on the monotonic clock since the solution was read
+static double solution_age(const struct timespec &received)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - received.tv_sec) + (now.tv_nsec - received.tv_nsec) / 1e9;
+}
+
 IPState RTKLIB::updateGPS()
 {
-    IPState rc = IPS_BUSY;
+    RTKFix fix = read_fix();
 
-    pthread_mutex_lock(&lock);
-    if (locationPending == false && timePending == false)
+    if (fix.fixStatus != lastFixStatus)
     {
-        rc = IPS_OK;
-        locationPending = true;
-        timePending = true;
+        lastFixStatus = fix.fixStatus;
+        switch (fix.fixStatus)
+        {
+            case status_fix:
+                GPSstatusTP.s = IPS_OK;
+                IUSaveText(&GPSstatusT[0], "FIX");
+                break;
+            case status_float:
+                GPSstatusTP.s = IPS_BUSY;
+                IUSaveText(&GPSstatusT[0], "FLOAT");
+                break;
+            case status_sbas:
+                GPSstatusTP.s = IPS_BUSY;
+                IUSaveText(&GPSstatusT[0], "SBAS");
+                break;
+            case status_dgps:
+                GPSstatusTP.s = IPS_BUSY;
+                IUSaveText(&GPSstatusT[0], "DGPS");
+                break;
+            case status_single:
+                GPSstatusTP.s = IPS_BUSY;
+                IUSaveText(&GPSstatusT[0], "SINGLE");
+                break;
+            case status_ppp:
+                GPSstatusTP.s = IPS_BUSY;
+                IUSaveText(&GPSstatusT[0], "PPP");
+                break;
+            case status_no_fix:
+                GPSstatusTP.s = IPS_ALERT;
+                IUSaveText(&GPSstatusT[0], "NO FIX");
+                break;
+            default:
+                GPSstatusTP.s = IPS_IDLE;
+                IUSaveText(&GPSstatusT[0], "UNKNOWN");
+                break;
+        }
+        IDSetText(&GPSstatusTP, nullptr);
     }
-    pthread_mutex_unlock(&lock);
 
-    return rc;
+    if (fix.updates == lastUpdate)
+        return IPS_BUSY;
+
+    lastUpdate = fix.updates;
+
+    LocationNP[LOCATION_LATITUDE].value  = fix.latitude;
+    LocationNP[LOCATION_LONGITUDE].value = fix.longitude;
+    LocationNP[LOCATION_ELEVATION].value = fix.elevation;
+
+    char ts[32] = {0};
+    struct tm *utc, *local;
+    // Report the GPS time as of now, not as of when the solution arrived
+    time_t raw_time = fix.time + static_cast<time_t>(solution_age(fix.received) + 0.5);
+
+    utc = gmtime(&raw_time);
+    strftime(ts, 32, "%Y-%m-%dT%H:%M:%S", utc);
+    TimeTP[0].setText(ts);
+
+    local = localtime(&raw_time);
+    snprintf(ts, 32, "%4.2f", (local->tm_gmtoff / 3600.0));
+    TimeTP[1].setText(ts);
+
+    return IPS_OK;
+}
+
+void RTKLIB::publish_fix()
+{
+    uint32_t sequence = fixSequence.load(std::memory_order_relaxed);
+    fixSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    publishedFix = pendingFix;
+    fixSequence.store(sequence + 2, std::memory_order_release);
+}
+
+RTKLIB::RTKFix RTKLIB::read_fix() const
+{
+    RTKFix fix;
+    uint32_t before, after;
+    do
+    {
+        before = fixSequence.load(std::memory_order_acquire);
+        fix = publishedFix;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = fixSequence.load(std::memory_order_relaxed);
+    }
+    while (before != after || (before & 1));
+
+    return fix;
 }
 
 bool RTKLIB::is_rtkrcv()
 {
     char line[RTKRCV_MAX_LENGTH];
 
+    rxLength = 0;
+
     int bytes_read = 0;
     int tty_rc = tty_nread_section(PortFD, line, RTKRCV_MAX_LENGTH, 0xC, 3, &bytes_read);
     if (tty_rc < 0)
@@ -139,16 +230,59 @@ void* RTKLIB::parse_rtkrcv_helper(void *obj)
     return nullptr;
 }
 
-void RTKLIB::parse_rtkrcv()
+int RTKLIB::read_solutions()
 {
-    static char ts[32] = {0};
+    int tty_rc = tty_timeout(PortFD, RTKRCV_TIMEOUT);
+    if (tty_rc != TTY_OK)
+        return tty_rc;
 
-    char line[RTKRCV_MAX_LENGTH];
+    // Timestamp the burst as soon as it is available, before any parsing
+    clock_gettime(CLOCK_MONOTONIC, &rxTime);
+
+    ssize_t bytes_read = read(PortFD, rxBuffer + rxLength, RX_BUFFER_SIZE - rxLength);
+    if (bytes_read < 0)
+        return TTY_READ_ERROR;
+    if (bytes_read == 0)
+    {
+        errno = ECONNRESET;
+        return TTY_READ_ERROR;
+    }
+
+    char *start = rxBuffer;
+    char *end = rxBuffer + rxLength + bytes_read;
+    char *eol;
+    bool updated = false;
+
+    while ((eol = static_cast<char *>(memchr(start, 0xC, end - start))) != nullptr)
+    {
+        *eol = '\0';
+        parse_solution(start);
+        updated = true;
+        start = eol + 1;
+    }
+
+    if (updated)
+        publish_fix();
+
+    rxLength = end - start;
+    // A full buffer without a single terminator is not an rtkrcv stream
+    if (rxLength == RX_BUFFER_SIZE)
+    {
+        rxLength = 0;
+        return TTY_OVERFLOW;
+    }
+    memmove(rxBuffer, start, rxLength);
+
+    return TTY_OK;
+}
+
+void RTKLIB::parse_rtkrcv()
+{
+    rxLength = 0;
 
     while (isConnected())
     {
-        int bytes_read = 0;
-        int tty_rc = tty_nread_section(PortFD, line, RTKRCV_MAX_LENGTH, 0xC, 3, &bytes_read);
+        int tty_rc = read_solutions();
         if (tty_rc < 0)
         {
             if (tty_rc == TTY_OVERFLOW)
@@ -160,17 +294,16 @@ void RTKLIB::parse_rtkrcv()
             }
             else
             {
-                char errmsg[MAXRBUF];
-                tty_error_msg(tty_rc, errmsg, MAXRBUF);
-                if (tty_rc == TTY_TIME_OUT || errno == ECONNREFUSED)
+                if (tty_rc == TTY_TIME_OUT || errno == ECONNREFUSED || errno == ECONNRESET)
                 {
-                    if (errno == ECONNREFUSED)
+                    if (errno == ECONNREFUSED || errno == ECONNRESET)
                     {
                         // sleep for 10 seconds
                         tcpConnection->Disconnect();
                         usleep(10 * 1e6);
                         tcpConnection->Connect();
                         PortFD = tcpConnection->getPortFD();
+                        rxLength = 0;
                     }
                     else if (timeoutCounter++ > MAX_TIMEOUT_COUNT)
                     {
@@ -182,84 +315,39 @@ void RTKLIB::parse_rtkrcv()
                         tcpConnection->Connect();
                         PortFD = tcpConnection->getPortFD();
                         timeoutCounter = 0;
+                        rxLength = 0;
                     }
                 }
                 continue;
             }
         }
-        line[bytes_read] = '\0';
-
-        LOGF_DEBUG("%s", line);
-        char flags;
-        char type;
-        double enu[3];
-        double timestamp;
-        rtkrcv_fix_status fix;
-        scansolution(line, &flags, &type, enu, &fix, &timestamp);
-        switch (fix)
-        {
-        case status_no_fix:
-            LOG_DEBUG("no fix");
-            break;
-        case status_float:
-            LOG_DEBUG("float fix");
-            break;
-        case status_sbas:
-            LOG_DEBUG("sbas fix");
-            break;
-        case status_dgps:
-            LOG_DEBUG("dgps fix");
-            break;
-        case status_single:
-            LOG_DEBUG("single fix");
-            break;
-        case status_ppp:
-            LOG_DEBUG("ppp fix");
-            break;
-        case status_unknown:
-            LOG_DEBUG("unknown fix status");
-            break;
-            case status_fix:
-            {
-                LocationNP[LOCATION_LATITUDE].value  = enu[0];
-                LocationNP[LOCATION_LONGITUDE].value = enu[1];
-                LocationNP[LOCATION_ELEVATION].value = enu[2];
-                if (LocationNP[LOCATION_LONGITUDE].value < 0)
-                    LocationNP[LOCATION_LONGITUDE].value += 360;
-
-                struct timespec timesp;
-                time_t raw_time;
-                struct tm *utc, *local;
-
-                timesp.tv_sec = (time_t)timestamp;
-                timesp.tv_nsec = (time_t)(timestamp*1000000000.0);
-
-                raw_time = timesp.tv_sec;
-                utc = gmtime(&raw_time);
-                strftime(ts, 32, "%Y-%m-%dT%H:%M:%S", utc);
-                TimeTP[0].setText(ts);
-
-                setSystemTime(raw_time);
-
-                local = localtime(&raw_time);
-                snprintf(ts, 32, "%4.2f", (local->tm_gmtoff / 3600.0));
-                TimeTP[1].setText(ts);
-
-                pthread_mutex_lock(&lock);
-                locationPending = false;
-                timePending = false;
-                LOG_DEBUG("Threaded Location and Time updates complete.");
-                pthread_mutex_unlock(&lock);
-                break;
-
-                default:
-                {
-                    LOG_DEBUG("solution is not parsed");
-                }
-                break;
-            }
-        }
     }
 
     pthread_exit(nullptr);
 }
+
+void RTKLIB::parse_solution(char *line)
+{
+    char flags;
+    char type;
+    double enu[3];
+    double timestamp;
+    rtkrcv_fix_status fix = status_unknown;
+    scansolution(line, &flags, &type, enu, &fix, &timestamp);
+
+    pendingFix.fixStatus = fix;
+    if (fix != status_fix)
+        return;
+
+    pendingFix.latitude  = enu[0];
+    pendingFix.longitude = enu[1];
+    pendingFix.elevation = enu[2];
+    if (pendingFix.longitude < 0)
+        pendingFix.longitude += 360;
+
+    pendingFix.time = static_cast<time_t>(timestamp);
+    pendingFix.received = rxTime;
+    pendingFix.updates++;
+
+    setSystemTime(pendingFix.time + static_cast<time_t>(solution_age(rxTime) + 0.5));
+}
@@ -26,6 +26,9 @@
 
 #include <indigps.h>
 
+#include <atomic>
+#include <time.h>
+
 class RTKLIB : public INDI::GPS
 {
   public:
@@ -45,14 +48,47 @@ class RTKLIB : public INDI::GPS
     virtual IPState updateGPS() override;
 
 private:
+    // Latest solution decoded by the rtkrcv thread, published to updateGPS through a seqlock
+    struct RTKFix
+    {
+        double latitude { 0 };
+        double longitude { 0 };
+        double elevation { 0 };
+        // GPS UTC time of the last fixed solution
+        time_t time { 0 };
+        // Local clock when the bytes carrying that solution were read
+        struct timespec received { 0, 0 };
+        // rtkrcv_fix_status of the last solution, 0 before the first one
+        int fixStatus { 0 };
+        uint32_t updates { 0 };
+    };
+
     Connection::TCP *tcpConnection { nullptr };
     bool is_rtkrcv();
     void parse_rtkrcv();
+    int read_solutions();
+    void parse_solution(char *line);
+    void publish_fix();
+    RTKFix read_fix() const;
 
     int PortFD { -1 };
     uint8_t timeoutCounter=0;
-    bool locationPending = true, timePending=true;
 
-    pthread_mutex_t lock;
+    // Receive buffer, several solutions are framed and parsed in place per read()
+    static constexpr size_t RX_BUFFER_SIZE = 4096;
+    char rxBuffer[RX_BUFFER_SIZE];
+    size_t rxLength { 0 };
+    struct timespec rxTime { 0, 0 };
+
+    // Working copy owned by the rtkrcv thread
+    RTKFix pendingFix;
+    // Published copy and its sequence counter, odd while a write is in progress
+    RTKFix publishedFix;
+    std::atomic<uint32_t> fixSequence { 0 };
+
+    // Last published state consumed by updateGPS
+    uint32_t lastUpdate { 0 };
+    int lastFixStatus { 0 };
+
     pthread_t rtkThread;
 };
@@ -69,14 +69,13 @@ bool HTTP::Connect()
 
     LOGF_INFO("Connecting to %s ...", baseurl);
 
-#if 0
-    if (m_Device->isSimulation() == false)
+    // Keep the client (and its keep-alive socket settings) across reconnects to the same mount
+    if (client == nullptr || clientURL != baseurl)
     {
+        delete client;
         client = new httplib::Client(baseurl);
+        clientURL = baseurl;
     }
-#else
-        client = new httplib::Client(baseurl);
-#endif
 
     bool rc = Handshake();
 
@@ -95,11 +94,16 @@ bool HTTP::Connect()
 
 bool HTTP::Disconnect()
 {
-    delete client;
-    client = nullptr;
+    if (client)
+        client->stop();
     return true;
 }
 
+HTTP::~HTTP()
+{
+    delete client;
+}
+
 void HTTP::Activated()
 {
     m_Device->defineProperty(&AddressTP);
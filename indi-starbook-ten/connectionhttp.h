@@ -32,7 +32,7 @@ class HTTP : public Interface
 {
   public:
     HTTP(INDI::DefaultDevice *dev);
-    virtual ~HTTP() = default;
+    virtual ~HTTP();
 
     virtual bool Connect() override;
 
@@ -59,6 +59,7 @@ class HTTP : public Interface
     ITextVectorProperty AddressTP;
     IText AddressT[1] {};
 
-    httplib::Client *client;
+    httplib::Client *client {nullptr};
+    std::string clientURL;
 };
 }
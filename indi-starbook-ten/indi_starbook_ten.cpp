@@ -264,7 +264,7 @@ INDIStarbookTen::ISNewSwitch(const char *dev, const char *name, ISState *states,
 bool
 INDIStarbookTen::Handshake() {
     auto http = httpConnection->getClient();
-    starbook->setHttpClient(http);
+    starbook->setHttpClient(http, httpConnection->host());
 
     try {
         starbook->getFirmwareVersion();
@@ -277,6 +277,14 @@ INDIStarbookTen::Handshake() {
 }
 
 
+bool
+INDIStarbookTen::Disconnect() {
+    // No status request may outlive the connection it was sent on
+    starbook->stopPollClients();
+    return INDI::Telescope::Disconnect();
+}
+
+
 bool
 INDIStarbookTen::updateStarbookState(StarbookTen::MountStatus& stat) {
     IUSaveText(&StateT[MS_STATE],
@@ -335,8 +343,10 @@ INDIStarbookTen::fetchStartupInfo() {
 bool
 INDIStarbookTen::ReadScopeStatus() {
     try {
-        auto stat = retry<StarbookTen::MountStatus>(2, &StarbookTen::getStatus, starbook);
-        bool isTracking = retry<bool>(2, &StarbookTen::isTracking, starbook);
+        bool guiding = isPropGuidingRA || isPropGuidingDE;
+        auto poll = retry<StarbookTen::PollStatus>(2, &StarbookTen::getPollStatus, starbook, guiding);
+        auto &stat = poll.status;
+        bool isTracking = poll.tracking;
 
         updateStarbookState(stat);
 
@@ -364,11 +374,11 @@ INDIStarbookTen::ReadScopeStatus() {
 
         NewRaDec(stat.ra, stat.dec);
 
-        auto ps = retry<StarbookTen::PierSide>(2, &StarbookTen::getPierSide, starbook);
+        auto ps = poll.pierside;
         setPierSide((ps == StarbookTen::PIERSIDE_EAST) ? INDI::Telescope::PIER_EAST : INDI::Telescope::PIER_WEST);
 
-        if (isPropGuidingRA || isPropGuidingDE) {
-            auto gs = retry<std::tuple<bool,bool> >(2, &StarbookTen::getGuidingRaDec, starbook);
+        if (guiding) {
+            auto &gs = poll.guiding;
             LOGF_DEBUG("Prop guiding status: RA=%d, DEC=%d", !!(std::get<0>(gs)), !!(std::get<1>(gs)));
             if (isPropGuidingRA && !std::get<0>(gs)) {
                 LOG_DEBUG("Prop guiding in RA finished");
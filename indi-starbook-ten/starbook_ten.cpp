@@ -1,5 +1,6 @@
 #include <regex>
 #include <cmath>
+#include <future>
 #include <stdio.h>
 #include "starbook_ten.h"
 
@@ -10,14 +11,8 @@ StarbookTen::StarbookTen(httplib::Client *http) : http(http) {
 
 StarbookTen::StarbookTen(const char *base_url) {
     http = new httplib::Client(base_url);
-
-    http->set_connection_timeout(2, 0);
-    http->set_read_timeout(3, 0);
-    http->set_write_timeout(3, 0);
-
-    http->set_keep_alive(true);
-
-    http->set_url_encode(false);
+    configureClient(http);
+    createPollClients(base_url);
 
     destroyClient = true;
 }
@@ -30,19 +25,57 @@ StarbookTen::~StarbookTen() {
 
 
 void
-StarbookTen::setHttpClient(httplib::Client *http) {
+StarbookTen::setHttpClient(httplib::Client *http, const char *base_url) {
     if (http) {
-        http->set_connection_timeout(2, 0);
-        http->set_read_timeout(3, 0);
-        http->set_write_timeout(3, 0);
-
-        http->set_keep_alive(true);
-
-        http->set_url_encode(false);
+        configureClient(http);
     }
 
     this->http = http;
     destroyClient = false;
+
+    stopPollClients();
+    if (http && base_url) {
+        createPollClients(base_url);
+    }
+
+    // A new client may well be a different mount
+    hasVersion = false;
+}
+
+
+void
+StarbookTen::configureClient(httplib::Client *client) {
+    // Keep-alive with a fixed budget: one stalled request must not hold up the poll for long
+    client->set_connection_timeout(2, 0);
+    client->set_read_timeout(3, 0);
+    client->set_write_timeout(3, 0);
+
+    client->set_keep_alive(true);
+
+    client->set_url_encode(false);
+}
+
+
+void
+StarbookTen::createPollClients(const char *base_url) {
+    // httplib clients are not safe to share between threads, so each concurrent
+    // status query gets its own persistent connection.
+    for (size_t i = 0; i < POLL_CLIENTS; i++) {
+        pollClients.emplace_back(new httplib::Client(base_url));
+        configureClient(pollClients.back().get());
+    }
+}
+
+
+std::string
+StarbookTen::fetch(httplib::Client *client, const char *path) {
+    auto res = client->Get(path);
+
+    if (!res || res->status != 200) {
+        throw std::runtime_error("HTTP get failed");
+    }
+
+    return res->body;
 }
 
 
@@ -64,6 +97,10 @@ StarbookTen::sendBasicCmd(const char *cmd) {
 
 std::tuple<int,int>
 StarbookTen::getFirmwareVersion() {
+    if (hasVersion) {
+        return version;
+    }
+
     auto res = http->Get("/version");
 
     if (!res || res->status != 200) {
@@ -77,7 +114,9 @@ StarbookTen::getFirmwareVersion() {
         int vmaj = std::stoi(sm[1]);
         int vmin = std::stoi(sm[2]);
 
-        return std::tuple<int,int>(vmaj, vmin);
+        version = std::tuple<int,int>(vmaj, vmin);
+        hasVersion = true;
+        return version;
     } else {
         throw std::runtime_error("Could not get version");
     }
@@ -86,16 +125,16 @@ StarbookTen::getFirmwareVersion() {
 
 StarbookTen::PierSide
 StarbookTen::getPierSide() {
-    auto res = http->Get("/get_pierside");
+    return parsePierSide(fetch(http, "/get_pierside"));
+}
 
-    if (!res || res->status != 200) {
-        throw std::runtime_error("HTTP get failed");
-    }
 
+StarbookTen::PierSide
+StarbookTen::parsePierSide(const std::string& body) {
     std::regex r(R"(PIERSIDE=([01]))");
     std::smatch sm;
 
-    if (std::regex_search(res->body, sm, r)) {
+    if (std::regex_search(body, sm, r)) {
         return static_cast<StarbookTen::PierSide>(std::stoi(sm[1]));
     } else {
         throw std::runtime_error("Could not get pier side");
@@ -275,16 +314,16 @@ StarbookTen::setCoordType(CoordType ct) {
 
 StarbookTen::MountStatus
 StarbookTen::getStatus() {
-    auto res = http->Get("/getstatus2");
+    return parseStatus(fetch(http, "/getstatus2"));
+}
 
-    if (!res || res->status != 200) {
-        throw std::runtime_error("HTTP get failed");
-    }
 
+StarbookTen::MountStatus
+StarbookTen::parseStatus(const std::string& body) {
     std::regex r(R"(<!--RA=(\-?\d+\.\d+)&DEC=(\-?\d+\.\d+)&GOTO=([01])&STATE=([A-Z]+)-->)");
     std::smatch sm;
 
-    if (std::regex_search(res->body, sm, r)) {
+    if (std::regex_search(body, sm, r)) {
         MountStatus stat;
 
         stat.ra = std::stod(sm[1]);
@@ -303,18 +342,18 @@ StarbookTen::getStatus() {
 
 bool
 StarbookTen::isTracking() {
-    auto res = http->Get("/gettrackstatus");
+    return parseTracking(fetch(http, "/gettrackstatus"));
+}
 
-    if (!res || res->status != 200) {
-        throw std::runtime_error("HTTP get failed");
-    }
 
+bool
+StarbookTen::parseTracking(const std::string& body) {
     // TRACK=2 seems to be used during gotos, but since we can already figure
     // gotos out from the getstatus2 call, there's no need to handle it here.
     std::regex r(R"(<!--TRACK=([012])-->)");
     std::smatch sm;
 
-    if (std::regex_search(res->body, sm, r)) {
+    if (std::regex_search(body, sm, r)) {
         return !(sm[1].compare("1"));
     } else {
         throw std::runtime_error("Could not get track status");
@@ -324,16 +363,16 @@ StarbookTen::isTracking() {
 
 std::tuple<bool,bool>
 StarbookTen::getGuidingRaDec() {
-    auto res = http->Get("/getguidestatus");
+    return parseGuiding(fetch(http, "/getguidestatus"));
+}
 
-    if (!res || res->status != 200) {
-        throw std::runtime_error("HTTP get failed");
-    }
 
+std::tuple<bool,bool>
+StarbookTen::parseGuiding(const std::string& body) {
     std::regex r(R"(<!--RA\+=([01])&RA\-=([01])&DEC\+=([01])&DEC\-=([01])-->)");
     std::smatch sm;
 
-    if (std::regex_search(res->body, sm, r)) {
+    if (std::regex_search(body, sm, r)) {
         return std::tuple<bool,bool>((!(sm[1].compare("1")) || !(sm[2].compare("1"))),
                                      (!(sm[3].compare("1")) || !(sm[4].compare("1"))));
     } else {
@@ -342,6 +381,80 @@ StarbookTen::getGuidingRaDec() {
 }
 
 
+StarbookTen::PollStatus
+StarbookTen::getPollStatus(bool guiding) {
+    std::lock_guard<std::mutex> lock(pollMutex);
+    PollStatus poll;
+
+    // The firmware has no combined query, so the per-poll GETs go out in
+    // parallel on their own connections and the poll costs one round trip.
+    if (pollClients.size() < POLL_CLIENTS) {
+        poll.status = getStatus();
+        poll.tracking = isTracking();
+        poll.pierside = getPierSide();
+        poll.guiding = guiding ? getGuidingRaDec() : std::tuple<bool,bool>(false, false);
+        return poll;
+    }
+
+    auto tracking = std::async(std::launch::async, [this]() {
+        return parseTracking(fetch(pollClients[0].get(), "/gettrackstatus"));
+    });
+    auto pierside = std::async(std::launch::async, [this]() {
+        return parsePierSide(fetch(pollClients[1].get(), "/get_pierside"));
+    });
+    std::future<std::tuple<bool,bool> > guide;
+    if (guiding) {
+        guide = std::async(std::launch::async, [this]() {
+            return parseGuiding(fetch(pollClients[2].get(), "/getguidestatus"));
+        });
+    }
+
+    // Collect every future before rethrowing so no request outlives this call
+    std::exception_ptr error;
+    try {
+        poll.status = getStatus();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    try {
+        poll.tracking = tracking.get();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    try {
+        poll.pierside = pierside.get();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    poll.guiding = std::tuple<bool,bool>(false, false);
+    if (guiding) {
+        try {
+            poll.guiding = guide.get();
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    return poll;
+}
+
+
+void
+StarbookTen::stopPollClients() {
+    // Break off requests still in flight, then wait for the poll to collect them
+    for (auto &client : pollClients) {
+        client->stop();
+    }
+
+    std::lock_guard<std::mutex> lock(pollMutex);
+    pollClients.clear();
+}
+
+
 std::tuple<double,double>
 StarbookTen::getRaDec() {
     auto stat = getStatus();
@@ -1,7 +1,11 @@
 #ifndef _STARBOOK_TEN_H_
 #define _STARBOOK_TEN_H_
 
+#include <memory>
+#include <mutex>
 #include <string>
+#include <tuple>
+#include <vector>
 #include <libnova/julian_day.h>
 #include <libnova/utility.h>
 #include "httplib.h"
@@ -12,6 +16,20 @@ class StarbookTen {
 private:
     httplib::Client *http;
 
+    // Extra keep-alive connections for the concurrent status poll
+    static const size_t POLL_CLIENTS = 3;
+    std::vector<std::unique_ptr<httplib::Client> > pollClients;
+    // Held by getPollStatus() until every concurrent request has been collected
+    std::mutex pollMutex;
+
+    // Firmware version never changes while connected
+    std::tuple<int,int> version;
+    bool hasVersion = false;
+
+    void configureClient(httplib::Client *client);
+    void createPollClients(const char *base_url);
+    std::string fetch(httplib::Client *client, const char *path);
+
     bool sendBasicCmd(const char *cmd);
     std::string sxfmt(double x);
 
@@ -52,6 +70,13 @@ public:
         State  state;
     };
 
+    struct PollStatus {
+        MountStatus          status;
+        bool                 tracking;
+        PierSide             pierside;
+        std::tuple<bool,bool> guiding;
+    };
+
     static const double slewRates[];
 
     StarbookTen(httplib::Client *http);
@@ -60,7 +85,7 @@ public:
 
     bool destroyClient;
 
-    void setHttpClient(httplib::Client *http);
+    void setHttpClient(httplib::Client *http, const char *base_url = nullptr);
 
     std::tuple<int,int> getFirmwareVersion();
 
@@ -83,6 +108,14 @@ public:
 
     std::tuple<double,double> getRaDec();
 
+    PollStatus getPollStatus(bool guiding);
+    void stopPollClients();
+
+    static MountStatus parseStatus(const std::string& body);
+    static bool parseTracking(const std::string& body);
+    static PierSide parsePierSide(const std::string& body);
+    static std::tuple<bool,bool> parseGuiding(const std::string& body);
+
     bool setPulseRate(int ra_arcsec_per_sec, int dec_arcsec_per_sec);
     bool movePulse(GuideDirection dir, uint32_t ms);
 
@@ -31,23 +31,11 @@ namespace starbook
 
 CommandInterface::CommandInterface(Connection::Curl *new_connection) : connection(new_connection) {}
 
-static std::string read_buffer;
-
-static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp)
-{
-    INDI_UNUSED(userp);
-    size_t real_size = size * nmemb;
-    read_buffer.append(static_cast<char *>(contents), real_size);
-    return real_size;
-}
-
 CommandResponse CommandInterface::SendCommand(const std::string &cmd)
 {
-    CURLcode rc;
-    CURL *handle = connection->getHandle();
+    std::string read_buffer;
 
     last_response.clear();
-    read_buffer.clear();
     std::ostringstream cmd_url;
 
     cmd_url << "http://" << connection->host() << ":" << connection->port() << "/" << cmd;
@@ -55,13 +43,7 @@ CommandResponse CommandInterface::SendCommand(const std::string &cmd)
 
     DEBUGFDEVICE(m_Device.c_str(), INDI::Logger::DBG_DEBUG, "CMD <%s>", last_cmd_url.c_str());
 
-    curl_easy_setopt(handle, CURLOPT_USERAGENT, "curl/7.58.0");
-    /* send all data to this function  */
-    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(handle, CURLOPT_WRITEDATA, &read_buffer);
-    curl_easy_setopt(handle, CURLOPT_URL, cmd_url.str().c_str());
-
-    rc = curl_easy_perform(handle);
+    CURLcode rc = connection->perform(last_cmd_url, read_buffer);
 
     if (rc != CURLE_OK)
     {
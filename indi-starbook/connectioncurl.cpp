@@ -24,6 +24,12 @@
 #include <cstring>
 
 namespace Connection {
+    static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp) {
+        size_t real_size = size * nmemb;
+        static_cast<std::string *>(userp)->append(static_cast<char *>(contents), real_size);
+        return real_size;
+    }
+
     Curl::Curl(INDI::DefaultDevice *dev) : Interface(dev, CONNECTION_CUSTOM) {
         curl_global_init(CURL_GLOBAL_ALL);
 
@@ -74,13 +80,30 @@ namespace Connection {
         return rc;
     }
 
-    void Curl::SetupHandle() const {
+    void Curl::SetupHandle() {
+        // everything but the URL is set once per connection
+        curl_easy_setopt(handle, CURLOPT_USERAGENT, "curl/7.58.0");
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &response);
         curl_easy_setopt(handle, CURLOPT_TIMEOUT, HANDLE_TIMEOUT);
+        curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, HANDLE_TIMEOUT);
         curl_easy_setopt(handle, CURLOPT_NOPROGRESS, 1L);
+        // reuse the mount connection between polls instead of reconnecting for every command
+        curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(handle, CURLOPT_FORBID_REUSE, 0L);
         // if debug
 //        curl_easy_setopt(handle, CURLOPT_VERBOSE, 0);
     }
 
+    CURLcode Curl::perform(const std::string &url, std::string &body) {
+        CURL *h = getHandle();
+        response.clear();
+        curl_easy_setopt(h, CURLOPT_URL, url.c_str());
+        CURLcode rc = curl_easy_perform(h);
+        body.swap(response);
+        return rc;
+    }
+
     bool Curl::Disconnect() {
         curl_easy_cleanup(handle);
         handle = nullptr;
@@ -64,6 +64,9 @@ namespace Connection {
             return handle;
         }
 
+        /** Fetch url over the handle kept for the whole connection, so its socket is reused */
+        CURLcode perform(const std::string &url, std::string &body);
+
     protected:
         ITextVectorProperty AddressTP;
         IText AddressT[2]{};
@@ -71,8 +74,9 @@ namespace Connection {
         const unsigned long HANDLE_TIMEOUT = 2;
 
         CURL *handle = nullptr;
+        std::string response;
 
-        void SetupHandle() const;
+        void SetupHandle();
     };
 
 }
@@ -23,7 +23,9 @@
  */
 
 #include <memory>
+#include <chrono>
 #include <deque>
+#include <cstring>
 #include <time.h>
 #include <math.h>
 #include <unistd.h>
@@ -159,6 +161,9 @@ bool SVBONYCCD::updateProperties()
         // stretch factor
         defineProperty(&StretchSP);
 
+        // streaming statistics
+        defineProperty(&StreamStatsNP);
+
         timerID = SetTimer(getCurrentPollingPeriod());
     }
     else
@@ -188,6 +193,9 @@ bool SVBONYCCD::updateProperties()
 
         // stretch factor
         deleteProperty(StretchSP.name);
+
+        // streaming statistics
+        deleteProperty(StreamStatsNP.name);
     }
 
     return true;
@@ -502,6 +510,13 @@ bool SVBONYCCD::Connect()
         return false;
     }
 
+    // streaming statistics
+    IUFillNumber(&StreamStatsN[STATS_DELIVERED], "STATS_DELIVERED", "Delivered frames", "%.f", 0, UINT32_MAX, 1, 0);
+    IUFillNumber(&StreamStatsN[STATS_DROPPED], "STATS_DROPPED", "Dropped frames", "%.f", 0, UINT32_MAX, 1, 0);
+    IUFillNumber(&StreamStatsN[STATS_LATE], "STATS_LATE", "Late frames", "%.f", 0, UINT32_MAX, 1, 0);
+    IUFillNumberVector(&StreamStatsNP, StreamStatsN, 3, getDeviceName(), "STREAM_STATS", "Stream stats", MAIN_CONTROL_TAB,
+                       IP_RO, 60, IPS_IDLE);
+
     // set frame format and feed UI
     nFrameFormat = 0;
     // initialize frameFormatDefinitions from cameraProperty
@@ -665,9 +680,11 @@ bool SVBONYCCD::Connect()
     // set CCD up
     updateCCDParams();
 
-    // create streaming thread
+    // create streaming threads
     terminateThread = false;
+    streamFrames.reset(PrimaryCCD.getFrameBufferSize());
     pthread_create(&primary_thread, nullptr, &streamVideoHelper, this);
+    pthread_create(&deliver_thread, nullptr, &deliverVideoHelper, this);
 
     /* Success! */
     LOG_INFO("CCD is online. Retrieving basic data.\n");
@@ -685,6 +702,10 @@ bool SVBONYCCD::Disconnect()
     pthread_cond_signal(&cv);
     pthread_mutex_unlock(&condMutex);
 
+    // wait for the delivery thread to hand back its frame
+    streamFrames.close();
+    pthread_join(deliver_thread, nullptr);
+
     //pthread_mutex_lock(&cameraID_mutex); // *1
 
     // stop camera
@@ -962,6 +983,16 @@ bool SVBONYCCD::StartStreaming()
 
     pthread_mutex_unlock(&cameraID_mutex);
 
+    // frame pool and statistics
+    // frames still held by the capture or delivery thread come back to the pool on their own
+    streamFrames.open(PrimaryCCD.getFrameBufferSize());
+    framesDelivered = 0;
+    framesLate = 0;
+    updateStreamStats();
+
+    // anchor capture timestamps
+    streamClock.start();
+
     pthread_mutex_lock(&condMutex);
     streaming = true;
     pthread_cond_signal(&cv);
@@ -1025,6 +1056,11 @@ bool SVBONYCCD::StopStreaming()
     pthread_cond_signal(&cv);
     pthread_mutex_unlock(&condMutex);
 
+    // drop frames not yet delivered
+    streamFrames.flush();
+
+    updateStreamStats();
+
     LOG_INFO("Streaming stopped\n");
 
     return true;
@@ -1039,10 +1075,35 @@ void* SVBONYCCD::streamVideoHelper(void * context)
 
 
 //
+void* SVBONYCCD::deliverVideoHelper(void * context)
+{
+    return static_cast<SVBONYCCD *>(context)->deliverVideo();
+}
+
+
+//
+void SVBONYCCD::updateStreamStats()
+{
+    uint32_t delivered = framesDelivered, dropped = streamFrames.dropped(), late = framesLate;
+
+    if(StreamStatsN[STATS_DELIVERED].value == delivered && StreamStatsN[STATS_DROPPED].value == dropped
+            && StreamStatsN[STATS_LATE].value == late)
+        return;
+
+    StreamStatsN[STATS_DELIVERED].value = delivered;
+    StreamStatsN[STATS_DROPPED].value = dropped;
+    StreamStatsN[STATS_LATE].value = late;
+    StreamStatsNP.s = (dropped > 0 || late > 0) ? IPS_BUSY : IPS_OK;
+    IDSetNumber(&StreamStatsNP, nullptr);
+}
+
+
+// capture thread : dequeue frames from the camera into the frame pool
 void* SVBONYCCD::streamVideo()
 {
-    auto start = std::chrono::high_resolution_clock::now();
-    auto finish = std::chrono::high_resolution_clock::now();
+    auto start = std::chrono::steady_clock::now();
+    auto finish = std::chrono::steady_clock::now();
+    auto lastCapture = std::chrono::steady_clock::time_point();
 
     while (true)
     {
@@ -1053,6 +1114,7 @@ void* SVBONYCCD::streamVideo()
             pthread_cond_wait(&cv, &condMutex);
             // ???
             ExposureRequest = 1.0 / Streamer->getTargetFPS();
+            lastCapture = std::chrono::steady_clock::time_point();
         }
 
         pthread_mutex_unlock(&condMutex);
@@ -1060,40 +1122,87 @@ void* SVBONYCCD::streamVideo()
         if (terminateThread)
             break;
 
-        unsigned char* imageBuffer = PrimaryCCD.getFrameBuffer();
+        StreamFrame *frame = streamFrames.acquire();
+        if(frame == nullptr)
+        {
+            // delivery thread holds every frame
+            usleep(1000);
+            continue;
+        }
 
         pthread_mutex_lock(&cameraID_mutex);
 
         // get the frame
-        status = SVBGetVideoData(cameraID, imageBuffer, PrimaryCCD.getFrameBufferSize(), 1000 );
+        status = SVBGetVideoData(cameraID, frame->data.data(), frame->data.size(), 1000 );
 
         pthread_mutex_unlock(&cameraID_mutex);
 
-        finish = std::chrono::high_resolution_clock::now();
+        finish = std::chrono::steady_clock::now();
+
+        if(status != SVB_SUCCESS)
+        {
+            streamFrames.release(frame);
+            continue;
+        }
+
+        // a frame is late when it arrives more than one and a half frame period after the previous one
+        if(lastCapture != std::chrono::steady_clock::time_point())
+        {
+            std::chrono::duration<double> interval = finish - lastCapture;
+            if(interval.count() > 1.5 * ExposureRequest)
+                framesLate++;
+        }
+        lastCapture = finish;
+
+        frame->timestamp = streamClock.timestamp(finish);
+        streamFrames.publish(frame);
+
+        std::chrono::duration<double> elapsed = finish - start;
+        if (elapsed.count() < ExposureRequest)
+            usleep(fabs(ExposureRequest - elapsed.count()) * 1e6);
+
+        start = std::chrono::steady_clock::now();
+    }
+
+    return nullptr;
+}
+
+
+// delivery thread : stretch, bin and send captured frames to the streamer
+void* SVBONYCCD::deliverVideo()
+{
+    while (StreamFrame *frame = streamFrames.wait())
+    {
+        uint32_t rawSize = PrimaryCCD.getSubW() * PrimaryCCD.getSubH() * bitDepth / 8;
 
         // stretching 12bits depth to 16bits depth
         if(bitDepth == 16 && (bitStretch != 0))
         {
-            u_int16_t* tmp = (u_int16_t*)imageBuffer;
-            for(int i = 0; i < PrimaryCCD.getFrameBufferSize() / 2; i++)
+            u_int16_t* tmp = (u_int16_t*)frame->data.data();
+            for(uint32_t i = 0; i < rawSize / 2; i++)
             {
                 tmp[i] <<= bitStretch;
             }
         }
 
+        uint32_t size = PrimaryCCD.getSubW() / PrimaryCCD.getBinX() * PrimaryCCD.getSubH() / PrimaryCCD.getBinY() * bitDepth / 8;
+
         if(binning)
         {
+            // software binning works in place on the primary CCD buffer
+            std::unique_lock<std::mutex> guard(ccdBufferLock);
+            memcpy(PrimaryCCD.getFrameBuffer(), frame->data.data(), rawSize);
             PrimaryCCD.binFrame();
+            Streamer->newFrame(PrimaryCCD.getFrameBuffer(), size, frame->timestamp);
+        }
+        else
+        {
+            Streamer->newFrame(frame->data.data(), size, frame->timestamp);
         }
 
-        uint32_t size = PrimaryCCD.getSubW() / PrimaryCCD.getBinX() * PrimaryCCD.getSubH() / PrimaryCCD.getBinY() * bitDepth / 8;
-        Streamer->newFrame(PrimaryCCD.getFrameBuffer(), size);
-
-        std::chrono::duration<double> elapsed = finish - start;
-        if (elapsed.count() < ExposureRequest)
-            usleep(fabs(ExposureRequest - elapsed.count()) * 1e6);
+        framesDelivered++;
 
-        start = std::chrono::high_resolution_clock::now();
+        streamFrames.release(frame);
     }
 
     return nullptr;
@@ -1291,6 +1400,9 @@ void SVBONYCCD::TimerHit()
     }
 
 
+    if (streaming)
+        updateStreamStats();
+
     if (HasCooler())
     {
         SVB_ERROR_CODE ret;
@@ -27,8 +27,11 @@
 
 #include <indiccd.h>
 #include <iostream>
+#include <atomic>
+#include <vector>
 
 #include "libsvbony/SVBCameraSDK.h"
+#include "framering.h"
 
 // WORKAROUND for bug #655
 // If defined following symbol, get buffered image data before calling StartExposure()
@@ -67,6 +70,8 @@ class SVBONYCCD : public INDI::CCD
         virtual bool StopStreaming() override;
         static void* streamVideoHelper(void *context);
         void* streamVideo();
+        static void* deliverVideoHelper(void *context);
+        void* deliverVideo();
 
         // subframe
         virtual bool UpdateCCDFrame(int x, int y, int w, int h) override;
@@ -138,6 +143,30 @@ class SVBONYCCD : public INDI::CCD
         pthread_t primary_thread;
         bool terminateThread;
 
+        // streaming frame pool
+        // streamVideo() captures into a free frame and queues it, deliverVideo()
+        // stretches, bins and hands it to the streamer, then gives it back.
+        // When the consumer lags, the oldest queued frame is dropped.
+        typedef struct streamFrame
+        {
+            std::vector<uint8_t> data;
+            uint64_t timestamp; // capture time in us since SER epoch
+        } StreamFrame;
+        static constexpr int STREAM_POOL_SIZE = 4;
+        FrameRing::Ring<StreamFrame, STREAM_POOL_SIZE> streamFrames;
+        pthread_t deliver_thread;
+
+        // capture timestamps : monotonic clock anchored to UTC at stream start
+        FrameRing::Clock streamClock;
+
+        // streaming statistics, dropped frames are counted by streamFrames
+        std::atomic<uint32_t> framesDelivered { 0 };
+        std::atomic<uint32_t> framesLate { 0 };
+        INumber StreamStatsN[3];
+        INumberVectorProperty StreamStatsNP;
+        enum { STATS_DELIVERED, STATS_DROPPED, STATS_LATE };
+        void updateStreamStats();
+
         // for cooling control
         double TemperatureRequest;
 
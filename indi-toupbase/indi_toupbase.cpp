@@ -70,6 +70,7 @@ ToupBase::ToupBase(const XP(DeviceV2) *instance) : m_Instance(instance)
 
 ToupBase::~ToupBase()
 {
+    stopStreamThread();
     delete[] m_FanS;
     delete[] m_HeatS;
 }
@@ -303,6 +304,8 @@ bool ToupBase::initProperties()
     PrimaryCCD.setMinMaxStep("CCD_BINNING", "HOR_BIN", 1, 4, 1, false);
     PrimaryCCD.setMinMaxStep("CCD_BINNING", "VER_BIN", 1, 4, 1, false);
 
+    m_Calibration.initProperties(IMAGE_SETTINGS_TAB);
+
     addAuxControls();
 
     return true;
@@ -371,6 +374,8 @@ bool ToupBase::updateProperties()
         defineProperty(&m_LevelRangeNP);
         defineProperty(&m_BlackLevelNP);
 
+        m_Calibration.updateProperties(true);
+
         // Firmware
         defineProperty(&m_CameraTP);
         defineProperty(&m_SDKVersionTP);
@@ -417,6 +422,7 @@ bool ToupBase::updateProperties()
         deleteProperty(m_BBAutoSP.name);
         deleteProperty(m_LevelRangeNP.name);
         deleteProperty(m_BlackLevelNP.name);
+        m_Calibration.updateProperties(false);
 
         deleteProperty(m_CameraTP.name);
         deleteProperty(m_SDKVersionTP.name);
@@ -466,6 +472,7 @@ bool ToupBase::Disconnect()
 {
     stopTimerNS();
     stopTimerWE();
+    stopStreamThread();
 
     FP(Close(m_Handle));
 
@@ -986,6 +993,9 @@ bool ToupBase::ISNewSwitch(const char *dev, const char *name, ISState *states, c
 {
     if (dev != nullptr && !strcmp(dev, getDeviceName()))
     {
+        if (m_Calibration.ISNewSwitch(dev, name, states, names, n))
+            return true;
+
         //////////////////////////////////////////////////////////////////////
         /// Binning
         //////////////////////////////////////////////////////////////////////
@@ -1219,6 +1229,14 @@ bool ToupBase::ISNewSwitch(const char *dev, const char *name, ISState *states, c
     return INDI::CCD::ISNewSwitch(dev, name, states, names, n);
 }
 
+bool ToupBase::ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n)
+{
+    if (m_Calibration.ISNewText(dev, name, texts, names, n))
+        return true;
+
+    return INDI::CCD::ISNewText(dev, name, texts, names, n);
+}
+
 bool ToupBase::StartStreaming()
 {
     const uint32_t uSecs = static_cast<uint32_t>(1000000.0f / Streamer->getTargetFPS());
@@ -1237,11 +1255,15 @@ bool ToupBase::StartStreaming()
     }
     m_CurrentTriggerMode = TRIGGER_VIDEO;
 
+    startStreamThread();
+
     return true;
 }
 
 bool ToupBase::StopStreaming()
 {
+    stopStreamThread();
+
     HRESULT rc = FP(put_Option(m_Handle, CP(OPTION_TRIGGER), 1));
     if (FAILED(rc))
     {
@@ -1252,6 +1274,78 @@ bool ToupBase::StopStreaming()
     return true;
 }
 
+void ToupBase::startStreamThread()
+{
+    stopStreamThread();
+
+    m_StreamSlots.open(PrimaryCCD.getFrameBufferSize());
+    m_StreamThread = std::thread(&ToupBase::streamThreadEntry, this);
+}
+
+void ToupBase::stopStreamThread()
+{
+    if (m_StreamSlots.close() && m_StreamSlots.dropped() > 0)
+        LOGF_DEBUG("Dropped %u frames while streaming.", m_StreamSlots.dropped());
+
+    // The streamer may stop streaming from within newFrame on the stream thread itself.
+    // The thread then leaves its loop once newFrame returns, and the next start,
+    // Disconnect or the destructor joins it.
+    if (m_StreamThread.get_id() == std::this_thread::get_id())
+        return;
+
+    if (m_StreamThread.joinable())
+        m_StreamThread.join();
+}
+
+// Called from the SDK event thread: pull the frame and leave everything else to the stream thread
+void ToupBase::pullVideoFrame(int captureBits)
+{
+    if (!m_StreamSlots.isOpen())
+        return;
+
+    StreamSlot *slot = m_StreamSlots.acquire();
+
+    // The stream thread holds every slot, skip this frame
+    if (slot == nullptr)
+    {
+        FP(put_Option(m_Handle, CP(OPTION_FLUSH), 3));
+        return;
+    }
+
+    {
+        // Snapshot the frame size so that an ROI change cannot tear this frame
+        std::lock_guard<std::mutex> guard(ccdBufferLock);
+        slot->size = PrimaryCCD.getFrameBufferSize();
+        slot->width = PrimaryCCD.getSubW() / PrimaryCCD.getBinX();
+        slot->height = PrimaryCCD.getSubH() / PrimaryCCD.getBinY();
+        slot->bpp = PrimaryCCD.getBPP();
+    }
+    if (slot->data.size() < slot->size)
+        slot->data.resize(slot->size);
+
+    HRESULT rc = FP(PullImageWithRowPitchV2(m_Handle, slot->data.data(), captureBits * m_Channels, -1, nullptr));
+
+    if (SUCCEEDED(rc))
+        m_StreamSlots.publish(slot);
+    else
+        m_StreamSlots.release(slot);
+}
+
+void ToupBase::streamThreadEntry()
+{
+    while (StreamSlot *slot = m_StreamSlots.wait())
+    {
+        // Colour video frames are interleaved, masters are planar
+        if (m_Channels == 1 && m_Calibration.isEnabled(true))
+            m_Calibration.process(slot->data.data(), slot->width, slot->height, 1, slot->bpp,
+                                  calibrationKey(1.0 / Streamer->getTargetFPS()), PrimaryCCD.getFrameType(), true);
+
+        Streamer->newFrame(slot->data.data(), slot->size);
+
+        m_StreamSlots.release(slot);
+    }
+}
+
 int ToupBase::SetTemperature(double temperature)
 {
     if (activateCooler(true) == false)
@@ -1661,6 +1755,18 @@ void ToupBase::addFITSKeywords(INDI::CCDChip *targetChip, std::vector<INDI::FITS
     fitsKeywords.push_back({"PRODATE", m_CameraT[TC_CAMERA_DATE].text, "Production Date"});
     fitsKeywords.push_back({"FIRMVER", m_CameraT[TC_CAMERA_FW_VERSION].text, "Firmware Version"});
     fitsKeywords.push_back({"HARDVER", m_CameraT[TC_CAMERA_HW_VERSION].text, "Hardware Version"});
+
+    m_Calibration.addFITSKeywords(fitsKeywords);
+}
+
+Calibration::FrameKey ToupBase::calibrationKey(double duration)
+{
+    Calibration::FrameKey key;
+    key.exposure = duration;
+    key.gain = m_ControlN[TC_GAIN].value;
+    if (HasCooler() || (m_Instance->model->flag & CP(FLAG_GETTEMPERATURE)))
+        key.temperature = TemperatureN[0].value;
+    return key;
 }
 
 bool ToupBase::saveConfigItems(FILE *fp)
@@ -1682,6 +1788,8 @@ bool ToupBase::saveConfigItems(FILE *fp)
     if (m_Instance->model->flag & CP(FLAG_HIGH_FULLWELL))
         IUSaveConfigSwitch(fp, &m_HighFullwellSP);
 
+    m_Calibration.saveConfigItems(fp);
+
     return true;
 }
 
@@ -1718,9 +1826,7 @@ void ToupBase::eventCallBack(unsigned event)
             int captureBits = m_BitsPerPixel == 8 ? 8 : m_maxBitDepth;
             if (Streamer->isStreaming() || Streamer->isRecording())
             {
-                HRESULT rc = FP(PullImageWithRowPitchV2(m_Handle, PrimaryCCD.getFrameBuffer(), captureBits * m_Channels, -1, nullptr));
-                if (SUCCEEDED(rc))
-                    Streamer->newFrame(PrimaryCCD.getFrameBuffer(), PrimaryCCD.getFrameBufferSize());
+                pullVideoFrame(captureBits);
             }
             else if (InExposure)
             {
@@ -1764,6 +1870,14 @@ void ToupBase::eventCallBack(unsigned event)
 
                     LOGF_DEBUG("Image received. Width: %d, Height: %d, flag: %d, timestamp: %ld", info.width, info.height, info.flag,
                                info.timestamp);
+
+                    if (m_Calibration.isEnabled(false))
+                    {
+                        std::lock_guard<std::mutex> guard(ccdBufferLock);
+                        m_Calibration.process(PrimaryCCD.getFrameBuffer(), PrimaryCCD.getSubW() / PrimaryCCD.getBinX(),
+                                              PrimaryCCD.getSubH() / PrimaryCCD.getBinY(), m_Channels, PrimaryCCD.getBPP(),
+                                              calibrationKey(m_ExposureRequest), PrimaryCCD.getFrameType(), false);
+                    }
                     ExposureComplete(&PrimaryCCD);
                 }
             }
@@ -24,6 +24,11 @@
 #include <indiccd.h>
 #include <inditimer.h>
 #include "libtoupbase.h"
+#include "calibrationstage.h"
+#include "framering.h"
+
+#include <thread>
+#include <vector>
 
 class ToupBase : public INDI::CCD
 {
@@ -46,6 +51,7 @@ class ToupBase : public INDI::CCD
     protected:
         virtual bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override;
         virtual bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n) override;
+        virtual bool ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n) override;
 
         // Streaming
         virtual bool StartStreaming() override;
@@ -292,5 +298,30 @@ class ToupBase : public INDI::CCD
         uint8_t *m_rgbBuffer { nullptr };
         int32_t m_rgbBufferSize { 0 };
 
+        //#############################################################################
+        // Streaming pull buffers
+        // The SDK event thread only pulls each video frame into a free slot and signals
+        // the stream thread, which hands it to the streamer. If the streamer falls
+        // behind, the oldest pending frame is overwritten.
+        //#############################################################################
+        struct StreamSlot
+        {
+            std::vector<uint8_t> data;
+            uint32_t size { 0 };
+            uint32_t width { 0 }, height { 0 }, bpp { 0 };
+        };
+        static constexpr uint8_t STREAM_SLOTS = 3;
+        FrameRing::Ring<StreamSlot, STREAM_SLOTS> m_StreamSlots;
+        std::thread m_StreamThread;
+
+        void startStreamThread();
+        void stopStreamThread();
+        void streamThreadEntry();
+        void pullVideoFrame(int captureBits);
+
+        // Optional bias, dark and flat calibration of exposures and stream frames
+        Calibration::Stage m_Calibration { this };
+        Calibration::FrameKey calibrationKey(double duration);
+
         int m_ConfigResolutionIndex {-1};
 };
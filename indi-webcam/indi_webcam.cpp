@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <eventloop.h>
 
 #include "indi_webcam.h"
+#include "imagekernels.h"
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -1501,36 +1502,15 @@ void indi_webcam::finishExposure()
         int subFrameSize     = subW * subH * bpp / 8 * ((naxis == 3) ? 3 : 1);
         int oneFrameSize     = subW * subH * bpp / 8;
 
-        int lineW  = subW * bpp / 8;
-
         LOGF_DEBUG("Subframing... subFrameSize: %d - oneFrameSize: %d - subX: %d - subY: %d - subW: %d - subH: %d",
                    subFrameSize, oneFrameSize,
                    subX, subY, subW, subH);
 
+        // Rows and planes are moved down in place, see ImageKernels::crop.
         if (naxis == 2)
-        {
-            // JM 2020-08-29: Using memmove since regions are overlaping
-            // as proposed by Camiel Severijns on INDI forums.
-            for (int i = subY; i < subY + subH; i++)
-                memmove(memptr + (i - subY) * lineW, memptr + (i * w + subX) * bpp / 8, lineW);
-        }
+            ImageKernels::crop(memptr, memptr, w * bpp / 8, subX, subY, subW, subH, bpp / 8);
         else
-        {
-            uint8_t * subR = memptr;
-            uint8_t * subG = memptr + oneFrameSize;
-            uint8_t * subB = memptr + oneFrameSize * 2;
-
-            uint8_t *startR = memptr;
-            uint8_t *startG = memptr + (w * h * bpp / 8);
-            uint8_t *startB = memptr + (w * h * bpp / 8 * 2);
-
-            for (int i = subY; i < subY + subH; i++)
-            {
-                memcpy(subR + (i - subY) * lineW, startR + (i * w + subX) * bpp / 8, lineW);
-                memcpy(subG + (i - subY) * lineW, startG + (i * w + subX) * bpp / 8, lineW);
-                memcpy(subB + (i - subY) * lineW, startB + (i * w + subX) * bpp / 8, lineW);
-            }
-        }
+            ImageKernels::cropPlanes(memptr, w, h, 3, subX, subY, subW, subH, bpp / 8);
 
         PrimaryCCD.setFrameBuffer(memptr);
         PrimaryCCD.setFrameBufferSize(subFrameSize, false);
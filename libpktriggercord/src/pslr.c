@@ -661,19 +661,8 @@ int pslr_get_buffer(pslr_handle_t h, int bufno, pslr_buffer_type type, int resol
         return PSLR_NO_MEMORY;
     }
 
-    uint32_t bufpos = 0;
-    while (true) {
-        uint32_t nextread = size - bufpos > 65536 ? 65536 : size - bufpos;
-        if (nextread == 0) {
-            break;
-        }
-        uint32_t bytes = pslr_buffer_read(h, buf+bufpos, nextread);
-        if (bytes == 0) {
-            break;
-        }
-        bufpos += bytes;
-    }
-    if ( bufpos != size ) {
+    ret = pslr_buffer_download(h, buf, size); // INDI modification, reapply for next update
+    if ( ret != PSLR_OK ) {
         free(buf);
         return PSLR_READ_ERROR;
     }
@@ -1108,6 +1097,39 @@ uint32_t pslr_buffer_read(pslr_handle_t h, uint8_t *buf, uint32_t size) {
     return blksz;
 }
 
+/* INDI modification, reapply for next update
+ * Download the whole open buffer into memory in one pass. Segments are walked
+ * back to back so the SCSI reads never stop for a per-block segment lookup or
+ * a round trip through the caller. */
+int pslr_buffer_download(pslr_handle_t h, uint8_t *buf, uint32_t size) {
+    ipslr_handle_t *p = (ipslr_handle_t *) h;
+    uint32_t i;
+    uint32_t pos = 0;
+    uint32_t done = 0;
+    uint32_t seg_offs;
+    uint32_t len;
+
+    DPRINT("[C]\tpslr_buffer_download(%d)\n", size);
+
+    for (i = 0; i < p->segment_count && done < size; i++) {
+        if (p->offset >= pos + p->segments[i].length) {
+            pos += p->segments[i].length;
+            continue;
+        }
+        seg_offs = p->offset - pos;
+        len = p->segments[i].length - seg_offs;
+        if (len > size - done) {
+            len = size - done;
+        }
+        CHECK(ipslr_download(p, p->segments[i].addr + seg_offs, len, buf + done));
+        done += len;
+        p->offset += len;
+        pos += p->segments[i].length;
+    }
+
+    return done == size ? PSLR_OK : PSLR_READ_ERROR;
+}
+
 uint32_t pslr_fullmemory_read(pslr_handle_t h, uint8_t *buf, uint32_t offset, uint32_t size) {
     ipslr_handle_t *p = (ipslr_handle_t *) h;
     int ret;
@@ -2815,6 +2815,9 @@ int CCCDCamera::FillImageBuffer(bool bMakeRequest)
 	iStride = m_ExposureSettings.ColumnsToRead * iPixelSize;
 	iTotRowsRead = 0;
 
+	// Hot pixels are replaced as row blocks arrive rather than in a pass over the finished image
+	bool bRemap = m_QSIInterface.m_hpmMap.BeginFrame(m_ExposureSettings, m_QSIInterface.m_log);
+
 	while (iTotRowsRead < m_ExposureSettings.RowsToRead)
 	{
 		// ReadImageByRow may return fewer rows than requested.  It is up to the caller to make additional calls to retreive the entire image.
@@ -2826,6 +2829,10 @@ int CCCDCamera::FillImageBuffer(bool bMakeRequest)
 			return Error ( "Image transfer error", IID_ICamera, MAKE_HRESULT(1,FACILITY_ITF, m_iError) );
 		}
 		iTotRowsRead += iRowsRead;  // Update the number of pixels read, ReadImage may return less row that we requested.
+
+		// All rows but the block's final one, which needs the next block for its neighbours
+		if (bRemap && iTotRowsRead < m_ExposureSettings.RowsToRead)
+			m_QSIInterface.m_hpmMap.RemapRows((BYTE *)m_pusBuffer, iStride, iTotRowsRead);
 	}
 	//
 	// Image is now in m_pusBuffer
@@ -2836,8 +2843,9 @@ int CCCDCamera::FillImageBuffer(bool bMakeRequest)
 	if( m_iError != ALL_OK ) 
 		return Error ( "Auto zero get data error", IID_ICamera, MAKE_HRESULT(1,FACILITY_ITF, m_iError) );
 
-	// Now apply the Hot Pixel map
-	m_QSIInterface.HotPixelRemap((BYTE *)m_pusBuffer, 0, m_ExposureSettings, m_DeviceDetails, m_AutoZeroData.zeroLevel);
+	// Remaining rows of the Hot Pixel map, and this image's zero level for the pixels without good neighbours
+	if (bRemap)
+		m_QSIInterface.m_hpmMap.EndFrame((BYTE *)m_pusBuffer, iStride, m_AutoZeroData.zeroLevel);
 	m_bImageValid = true;
 	return S_OK;
 }
@@ -3738,6 +3746,24 @@ int CCCDCamera::get_PixelMask(std::vector<Pixel> *pixels)
 	return S_OK;
 }
 
+int CCCDCamera::AddPixelMaskFromDark(unsigned short threshold, int *pCount)
+{
+	// Adds the pixels of the last image more than threshold ADU above its median to the pixel mask.
+	// The image should be a dark; pixels already masked were corrected during its readout and are kept.
+	if (!m_bIsConnected)
+		return Error ( "Not Connected", IID_ICamera, MAKE_HRESULT(1,FACILITY_ITF, QSI_NOTCONNECTED) );
+
+	FillImageBuffer(true);
+
+	if ( !m_bImageValid )
+		return Error ( _T("No Image Available"), IID_ICamera, MAKE_HRESULT(1,FACILITY_ITF, QSI_NOIMAGEAVAILABLE) );
+
+	*pCount = m_QSIInterface.m_hpmMap.AddFromDark(m_pusBuffer, m_ExposureSettings, threshold);
+	m_QSIInterface.m_hpmMap.Save();
+	m_QSIInterface.LogWrite(2, _T("Added %d pixels from dark to pixel mask."), *pCount);
+	return S_OK;
+}
+
 int CCCDCamera::get_FilterPositionTrim( std::vector<short> * pVal )
 {
 	// 
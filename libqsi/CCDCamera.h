@@ -270,6 +270,7 @@ public:
 	int get_MaskPixels(bool* pVal);
 	int put_PixelMask(std::vector<Pixel> pixels);
 	int get_PixelMask(std::vector<Pixel> *pixels);
+	int AddPixelMaskFromDark(unsigned short threshold, int *pCount);
 	int get_FilterPositionTrim( std::vector<short> * pVal);
 	int put_FilterPositionTrim( std::vector<short>);
 	int get_HasFilterWheelTrim(bool* pVal);
@@ -0,0 +1,248 @@
+/*****************************************************************************************
+NAME
+ HotPixelIndex
+
+DESCRIPTION
+ Indexed hot pixel map, corrected row block by row block as an image is read out
+
+COPYRIGHT (C)
+ QSI (Quantum Scientific Imaging) 2011
+
+REVISION HISTORY
+ Original Version
+******************************************************************************************/
+#include "HotPixelIndex.h"
+#include <algorithm>
+
+HotPixelIndex::HotPixelIndex(void)
+{
+	m_FrameValid = false;
+	m_Columns = 0;
+	m_Rows = 0;
+	m_RowsDone = 0;
+}
+
+void HotPixelIndex::SetPixels(const std::vector<Pixel> & pixels)
+{
+	m_SensorRuns.clear();
+	m_SensorRuns.reserve(pixels.size());
+	for (std::vector<Pixel>::const_iterator vi = pixels.begin(); vi != pixels.end(); vi++)
+	{
+		if ((*vi).x < 0 || (*vi).y < 0)
+			continue;
+		Run run = { (*vi).y, (*vi).x, 1 };
+		m_SensorRuns.push_back(run);
+	}
+	std::sort(m_SensorRuns.begin(), m_SensorRuns.end());
+	Merge(m_SensorRuns);
+	m_FrameValid = false;
+}
+
+std::vector<Pixel> HotPixelIndex::GetPixels(void) const
+{
+	std::vector<Pixel> pixels;
+	pixels.reserve(Count());
+	for (std::vector<Run>::const_iterator ri = m_SensorRuns.begin(); ri != m_SensorRuns.end(); ri++)
+		for (int x = (*ri).x; x < (*ri).x + (*ri).length; x++)
+			pixels.push_back(Pixel(x, (*ri).y));
+	return pixels;
+}
+
+int HotPixelIndex::Count(void) const
+{
+	int count = 0;
+	for (std::vector<Run>::const_iterator ri = m_SensorRuns.begin(); ri != m_SensorRuns.end(); ri++)
+		count += (*ri).length;
+	return count;
+}
+
+// Join sorted runs that overlap or touch in the same row
+void HotPixelIndex::Merge(std::vector<Run> & runs)
+{
+	if (runs.empty())
+		return;
+
+	size_t out = 0;
+	for (size_t i = 1; i < runs.size(); i++)
+	{
+		Run & last = runs[out];
+		if (runs[i].y == last.y && runs[i].x <= last.x + last.length)
+			last.length = std::max(last.length, runs[i].x + runs[i].length - last.x);
+		else
+			runs[++out] = runs[i];
+	}
+	runs.resize(out + 1);
+}
+
+int HotPixelIndex::AddFromDark(const uint16_t * Dark, int Stride, int ColumnOffset, int RowOffset,
+							   int Columns, int Rows, int BinX, int BinY, uint16_t Threshold)
+{
+	if (Dark == NULL || Columns <= 0 || Rows <= 0 || BinX <= 0 || BinY <= 0)
+		return 0;
+
+	// Median from a histogram, a single pass whatever the frame size
+	std::vector<uint32_t> histogram(65536, 0);
+	for (int y = 0; y < Rows; y++)
+	{
+		const uint16_t * row = Dark + (size_t)y * Stride;
+		for (int x = 0; x < Columns; x++)
+			histogram[row[x]]++;
+	}
+
+	size_t half = ((size_t)Columns * Rows) / 2;
+	size_t seen = 0;
+	int median = 0;
+	while (median < 65535 && (seen += histogram[median]) <= half)
+		median++;
+
+	int limit = median + Threshold;
+	if (limit >= 65535)
+		return 0;
+
+	std::vector<Pixel> pixels = GetPixels();
+	int before = Count();
+	for (int y = 0; y < Rows; y++)
+	{
+		const uint16_t * row = Dark + (size_t)y * Stride;
+		for (int x = 0; x < Columns; x++)
+		{
+			if (row[x] <= limit)
+				continue;
+			// A binned pixel is hot because of any of the sensor pixels under it
+			for (int sy = 0; sy < BinY; sy++)
+				for (int sx = 0; sx < BinX; sx++)
+					pixels.push_back(Pixel((ColumnOffset + x) * BinX + sx, (RowOffset + y) * BinY + sy));
+		}
+	}
+
+	SetPixels(pixels);
+	return Count() - before;
+}
+
+int HotPixelIndex::BeginFrame(int ColumnOffset, int RowOffset, int Columns, int Rows, int BinX, int BinY)
+{
+	int frame[6] = { ColumnOffset, RowOffset, Columns, Rows, BinX, BinY };
+	m_RowsDone = 0;
+	m_Deferred.clear();
+
+	if (!m_FrameValid || !std::equal(frame, frame + 6, m_Frame))
+	{
+		std::copy(frame, frame + 6, m_Frame);
+		m_FrameValid = true;
+		m_FrameRuns.clear();
+		m_Columns = std::max(Columns, 0);
+		m_Rows = std::max(Rows, 0);
+
+		if (BinX > 0 && BinY > 0)
+		{
+			// Frame bounds on the sensor
+			int sx0 = ColumnOffset * BinX, sx1 = (ColumnOffset + m_Columns) * BinX;
+			int sy0 = RowOffset * BinY, sy1 = (RowOffset + m_Rows) * BinY;
+
+			Run first = { sy0, 0, 0 };
+			std::vector<Run>::const_iterator ri = std::lower_bound(m_SensorRuns.begin(), m_SensorRuns.end(), first);
+			for (; ri != m_SensorRuns.end() && (*ri).y < sy1; ri++)
+			{
+				int a = std::max((*ri).x, sx0);
+				int b = std::min((*ri).x + (*ri).length, sx1);
+				if (a >= b)
+					continue;
+				Run run = { (*ri).y / BinY - RowOffset, a / BinX - ColumnOffset, (b - 1) / BinX - a / BinX + 1 };
+				m_FrameRuns.push_back(run);
+			}
+
+			// Binned rows gather several sensor rows
+			if (BinY > 1)
+				std::sort(m_FrameRuns.begin(), m_FrameRuns.end());
+			Merge(m_FrameRuns);
+		}
+
+		m_RowIndex.assign(m_Rows + 1, 0);
+		size_t index = 0;
+		for (int r = 0; r <= m_Rows; r++)
+		{
+			while (index < m_FrameRuns.size() && m_FrameRuns[index].y < r)
+				index++;
+			m_RowIndex[r] = (int)index;
+		}
+	}
+
+	int count = 0;
+	for (std::vector<Run>::const_iterator ri = m_FrameRuns.begin(); ri != m_FrameRuns.end(); ri++)
+		count += (*ri).length;
+	return count;
+}
+
+bool HotPixelIndex::IsHot(int x, int y) const
+{
+	for (int i = m_RowIndex[y]; i < m_RowIndex[y + 1]; i++)
+	{
+		const Run & run = m_FrameRuns[i];
+		if (x < run.x)
+			return false;
+		if (x < run.x + run.length)
+			return true;
+	}
+	return false;
+}
+
+bool HotPixelIndex::Neighbours(const uint16_t * Image, int Stride, int x, int y, uint16_t & Value) const
+{
+	uint16_t values[8];
+	int count = 0;
+
+	for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, m_Rows - 1); ny++)
+	{
+		const uint16_t * row = Image + (size_t)ny * Stride;
+		for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, m_Columns - 1); nx++)
+		{
+			if ((nx == x && ny == y) || IsHot(nx, ny))
+				continue;
+			// Insertion sort, there are at most 8
+			int i = count++;
+			for (; i > 0 && values[i - 1] > row[nx]; i--)
+				values[i] = values[i - 1];
+			values[i] = row[nx];
+		}
+	}
+
+	if (count == 0)
+		return false;
+	if (count & 1)
+		Value = values[count / 2];
+	else
+		Value = (uint16_t)((values[count / 2 - 1] + values[count / 2] + 1) / 2);
+	return true;
+}
+
+void HotPixelIndex::RemapRows(uint16_t * Image, int Stride, int RowsRead)
+{
+	// The last row read waits for the one below it, unless the frame is complete
+	int limit = RowsRead >= m_Rows ? m_Rows : RowsRead - 1;
+
+	for (int r = m_RowsDone; r < limit; r++)
+	{
+		uint16_t * row = Image + (size_t)r * Stride;
+		for (int i = m_RowIndex[r]; i < m_RowIndex[r + 1]; i++)
+		{
+			const Run & run = m_FrameRuns[i];
+			for (int x = run.x; x < run.x + run.length; x++)
+			{
+				// Hot pixels are never used as neighbours, so leaving this one as is until EndFrame() changes nothing else
+				if (!Neighbours(Image, Stride, x, r, row[x]))
+					m_Deferred.push_back(Pixel(x, r));
+			}
+		}
+	}
+
+	m_RowsDone = std::max(m_RowsDone, limit);
+}
+
+void HotPixelIndex::EndFrame(uint16_t * Image, int Stride, uint16_t Fallback)
+{
+	RemapRows(Image, Stride, m_Rows);
+
+	for (std::vector<Pixel>::const_iterator vi = m_Deferred.begin(); vi != m_Deferred.end(); vi++)
+		Image[(size_t)(*vi).y * Stride + (*vi).x] = Fallback;
+	m_Deferred.clear();
+}
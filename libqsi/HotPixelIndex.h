@@ -0,0 +1,82 @@
+/*****************************************************************************************
+NAME
+ HotPixelIndex
+
+DESCRIPTION
+ Indexed hot pixel map, corrected row block by row block as an image is read out
+
+COPYRIGHT (C)
+ QSI (Quantum Scientific Imaging) 2011
+
+REVISION HISTORY
+ Original Version
+******************************************************************************************/
+#ifndef HOTPIXELINDEX_H
+#define HOTPIXELINDEX_H
+
+#include "qsiapi.h"
+#include <stdint.h>
+#include <vector>
+
+//
+// Hot pixels are kept as runs of adjacent columns, sorted by row then column, in
+// unbinned sensor coordinates. BeginFrame() maps them once into the binned frame
+// being read and indexes them by frame row, so RemapRows() only visits the runs
+// of the rows it was given. A hot pixel is replaced by the median of its
+// non-hot 3x3 neighbours, which needs the row below it, so each call corrects
+// the rows read so far but the last one. EndFrame() corrects the rest once the
+// whole frame is in. Pixels without any good neighbour are left until then, so
+// the fallback value only needs to be known at the end of the readout.
+//
+class HotPixelIndex
+{
+public:
+	HotPixelIndex(void);
+
+	// Pixels in unbinned sensor coordinates, duplicates are ignored
+	void SetPixels(const std::vector<Pixel> & pixels);
+	std::vector<Pixel> GetPixels(void) const;
+	int Count(void) const;
+
+	// Add every pixel of a dark frame more than Threshold ADU above its median.
+	// The frame geometry is given as in QSI_ExposureSettings. Returns the number of pixels added.
+	int AddFromDark(const uint16_t * Dark, int Stride, int ColumnOffset, int RowOffset,
+					int Columns, int Rows, int BinX, int BinY, uint16_t Threshold);
+
+	// Prepare the correction of a frame. Returns the number of hot pixels in it.
+	int BeginFrame(int ColumnOffset, int RowOffset, int Columns, int Rows, int BinX, int BinY);
+	// Correct the rows of the frame that can be, given RowsRead rows are in Image.
+	// Stride is in pixels.
+	void RemapRows(uint16_t * Image, int Stride, int RowsRead);
+	// Correct the remaining rows of the complete frame. Fallback is used for pixels without any good neighbour.
+	void EndFrame(uint16_t * Image, int Stride, uint16_t Fallback);
+
+private:
+	struct Run
+	{
+		int y;
+		int x;
+		int length;
+		bool operator<(const Run & other) const
+		{
+			return y < other.y || (y == other.y && x < other.x);
+		}
+	};
+
+	static void Merge(std::vector<Run> & runs);
+	bool IsHot(int x, int y) const;
+	bool Neighbours(const uint16_t * Image, int Stride, int x, int y, uint16_t & Value) const;
+
+	std::vector<Run> m_SensorRuns;
+	// Current frame
+	std::vector<Run> m_FrameRuns;
+	std::vector<int> m_RowIndex;	// Runs of frame row r are m_FrameRuns[m_RowIndex[r]] to m_FrameRuns[m_RowIndex[r + 1] - 1]
+	int m_Frame[6];					// Geometry m_FrameRuns was built for
+	bool m_FrameValid;
+	int m_Columns;
+	int m_Rows;
+	int m_RowsDone;
+	std::vector<Pixel> m_Deferred;	// Corrected rows' pixels without any good neighbour, set by EndFrame()
+};
+
+#endif
@@ -22,6 +22,7 @@ DRC 03.23.11 Original Version
 HotPixelMap::HotPixelMap(void)
 {
 	m_bEnable = false;
+	m_bFrameActive = false;
 }
 
 HotPixelMap::HotPixelMap(std::string Serial)
@@ -31,7 +32,9 @@ HotPixelMap::HotPixelMap(std::string Serial)
 	int dSize = 4;
 	int RemapCount = 0;
 	QSI_Registry reg;
+	std::vector<Pixel> pixels;
 
+	m_bFrameActive = false;
 	this->serial = Serial;
 	std::string Root = std::string(REGMAPROOT);
 	Root += Serial;
@@ -51,7 +54,7 @@ HotPixelMap::HotPixelMap(std::string Serial)
 				(lResult = reg.RegQueryValueEx(Root, YName, 0, 0, &dwY, dSize) == 0) )
 		{
 			std::stringstream cnv;
-			HotMap.push_back(Pixel(dwX, dwY));
+			pixels.push_back(Pixel(dwX, dwY));
 			RemapCount++;
 			cnv << RemapCount;
 			XName = std::string(_T("X")); 
@@ -59,6 +62,7 @@ HotPixelMap::HotPixelMap(std::string Serial)
 			YName = std::string(_T("Y"));
 			YName += cnv.str();
 		}
+		HotMap.SetPixels(pixels);
 	}
 }
 
@@ -72,6 +76,7 @@ bool HotPixelMap::Save(void)
 	std::string XName = _T("X0");
 	std::string YName = _T("Y0");
 	std::string Root = std::string(REGMAPROOT);
+	std::vector<Pixel> pixels = HotMap.GetPixels();
 	std::vector<Pixel>::iterator vi;
 	QSI_Registry reg;
 
@@ -83,7 +88,7 @@ bool HotPixelMap::Save(void)
 	reg.RegDelnode (Root);
 
 	reg.SetNumber(Root, std::string(_T("Enable")), m_bEnable?1:0);
-	for (vi = HotMap.begin(); vi != HotMap.end(); vi++)
+	for (vi = pixels.begin(); vi != pixels.end(); vi++)
 	{
 		std::stringstream cnv;
 		cnv << RemapCount;
@@ -99,83 +104,47 @@ bool HotPixelMap::Save(void)
 	return true;
 }
 
-void HotPixelMap::Remap(	BYTE * Image, int RowPad, QSI_ExposureSettings Exposure,
-							QSI_DeviceDetails Details, USHORT ZeroPixel, QSILog * log)
+bool HotPixelMap::BeginFrame(QSI_ExposureSettings Exposure, QSILog * log)
 {
-	int pIndex;
-	std::vector<Pixel>::iterator vi;
-
+	m_bFrameActive = false;
 	if (!m_bEnable)
-		return;
-	log->Write(2, _T("Hot Pixel Remap enabled."));
+		return false;
 
-	for (vi = HotMap.begin(); vi != HotMap.end(); vi++)
-	{
-		log->Write(2, _T("Remap pixel: x=%d, y=%d"), (*vi).x, (*vi).y);
+	int count = HotMap.BeginFrame(Exposure.ColumnOffset, Exposure.RowOffset, Exposure.ColumnsToRead, Exposure.RowsToRead,
+								  Exposure.BinFactorX, Exposure.BinFactorY);
+	log->Write(2, _T("Hot Pixel Remap enabled, %d of %d pixels in image area."), count, HotMap.Count());
 
-		if (FindTargetPixelIndex(*vi, RowPad, Exposure, Details, log, &pIndex))
-		{
-			log->Write(2, _T("Remap pixel: x=%d, y=%d, old value: %d, new value: %d."),
-							(*vi).x, (*vi).y, *(USHORT*)(&Image[pIndex]), ZeroPixel); 
-			*(USHORT*)(&Image[pIndex]) = ZeroPixel;
-		}
-	}
+	m_bFrameActive = count > 0;
+	return m_bFrameActive;
 }
 
-bool HotPixelMap::FindTargetPixelIndex(	Pixel pxIn, int RowPad, QSI_ExposureSettings Exposure,
-										QSI_DeviceDetails Details, QSILog * log, int * pIndex)
+void HotPixelMap::RemapRows(BYTE * Image, int Stride, int RowsRead)
 {
-	int iStartX;
-	int iStartY;
-	int iSizeX;
-	int iSizeY;
-	int iBinnedLocX;
-	int iBinnedLocY;
-	int iRowLen;
-	static const int BYTESPERPIXEL = 2;
-
-	// Is the requested remap pixel in the array range of the camera?
-	if (pxIn.x >= Details.ArrayColumns || pxIn.y >= Details.ArrayRows)
-	{
-		log->Write(2, _T("Remap pixel: x=%d, y=%d not in CCD imager area."), pxIn.x, pxIn.y);
-		return false;
-	}
+	if (!m_bFrameActive)
+		return;
+	HotMap.RemapRows((uint16_t *)Image, Stride / sizeof(USHORT), RowsRead);
+}
 
-	// Un-Bin the parameters of the image and check if this pixel is in the requested frame
-	iStartX = Exposure.ColumnOffset * Exposure.BinFactorX;
-	iStartY = Exposure.RowOffset * Exposure.BinFactorY;
-	iSizeX =  Exposure.ColumnsToRead * Exposure.BinFactorX;
-	iSizeY =  Exposure.RowsToRead * Exposure.BinFactorY;
-	// RowLen and RowPad in bytes (for CCDSoft padding)
-	// The "Row length in bytes" is Exposure.ColumnsToRead number of columns times two
-	iRowLen =  Exposure.ColumnsToRead * BYTESPERPIXEL; 
-
-	// Is the remapped pixel in the target area?
-	if (pxIn.x >= iStartX && pxIn.x < iStartX + iSizeX &&
-		pxIn.y >= iStartY && pxIn.y < iStartY + iSizeY )
-	{
-		// Hit on remap
-		// Now cal the binned pixel index of the hot pixel
-		iBinnedLocX = (pxIn.x / Exposure.BinFactorX) - Exposure.ColumnOffset;
-		iBinnedLocY = (pxIn.y / Exposure.BinFactorY) - Exposure.RowOffset;
-		// Calc image array index in bytes, caller will use that to replace pixel
-		*pIndex = (iBinnedLocX * BYTESPERPIXEL) + ((iRowLen + RowPad) * iBinnedLocY);
-		log->Write(2, _T("Remap pixel: x=%d, y=%d at image index: %d"), pxIn.x, pxIn.y, *pIndex);
-		return true;
-	}
-	else
-	{
-		log->Write(2, _T("Remap pixel: x=%d, y=%d not in image area."), pxIn.x, pxIn.y);
-		return false;
-	}
+void HotPixelMap::EndFrame(BYTE * Image, int Stride, USHORT ZeroPixel)
+{
+	if (!m_bFrameActive)
+		return;
+	HotMap.EndFrame((uint16_t *)Image, Stride / sizeof(USHORT), ZeroPixel);
+	m_bFrameActive = false;
+}
+
+int HotPixelMap::AddFromDark(USHORT * Image, QSI_ExposureSettings Exposure, USHORT Threshold)
+{
+	return HotMap.AddFromDark(Image, Exposure.ColumnsToRead, Exposure.ColumnOffset, Exposure.RowOffset,
+							  Exposure.ColumnsToRead, Exposure.RowsToRead, Exposure.BinFactorX, Exposure.BinFactorY, Threshold);
 }
 
 std::vector<Pixel> HotPixelMap::GetPixels(void)
 {
-	return this->HotMap;
+	return HotMap.GetPixels();
 }
 
 void HotPixelMap::SetPixels(std::vector<Pixel> map)
 {
-	this->HotMap = map;
+	HotMap.SetPixels(map);
 }
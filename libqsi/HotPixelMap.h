@@ -20,6 +20,7 @@ DRC 03.23.11 Original Version
 #include "QSI_Global.h"
 #include "QSILog.h"
 #include "qsiapi.h"
+#include "HotPixelIndex.h"
 #include <vector>
 #include <string>
 
@@ -29,15 +30,18 @@ public:
 	HotPixelMap(void);
 	HotPixelMap(std::string Serial);
 	~HotPixelMap(void);
-	void Remap(	BYTE * Image, int RowPad, QSI_ExposureSettings Exposure,
-				QSI_DeviceDetails Details, USHORT ZeroPixel, QSILog * log);
+	// Inline correction during readout: BeginFrame, RemapRows after each row block, then EndFrame
+	bool BeginFrame(QSI_ExposureSettings Exposure, QSILog * log);
+	void RemapRows(BYTE * Image, int Stride, int RowsRead);
+	void EndFrame(BYTE * Image, int Stride, USHORT ZeroPixel);
+	int AddFromDark(USHORT * Image, QSI_ExposureSettings Exposure, USHORT Threshold);
 	bool Save(void);
 	std::vector<Pixel> GetPixels(void);
 	void SetPixels(std::vector<Pixel> map);
 	bool m_bEnable;
 private:
-	bool FindTargetPixelIndex(	Pixel pxIn, int RowPad, QSI_ExposureSettings Exposure, QSI_DeviceDetails Details, QSILog * log, int * pIndex);
-	std::vector<Pixel> HotMap;
+	HotPixelIndex HotMap;
+	bool m_bFrameActive;
 	std::string serial;
 };
 
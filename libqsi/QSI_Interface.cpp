@@ -2913,14 +2913,6 @@ int QSI_Interface::QSIWriteTimeout(int timeout)
 	return m_iError;
 }
 
-void QSI_Interface::HotPixelRemap(	BYTE * Image, int RowPad, QSI_ExposureSettings Exposure,
-							QSI_DeviceDetails Details, USHORT ZeroPixel)
-{
-	m_log->Write(2, _T("Hot Pixel Remap started."));
-	m_hpmMap.Remap(Image, RowPad, Exposure, Details, ZeroPixel, m_log);
-	m_log->Write(2, _T("Hot Pixel Remap complete."));
-}
-
 int QSI_Interface::CMD_SetFilterTrim(int pos, bool probe)
 {
 	m_log->Write(2, _T("SetFilterTrim started."));
@@ -127,9 +127,6 @@ public:
 	int QSIWriteDataPending(int * count);
 	int QSIReadTimeout(int timeout);
 	int QSIWriteTimeout(int timeout);
-	//
-	void HotPixelRemap(	BYTE * Image, int RowPad, QSI_ExposureSettings Exposure,
-							QSI_DeviceDetails Details, USHORT ZeroPixel);
 
 	int CMD_ExtTrigMode( BYTE action, BYTE polarity);
 
@@ -619,6 +619,11 @@ int QSICamera::get_PixelMask(std::vector<Pixel> *pixels )
 	return ((CCCDCamera *)pCam)->get_PixelMask( pixels );
 }
 
+int QSICamera::AddPixelMaskFromDark(unsigned short threshold, int *pCount)
+{
+	return ((CCCDCamera *)pCam)->AddPixelMaskFromDark( threshold, pCount );
+}
+
 int QSICamera::get_FilterPositionTrim( std::vector<short> * pVal)
 {
 	return ((CCCDCamera *)pCam)->get_FilterPositionTrim( pVal );
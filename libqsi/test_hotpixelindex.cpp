@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+#include "HotPixelIndex.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+static bool samePixels(std::vector<Pixel> a, std::vector<Pixel> b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++)
+		if (a[i].x != b[i].x || a[i].y != b[i].y)
+			return false;
+	return true;
+}
+
+TEST(HotPixelIndex, pixels_round_trip)
+{
+	std::vector<Pixel> pixels;
+	pixels.push_back(Pixel(5, 2));
+	pixels.push_back(Pixel(3, 2));
+	pixels.push_back(Pixel(4, 2));
+	pixels.push_back(Pixel(4, 2));
+	pixels.push_back(Pixel(9, 0));
+	pixels.push_back(Pixel(-1, 3));
+
+	HotPixelIndex index;
+	index.SetPixels(pixels);
+	EXPECT_EQ(index.Count(), 4);
+
+	// Sorted by row then column, duplicates and negative coordinates dropped
+	std::vector<Pixel> expected;
+	expected.push_back(Pixel(9, 0));
+	expected.push_back(Pixel(3, 2));
+	expected.push_back(Pixel(4, 2));
+	expected.push_back(Pixel(5, 2));
+	EXPECT_TRUE(samePixels(index.GetPixels(), expected));
+}
+
+TEST(HotPixelIndex, median_of_good_neighbours)
+{
+	const int W = 5, H = 4;
+	uint16_t image[H][W] =
+	{
+		{ 10, 20, 30, 40, 50 },
+		{ 60, 900, 80, 90, 100 },
+		{ 11, 700, 13, 14, 15 },
+		{ 16, 17, 18, 19, 20 },
+	};
+
+	std::vector<Pixel> pixels;
+	pixels.push_back(Pixel(1, 1));
+	pixels.push_back(Pixel(1, 2));
+
+	HotPixelIndex index;
+	index.SetPixels(pixels);
+	ASSERT_EQ(index.BeginFrame(0, 0, W, H, 1, 1), 2);
+	index.EndFrame(&image[0][0], W, 0);
+
+	// (1,1) skips the hot (1,2): 10 11 13 20 30 60 80 -> 20
+	EXPECT_EQ(image[1][1], 20);
+	// (1,2) skips the hot (1,1): 11 13 16 17 18 60 80 -> 17
+	EXPECT_EQ(image[2][1], 17);
+	EXPECT_EQ(image[0][0], 10);
+	EXPECT_EQ(image[3][4], 20);
+}
+
+TEST(HotPixelIndex, fallback_without_good_neighbours)
+{
+	const int W = 3, H = 3;
+	std::vector<Pixel> pixels;
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++)
+			pixels.push_back(Pixel(x, y));
+
+	std::vector<uint16_t> image(W * H, 60000);
+	HotPixelIndex index;
+	index.SetPixels(pixels);
+	ASSERT_EQ(index.BeginFrame(0, 0, W, H, 1, 1), W * H);
+	index.EndFrame(image.data(), W, 123);
+	for (size_t i = 0; i < image.size(); i++)
+		EXPECT_EQ(image[i], 123) << i;
+}
+
+TEST(HotPixelIndex, fallback_waits_for_end_of_frame)
+{
+	const int W = 3, H = 6;
+	// The top half is all hot, so its first row has no good neighbour at all
+	std::vector<Pixel> pixels;
+	for (int y = 0; y < 3; y++)
+		for (int x = 0; x < W; x++)
+			pixels.push_back(Pixel(x, y));
+
+	std::vector<uint16_t> image(W * H, 60000);
+	for (int i = 3 * W; i < W * H; i++)
+		image[i] = 100;
+	HotPixelIndex index;
+	index.SetPixels(pixels);
+	ASSERT_EQ(index.BeginFrame(0, 0, W, H, 1, 1), 3 * W);
+
+	// Before the zero level of the image is known
+	index.RemapRows(image.data(), W, 5);
+	for (int i = 0; i < 2 * W; i++)
+		EXPECT_EQ(image[i], 60000) << i;
+	for (int i = 2 * W; i < 3 * W; i++)
+		EXPECT_EQ(image[i], 100) << i;
+
+	index.EndFrame(image.data(), W, 123);
+	for (int i = 0; i < 2 * W; i++)
+		EXPECT_EQ(image[i], 123) << i;
+	for (int i = 2 * W; i < W * H; i++)
+		EXPECT_EQ(image[i], 100) << i;
+}
+
+TEST(HotPixelIndex, row_blocks_match_whole_frame)
+{
+	const int W = 101, H = 77;
+	std::mt19937 rng(3);
+	std::vector<uint16_t> base(W * H);
+	for (size_t i = 0; i < base.size(); i++)
+		base[i] = 1000 + rng() % 50;
+
+	// Scattered pixels, a run along a row and a full column
+	std::vector<Pixel> pixels;
+	for (int i = 0; i < 300; i++)
+		pixels.push_back(Pixel(rng() % W, rng() % H));
+	for (int x = 10; x < 20; x++)
+		pixels.push_back(Pixel(x, 40));
+	for (int y = 0; y < H; y++)
+		pixels.push_back(Pixel(55, y));
+
+	HotPixelIndex index;
+	index.SetPixels(pixels);
+	std::vector<Pixel> hot = index.GetPixels();
+	for (size_t i = 0; i < hot.size(); i++)
+		base[hot[i].y * W + hot[i].x] = 60000;
+
+	std::vector<uint16_t> whole = base;
+	int count = index.BeginFrame(0, 0, W, H, 1, 1);
+	EXPECT_EQ(count, index.Count());
+	index.EndFrame(whole.data(), W, 7);
+
+	// As FillImageBuffer reads, in uneven blocks, the last one completing the frame
+	std::vector<uint16_t> blocks = base;
+	ASSERT_EQ(index.BeginFrame(0, 0, W, H, 1, 1), count);
+	for (int rows = 5; rows < H; rows += 9)
+		index.RemapRows(blocks.data(), W, rows);
+	index.EndFrame(blocks.data(), W, 7);
+
+	EXPECT_EQ(whole, blocks);
+	for (size_t i = 0; i < whole.size(); i++)
+		ASSERT_TRUE(whole[i] < 1050 || whole[i] == 7) << i;
+}
+
+TEST(HotPixelIndex, binned_subframe)
+{
+	// Sensor pixels, the frame is 2x2 binned with a (3, 2) binned offset, so sensor columns 6-13 and rows 4-9
+	std::vector<Pixel> pixels;
+	pixels.push_back(Pixel(7, 5));		// binned (0, 0)
+	pixels.push_back(Pixel(6, 4));		// same binned pixel
+	pixels.push_back(Pixel(11, 9));		// binned (2, 2)
+	pixels.push_back(Pixel(5, 5));		// left of the frame
+	pixels.push_back(Pixel(8, 10));		// below the frame
+
+	HotPixelIndex index;
+	index.SetPixels(pixels);
+	const int W = 4, H = 3;
+	ASSERT_EQ(index.BeginFrame(3, 2, W, H, 2, 2), 2);
+
+	std::vector<uint16_t> image(W * H, 100);
+	image[0] = 5000;
+	image[2 * W + 2] = 5000;
+	index.EndFrame(image.data(), W, 0);
+	for (size_t i = 0; i < image.size(); i++)
+		EXPECT_EQ(image[i], 100) << i;
+
+	// Back to the full unbinned frame, every pixel is in
+	EXPECT_EQ(index.BeginFrame(0, 0, 16, 16, 1, 1), 5);
+}
+
+TEST(HotPixelIndex, add_from_dark)
+{
+	const int W = 20, H = 10;
+	std::vector<uint16_t> dark(W * H, 1000);
+	dark[3 * W + 4] = 1600;
+	dark[7 * W + 19] = 3000;
+	dark[5 * W + 5] = 1400;		// below the threshold
+
+	HotPixelIndex index;
+	EXPECT_EQ(index.AddFromDark(dark.data(), W, 0, 0, W, H, 1, 1, 500), 2);
+	// Already known pixels are not counted again
+	EXPECT_EQ(index.AddFromDark(dark.data(), W, 0, 0, W, H, 1, 1, 500), 0);
+
+	std::vector<Pixel> expected;
+	expected.push_back(Pixel(4, 3));
+	expected.push_back(Pixel(19, 7));
+	EXPECT_TRUE(samePixels(index.GetPixels(), expected));
+
+	// A binned dark marks every sensor pixel under a hot binned pixel
+	HotPixelIndex binned;
+	EXPECT_EQ(binned.AddFromDark(dark.data(), W, 1, 2, W, H, 2, 2, 500), 8);
+	std::vector<Pixel> sensor = binned.GetPixels();
+	EXPECT_TRUE(std::find_if(sensor.begin(), sensor.end(), [](const Pixel & p) { return p.x == 10 && p.y == 10; })
+				!= sensor.end());
+}
+
+int main(int argc, char **argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,116 @@
+/*******************************************************************************
+ Serial Replay Test Bench
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "replaybench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <numeric>
+
+namespace SerialReplay
+{
+
+std::string BenchResult::summary() const
+{
+    char line[512];
+    snprintf(line, sizeof(line),
+             "[bench] %s: %zu round trips (%zu failed), p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us, "
+             "%.0f B/s, %u mismatches",
+             name.c_str(), samples, failures, p50_us, p90_us, p99_us, max_us, bytes_per_sec, mismatches);
+    return line;
+}
+
+double Bench::percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+
+    // Nearest rank
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+    return sorted[rank - 1];
+}
+
+BenchResult Bench::run(const std::string &name, size_t iterations, const std::function<bool()> &roundTrip,
+                       size_t warmup)
+{
+    const char *override = getenv("SERIAL_BENCH_ITERATIONS");
+    if (override != nullptr && atol(override) > 0)
+        iterations = static_cast<size_t>(atol(override));
+
+    for (size_t i = 0; i < warmup; i++)
+        roundTrip();
+
+    BenchResult result;
+    result.name = name;
+
+    std::vector<double> latencies;
+    latencies.reserve(iterations);
+
+    uint64_t startBytes = m_Device.bytesReceived() + m_Device.bytesSent();
+    uint32_t startMismatches = m_Device.mismatches();
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        auto before = std::chrono::steady_clock::now();
+        bool ok = roundTrip();
+        auto after = std::chrono::steady_clock::now();
+
+        if (!ok)
+        {
+            result.failures++;
+            continue;
+        }
+        latencies.push_back(std::chrono::duration<double, std::micro>(after - before).count());
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    std::sort(latencies.begin(), latencies.end());
+    result.samples = latencies.size();
+    result.p50_us = percentile(latencies, 50);
+    result.p90_us = percentile(latencies, 90);
+    result.p99_us = percentile(latencies, 99);
+    result.max_us = latencies.empty() ? 0 : latencies.back();
+    result.mean_us = latencies.empty() ? 0 : std::accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size();
+    result.elapsed_s = std::chrono::duration<double>(end - start).count();
+    result.bytes = m_Device.bytesReceived() + m_Device.bytesSent() - startBytes;
+    result.bytes_per_sec = result.elapsed_s > 0 ? result.bytes / result.elapsed_s : 0;
+    result.mismatches = m_Device.mismatches() - startMismatches;
+
+    printf("%s\n", result.summary().c_str());
+    fflush(stdout);
+
+    const char *csv = getenv("SERIAL_BENCH_CSV");
+    if (csv != nullptr && csv[0] != '\0')
+    {
+        std::ofstream file(csv, std::ios::app);
+        file << result.name << ',' << result.samples << ',' << result.failures << ',' << result.p50_us << ','
+             << result.p90_us << ',' << result.p99_us << ',' << result.max_us << ',' << result.mean_us << ','
+             << result.bytes_per_sec << ',' << result.mismatches << '\n';
+    }
+
+    return result;
+}
+
+}
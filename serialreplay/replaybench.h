@@ -0,0 +1,77 @@
+/*******************************************************************************
+ Serial Replay Test Bench
+
+ Round trip latency and throughput measurement for serial protocol drivers.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include "replaydevice.h"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace SerialReplay
+{
+
+struct BenchResult
+{
+    std::string name;
+    size_t samples { 0 };
+    size_t failures { 0 };
+    // Round trip latency in microseconds
+    double p50_us { 0 };
+    double p90_us { 0 };
+    double p99_us { 0 };
+    double max_us { 0 };
+    double mean_us { 0 };
+    double elapsed_s { 0 };
+    uint64_t bytes { 0 };
+    double bytes_per_sec { 0 };
+    uint32_t mismatches { 0 };
+
+    /** One line summary, as printed by Bench::run. */
+    std::string summary() const;
+};
+
+/**
+ * @brief Drives a driver command loop against a replay device.
+ *
+ * Each iteration calls roundTrip once, which should send one command through
+ * the driver and wait for its reply, returning false if the driver reported an
+ * error. The number of iterations can be raised without rebuilding through the
+ * SERIAL_BENCH_ITERATIONS environment variable, and results are appended as CSV
+ * to the file named by SERIAL_BENCH_CSV when it is set.
+ */
+class Bench
+{
+    public:
+        explicit Bench(Device &device) : m_Device(device) {}
+
+        BenchResult run(const std::string &name, size_t iterations, const std::function<bool()> &roundTrip,
+                        size_t warmup = 10);
+
+        /** Percentile of an ascending sorted sample, p between 0 and 100. */
+        static double percentile(const std::vector<double> &sorted, double p);
+
+    private:
+        Device &m_Device;
+};
+
+}
@@ -0,0 +1,419 @@
+/*******************************************************************************
+ Serial Replay Test Bench
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "replaydevice.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace SerialReplay
+{
+
+// Input that never matches is dropped once it grows past this.
+static const size_t MAX_PENDING_INPUT = 4096;
+// The replay thread checks whether it should stop this often.
+static const int POLL_INTERVAL_MS = 50;
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static void parseQuoted(const std::string &line, size_t &i, std::vector<uint8_t> &bytes, int lineNumber)
+{
+    // Skip opening quote
+    i++;
+    while (i < line.size() && line[i] != '"')
+    {
+        char c = line[i++];
+        if (c != '\\')
+        {
+            bytes.push_back(static_cast<uint8_t>(c));
+            continue;
+        }
+
+        if (i >= line.size())
+            break;
+
+        char e = line[i++];
+        switch (e)
+        {
+            case 'r':
+                bytes.push_back('\r');
+                break;
+            case 'n':
+                bytes.push_back('\n');
+                break;
+            case 't':
+                bytes.push_back('\t');
+                break;
+            case 'x':
+            {
+                int hi = i < line.size() ? hexValue(line[i]) : -1;
+                int lo = i + 1 < line.size() ? hexValue(line[i + 1]) : -1;
+                if (hi < 0 || lo < 0)
+                    throw std::invalid_argument("line " + std::to_string(lineNumber) + ": bad \\x escape");
+                bytes.push_back(static_cast<uint8_t>(hi << 4 | lo));
+                i += 2;
+                break;
+            }
+            default:
+                bytes.push_back(static_cast<uint8_t>(e));
+                break;
+        }
+    }
+
+    if (i >= line.size())
+        throw std::invalid_argument("line " + std::to_string(lineNumber) + ": unterminated string");
+    // Skip closing quote
+    i++;
+}
+
+Transcript Transcript::parse(const std::string &text)
+{
+    Transcript transcript;
+    std::istringstream input(text);
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(input, line))
+    {
+        lineNumber++;
+
+        size_t i = line.find_first_not_of(" \t\r");
+        if (i == std::string::npos || line[i] == '#')
+            continue;
+
+        Direction direction;
+        if (line[i] == '>')
+            direction = TO_DEVICE;
+        else if (line[i] == '<')
+            direction = FROM_DEVICE;
+        else
+            throw std::invalid_argument("line " + std::to_string(lineNumber) + ": expected '>' or '<'");
+        i++;
+
+        uint32_t delay_us = 0;
+        std::vector<uint8_t> bytes;
+        while (i < line.size())
+        {
+            char c = line[i];
+            if (isspace(static_cast<unsigned char>(c)))
+            {
+                i++;
+            }
+            else if (c == '#')
+            {
+                break;
+            }
+            else if (c == '@')
+            {
+                size_t end = 0;
+                delay_us = std::stoul(line.substr(i + 1), &end);
+                i += end + 1;
+            }
+            else if (c == '"')
+            {
+                parseQuoted(line, i, bytes, lineNumber);
+            }
+            else
+            {
+                int hi = hexValue(c);
+                int lo = i + 1 < line.size() ? hexValue(line[i + 1]) : -1;
+                if (hi < 0 || lo < 0)
+                    throw std::invalid_argument("line " + std::to_string(lineNumber) + ": bad hex byte");
+                bytes.push_back(static_cast<uint8_t>(hi << 4 | lo));
+                i += 2;
+            }
+        }
+
+        if (bytes.empty())
+            throw std::invalid_argument("line " + std::to_string(lineNumber) + ": step without bytes");
+
+        transcript.add(direction, bytes, delay_us);
+    }
+
+    return transcript;
+}
+
+Transcript Transcript::load(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file)
+        throw std::runtime_error("cannot read transcript " + path);
+
+    std::stringstream text;
+    text << file.rdbuf();
+    return parse(text.str());
+}
+
+void Transcript::add(Direction direction, const std::vector<uint8_t> &bytes, uint32_t delay_us)
+{
+    m_Steps.push_back({direction, bytes, delay_us});
+}
+
+void Transcript::add(Direction direction, const std::string &bytes, uint32_t delay_us)
+{
+    add(direction, std::vector<uint8_t>(bytes.begin(), bytes.end()), delay_us);
+}
+
+Device::Device(const Transcript &transcript) : m_Transcript(transcript)
+{
+}
+
+Device::~Device()
+{
+    stop();
+}
+
+static bool makeRaw(int fd)
+{
+    struct termios tty;
+    if (tcgetattr(fd, &tty) != 0)
+        return false;
+    cfmakeraw(&tty);
+    return tcsetattr(fd, TCSANOW, &tty) == 0;
+}
+
+bool Device::start()
+{
+    stop();
+
+    m_Master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (m_Master < 0)
+        return false;
+
+    char name[256] = {0};
+    if (grantpt(m_Master) != 0 || unlockpt(m_Master) != 0 || ptsname_r(m_Master, name, sizeof(name)) != 0)
+    {
+        stop();
+        return false;
+    }
+    m_Path = name;
+
+    m_Slave = open(name, O_RDWR | O_NOCTTY);
+    if (m_Slave < 0 || !makeRaw(m_Slave))
+    {
+        stop();
+        return false;
+    }
+
+    m_Step = 0;
+    m_Input.clear();
+    m_BytesReceived = 0;
+    m_BytesSent = 0;
+    m_Mismatches = 0;
+    m_Finished = false;
+
+    m_Running = true;
+    m_Thread = std::thread(&Device::replayLoop, this);
+    return true;
+}
+
+void Device::stop()
+{
+    m_Running = false;
+    if (m_Thread.joinable())
+        m_Thread.join();
+
+    if (m_Slave >= 0)
+        close(m_Slave);
+    if (m_Master >= 0)
+        close(m_Master);
+    m_Slave = -1;
+    m_Master = -1;
+}
+
+int Device::connect()
+{
+    if (m_Path.empty())
+        return -1;
+
+    int fd = open(m_Path.c_str(), O_RDWR | O_NOCTTY);
+    if (fd < 0)
+        return -1;
+
+    if (!makeRaw(fd))
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void Device::sleepMicros(uint64_t us)
+{
+    if (us > 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void Device::replayLoop()
+{
+    uint8_t buffer[512];
+
+    while (m_Running)
+    {
+        // Anything the device says on its own, or in reply to the last request
+        if (!sendReplies())
+            break;
+
+        struct pollfd pfd = { m_Master, POLLIN, 0 };
+        int rc = poll(&pfd, 1, POLL_INTERVAL_MS);
+        if (rc < 0 && errno != EINTR)
+            break;
+        if (rc <= 0)
+            continue;
+
+        ssize_t n = read(m_Master, buffer, sizeof(buffer));
+        if (n < 0)
+        {
+            // EIO while no slave is open, wait for the driver to reconnect.
+            if (errno == EAGAIN || errno == EINTR || errno == EIO)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+                continue;
+            }
+            break;
+        }
+
+        m_BytesReceived += n;
+        m_Input.insert(m_Input.end(), buffer, buffer + n);
+
+        while (matchRequest())
+        {
+            if (!sendReplies())
+                return;
+        }
+
+        if (m_Input.size() > MAX_PENDING_INPUT)
+        {
+            m_Input.clear();
+            m_Mismatches++;
+        }
+    }
+}
+
+bool Device::sendReplies()
+{
+    const auto &steps = m_Transcript.steps();
+
+    while (m_Running)
+    {
+        if (m_Step >= steps.size())
+        {
+            if (!m_Loop || steps.empty())
+            {
+                m_Finished = true;
+                return true;
+            }
+            m_Step = 0;
+        }
+
+        const auto &step = steps[m_Step];
+        if (step.direction != Transcript::FROM_DEVICE)
+            return true;
+
+        sleepMicros(static_cast<uint64_t>(step.delay_us * m_TimeScale));
+
+        // 10 bits per byte with start and stop bits
+        uint32_t baud = m_BaudRate;
+        if (baud > 0)
+            sleepMicros(step.bytes.size() * 10000000ULL / baud);
+
+        size_t written = 0;
+        while (written < step.bytes.size())
+        {
+            ssize_t n = write(m_Master, step.bytes.data() + written, step.bytes.size() - written);
+            if (n < 0)
+            {
+                if (errno == EAGAIN || errno == EINTR)
+                    continue;
+                return false;
+            }
+            written += n;
+        }
+
+        m_BytesSent += written;
+        m_Step++;
+    }
+
+    return false;
+}
+
+bool Device::matchRequest()
+{
+    const auto &steps = m_Transcript.steps();
+    if (m_Input.empty() || m_Step >= steps.size())
+    {
+        // Nothing left to answer, swallow whatever the driver sends.
+        if (m_Step >= steps.size())
+            m_Input.clear();
+        return false;
+    }
+
+    const auto &expected = steps[m_Step].bytes;
+    auto found = std::search(m_Input.begin(), m_Input.end(), expected.begin(), expected.end());
+    if (found != m_Input.end())
+    {
+        if (found != m_Input.begin())
+            m_Mismatches++;
+        m_Input.erase(m_Input.begin(), found + expected.size());
+        m_Step++;
+        return true;
+    }
+
+    // Not there yet, unless the driver already sent something else entirely.
+    if (m_Input.size() < expected.size())
+        return false;
+
+    for (size_t i = 0; i < steps.size(); i++)
+    {
+        if (steps[i].direction != Transcript::TO_DEVICE)
+            continue;
+
+        auto other = std::search(m_Input.begin(), m_Input.end(), steps[i].bytes.begin(), steps[i].bytes.end());
+        if (other == m_Input.end())
+            continue;
+
+        m_Mismatches++;
+        m_Input.erase(m_Input.begin(), other + steps[i].bytes.size());
+        m_Step = i + 1;
+        return true;
+    }
+
+    return false;
+}
+
+}
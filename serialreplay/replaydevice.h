@@ -0,0 +1,173 @@
+/*******************************************************************************
+ Serial Replay Test Bench
+
+ A pseudo terminal that plays back recorded device transcripts so serial
+ protocol drivers can be exercised and benchmarked without hardware.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SerialReplay
+{
+
+/**
+ * @brief A recorded exchange between a driver and its device.
+ *
+ * Transcripts are plain text, one step per line:
+ *
+ *     # comment
+ *     > 01 02 07 F7              bytes the driver is expected to send
+ *     < @1800 01 0B 87 ...       bytes the device sends, 1800us after the previous step
+ *     > ":j1\r"                  quoted strings accept \r \n \t \\ \" and \xNN escapes
+ *
+ * Hex bytes and quoted strings may be mixed on one line. The delay is optional
+ * and defaults to no delay.
+ */
+class Transcript
+{
+    public:
+        enum Direction
+        {
+            TO_DEVICE,
+            FROM_DEVICE
+        };
+
+        struct Step
+        {
+            Direction direction;
+            std::vector<uint8_t> bytes;
+            uint32_t delay_us;
+        };
+
+        /** Parse transcript text, throws std::invalid_argument on syntax errors. */
+        static Transcript parse(const std::string &text);
+        /** Load and parse a transcript file, throws std::runtime_error if it cannot be read. */
+        static Transcript load(const std::string &path);
+
+        void add(Direction direction, const std::vector<uint8_t> &bytes, uint32_t delay_us = 0);
+        void add(Direction direction, const std::string &bytes, uint32_t delay_us = 0);
+
+        const std::vector<Step> &steps() const
+        {
+            return m_Steps;
+        }
+
+    private:
+        std::vector<Step> m_Steps;
+};
+
+/**
+ * @brief Fake serial device on a pseudo terminal.
+ *
+ * The device runs its own thread on the master side of the pty. Requests from
+ * the driver are matched against the transcript in order, and the replies that
+ * follow them are written back after their recorded delay. When a request does
+ * not match, the device looks it up elsewhere in the transcript and carries on
+ * from there, counting a mismatch.
+ */
+class Device
+{
+    public:
+        explicit Device(const Transcript &transcript);
+        ~Device();
+
+        Device(const Device &) = delete;
+        Device &operator=(const Device &) = delete;
+
+        /** Create the pty and start replaying. Returns false if the pty cannot be created. */
+        bool start();
+        void stop();
+
+        /** Path of the slave side, for drivers that open the port by name. */
+        const std::string &path() const
+        {
+            return m_Path;
+        }
+
+        /** Open a raw file descriptor on the slave side. The caller closes it. */
+        int connect();
+
+        /** Restart from the top of the transcript when it runs out. */
+        void setLoop(bool enable)
+        {
+            m_Loop = enable;
+        }
+        /** Multiply recorded delays, 0 replies as fast as possible. */
+        void setTimeScale(double scale)
+        {
+            m_TimeScale = scale;
+        }
+        /** Pace replies as if sent at this baud rate, 0 disables pacing. */
+        void setBaudRate(uint32_t baud)
+        {
+            m_BaudRate = baud;
+        }
+
+        uint64_t bytesReceived() const
+        {
+            return m_BytesReceived;
+        }
+        uint64_t bytesSent() const
+        {
+            return m_BytesSent;
+        }
+        uint32_t mismatches() const
+        {
+            return m_Mismatches;
+        }
+        /** True once a non-looping transcript has been played to the end. */
+        bool finished() const
+        {
+            return m_Finished;
+        }
+
+    private:
+        void replayLoop();
+        bool sendReplies();
+        bool matchRequest();
+        void sleepMicros(uint64_t us);
+
+        Transcript m_Transcript;
+        std::string m_Path;
+        int m_Master { -1 };
+        // Held open so the master does not see a hangup between driver connections.
+        int m_Slave { -1 };
+
+        std::thread m_Thread;
+        std::atomic_bool m_Running { false };
+
+        size_t m_Step { 0 };
+        std::vector<uint8_t> m_Input;
+
+        std::atomic_bool m_Loop { false };
+        std::atomic<double> m_TimeScale { 1.0 };
+        std::atomic<uint32_t> m_BaudRate { 0 };
+
+        std::atomic<uint64_t> m_BytesReceived { 0 };
+        std::atomic<uint64_t> m_BytesSent { 0 };
+        std::atomic<uint32_t> m_Mismatches { 0 };
+        std::atomic_bool m_Finished { false };
+};
+
+}